@@ -1,7 +1,44 @@
 #include <csp/csplib/data/Archive.h>
 
+#include <algorithm>
+#include <cstring>
+
 namespace csp {
 
+#if (CSP_BYTE_ORDER != CSP_LE)
+namespace {
+
+// Reverse the byte order of each word of an array (between little-endian and
+// big-endian).
+void swapWords(void *data, uint32_t bytes, int size) {
+	uint8_t *p = static_cast<uint8_t*>(data);
+	switch (size) {
+		case 2:
+			for (uint32_t i = 0; i < bytes; i += 2) {
+				uint16_t *x = reinterpret_cast<uint16_t*>(p + i);
+				*x = CSP_UINT16_SWAP_LE_BE(*x);
+			}
+			break;
+		case 4:
+			for (uint32_t i = 0; i < bytes; i += 4) {
+				uint32_t *x = reinterpret_cast<uint32_t*>(p + i);
+				*x = CSP_UINT32_SWAP_LE_BE(*x);
+			}
+			break;
+		case 8:
+			for (uint32_t i = 0; i < bytes; i += 8) {
+				uint64_t *x = reinterpret_cast<uint64_t*>(p + i);
+				*x = CSP_UINT64_SWAP_LE_BE(*x);
+			}
+			break;
+		default:
+			assert(0);
+	}
+}
+
+} // namespace
+#endif
+
 PackFile::PackFile(const char *fn, const char *mode) {
 	_f = (FILE*) fopen(fn, mode);
 	assert(_f); // XXX add error handling
@@ -162,6 +199,18 @@ Reader& Reader::operator>>(boost::asio::ip::address &x) {
 }
 
 
+void Reader::readBlock(void *data, uint32_t count, uint32_t size, int swap) {
+	if (count > static_cast<uint32_t>(_end - _read) / size) throw DataUnderflow();
+	const uint32_t bytes = count * size;
+	memcpy(data, _read, bytes);
+	_read += bytes;
+#if (CSP_BYTE_ORDER != CSP_LE)
+	if (swap > 0) swapWords(data, bytes, swap);
+#else
+	(void) swap;
+#endif
+}
+
 int32_t Reader::readLength() {
 	if (_read >= _end) throw DataUnderflow();
 	const uint32_t bytes = (static_cast<uint32_t>(*_read) & 3) + 1;
@@ -271,6 +320,29 @@ Writer& Writer::operator<<(const boost::asio::ip::address &y) {
 }
 
 
+void Writer::writeBlock(void const *data, uint32_t count, uint32_t size, int swap) {
+#if (CSP_BYTE_ORDER != CSP_LE)
+	if (swap > 0) {
+		// convert to little-endian in pieces to bound the temporary buffer.
+		uint8_t buffer[4096];
+		const uint8_t *bytes = static_cast<uint8_t const*>(data);
+		const uint32_t step = sizeof(buffer) / size * size;
+		for (uint32_t remaining = count * size; remaining > 0; ) {
+			const uint32_t n = std::min(remaining, step);
+			memcpy(buffer, bytes, n);
+			swapWords(buffer, n, swap);
+			write(buffer, n);
+			bytes += n;
+			remaining -= n;
+		}
+		return;
+	}
+#else
+	(void) swap;
+#endif
+	write(data, count * size);
+}
+
 void Writer::writeLength(int32_t length) {
 	assert(length >= 0 && length <= 1073741823);
 	uint32_t bf0 = static_cast<uint32_t>(length - 0x40) & 0x80000000;
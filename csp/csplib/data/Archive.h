@@ -23,12 +23,14 @@
  * @brief Classes for storing and retrieving data from data archives.
  */
 
+#include <csp/csplib/data/BaseType.h>
 #include <csp/csplib/util/Endian.h>
 #include <csp/csplib/util/Exception.h>
 #include <csp/csplib/util/HashUtility.h>
 
 #include <boost/asio.hpp>
 #include <string>
+#include <type_traits>
 #include <vector>
 #include <cstdlib>
 #include <cstdio>
@@ -42,6 +44,20 @@ CSP_EXCEPTION(DataUnderflow)
 CSP_EXCEPTION(ConstViolation)
 CSP_EXCEPTION(SerializeError)
 
+// Standard types with a fixed size encoding.  Integers are stored little-endian,
+// floating point values in native byte order.
+template <> struct ArchiveTraits<char>: ArchiveBulk<0> {};
+template <> struct ArchiveTraits<int8_t>: ArchiveBulk<0> {};
+template <> struct ArchiveTraits<uint8_t>: ArchiveBulk<0> {};
+template <> struct ArchiveTraits<int16_t>: ArchiveBulk<2> {};
+template <> struct ArchiveTraits<uint16_t>: ArchiveBulk<2> {};
+template <> struct ArchiveTraits<int32_t>: ArchiveBulk<4> {};
+template <> struct ArchiveTraits<uint32_t>: ArchiveBulk<4> {};
+template <> struct ArchiveTraits<int64_t>: ArchiveBulk<8> {};
+template <> struct ArchiveTraits<uint64_t>: ArchiveBulk<8> {};
+template <> struct ArchiveTraits<float>: ArchiveBulk<0> {};
+template <> struct ArchiveTraits<double>: ArchiveBulk<0> {};
+
 /** A trivial FILE * wrapper to provide a uniform file interface for both C++
  *  and Python.
  */
@@ -81,6 +97,20 @@ class CSPLIB_EXPORT Reader {
 	DataArchive *_data_archive;
 	bool _load_all;
 
+#ifndef SWIG
+	void readBlock(void *data, uint32_t count, uint32_t size, int swap);
+
+	template <typename T>
+	void readArray(T *values, uint32_t n, std::true_type) {
+		readBlock(values, n, sizeof(T), ArchiveTraits<T>::Swap);
+	}
+
+	template <typename T>
+	void readArray(T *values, uint32_t n, std::false_type) {
+		for (uint32_t i = 0; i < n; ++i) *this >> values[i];
+	}
+#endif // SWIG
+
 protected:
 	Reader(uint8_t const *buffer, uint32_t length, DataArchive *data_archive=0, bool load_all=false);
 
@@ -113,6 +143,17 @@ public:
 
 	int32_t readLength();
 
+#ifndef SWIG
+	/** Read an array of values, equivalent to reading each value in turn.
+	 *  Arrays of types marked as bulk by ArchiveTraits are copied directly
+	 *  from the buffer.
+	 */
+	template <typename T>
+	void readArray(T *values, uint32_t n) {
+		readArray(values, n, std::integral_constant<bool, ArchiveTraits<T>::Bulk>());
+	}
+#endif // SWIG
+
 	// explicit methods for use from Python
 
 #ifdef SWIG
@@ -187,8 +228,18 @@ template<typename T>
 inline Reader& operator>>(Reader& reader, std::vector<T> &y) {
 	int32_t n = reader.readLength();
 	y.resize(n);
-	typename std::vector<T>::iterator i = y.begin();
-	while (n-- > 0) reader >> (*i++);
+	if (n > 0) reader.readArray(&y[0], n);
+	return reader;
+}
+
+inline Reader& operator>>(Reader& reader, std::vector<bool> &y) {
+	int32_t n = reader.readLength();
+	y.resize(n);
+	for (int32_t i = 0; i < n; ++i) {
+		bool x;
+		reader >> x;
+		y[i] = x;
+	}
 	return reader;
 }
 
@@ -198,6 +249,20 @@ inline Reader& operator>>(Reader& reader, std::vector<T> &y) {
  * to a data source.
  */
 class CSPLIB_EXPORT Writer {
+#ifndef SWIG
+	void writeBlock(void const *data, uint32_t count, uint32_t size, int swap);
+
+	template <typename T>
+	void writeArray(T const *values, uint32_t n, std::true_type) {
+		writeBlock(values, n, sizeof(T), ArchiveTraits<T>::Swap);
+	}
+
+	template <typename T>
+	void writeArray(T const *values, uint32_t n, std::false_type) {
+		for (uint32_t i = 0; i < n; ++i) *this << values[i];
+	}
+#endif // SWIG
+
 protected:
 	virtual void write(void const* data, uint32_t bytes)=0;
 
@@ -224,6 +289,17 @@ public:
 
 	void writeLength(int32_t length);
 
+#ifndef SWIG
+	/** Write an array of values, equivalent to writing each value in turn.
+	 *  Arrays of types marked as bulk by ArchiveTraits are written with a
+	 *  single call to write() (on little-endian hosts).
+	 */
+	template <typename T>
+	void writeArray(T const *values, uint32_t n) {
+		writeArray(values, n, std::integral_constant<bool, ArchiveTraits<T>::Bulk>());
+	}
+#endif // SWIG
+
 	// explicit packing (use from python)
 
 #ifdef SWIG
@@ -274,8 +350,13 @@ inline Writer& operator<<(Writer &writer, BASETYPE const &x) {
 template<typename T>
 inline Writer& operator<<(Writer &writer, std::vector<T> const &x) {
 	writer.writeLength(x.size());
-	typename std::vector<T>::const_iterator i = x.begin();
-	for (; i != x.end(); ++i) writer << (*i);
+	if (!x.empty()) writer.writeArray(&x[0], x.size());
+	return writer;
+}
+
+inline Writer& operator<<(Writer &writer, std::vector<bool> const &x) {
+	writer.writeLength(x.size());
+	for (std::vector<bool>::const_iterator i = x.begin(); i != x.end(); ++i) writer << static_cast<bool>(*i);
 	return writer;
 }
 
@@ -306,6 +387,28 @@ private:
 };
 
 
+/** Utility class for serializing objects to memory.
+ *
+ *  Used by the data compiler to serialize objects in parallel before
+ *  they are written to a data archive.
+ */
+class CSPLIB_EXPORT ArchiveStringWriter: public Writer {
+public:
+	ArchiveStringWriter(): Writer() { }
+
+	/** The serialized data. */
+	std::string const &str() const { return _buffer; }
+
+protected:
+	virtual void write(const void* x, uint32_t n) {
+		_buffer.append(reinterpret_cast<const char*>(x), n);
+	}
+
+private:
+	std::string _buffer;
+};
+
+
 /** Utility class for extracting raw data from an object archive.
  *
  *  ArchiveReader instances are created by the DataArchive class when an
@@ -77,6 +77,29 @@ class Reader;
 class Writer;
 
 
+/** Describes how arrays of a type are serialized (see Reader::readArray).
+ *
+ *  Types whose serialized form is identical to their memory layout, apart
+ *  from byte order, are marked as bulk and copied as a block.  Swap is the
+ *  size of the little-endian words that must be byte swapped on big-endian
+ *  hosts, or zero if the bytes are stored in native order.  All other types
+ *  are serialized one element at a time.
+ */
+template <typename T>
+struct ArchiveTraits {
+	static const bool Bulk = false;
+	static const int Swap = 0;
+};
+
+/** Base class for ArchiveTraits specializations of bulk types.
+ */
+template <int SWAP>
+struct ArchiveBulk {
+	static const bool Bulk = true;
+	static const int Swap = SWAP;
+};
+
+
 /** Error parsing XML cdata.
  */
 CSP_EXCEPTION(ParseException)
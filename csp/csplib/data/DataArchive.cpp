@@ -30,6 +30,8 @@
 #include <csp/csplib/util/Log.h>
 #include <csp/csplib/util/Verify.h>
 
+#include <algorithm>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
@@ -54,6 +56,25 @@ static std::string base_path(std::string const &path) {
 	return (x == std::string::npos) ? "" : std::string(path, 0, x);
 }
 
+/// Identifies the perfect hash index following the path table of contents.
+static const char IndexMagic[8] = { 'P', 'H', 'I', 'N', 'D', 'E', 'X', '1' };
+
+/// Limit on the displacements tried for each bucket when building the index.
+static const uint32_t MaxDisplacement = 1 << 20;
+
+/** Mix an object id with a seed (a 64-bit finalizer; object ids are already
+ *  hashes, but the low bits of the two halves need not be independent).
+ */
+static inline uint32_t index_hash(ObjectID const &id, uint32_t seed) {
+	uint64_t x = id.u64() ^ (static_cast<uint64_t>(seed) * 0x9e3779b97f4a7c15ULL);
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return static_cast<uint32_t>(x);
+}
+
 void DataArchive::_addEntry(int offset, int length, ObjectID hash, std::string const &path) {
 	ObjectID child_id(path);
 	TableEntry t;
@@ -64,7 +85,6 @@ void DataArchive::_addEntry(int offset, int length, ObjectID hash, std::string c
 	_table_map[child_id] = _table.size();
 	_table.push_back(t);
 	_paths.push_back(path);
-	_pathmap[child_id] = path;
 	std::string parent_path = base_path(path);
 	ObjectID parent_id(parent_path);
 	for (bool make_path = true; make_path; ) {
@@ -113,10 +133,16 @@ void DataArchive::readTable() {
 	if (static_cast<uint32_t>(n) != n_objects) {
 		throw CorruptArchive("Lookup table truncated.");
 	}
-	for (std::size_t i = 0; i < static_cast<std::size_t>(n_objects); i++) {
-		_table_map[_table[i].pathhash] = i;
-	}
 	_readPaths();
+	if (_paths.size() != _table.size()) {
+		throw CorruptArchive("Path table of contents does not match the lookup table.");
+	}
+	if (!_readIndex()) {
+		CSPLOG(Prio_INFO, Cat_ARCHIVE) << "DataArchive: no index in '" << _fn << "', building lookup table";
+		for (std::size_t i = 0; i < static_cast<std::size_t>(n_objects); i++) {
+			_table_map[_table[i].pathhash] = i;
+		}
+	}
 }
 
 void DataArchive::_readPaths() {
@@ -155,7 +181,6 @@ void DataArchive::_readPaths() {
 		std::string path = cptr;
 		cptr += path.size() + 1;
 		_paths.push_back(path);
-		_pathmap[ObjectID(path)] = path;
 		if (cptr >= toc_end && n_paths != 0) {
 			throw CorruptArchive("Path table of contents truncated.");
 		}
@@ -173,6 +198,11 @@ void DataArchive::writeTable() {
 	fwrite(&n_objects, sizeof(n_objects), 1, _f);
 	fwrite(&(_table[0]), sizeof(TableEntry), _table.size(), _f);
 	_writePaths();
+	if (_buildIndex()) {
+		_writeIndex();
+	} else {
+		CSPLOG(Prio_WARNING, Cat_ARCHIVE) << "DataArchive: unable to build index for '" << _fn << "'";
+	}
 	fseek(_f, 8, SEEK_SET);
 	fwrite(&_table_offset, sizeof(_table_offset), 1, _f);
 	_finalized = true;
@@ -209,6 +239,102 @@ void DataArchive::_writePaths() const {
 	fseek(_f, end, SEEK_SET);
 }
 
+bool DataArchive::_buildIndex() {
+	_index_displace.clear();
+	_index_slots.clear();
+
+	// if a path was added more than once, the last entry is used (as in _table_map).
+	std::vector<uint32_t> entries;
+	entries.reserve(_table_map.size());
+	for (TableMap::const_iterator iter = _table_map.begin(); iter != _table_map.end(); ++iter) {
+		entries.push_back(static_cast<uint32_t>(iter->second));
+	}
+	const uint32_t n_slots = static_cast<uint32_t>(entries.size());
+	if (n_slots == 0) return true;
+	const uint32_t n_buckets = n_slots / 2 + 1;
+
+	std::vector<std::vector<uint32_t> > buckets(n_buckets);
+	for (unsigned i = 0; i < entries.size(); ++i) {
+		buckets[index_hash(_table[entries[i]].pathhash, 0) % n_buckets].push_back(entries[i]);
+	}
+	// place the largest buckets first, while most slots are still free.
+	std::vector<uint32_t> order(n_buckets);
+	for (uint32_t i = 0; i < n_buckets; ++i) order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&buckets](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+	const uint32_t Empty = 0xffffffff;
+	std::vector<uint32_t> displace(n_buckets, 0);
+	std::vector<uint32_t> slots(n_slots, Empty);
+	std::vector<uint32_t> placed;
+	for (uint32_t i = 0; i < n_buckets; ++i) {
+		std::vector<uint32_t> const &bucket = buckets[order[i]];
+		if (bucket.empty()) break;
+		bool done = false;
+		for (uint32_t d = 1; d < MaxDisplacement && !done; ++d) {
+			placed.clear();
+			for (unsigned j = 0; j < bucket.size(); ++j) {
+				const uint32_t slot = index_hash(_table[bucket[j]].pathhash, d) % n_slots;
+				if (slots[slot] != Empty || std::find(placed.begin(), placed.end(), slot) != placed.end()) break;
+				placed.push_back(slot);
+			}
+			if (placed.size() == bucket.size()) {
+				for (unsigned j = 0; j < bucket.size(); ++j) slots[placed[j]] = bucket[j];
+				displace[order[i]] = d;
+				done = true;
+			}
+		}
+		if (!done) return false;
+	}
+	_index_displace.swap(displace);
+	_index_slots.swap(slots);
+	return true;
+}
+
+void DataArchive::_writeIndex() const {
+	fwrite(IndexMagic, sizeof(IndexMagic), 1, _f);
+	uint32_t size = static_cast<uint32_t>(_index_displace.size());
+	fwrite(&size, sizeof(size), 1, _f);
+	size = static_cast<uint32_t>(_index_slots.size());
+	fwrite(&size, sizeof(size), 1, _f);
+	if (!_index_slots.empty()) {
+		fwrite(&(_index_displace[0]), sizeof(uint32_t), _index_displace.size(), _f);
+		fwrite(&(_index_slots[0]), sizeof(uint32_t), _index_slots.size(), _f);
+	}
+}
+
+bool DataArchive::_readIndex() {
+	char magic[sizeof(IndexMagic)];
+	if (fread(magic, sizeof(magic), 1, _f) != 1 || memcmp(magic, IndexMagic, sizeof(magic)) != 0) {
+		return false;
+	}
+	uint32_t n_buckets, n_slots;
+	if (fread(&n_buckets, sizeof(n_buckets), 1, _f) != 1 || fread(&n_slots, sizeof(n_slots), 1, _f) != 1 || n_slots > _table.size() || n_buckets > n_slots + 1) {
+		throw CorruptArchive("Index header.");
+	}
+	if (n_slots == 0) return _table.empty();
+	_index_displace.resize(n_buckets);
+	_index_slots.resize(n_slots);
+	if (fread(&(_index_displace[0]), sizeof(uint32_t), n_buckets, _f) != n_buckets || fread(&(_index_slots[0]), sizeof(uint32_t), n_slots, _f) != n_slots) {
+		throw CorruptArchive("Index truncated.");
+	}
+	for (uint32_t i = 0; i < n_slots; ++i) {
+		if (_index_slots[i] >= _table.size()) throw CorruptArchive("Index entry out of range.");
+	}
+	return true;
+}
+
+int DataArchive::_findEntry(ObjectID const &id) const {
+	if (_index_slots.empty()) {
+		TableMap::const_iterator iter = _table_map.find(id);
+		return (iter == _table_map.end()) ? -1 : static_cast<int>(iter->second);
+	}
+	const uint32_t n_buckets = static_cast<uint32_t>(_index_displace.size());
+	const uint32_t n_slots = static_cast<uint32_t>(_index_slots.size());
+	const uint32_t d = _index_displace[index_hash(id, 0) % n_buckets];
+	const uint32_t index = _index_slots[index_hash(id, d) % n_slots];
+	return (_table[index].pathhash == id) ? static_cast<int>(index) : -1;
+}
+
 DataArchive::DataArchive(std::string const &fn, bool read, bool chain) {
 	_chain = chain;
 	_finalized = false;
@@ -250,14 +376,42 @@ DataArchive::~DataArchive() {
 
 void DataArchive::addObject(Object& a, std::string const &path) {
 	if (!_is_read && !_finalized) {
-		int offset = ftell(_f);
-		ArchiveWriter writer(_f);
 		CSPLOG(Prio_DEBUG, Cat_ARCHIVE) << "DataArchive: adding " << path << " [" << ObjectID(path) << "]";
+		ArchiveStringWriter writer;
 		a.serialize(writer);
-		int length = writer.getCount();
-		CSPLOG(Prio_DEBUG, Cat_ARCHIVE) << "DataArchive: stored " << length << " bytes (" << path << ")";
-		_addEntry(offset, length, a.getClassHash(), path);
+		addObjectData(path, a.getClassHash(), writer.str());
+	}
+}
+
+void DataArchive::addObjectData(std::string const &path, ObjectID const &classhash, std::string const &data) {
+	if (_is_read || _finalized) return;
+	const hasht key = hash_string(data);
+	DataMap::const_iterator iter = _data_map.find(key);
+	if (iter != _data_map.end() && _table[iter->second].length == data.size()) {
+		TableEntry const &t = _table[iter->second];
+		CSPLOG(Prio_DEBUG, Cat_ARCHIVE) << "DataArchive: sharing " << t.length << " bytes with " << _paths[iter->second] << " (" << path << ")";
+		_addEntry(t.offset, t.length, classhash, path);
+		return;
+	}
+	const int offset = ftell(_f);
+	if (!data.empty()) fwrite(data.data(), data.size(), 1, _f);
+	CSPLOG(Prio_DEBUG, Cat_ARCHIVE) << "DataArchive: stored " << data.size() << " bytes (" << path << ")";
+	_data_map[key] = _table.size();
+	_addEntry(offset, static_cast<int>(data.size()), classhash, path);
+}
+
+bool DataArchive::getObjectData(ObjectID const &id, ObjectID &classhash, std::string &data) {
+	assert(_is_read);
+	const int index = _findEntry(id);
+	if (index < 0) return false;
+	TableEntry const &t = _table[index];
+	classhash = t.classhash;
+	data.resize(t.length);
+	fseek(_f, t.offset, SEEK_SET);
+	if (t.length > 0 && fread(&data[0], t.length, 1, _f) != 1) {
+		throw CorruptArchive("Object data truncated.");
 	}
+	return true;
 }
 
 const LinkBase DataArchive::getObject(std::string const &path) {
@@ -275,7 +429,7 @@ std::vector<ObjectID> DataArchive::getChildren(std::string const &path) const {
 }
 
 bool DataArchive::hasObject(ObjectID const &id) const {
-	return _table_map.find(id) != _table_map.end();
+	return _findEntry(id) >= 0;
 }
 
 bool DataArchive::hasObject(std::string const & path) const {
@@ -283,9 +437,8 @@ bool DataArchive::hasObject(std::string const & path) const {
 }
 
 std::string DataArchive::getPathString(ObjectID const &id) const {
-	PathMap::const_iterator idx = _pathmap.find(id);
-	if (idx == _pathmap.end()) return "";
-	return idx->second;
+	const int index = _findEntry(id);
+	return (index < 0) ? "" : _paths[index];
 }
 
 const DataArchive::TableEntry* DataArchive::_lookupPath(Path const &path, std::string const &path_str) const {
@@ -294,8 +447,8 @@ const DataArchive::TableEntry* DataArchive::_lookupPath(Path const &path, std::s
 }
 
 const DataArchive::TableEntry* DataArchive::_lookupPath(ObjectID const &id, std::string const &path_str) const {
-	TableMap::const_iterator i = _table_map.find(id);
-	if (i == _table_map.end()) {
+	const int index = _findEntry(id);
+	if (index < 0) {
 		std::string msg = path_str;
 		if (msg.empty()) {
 			msg = getPathString(id);
@@ -306,8 +459,7 @@ const DataArchive::TableEntry* DataArchive::_lookupPath(ObjectID const &id, std:
 		CSPLOG(Prio_ERROR, Cat_ARCHIVE) << "DataArchive: path not found in '" << _fn << "' (" << msg << ") " + id.str();
 		throw IndexError(msg.c_str());
 	}
-	int idx = (*i).second;
-	return &(_table[idx]);
+	return &(_table[index]);
 }
 
 Object *DataArchive::_createObject(ObjectID classhash) {
@@ -328,18 +480,21 @@ Object *DataArchive::_createObject(ObjectID classhash) {
 // the static cache.
 
 const LinkBase DataArchive::getObject(const Path& path, std::string const &path_str) {
+	ObjectID id = (ObjectID) path.getPath();
+	const int index = _findEntry(id);
+	if (index < 0) {
+		if (_manager == 0) _lookupPath(id, path_str);  // throws IndexError
+		return _manager->getObject(path, path_str, this);
+	}
+	return _loadObject(path, path_str, index);
+}
+
+const LinkBase DataArchive::_loadObject(Path const &path, std::string const &path_str, std::size_t index) {
 	ObjectID id = (ObjectID) path.getPath();
 	// look among previously created static objects
 	LinkBase const *cached = _getStatic(id);
 	if (cached != 0) return *cached;
-	TableEntry const *t;
-	try {
-		t = _lookupPath(path, path_str);
-	}
-	catch (IndexError &) {
-		if (_manager == 0) throw;
-		return _manager->getObject(path, path_str, this);
-	}
+	TableEntry const *t = &(_table[index]);
 	CSPLOG(Prio_DEBUG, Cat_ARCHIVE) << "getObject using interface registry @ " << (&(InterfaceRegistry::getInterfaceRegistry()));
 	InterfaceProxy *proxy = InterfaceRegistry::getInterfaceRegistry().getInterface(t->classhash);
 	std::string from = path_str;
@@ -459,15 +614,12 @@ std::vector<std::string> DataArchive::getAllPathStrings() const {
 }
 
 InterfaceProxy *DataArchive::getObjectInterface(ObjectID const &id, std::string const &path) const {
-	TableEntry const *t;
-	try {
-		t = _lookupPath(id, path);
-	}
-	catch (IndexError &) {
-		if (_manager == 0) throw;
+	const int index = _findEntry(id);
+	if (index < 0) {
+		if (_manager == 0) _lookupPath(id, path);  // throws IndexError
 		return _manager->getObjectInterface(id, path, this);
 	}
-	return InterfaceRegistry::getInterfaceRegistry().getInterface(t->classhash);
+	return InterfaceRegistry::getInterfaceRegistry().getInterface(_table[index].classhash);
 }
 
 InterfaceProxy *DataArchive::getObjectInterface(std::string const &path) const {
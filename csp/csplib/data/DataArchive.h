@@ -90,8 +90,10 @@ private:
 	/** An entry in the data archive lookup table.
 	 *
 	 *  The lookup table is an index of all objects in the
-	 *  archive.  It is loaded as a hash map, providing O(1)
-	 *  access to objects in the archive.
+	 *  archive.  It is accessed through a perfect hash index
+	 *  stored in the archive (or a hash map for archives written
+	 *  without one), providing O(1) access to objects in the
+	 *  archive.
 	 */
 	struct TableEntry {
 		/// the object path identifier hash
@@ -135,18 +137,30 @@ private:
 	/// A map of all parent-child relationships in the archive.
 	ChildMap _children;
 
-	typedef HashMap<ObjectID, std::string>::Type PathMap;
-	/// A map for accessing the path string of any object id in the archive.
-	PathMap _pathmap;
-
 	typedef HashMap<ObjectID, std::size_t>::Type TableMap;
-	/// A map for finding the table index of an object id in the archive.
+	/// A map for finding the table index of an object id in the archive (write mode,
+	/// and archives without a perfect hash index).
 	TableMap _table_map;
 
+	/** A minimal perfect hash index of the table, written when the archive
+	 *  is finalized.  Object ids are hashed into buckets, and the keys in
+	 *  each bucket are mapped to distinct slots by a per-bucket displacement.
+	 *  Each slot holds the table index of one object, so a lookup costs two
+	 *  array reads and one comparison, and opening the archive requires no
+	 *  hash map construction.
+	 */
+	std::vector<uint32_t> _index_displace;
+	std::vector<uint32_t> _index_slots;
+
 	typedef HashMap<ObjectID, LinkBase>::Type CacheMap;
 	/// A map of all cached objects indexed by object id.
 	CacheMap _static_map;
 
+	typedef HashMap<hasht, std::size_t>::Type DataMap;
+	/// A map for finding the table index of serialized data by content hash (write mode).
+	DataMap _data_map;
+
+	/// The path strings of the objects, in table order.
 	std::vector<std::string> _paths;
 	
 	FILE *_f;
@@ -195,6 +209,32 @@ private:
 	 */
 	void _writePaths() const;
 
+	/** Build the perfect hash index of the object table.
+	 *
+	 *  @returns false if no index could be constructed.
+	 */
+	bool _buildIndex();
+
+	/** Write the perfect hash index to the archive.
+	 */
+	void _writeIndex() const;
+
+	/** Read the perfect hash index, if present, from the archive.
+	 *
+	 *  @returns false if the archive has no index.
+	 */
+	bool _readIndex();
+
+	/** Find the table index of an object.
+	 *
+	 *  @returns the index, or -1 if the object is not in the archive.
+	 */
+	int _findEntry(ObjectID const &id) const;
+
+	/** Create an object from a table entry.
+	 */
+	const LinkBase _loadObject(Path const &path, std::string const &path_str, std::size_t index);
+
 public:
 
 	/** Open a new data archive.
@@ -216,6 +256,26 @@ public:
 	 */
 	void addObject(Object &object, std::string const & path);
 
+	/** Add a serialized object to the archive.
+	 *
+	 *  Objects are stored by content: if identical data has already been
+	 *  added under another path, the new entry refers to the existing copy.
+	 *
+	 *  @param path the path string of the object
+	 *  @param classhash the class identifier hash of the object
+	 *  @param data the serialized object
+	 */
+	void addObjectData(std::string const &path, ObjectID const &classhash, std::string const &data);
+
+	/** Read the serialized data of an object in the archive (read mode).
+	 *
+	 *  @param id the object id
+	 *  @param classhash returns the class identifier hash of the object
+	 *  @param data returns the serialized object
+	 *  @returns false if the object is not in the archive.
+	 */
+	bool getObjectData(ObjectID const &id, ObjectID &classhash, std::string &data);
+
 	/** Write the entry table and close the data archive.
 	 *
 	 *  This should only be called after writing objects
@@ -0,0 +1,641 @@
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+/**
+ * @file DataCompiler.cpp
+ * @brief Compiles XML object definitions into a data archive.
+ */
+
+#include <csp/csplib/data/DataCompiler.h>
+#include <csp/csplib/data/Archive.h>
+#include <csp/csplib/data/DataArchive.h>
+#include <csp/csplib/data/Date.h>
+#include <csp/csplib/data/External.h>
+#include <csp/csplib/data/GeoPos.h>
+#include <csp/csplib/data/InterfaceProxy.h>
+#include <csp/csplib/data/InterfaceRegistry.h>
+#include <csp/csplib/data/Key.h>
+#include <csp/csplib/data/LUT.h>
+#include <csp/csplib/data/Link.h>
+#include <csp/csplib/data/Matrix3.h>
+#include <csp/csplib/data/Object.h>
+#include <csp/csplib/data/Quat.h>
+#include <csp/csplib/data/Real.h>
+#include <csp/csplib/data/TypeAdapter.h>
+#include <csp/csplib/data/Vector2.h>
+#include <csp/csplib/data/Vector3.h>
+#include <csp/csplib/util/FileUtility.h>
+#include <csp/csplib/util/Log.h>
+#include <csp/csplib/util/Timing.h>
+#include <csp/csplib/xml/XmlParser.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <locale>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+
+
+namespace csp {
+
+namespace {
+
+/** Included in the input hash of every object.  Change this whenever the
+ *  compiler output changes for the same inputs, to force a full rebuild.
+ */
+const char *CompilerVersion = "DataCompiler.1";
+
+/** Real::parseXML samples the shared (unsynchronized) random number
+ *  generator of the Real class.
+ */
+std::mutex RealMutex;
+
+bool endsWith(std::string const &s, std::string const &suffix) {
+	return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+/** Convert a source file path relative to the source directory to an object path. */
+std::string pathToId(std::string const &prefix, std::string path) {
+	if (endsWith(path, ".gz")) path.resize(path.size() - 3);
+	if (endsWith(path, ".xml")) path.resize(path.size() - 4);
+	std::replace(path.begin(), path.end(), '/', '.');
+	std::replace(path.begin(), path.end(), '\\', '.');
+	return prefix + ":" + path;
+}
+
+/** Convert a (possibly relative) object path to an absolute path. */
+std::string adjustPath(std::string const &base, std::string const &id) {
+	if (id.find(':') != std::string::npos) return id;
+	if (id.empty() || id[0] != '.') return base + "." + id;
+	std::string::size_type colon = base.find(':');
+	std::string prefix = (colon == std::string::npos) ? "" : base.substr(0, colon);
+	return prefix + ":" + id.substr(1);
+}
+
+std::string trim(std::string const &s) {
+	std::string::size_type start = s.find_first_not_of(" \t\r\n");
+	if (start == std::string::npos) return "";
+	std::string::size_type end = s.find_last_not_of(" \t\r\n");
+	return s.substr(start, end - start + 1);
+}
+
+/** The character data of an element (excluding child elements). */
+std::string getText(XMLNode node) {
+	std::string text;
+	const int n = node.nText();
+	for (int i = 0; i < n; ++i) {
+		if (i > 0) text += " ";
+		text += node.getText(i);
+	}
+	return text;
+}
+
+std::string getAttribute(XMLNode node, const char *name, const char *default_value = "") {
+	const char *value = node.getAttribute(name);
+	return value ? value : default_value;
+}
+
+bool readFile(std::string const &path, std::string &data) {
+	std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+	if (!file) return false;
+	std::ostringstream buffer;
+	buffer << file.rdbuf();
+	data = buffer.str();
+	return !file.bad();
+}
+
+/** Parse a whitespace separated list of numbers. */
+std::vector<double> parseNumbers(std::string const &text) {
+	std::vector<double> values;
+	std::istringstream stream(text);
+	stream.imbue(std::locale::classic());
+	double value;
+	while (stream >> value) values.push_back(value);
+	if (!stream.eof()) throw ParseException("Invalid number in list: " + trim(text));
+	return values;
+}
+
+
+/** Builds an object from its XML definition.  Mirrors the element handlers
+ *  of tools/data/parse.py.
+ */
+class ObjectBuilder {
+public:
+	ObjectBuilder(std::string const &id, std::vector<std::string> &warnings): m_Id(id), m_Warnings(warnings) {
+		std::string::size_type dot = id.rfind('.');
+		m_Base = (dot == std::string::npos) ? "" : id.substr(0, dot);
+	}
+
+	Ref<Object> buildObject(XMLNode node);
+
+	/** Collect the classes and the object paths referenced by an element
+	 *  and its children, without building any objects.
+	 */
+	void scan(XMLNode node, std::set<std::string> &classes, std::vector<std::string> &paths) const;
+
+private:
+	/** The destination of a value: a member variable, or a list member. */
+	struct Target {
+		Target(InterfaceProxy *proxy_, Object *object_, std::string const &name_, bool list_):
+			proxy(proxy_), object(object_), name(name_), list(list_) { }
+		void store(TypeAdapter const &value) const {
+			if (list) {
+				proxy->push_back(object, name, value);
+			} else {
+				proxy->set(object, name, value);
+			}
+		}
+		InterfaceProxy *proxy;
+		Object *object;
+		std::string name;
+		bool list;
+	};
+
+	void parseValue(XMLNode node, Target const &target);
+	void parseList(XMLNode node, Target const &target);
+	template <int N> void parseTable(XMLNode node, Target const &target);
+
+	template <class T> void parseBaseType(std::string const &text, Target const &target) {
+		T value;
+		value.parseXML(text.c_str());
+		target.store(TypeAdapter(value));
+	}
+
+	void parseReal(std::string const &text, Target const &target) {
+		Real value;
+		{
+			std::lock_guard<std::mutex> lock(RealMutex);
+			value.parseXML(text.c_str());
+		}
+		target.store(TypeAdapter(value));
+	}
+
+	std::string m_Id;
+	std::string m_Base;
+	std::vector<std::string> &m_Warnings;
+};
+
+Ref<Object> ObjectBuilder::buildObject(XMLNode node) {
+	const std::string classname = getAttribute(node, "class");
+	if (classname.empty()) throw ParseException("Object missing class attribute");
+	InterfaceProxy *proxy = InterfaceRegistry::getInterfaceRegistry().getInterface(classname.c_str());
+	if (!proxy) throw ParseException("Class '" + classname + "' not available");
+	if (node.getAttribute("static")) {
+		m_Warnings.push_back("'static' attribute of <Object> is deprecated.");
+	}
+	Ref<Object> object = proxy->createObject();
+	std::set<std::string> assigned;
+	const int n = node.nChildNode();
+	for (int i = 0; i < n; ++i) {
+		XMLNode child = node.getChildNode(i);
+		const std::string name = getAttribute(child, "name");
+		if (name.empty()) {
+			throw ParseException(std::string("<") + child.getName() + "> in '" + classname + "' Object missing name attribute");
+		}
+		if (!proxy->variableExists(name)) {
+			throw ParseException("Setting unknown member '" + name + "' of class '" + classname + "'");
+		}
+		parseValue(child, Target(proxy, object.get(), name, false));
+		assigned.insert(name);
+	}
+	std::vector<std::string> required = proxy->getRequiredNames();
+	std::string unassigned;
+	for (unsigned i = 0; i < required.size(); ++i) {
+		if (assigned.count(required[i]) == 0) unassigned += "\n       : " + required[i];
+	}
+	if (!unassigned.empty()) {
+		m_Warnings.push_back("'" + classname + "' Object in '" + m_Id + "' has unassigned member(s):" + unassigned);
+	}
+	object->parseXML(getText(node).c_str());
+	object->convertXML();
+	return object;
+}
+
+void ObjectBuilder::parseValue(XMLNode node, Target const &target) {
+	const std::string tag = node.getName();
+	const std::string text = getText(node);
+	if (tag == "Float") {
+		char *end = 0;
+		const double value = strtod(text.c_str(), &end);
+		if (end == text.c_str() || !trim(end).empty()) throw ParseException("Invalid <Float> value '" + text + "'");
+		target.store(TypeAdapter(value));
+	} else if (tag == "Int") {
+		char *end = 0;
+		const long value = strtol(text.c_str(), &end, 0);
+		if (end == text.c_str() || !trim(end).empty()) throw ParseException("Invalid <Int> value '" + text + "'");
+		target.store(TypeAdapter(static_cast<int>(value)));
+	} else if (tag == "Bool") {
+		std::string value = trim(text);
+		std::transform(value.begin(), value.end(), value.begin(), ::toupper);
+		if (value == "TRUE") {
+			target.store(TypeAdapter(1));
+		} else if (value == "FALSE") {
+			target.store(TypeAdapter(0));
+		} else {
+			char *end = 0;
+			const long x = strtol(value.c_str(), &end, 10);
+			if (end == value.c_str() || *end) throw ParseException("Invalid <Bool> value '" + text + "'");
+			target.store(TypeAdapter(static_cast<int>(x)));
+		}
+	} else if (tag == "String" || tag == "Enum") {
+		target.store(TypeAdapter(text));
+	} else if (tag == "Vector3") {
+		parseBaseType<Vector3>(text, target);
+	} else if (tag == "Vector2") {
+		parseBaseType<Vector2>(text, target);
+	} else if (tag == "Matrix") {
+		parseBaseType<Matrix3>(text, target);
+	} else if (tag == "Quat") {
+		parseBaseType<Quat>(text, target);
+	} else if (tag == "Date") {
+		parseBaseType<SimDate>(text, target);
+	} else if (tag == "LLA") {
+		parseBaseType<LLA>(text, target);
+	} else if (tag == "UTM") {
+		parseBaseType<UTM>(text, target);
+	} else if (tag == "ECEF") {
+		parseBaseType<ECEF>(text, target);
+	} else if (tag == "Real") {
+		parseReal(text, target);
+	} else if (tag == "Key") {
+		target.store(TypeAdapter(Key(text)));
+	} else if (tag == "Path") {
+		const std::string path = adjustPath(m_Base, trim(text));
+		target.store(TypeAdapter(LinkBase(path.c_str())));
+	} else if (tag == "External") {
+		External external;
+		external.setSource(ospath::denormalize(trim(text)).c_str());
+		target.store(TypeAdapter(external));
+	} else if (tag == "Object") {
+		Ref<Object> object = buildObject(node);
+		target.store(TypeAdapter(*object));
+	} else if (tag == "List" && !target.list) {
+		parseList(node, target);
+	} else if (tag == "Table1" && !target.list) {
+		parseTable<1>(node, target);
+	} else if (tag == "Table2" && !target.list) {
+		parseTable<2>(node, target);
+	} else if (tag == "Table3" && !target.list) {
+		parseTable<3>(node, target);
+	} else {
+		throw ParseException("Unknown child element <" + tag + ">");
+	}
+}
+
+void ObjectBuilder::parseList(XMLNode node, Target const &target) {
+	const Target item(target.proxy, target.object, target.name, true);
+	target.proxy->clear(target.object, target.name);
+	const std::string type = getAttribute(node, "type");
+	if (type.empty()) {
+		const int n = node.nChildNode();
+		for (int i = 0; i < n; ++i) parseValue(node.getChildNode(i), item);
+		return;
+	}
+	if (node.nChildNode() > 0) {
+		throw ParseException("Invalid child element <" + std::string(node.getChildNode(0).getName()) + "> in typed <List>");
+	}
+	std::istringstream stream(getText(node));
+	std::string token;
+	while (stream >> token) {
+		if (type == "int") {
+			char *end = 0;
+			const long value = strtol(token.c_str(), &end, 10);
+			if (*end) throw ParseException("Invalid int in list: '" + token + "'");
+			item.store(TypeAdapter(static_cast<int>(value)));
+		} else if (type == "float") {
+			char *end = 0;
+			const double value = strtod(token.c_str(), &end);
+			if (*end) throw ParseException("Invalid float in list: '" + token + "'");
+			item.store(TypeAdapter(value));
+		} else if (type == "real") {
+			parseReal(token, item);
+		} else if (type == "key") {
+			item.store(TypeAdapter(Key(token)));
+		} else {
+			throw ParseException("Unknown LIST type (" + type + ")");
+		}
+	}
+}
+
+template <int N>
+void ObjectBuilder::parseTable(XMLNode node, Target const &target) {
+	std::vector<std::vector<float> > breaks(N);
+	std::vector<int> spacing(N, 0);
+	std::vector<bool> have_breaks(N, false);
+	std::vector<float> values;
+	bool have_values = false;
+	const int n = node.nChildNode();
+	for (int i = 0; i < n; ++i) {
+		XMLNode child = node.getChildNode(i);
+		const std::string tag = child.getName();
+		std::vector<double> data = parseNumbers(getText(child));
+		double scale = 1.0;
+		if (child.getAttribute("scale")) scale = atof(child.getAttribute("scale"));
+		if (tag == "Values") {
+			values.resize(data.size());
+			for (unsigned j = 0; j < data.size(); ++j) values[j] = static_cast<float>(data[j] * scale);
+			have_values = true;
+		} else if (tag.compare(0, 6, "Breaks") == 0 && tag.size() == 7 && tag[6] >= '0' && tag[6] < '0' + N) {
+			const int dim = tag[6] - '0';
+			if (!child.getAttribute("spacing")) {
+				throw ParseException("LUTHandler <" + tag + "> tag missing required attribute 'spacing'");
+			}
+			if (data.empty()) throw ParseException("LUTHandler <" + tag + "> has no breakpoints");
+			const double dx = atof(child.getAttribute("spacing")) * scale;
+			breaks[dim].resize(data.size());
+			for (unsigned j = 0; j < data.size(); ++j) breaks[dim][j] = static_cast<float>(data[j] * scale);
+			const double range = (*std::max_element(data.begin(), data.end()) - *std::min_element(data.begin(), data.end())) * scale;
+			spacing[dim] = 1 + static_cast<int>(range / dx);
+			have_breaks[dim] = true;
+		} else {
+			throw ParseException("Invalid child element <" + tag + "> in <" + node.getName() + ">");
+		}
+	}
+	std::size_t total = 1;
+	for (int i = 0; i < N; ++i) {
+		if (!have_breaks[i]) throw ParseException(std::string("LUTHandler required tag(s) missing: Breaks") + char('0' + i));
+		total *= breaks[i].size();
+	}
+	if (!have_values) throw ParseException("LUTHandler required tag(s) missing: Values");
+	if (values.size() != total) {
+		std::ostringstream msg;
+		msg << "LUTHandler value count does not match breakpoint count (" << values.size() << " vs " << total << ")";
+		throw ParseException(msg.str());
+	}
+	Interpolation::Modes mode;
+	std::string method = getAttribute(node, "method", "linear");
+	std::transform(method.begin(), method.end(), method.begin(), ::toupper);
+	if (method == "LINEAR") {
+		mode = Interpolation::LINEAR;
+	} else if (method == "SPLINE") {
+		mode = Interpolation::SPLINE;
+	} else {
+		throw ParseException("LUTHandler: unknown interpolation method '" + method + "'");
+	}
+	LUT<N, float> table;
+	table.load(values, breaks);
+	table.interpolate(spacing, mode);
+	target.store(TypeAdapter(table));
+}
+
+void ObjectBuilder::scan(XMLNode node, std::set<std::string> &classes, std::vector<std::string> &paths) const {
+	const std::string tag = node.getName();
+	if (tag == "Object") {
+		classes.insert(getAttribute(node, "class"));
+	} else if (tag == "Path") {
+		paths.push_back(adjustPath(m_Base, trim(getText(node))));
+	}
+	const int n = node.nChildNode();
+	for (int i = 0; i < n; ++i) scan(node.getChildNode(i), classes, paths);
+}
+
+} // namespace
+
+
+/** The source and output of one object. */
+struct DataCompiler::Unit {
+	Unit(std::string const &file_, std::string const &id_): file(file_), id(id_), reuse(false) { }
+	bool operator<(Unit const &other) const { return id < other.id; }
+	std::string file;
+	std::string id;
+	hasht key;
+	bool reuse;
+	ObjectID classhash;
+	std::string data;
+	std::vector<std::string> paths;
+	std::vector<std::string> warnings;
+	std::string error;
+};
+
+struct DataCompiler::Context {
+	Context(std::vector<Unit> &units_): units(units_), next(0) { }
+	std::vector<Unit> &units;
+	std::atomic<unsigned> next;
+};
+
+
+DataCompiler::DataCompiler():
+	m_Threads(0),
+	m_Incremental(true),
+	m_Built(0),
+	m_Reused(0),
+	m_Warnings(0),
+	m_Errors(0) {
+}
+
+DataCompiler::~DataCompiler() {
+}
+
+void DataCompiler::findSources(std::string const &source, std::string const &directory, std::string const &prefix, std::vector<Unit> &units) const {
+	ospath::DirectoryContents entries = ospath::getDirectoryContents(ospath::join(source, directory));
+	std::sort(entries.begin(), entries.end());
+	for (unsigned i = 0; i < entries.size(); ++i) {
+		std::string const &entry = entries[i];
+		if (entry.empty() || entry[0] == '.') continue;
+		const std::string relative = directory.empty() ? entry : directory + "/" + entry;
+		const std::string path = ospath::join(source, relative);
+		if (endsWith(entry, ".xml") || endsWith(entry, ".xml.gz")) {
+			units.push_back(Unit(path, pathToId(prefix, relative)));
+		} else if (ospath::isdir(path)) {
+			findSources(source, relative, prefix, units);
+		}
+	}
+}
+
+void DataCompiler::loadPrevious(std::string const &archive) {
+	m_Manifest.clear();
+	m_Previous.reset();
+	if (!m_Incremental) return;
+	std::ifstream manifest((archive + ".inputs").c_str());
+	if (!manifest || !ospath::exists(archive)) return;
+	std::string line;
+	while (std::getline(manifest, line)) {
+		std::istringstream stream(line);
+		uint64_t key;
+		std::string id;
+		if (stream >> std::hex >> key >> id) m_Manifest[id] = key;
+	}
+	try {
+		m_Previous.reset(new DataArchive(archive, /*read=*/true, /*chain=*/false));
+	} catch (Exception &e) {
+		CSPLOG(Prio_WARNING, Cat_ARCHIVE) << "DataCompiler: unable to read previous archive " << archive << " (" << e.getMessage() << "); rebuilding all objects";
+		e.clear();
+		m_Manifest.clear();
+	}
+}
+
+void DataCompiler::process(Unit &unit) const {
+	if (endsWith(unit.file, ".gz")) {
+		unit.error = "compressed sources are not supported";
+		return;
+	}
+	std::string source;
+	if (!readFile(unit.file, source)) {
+		unit.error = "unable to read source file";
+		return;
+	}
+	XMLResults results;
+	XMLNode root = XMLNode::parseString(source.c_str(), "Object", &results);
+	if (results.error != eXMLErrorNone) {
+		std::ostringstream msg;
+		msg << "[line " << results.nLine << ", col " << results.nColumn << "] " << XMLNode::getError(results.error);
+		unit.error = msg.str();
+		return;
+	}
+
+	// the inputs of an object are its source and the interfaces of the
+	// classes it instantiates (the class hash changes with the interface).
+	ObjectBuilder builder(unit.id, unit.warnings);
+	std::set<std::string> classes;
+	builder.scan(root, classes, unit.paths);
+	std::string inputs = source;
+	inputs += CompilerVersion;
+	for (std::set<std::string>::const_iterator iter = classes.begin(); iter != classes.end(); ++iter) {
+		InterfaceProxy *proxy = InterfaceRegistry::getInterfaceRegistry().getInterface(iter->c_str());
+		inputs += *iter + (proxy ? proxy->getClassHash().str() : std::string("?"));
+	}
+	unit.key = hash_string(inputs);
+
+	if (m_Previous.get()) {
+		Manifest::const_iterator previous = m_Manifest.find(unit.id);
+		if (previous != m_Manifest.end() && previous->second == unit.key.u64() && m_Previous->hasObject(unit.id)) {
+			unit.reuse = true;
+			return;
+		}
+	}
+
+	try {
+		Ref<Object> object = builder.buildObject(root);
+		ArchiveStringWriter writer;
+		object->serialize(writer);
+		unit.classhash = object->getClassHash();
+		unit.data = writer.str();
+	} catch (Exception &e) {
+		unit.error = e.getMessage();
+		e.clear();
+	} catch (std::exception &e) {
+		unit.error = e.what();
+	}
+}
+
+void DataCompiler::work(Context *context) const {
+	const unsigned n = context->units.size();
+	for (unsigned i = context->next++; i < n; i = context->next++) {
+		process(context->units[i]);
+	}
+}
+
+bool DataCompiler::write(std::vector<Unit> const &units, std::string const &archive) {
+	const std::string temporary = archive + ".tmp";
+	try {
+		DataArchive output(temporary, /*read=*/false);
+		std::string data;
+		ObjectID classhash;
+		for (unsigned i = 0; i < units.size(); ++i) {
+			Unit const &unit = units[i];
+			if (unit.reuse) {
+				m_Previous->getObjectData(unit.id, classhash, data);
+				output.addObjectData(unit.id, classhash, data);
+				++m_Reused;
+			} else {
+				output.addObjectData(unit.id, unit.classhash, unit.data);
+				++m_Built;
+			}
+		}
+		output.finalize();
+	} catch (Exception &e) {
+		CSPLOG(Prio_ERROR, Cat_ARCHIVE) << "DataCompiler: error writing " << temporary << ": " << e.getMessage();
+		e.clear();
+		++m_Errors;
+		return false;
+	}
+	m_Previous.reset();
+	std::remove(archive.c_str());
+	if (std::rename(temporary.c_str(), archive.c_str()) != 0) {
+		CSPLOG(Prio_ERROR, Cat_ARCHIVE) << "DataCompiler: unable to rename " << temporary << " to " << archive;
+		++m_Errors;
+		return false;
+	}
+	std::ofstream manifest((archive + ".inputs").c_str());
+	for (unsigned i = 0; i < units.size(); ++i) {
+		char key[17];
+		snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(units[i].key.u64()));
+		manifest << key << " " << units[i].id << "\n";
+	}
+	return true;
+}
+
+bool DataCompiler::compile(std::string const &source, std::string const &archive) {
+	const timing_t start = get_realtime();
+	m_Built = m_Reused = m_Warnings = m_Errors = 0;
+
+	std::string prefix = ospath::basename(archive);
+	ospath::stripFileExtension(prefix);
+	std::vector<Unit> units;
+	findSources(source, "", prefix, units);
+	std::sort(units.begin(), units.end());
+	CSPLOG(Prio_INFO, Cat_ARCHIVE) << "DataCompiler: compiling " << units.size() << " objects from " << source << " to " << archive;
+
+	loadPrevious(archive);
+
+	unsigned threads = m_Threads;
+	if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = std::max(1u, std::min<unsigned>(threads, units.size()));
+	Context context(units);
+	std::vector<std::thread> workers;
+	for (unsigned i = 1; i < threads; ++i) {
+		workers.push_back(std::thread(&DataCompiler::work, this, &context));
+	}
+	work(&context);
+	for (unsigned i = 0; i < workers.size(); ++i) workers[i].join();
+
+	// report in path order, after all objects are built.
+	std::set<std::string> ids;
+	for (unsigned i = 0; i < units.size(); ++i) ids.insert(units[i].id);
+	for (unsigned i = 0; i < units.size(); ++i) {
+		Unit const &unit = units[i];
+		for (unsigned j = 0; j < unit.warnings.size(); ++j) {
+			CSPLOG(Prio_WARNING, Cat_ARCHIVE) << unit.file << ": " << unit.warnings[j];
+			++m_Warnings;
+		}
+		if (!unit.error.empty()) {
+			CSPLOG(Prio_ERROR, Cat_ARCHIVE) << unit.file << ": " << unit.error;
+			++m_Errors;
+		}
+		for (unsigned j = 0; j < unit.paths.size(); ++j) {
+			if (ids.count(unit.paths[j]) == 0) {
+				CSPLOG(Prio_ERROR, Cat_ARCHIVE) << unit.file << ": broken path '" << unit.paths[j] << "'";
+				++m_Errors;
+			}
+		}
+	}
+	if (m_Errors > 0 || !write(units, archive)) {
+		m_Previous.reset();
+		CSPLOG(Prio_ERROR, Cat_ARCHIVE) << "DataCompiler: compile failed with " << m_Errors << " error(s)";
+		return false;
+	}
+	CSPLOG(Prio_INFO, Cat_ARCHIVE) << "DataCompiler: built " << m_Built << " and reused " << m_Reused << " objects in " << (get_realtime() - start) << " s (" << m_Warnings << " warnings)";
+	return true;
+}
+
+} // namespace csp
@@ -0,0 +1,120 @@
+#pragma once
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+/**
+ * @file DataCompiler.h
+ * @brief Compiles XML object definitions into a data archive.
+ */
+
+#include <csp/csplib/util/Export.h>
+#include <csp/csplib/util/HashUtility.h>
+#include <csp/csplib/util/Properties.h>
+#include <csp/csplib/util/ScopedPointer.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+
+namespace csp {
+
+class DataArchive;
+
+
+/** Compiles XML object definitions into a data archive.
+ *
+ *  This is a native implementation of the data compiler in tools/data.
+ *  Every XML file below the source directory defines one object, with a
+ *  path derived from the relative file path and the archive name.  For
+ *  example, vehicles/aircraft/m2k.xml compiled into sim.dar becomes
+ *  "sim:vehicles.aircraft.m2k".  Files are parsed and serialized in
+ *  parallel, and then written to the archive in path order.
+ *
+ *  Compilation is incremental.  A manifest stored next to the archive
+ *  (the archive name plus ".inputs") records a hash of the inputs of
+ *  every object: the XML source and the interfaces of the classes it
+ *  instantiates.  Objects whose inputs are unchanged are copied from the
+ *  previous archive instead of being rebuilt.  The new archive is written
+ *  to a temporary file that replaces the previous archive only if the
+ *  compile succeeds.
+ *
+ *  The interfaces of all object classes in the source data must be
+ *  registered before compiling (e.g. by registerAllObjectInterfaces).
+ */
+class CSPLIB_EXPORT DataCompiler: public NonCopyable {
+public:
+	DataCompiler();
+	~DataCompiler();
+
+	/** Set the number of threads used to build objects.  The default (0)
+	 *  uses one thread per processor.
+	 */
+	void setThreads(unsigned threads) { m_Threads = threads; }
+
+	/** Enable or disable reuse of unchanged objects from the previous
+	 *  archive.  Enabled by default.
+	 */
+	void setIncremental(bool incremental) { m_Incremental = incremental; }
+
+	/** Compile all XML files below a directory into a single archive.
+	 *  Errors and warnings are logged.
+	 *
+	 *  @param source the directory containing the XML sources.
+	 *  @param archive the path of the archive to create.
+	 *  @returns true if the archive was written.
+	 */
+	bool compile(std::string const &source, std::string const &archive);
+
+	/** The number of objects built by the last compile. */
+	unsigned numBuilt() const { return m_Built; }
+
+	/** The number of objects copied from the previous archive by the last compile. */
+	unsigned numReused() const { return m_Reused; }
+
+	/** The number of warnings reported by the last compile. */
+	unsigned numWarnings() const { return m_Warnings; }
+
+	/** The number of errors reported by the last compile. */
+	unsigned numErrors() const { return m_Errors; }
+
+private:
+	struct Unit;
+	struct Context;
+
+	typedef std::map<std::string, uint64_t> Manifest;
+
+	unsigned m_Threads;
+	bool m_Incremental;
+	unsigned m_Built;
+	unsigned m_Reused;
+	unsigned m_Warnings;
+	unsigned m_Errors;
+
+	/// Input hashes and objects from the previous compile (read only while building).
+	Manifest m_Manifest;
+	ScopedPointer<DataArchive> m_Previous;
+
+	void findSources(std::string const &source, std::string const &directory, std::string const &prefix, std::vector<Unit> &units) const;
+	void loadPrevious(std::string const &archive);
+	void work(Context *context) const;
+	void process(Unit &unit) const;
+	bool write(std::vector<Unit> const &units, std::string const &archive);
+};
+
+} // namespace csp
@@ -23,6 +23,7 @@
 
 #include <csp/csplib/data/DataManager.h>
 #include <csp/csplib/data/DataArchive.h>
+#include <csp/csplib/data/InterfaceRegistry.h>
 #include <csp/csplib/util/Log.h>
 #include <csp/csplib/util/Exception.h>
 
@@ -47,6 +48,8 @@ void DataManager::closeAll() {
 		}
 	}
 	_archives.clear();
+	_archive_map.clear();
+	_children.clear();
 }
 
 void DataManager::addArchive(DataArchive *d) {
@@ -57,18 +60,21 @@ void DataManager::addArchive(DataArchive *d) {
 			if (_archives[idx] == 0) {
 				_archives[idx] = d;
 				added = true;
+				break;
 			}
 		}
 		if (!added) {
 			_archives.push_back(d);
 		}
-		std::vector<ObjectID> ids = d->getAllObjects();
-		std::vector<ObjectID>::iterator id;
-		for (id = ids.begin(); id != ids.end(); id++) {
-			if (_archive_map.find(*id) != _archive_map.end()) {
-				CSPLOG(Prio_ERROR, Cat_ARCHIVE) << "Duplicate object ID [" << (*id) << "] adding data archive '" << d->getFileName() << "' to data manager.";
+		// merge the archive's index, so that each lookup is a single probe
+		// regardless of the number of archives.
+		_archive_map.reserve(_archive_map.size() + d->_table.size());
+		for (std::size_t i = 0; i < d->_table.size(); i++) {
+			ObjectID const &id = d->_table[i].pathhash;
+			if (_archive_map.find(id) != _archive_map.end()) {
+				CSPLOG(Prio_ERROR, Cat_ARCHIVE) << "Duplicate object ID [" << id << "] adding data archive '" << d->getFileName() << "' to data manager.";
 			}
-			_archive_map[*id] = idx;
+			_archive_map[id] = Entry(idx, d->_findEntry(id));
 		}
 		d->setManager(this);
 		DataArchive::ChildMap const &map = d->getChildMap();
@@ -102,7 +108,7 @@ bool DataManager::hasObject(std::string const & path) const {
 std::string DataManager::getPathString(ObjectID const &id) const {
 	ArchiveMap::const_iterator idx = _archive_map.find(id);
 	if (idx == _archive_map.end()) return "";
-	return _archives[idx->second]->getPathString(id);
+	return _archives[idx->second.archive]->_paths[idx->second.index];
 }
 
 const LinkBase DataManager::getObject(std::string const &path) {
@@ -115,8 +121,8 @@ const LinkBase DataManager::getObject(Path const& path, std::string const &path_
 
 const LinkBase DataManager::getObject(Path const& path, std::string const &path_str, DataArchive const *d) const {
 	hasht id = (hasht) path.getPath();
-	DataArchive *archive = findArchive(id, path_str, d);
-	return archive->getObject(path, path_str);
+	Entry const &entry = findEntry(id, path_str, d);
+	return _archives[entry.archive]->_loadObject(path, path_str, entry.index);
 }
 
 void DataManager::cleanStatic() {
@@ -136,16 +142,16 @@ InterfaceProxy *DataManager::getObjectInterface(std::string const &path) const {
 }
 
 InterfaceProxy *DataManager::getObjectInterface(ObjectID const &id, std::string const &path_str, DataArchive const *d) const {
-	DataArchive *archive = findArchive(id, path_str, d);
-	return archive->getObjectInterface(id);
+	Entry const &entry = findEntry(id, path_str, d);
+	return InterfaceRegistry::getInterfaceRegistry().getInterface(_archives[entry.archive]->_table[entry.index].classhash);
 }
 
-DataArchive *DataManager::findArchive(ObjectID const &id, std::string const &path_str, DataArchive const *d) const {
+DataManager::Entry const &DataManager::findEntry(ObjectID const &id, std::string const &path_str, DataArchive const *d) const {
 	ArchiveMap::const_iterator idx = _archive_map.find(id);
 	DataArchive *archive = 0;
 	if (idx != _archive_map.end()) {
-		assert(idx->second < _archives.size());
-		archive = _archives[idx->second];
+		assert(idx->second.archive < _archives.size());
+		archive = _archives[idx->second.archive];
 	}
 	if (archive == 0 || archive == d) {
 		std::string msg = path_str;
@@ -153,10 +159,10 @@ DataArchive *DataManager::findArchive(ObjectID const &id, std::string const &pat
 			msg = "human-readable path unavailable";
 		}
 		msg = "path not found (" + msg + ")" + id.str() + "\n";
-		CSPLOG(Prio_ERROR, Cat_ARCHIVE) << "DataManager::findArchive() : " << msg;
+		CSPLOG(Prio_ERROR, Cat_ARCHIVE) << "DataManager::findEntry() : " << msg;
 		throw IndexError(msg.c_str());
 	}
-	return archive;
+	return idx->second;
 }
 
 } // namespace csp
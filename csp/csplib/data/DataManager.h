@@ -141,12 +141,6 @@ public:
 	void closeAll();
 
 private:
-	/** Find the archive that holds the specified object.
-	 *
-	 *  Throws an exception if the object isn't found.
-	 */
-	DataArchive *findArchive(ObjectID const &id, std::string const &path_str, DataArchive const *d) const;
-
 	/** Create a new object from a Path instance.
 	 *
 	 *  For internal use by the DataArchive class.  When a particular
@@ -175,10 +169,26 @@ private:
 	/// The collection of managed archives.
 	Archives _archives;
 
-	typedef HashMap<ObjectID, std::size_t>::Type ArchiveMap;
-	/// A map for finding the index of an archive.
+	/// The location of an object in the managed archives.
+	struct Entry {
+		Entry(): archive(0), index(0) { }
+		Entry(std::size_t archive_, std::size_t index_): archive(archive_), index(index_) { }
+		/// the index of the archive in _archives.
+		std::size_t archive;
+		/// the index of the object in the archive's lookup table.
+		std::size_t index;
+	};
+
+	typedef HashMap<ObjectID, Entry>::Type ArchiveMap;
+	/// A merged index of the objects in all managed archives.
 	ArchiveMap _archive_map;
 
+	/** Find the location of the specified object.
+	 *
+	 *  Throws an exception if the object isn't found.
+	 */
+	Entry const &findEntry(ObjectID const &id, std::string const &path_str, DataArchive const *d) const;
+
 	typedef HashMap<ObjectID, std::vector<hasht> >::Type ChildMap;
 	/// A map of all parent-child relationships in the managed archives.
 	ChildMap _children;
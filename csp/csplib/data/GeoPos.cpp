@@ -26,7 +26,9 @@
 #include <csp/csplib/data/GeoPos.h>
 #include <csp/csplib/data/Archive.h>
 #include <csp/csplib/util/Math.h>
+#include <csp/csplib/util/SimdMath.h>
 
+#include <algorithm>
 #include <cmath>
 #include <sstream>
 #include <iomanip>
@@ -76,7 +78,7 @@ LLA ECEFtoLLA(ECEF const &ecef, ReferenceEllipsoid const &_ref)
 	double q = _ref.A_B * ecef.z();
 	double h = 1.0 / sqrt(p*p+q*q);
 	_iterateECEF(_lat, _alt, p, ecef.z(), p*h, q*h, ecef.z(), _ref);
-	return LLA(_lon, _lat, _alt);
+	return LLA(_lat, _lon, _alt);
 }
 
 ECEF LLAtoECEF(LLA const &lla, ReferenceEllipsoid const &_ref)
@@ -159,15 +161,16 @@ LLA UTMtoLLA(UTM const &utm, ReferenceEllipsoid const &_ref)
 }
 
 
-UTM LLAtoUTM(LLA const &lla, ReferenceEllipsoid const &_ref, char _zone)
+/** Select the UTM zone for a given position, handling the special zones
+ *  of Norway and Svalbard.  Normalizes the longitude, and sets the zone
+ *  and the longitude of the central meridian of the zone.  If _zone is
+ *  not -1 on input it is used instead of the standard zone (except in
+ *  the special zones).
+ */
+void _selectZone(double lat, double &lon, char &_zone, double &lon0)
 {
-	// central-meridian scale factor
-	static double k0 = 0.9996;
-	double lon = lla.longitude();
-	double lat = lla.latitude();
-	double lon0 = 0.0;
-	double nu, T, T2, C, CP, A, A2, A4, M, S;
-	
+	lon0 = 0.0;
+
 	//Make sure the longitude is between -180.00 .. 179.9
 	if (lon >= PI) {
 		int n = (int) (0.5 * lon / PI + 0.5);
@@ -232,6 +235,18 @@ UTM LLAtoUTM(LLA const &lla, ReferenceEllipsoid const &_ref, char _zone)
 		_zone = char((lon / PI + 1.0) * 30.0) + 1;
 		lon0 = toRadians((int(_zone) - 1)*6.0 - 180.0 + 3.0);
 	}
+}
+
+UTM LLAtoUTM(LLA const &lla, ReferenceEllipsoid const &_ref, char _zone)
+{
+	// central-meridian scale factor
+	static double k0 = 0.9996;
+	double lon = lla.longitude();
+	double lat = lla.latitude();
+	double lon0;
+	double nu, T, T2, C, CP, A, A2, A4, M, S;
+
+	_selectZone(lat, lon, _zone, lon0);
 
 	S = sin(lat);
 	C = cos(lat);
@@ -270,6 +285,241 @@ UTM LLAtoUTM(LLA const &lla, ReferenceEllipsoid const &_ref, char _zone)
 }
 
 
+
+////////////////////////////////////////////////////////////////////////////////
+// Batch conversions
+//
+// The conversion kernels below are templates that are evaluated for pairs of
+// points (simd::Vec2d) where SSE2 is available, and for single points at the
+// end of the arrays.  The formulas are those of the single point conversions
+// above, with multiple angles expanded in terms of a single sincos.
+
+namespace {
+
+// Points processed per block by the conversions that need temporary arrays.
+const unsigned BatchBlock = 64;
+
+template <typename T>
+void _LLAtoECEF(T lat, T lon, T alt, T &x, T &y, T &z, ReferenceEllipsoid const &_ref) {
+	T s_lat, c_lat, s_lon, c_lon;
+	simd::sincos(lat, s_lat, c_lat);
+	simd::sincos(lon, s_lon, c_lon);
+	// the reduced latitude is atan(B/A * tan(lat)); r * c_lat is its cosine.
+	const T r = 1.0 / simd::sqrt(c_lat * c_lat + (_ref.B2_A2 * s_lat) * s_lat);
+	const T p = (_ref.A * r + alt) * c_lat;
+	x = p * c_lon;
+	y = p * s_lon;
+	z = (_ref.B * _ref.B_A * r + alt) * s_lat;
+}
+
+template <typename T>
+void _ECEFtoLLA(T x, T y, T z, T &lat, T &lon, T &alt, ReferenceEllipsoid const &_ref) {
+	// see _iterateECEF.
+	lon = simd::atan2(y, x);
+	const T p = simd::sqrt(x * x + y * y);
+	const T q = _ref.A_B * z;
+	T h = 1.0 / simd::sqrt(p * p + q * q);
+	T x_ = p * h;
+	T y_ = q * h;
+	for (int iter = 0; ; ++iter) {
+		x_ *= _ref.A;
+		y_ *= _ref.B;
+		alt = simd::sqrt((z - y_) * (z - y_) + (p - x_) * (p - x_));
+		const T sy = _ref.A2_B2 * y_;
+		if (iter > 15) {
+			lat = simd::atan2(sy, x_);
+			break;
+		}
+		h = 1.0 / simd::sqrt(sy * sy + x_ * x_);
+		const T dz = z - y_ - alt * sy * h;
+		const T dp = p - x_ - alt * x_ * h;
+		y_ = _ref.A_B * (y_ + dz);
+		x_ = x_ + dp;
+		const T hp = 1.0 / simd::sqrt(y_ * y_ + x_ * x_);
+		x_ *= hp;
+		y_ *= hp;
+	}
+}
+
+// dlon is the longitude relative to the central meridian of the zone.
+template <typename T>
+void _LLAtoUTM(T lat, T dlon, T &easting, T &northing, ReferenceEllipsoid const &_ref) {
+	const double k0 = 0.9996;
+	T S, C;
+	simd::sincos(lat, S, C);
+	const T T1 = S / C;
+	const T T2 = T1 * T1;
+	const T nu = _ref.A / simd::sqrt(1.0 - _ref.e2 * S * S);
+	const T CP = _ref.ep2 * C * C;
+	const T A = C * dlon;
+	const T A2 = A * A;
+	const T A4 = A2 * A2;
+	const T s2 = 2.0 * S * C;
+	const T c2 = 1.0 - 2.0 * S * S;
+	const T s4 = 2.0 * s2 * c2;
+	const T c4 = 1.0 - 2.0 * s2 * s2;
+	const T s6 = s4 * c2 + c4 * s2;
+	const T M = _ref.A * (_ref.m_0 * lat + _ref.m_1 * s2 + _ref.m_2 * s4 - _ref.m_3 * s6);
+	easting = k0 * nu * (A +
+	                     (1.0 - T2 + CP) * A2 * A / 6.0 +
+	                     (5.0 + T2 * (T2 - 18.0) + 72.0 * CP - 58.0 * _ref.ep2) * A4 * A / 120.0
+	                    ) + 500000.0;
+	northing = k0 * (M +
+	                 nu * T1 * (0.5 * A2 +
+	                            (5.0 - T2 + CP * (9.0 + 4.0 * CP)) * A4 / 24.0 +
+	                            (61.0 + T2 * (T2 - 58.0) + 600.0 * CP - 330.0 * _ref.ep2) * A4 * A2 / 720.0
+	                           )
+	                );
+	northing += simd::select(lat < 0.0, T(10000000.0), T(0.0));
+}
+
+// x and y are the easting and northing without the false easting and northing.
+template <typename T>
+void _UTMtoLLA(T x, T y, T lon0, T &lat, T &lon, ReferenceEllipsoid const &_ref) {
+	const double k0 = 0.9996;
+	const T mu = y * (_ref.m_f / k0);
+	T s2, c2;
+	simd::sincos(2.0 * mu, s2, c2);
+	const T s4 = 2.0 * s2 * c2;
+	const T c4 = 1.0 - 2.0 * s2 * s2;
+	const T s6 = s4 * c2 + c4 * s2;
+	const T phi = mu + _ref.m_a * s2 + _ref.m_b * s4 + _ref.m_c * s6;
+	T S, C;
+	simd::sincos(phi, S, C);
+	const T T1 = S / C;
+	const T nu = _ref.A / simd::sqrt(1.0 - _ref.e2 * S * S);
+	const T T2 = T1 * T1;
+	const T CP = C * C * _ref.ep2;
+	const T SP = 1.0 - S * S * _ref.e2;
+	const T R = _ref.A * _ref.B2_A2 / (SP * simd::sqrt(SP));
+	const T D = x / (nu * k0);
+	const T D2 = D * D;
+	lat = phi - (nu * T1 / R) * (D2 * (0.5 - D2 * ((120.0 + 90.0 * T2 + CP * (300.0 - 120.0 * CP) - 270.0 * _ref.ep2)
+	      + (61.0 + 90.0 * T2 + 298.0 * CP + 45.0 * T2 * T2 - 252.0 * _ref.ep2 - 3.0 * CP * CP) * D2) / 720.0));
+	lon = D * (1.0 -
+	           D2 * ((1.0 + 2.0 * T2 + CP) / 6.0 -
+	                 (5.0 - CP * (2.0 + 3.0 * CP) + 8.0 * _ref.ep2 + T2 * (28.0 + 24.0 * T2)) * D2 / 120.0
+	                )
+	          ) / C + lon0;
+}
+
+} // namespace
+
+
+void LLAtoECEF(unsigned n, double const *lat, double const *lon, double const *alt, double *x, double *y, double *z, ReferenceEllipsoid const &_ref)
+{
+	unsigned i = 0;
+#ifdef CSP_SIMD_SSE2
+	for (; i + 1 < n; i += 2) {
+		simd::Vec2d x2, y2, z2;
+		_LLAtoECEF(simd::Vec2d::load(lat + i), simd::Vec2d::load(lon + i), simd::Vec2d::load(alt + i), x2, y2, z2, _ref);
+		x2.store(x + i);
+		y2.store(y + i);
+		z2.store(z + i);
+	}
+#endif
+	for (; i < n; ++i) {
+		_LLAtoECEF(lat[i], lon[i], alt[i], x[i], y[i], z[i], _ref);
+	}
+}
+
+void ECEFtoLLA(unsigned n, double const *x, double const *y, double const *z, double *lat, double *lon, double *alt, ReferenceEllipsoid const &_ref)
+{
+	unsigned i = 0;
+#ifdef CSP_SIMD_SSE2
+	for (; i + 1 < n; i += 2) {
+		simd::Vec2d lat2, lon2, alt2;
+		_ECEFtoLLA(simd::Vec2d::load(x + i), simd::Vec2d::load(y + i), simd::Vec2d::load(z + i), lat2, lon2, alt2, _ref);
+		lat2.store(lat + i);
+		lon2.store(lon + i);
+		alt2.store(alt + i);
+	}
+#endif
+	for (; i < n; ++i) {
+		_ECEFtoLLA(x[i], y[i], z[i], lat[i], lon[i], alt[i], _ref);
+	}
+}
+
+void LLAtoUTM(unsigned n, double const *lat, double const *lon, double *easting, double *northing, char *zone, char *designator, ReferenceEllipsoid const &_ref, char _zone)
+{
+	double dlon[BatchBlock];
+	for (unsigned base = 0; base < n; base += BatchBlock) {
+		const unsigned count = std::min(n - base, BatchBlock);
+		// zone selection is branchy, so it is done one point at a time.
+		for (unsigned j = 0; j < count; ++j) {
+			double lon_j = lon[base + j];
+			double lon0;
+			char zone_j = _zone;
+			_selectZone(lat[base + j], lon_j, zone_j, lon0);
+			dlon[j] = lon_j - lon0;
+			zone[base + j] = zone_j;
+			designator[base + j] = UTM::getDesignator(lat[base + j]);
+		}
+		unsigned j = 0;
+#ifdef CSP_SIMD_SSE2
+		for (; j + 1 < count; j += 2) {
+			const unsigned i = base + j;
+			simd::Vec2d easting2, northing2;
+			_LLAtoUTM(simd::Vec2d::load(lat + i), simd::Vec2d::load(dlon + j), easting2, northing2, _ref);
+			easting2.store(easting + i);
+			northing2.store(northing + i);
+		}
+#endif
+		for (; j < count; ++j) {
+			const unsigned i = base + j;
+			_LLAtoUTM(lat[i], dlon[j], easting[i], northing[i], _ref);
+		}
+	}
+}
+
+void UTMtoLLA(unsigned n, double const *easting, double const *northing, char const *zone, char const *designator, double *lat, double *lon, ReferenceEllipsoid const &_ref)
+{
+	double x[BatchBlock], y[BatchBlock], lon0[BatchBlock];
+	for (unsigned base = 0; base < n; base += BatchBlock) {
+		const unsigned count = std::min(n - base, BatchBlock);
+		for (unsigned j = 0; j < count; ++j) {
+			const unsigned i = base + j;
+			x[j] = easting[i] - 500000.0;
+			y[j] = northing[i];
+			if ((designator[i] - 'N') < 0) y[j] -= 10000000.0;
+			lon0[j] = toRadians(((zone[i] - 1) * 6.0 - 180.0 + 3.0));
+		}
+		unsigned j = 0;
+#ifdef CSP_SIMD_SSE2
+		for (; j + 1 < count; j += 2) {
+			simd::Vec2d lat2, lon2;
+			_UTMtoLLA(simd::Vec2d::load(x + j), simd::Vec2d::load(y + j), simd::Vec2d::load(lon0 + j), lat2, lon2, _ref);
+			lat2.store(lat + base + j);
+			lon2.store(lon + base + j);
+		}
+#endif
+		for (; j < count; ++j) {
+			_UTMtoLLA(x[j], y[j], lon0[j], lat[base + j], lon[base + j], _ref);
+		}
+	}
+}
+
+void ECEFtoUTM(unsigned n, double const *x, double const *y, double const *z, double *easting, double *northing, char *zone, char *designator, double *alt, ReferenceEllipsoid const &_ref)
+{
+	double lat[BatchBlock], lon[BatchBlock];
+	for (unsigned base = 0; base < n; base += BatchBlock) {
+		const unsigned count = std::min(n - base, BatchBlock);
+		ECEFtoLLA(count, x + base, y + base, z + base, lat, lon, alt + base, _ref);
+		LLAtoUTM(count, lat, lon, easting + base, northing + base, zone + base, designator + base, _ref);
+	}
+}
+
+void UTMtoECEF(unsigned n, double const *easting, double const *northing, char const *zone, char const *designator, double const *alt, double *x, double *y, double *z, ReferenceEllipsoid const &_ref)
+{
+	double lat[BatchBlock], lon[BatchBlock];
+	for (unsigned base = 0; base < n; base += BatchBlock) {
+		const unsigned count = std::min(n - base, BatchBlock);
+		UTMtoLLA(count, easting + base, northing + base, zone + base, designator + base, lat, lon, _ref);
+		LLAtoECEF(count, lat, lon, alt + base, x + base, y + base, z + base, _ref);
+	}
+}
+
+
 void SurfaceDistance(LLA const &p, LLA const &q, double &distance, double &bearing, ReferenceEllipsoid const &_ref)
 {
 	double U1 = atan2((1-_ref.f) * tan(p.latitude()), 1.0);
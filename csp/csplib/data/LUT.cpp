@@ -453,9 +453,7 @@ void LUT<N,X>::serialize(Reader &reader) {
 	reader >> x1;
 	reader >> n;
 	TableVector *_table = new TableVector(n);
-	for (int i = 0; i < n; i++) {
-		reader >> ((*_table)[i]);
-	}
+	if (n > 0) reader.readArray(&(*_table)[0], n);
 	substitute(_table);
 	InterpolationType<X>::postInterpolation(x0, x1, n-1);
 }
@@ -708,9 +706,7 @@ void LUT<1,X>::serialize(Reader &reader) {
 	reader >> x1;
 	reader >> n;
 	TableVector *_table = new TableVector(n);
-	for (int i = 0; i < n; i++) {
-		reader >> ((*_table)[i]);
-	}
+	if (n > 0) reader.readArray(&(*_table)[0], n);
 	substitute(_table);
 	InterpolationType<X>::postInterpolation(x0, x1, n-1);
 }
@@ -728,9 +724,7 @@ void LUT<1,X>::serialize(Writer &writer) const {
 	writer << this->m_X0;
 	writer << this->m_X1;
 	writer << n;
-	for (int i = 0; i < n; i++) {
-		writer << table(i);
-	}
+	if (n > 0) writer.writeArray(&table(0), n);
 }
 
 template <typename X>
@@ -92,11 +92,11 @@ LinkCore LinkCore::_serialize(Reader &reader, DataArchive* &data_archive) {
 void LinkCore::_serialize(Writer &writer) const {
 	Path::serialize(writer);
 	if (isNone()) {
-		ArchiveWriter *arc = dynamic_cast<ArchiveWriter*>(&writer);
 		// XXX temporary assert for debugging; not exactly sure yet how to
 		// handle Links outside of DataArchives.  the current idea (without
-		// the assert) is to only read and write the path.
-		assert(arc);
+		// the assert) is to only read and write the path.  objects serialized
+		// to memory by the data compiler are copied into a DataArchive.
+		assert(dynamic_cast<ArchiveWriter*>(&writer) || dynamic_cast<ArchiveStringWriter*>(&writer));
 
 		if (isNull()) {
 			// saving a null+none link is now allowed.  in the context of xml interfaces,
@@ -38,6 +38,7 @@
 #include <cassert>
 #include <cmath>
 #include <string.h>
+#include <type_traits>
 
 namespace csp {
 
@@ -97,7 +98,7 @@ public:
 
 	/** Copy constructor.
 	 */
-	Matrix3(const Matrix3& other) { set(other); }
+	Matrix3(const Matrix3&)=default;
 
 	/** Construct and initialize a matrix from a double[9] array.
 	 */
@@ -116,7 +117,7 @@ public:
 
 	/** Destructor.
 	 */
-	~Matrix3() {}
+	~Matrix3()=default;
 
 	/** Compare two matrices.
 	 *
@@ -165,11 +166,7 @@ public:
 #ifndef SWIG
 	/** Copy operator.
 	 */
-	inline Matrix3& operator = (const Matrix3& other) {
-		if (&other == this) return *this;
-		set(reinterpret_cast<double const *>(other._mat));
-		return *this;
-	}
+	Matrix3& operator = (const Matrix3&)=default;
 #endif // SWIG
 
 	/** Set this matrix from another matrix.
@@ -668,5 +665,6 @@ inline Vector3 Matrix3::preMult(const Vector3& v) const {
 
 CSPLIB_EXPORT std::ostream &operator <<(std::ostream &o, Matrix3 const &m);
 
+static_assert(std::is_trivially_copyable<Matrix3>::value, "Matrix3 must be trivially copyable");
 
 } // namespace csp
@@ -2,6 +2,8 @@
 
 #include <csp/csplib/data/BaseType.h>
 
+#include <type_traits>
+
 namespace csp {
 
 /** A two-dimensional vector class using double-precision.
@@ -12,7 +14,7 @@ class CSPLIB_EXPORT Vector2 {
 public:
 	Vector2(): _x(0.0), _y(0.0) {}
 	Vector2(double x_, double y_): _x(x_), _y(y_) {}
-	Vector2(const Vector2& v): _x(v._x), _y(v._y) {}
+	Vector2(const Vector2&)=default;
 
 	Vector2& operator=(const Vector2&)=default;
 
@@ -32,4 +34,11 @@ private:
 
 CSPLIB_EXPORT std::ostream &operator <<(std::ostream &o, Vector2 const &v);
 
+/** Vectors are serialized as their two doubles, so arrays of vectors are
+ *  copied in bulk.
+ */
+template <> struct ArchiveTraits<Vector2>: ArchiveBulk<0> {};
+static_assert(sizeof(Vector2) == 2 * sizeof(double), "Vector2 must be two packed doubles");
+static_assert(std::is_trivially_copyable<Vector2>::value, "Vector2 must be trivially copyable");
+
 }
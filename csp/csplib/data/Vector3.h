@@ -36,6 +36,7 @@
 
 #include <cmath>
 #include <cstdlib>
+#include <type_traits>
 #include <vector>
 
 
@@ -90,14 +91,11 @@ public:
 	/// Construct and initialize a new vector.
 	Vector3(double x_, double y_, double z_): _x(x_), _y(y_), _z(z_) {}
 	/// Copy constructor.
-	Vector3(const Vector3& v): _x(v._x), _y(v._y), _z(v._z) {}
+	Vector3(const Vector3&) = default;
 
 #ifndef SWIG
 	/// Copy operator.
-	const Vector3& operator = (const Vector3& v) {
-		_x=v._x; _y=v._y; _z=v._z;
-		return *this;
-	}
+	Vector3& operator = (const Vector3&) = default;
 #endif // SWIG
 
 	/// Test for equality with another vectors.
@@ -340,4 +338,11 @@ inline Vector3 operator * (double lhs, const Vector3 &rhs) { return rhs*lhs; }
 
 CSPLIB_EXPORT std::ostream &operator <<(std::ostream &o, Vector3 const &v);
 
+/** Vectors are serialized as their three doubles, so arrays of vectors are
+ *  copied in bulk.
+ */
+template <> struct ArchiveTraits<Vector3>: ArchiveBulk<0> {};
+static_assert(sizeof(Vector3) == 3 * sizeof(double), "Vector3 must be three packed doubles");
+static_assert(std::is_trivially_copyable<Vector3>::value, "Vector3 must be trivially copyable");
+
 } // namespace csp
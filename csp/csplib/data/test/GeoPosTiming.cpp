@@ -0,0 +1,108 @@
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+// Compares the throughput of the single point geodetic conversions with the
+// batch conversions over arrays of coordinates, for points spread over the
+// UTM latitude range.
+//
+// usage: geopos_timing [points] [repeats]
+
+#include <csp/csplib/data/GeoPos.h>
+#include <csp/csplib/util/Math.h>
+#include <csp/csplib/util/Timing.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace csp;
+
+namespace {
+
+void report(const char *label, double single, double batch, int points) {
+	char line[256];
+	snprintf(line, sizeof(line), "%-12s single %8.2f Mpt/s, batch %8.2f Mpt/s (%.2fx)", label, points * 1e-6 / single, points * 1e-6 / batch, single / batch);
+	std::cout << line << "\n";
+}
+
+} // namespace
+
+
+int main(int argc, char **argv) {
+	const int count = (argc > 1) ? atoi(argv[1]) : 100000;
+	const int repeats = (argc > 2) ? atoi(argv[2]) : 10;
+	const int points = count * repeats;
+
+	std::vector<double> lat(count), lon(count), alt(count);
+	srand(42);
+	for (int i = 0; i < count; ++i) {
+		lat[i] = toRadians(-80.0 + 164.0 * rand() / RAND_MAX);
+		lon[i] = toRadians(-180.0 + 360.0 * rand() / RAND_MAX);
+		alt[i] = 10000.0 * rand() / RAND_MAX;
+	}
+	std::vector<double> x(count), y(count), z(count), easting(count), northing(count), lat2(count), lon2(count), alt2(count);
+	std::vector<char> zone(count), designator(count);
+	std::vector<ECEF> ecef(count);
+	std::vector<UTM> utm(count);
+	std::vector<LLA> lla(count);
+	Timer timer;
+	double single, batch;
+
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		for (int i = 0; i < count; ++i) ecef[i] = LLAtoECEF(LLA(lat[i], lon[i], alt[i]));
+	}
+	single = timer.stop();
+	timer.start();
+	for (int r = 0; r < repeats; ++r) LLAtoECEF(count, &lat[0], &lon[0], &alt[0], &x[0], &y[0], &z[0]);
+	batch = timer.stop();
+	report("LLAtoECEF", single, batch, points);
+
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		for (int i = 0; i < count; ++i) lla[i] = ECEFtoLLA(ECEF(x[i], y[i], z[i]));
+	}
+	single = timer.stop();
+	timer.start();
+	for (int r = 0; r < repeats; ++r) ECEFtoLLA(count, &x[0], &y[0], &z[0], &lat2[0], &lon2[0], &alt2[0]);
+	batch = timer.stop();
+	report("ECEFtoLLA", single, batch, points);
+
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		for (int i = 0; i < count; ++i) utm[i] = LLAtoUTM(LLA(lat[i], lon[i], alt[i]));
+	}
+	single = timer.stop();
+	timer.start();
+	for (int r = 0; r < repeats; ++r) LLAtoUTM(count, &lat[0], &lon[0], &easting[0], &northing[0], &zone[0], &designator[0]);
+	batch = timer.stop();
+	report("LLAtoUTM", single, batch, points);
+
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		for (int i = 0; i < count; ++i) lla[i] = UTMtoLLA(UTM(easting[i], northing[i], zone[i], designator[i]));
+	}
+	single = timer.stop();
+	timer.start();
+	for (int r = 0; r < repeats; ++r) UTMtoLLA(count, &easting[0], &northing[0], &zone[0], &designator[0], &lat2[0], &lon2[0]);
+	batch = timer.stop();
+	report("UTMtoLLA", single, batch, points);
+
+	return 0;
+}
@@ -0,0 +1,127 @@
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+
+/**
+ * @file test_Archive.cpp
+ * @brief Test serialization of arrays with Reader and Writer.
+ */
+
+
+#include <csp/csplib/data/Archive.h>
+#include <csp/csplib/data/Vector3.h>
+#include <csp/csplib/util/Testing.h>
+
+#include <string>
+#include <vector>
+
+using namespace csp;
+
+
+CSP_TESTFIXTURE(Archive) {
+public:
+	// vectors written in bulk have the same encoding as their elements
+	// written one at a time, and read back unchanged.
+	template <typename T>
+	bool roundTrip(std::vector<T> const &values) {
+		ArchiveStringWriter bulk, single;
+		bulk << values;
+		single.writeLength(values.size());
+		for (unsigned i = 0; i < values.size(); ++i) single << static_cast<T>(values[i]);
+		if (bulk.str() != single.str()) return false;
+		ArchiveReader reader(bulk.str().data(), bulk.str().size());
+		std::vector<T> result;
+		reader >> result;
+		return reader.isComplete() && result == values;
+	}
+
+	CSP_TESTCASE(Vectors) {
+		std::vector<int16_t> shorts;
+		std::vector<uint32_t> words;
+		std::vector<int64_t> longs;
+		std::vector<float> floats;
+		std::vector<double> doubles;
+		std::vector<Vector3> vectors;
+		std::vector<bool> flags;
+		std::vector<std::string> strings;
+		for (int i = 0; i < 1000; ++i) {
+			shorts.push_back(static_cast<int16_t>(i * 37 - 5000));
+			words.push_back(i * 2654435761U);
+			longs.push_back(static_cast<int64_t>(i) * -123456789012LL);
+			floats.push_back(i * 0.37f);
+			doubles.push_back(i / 7.0);
+			vectors.push_back(Vector3(i, -i, i * 0.5));
+			flags.push_back(i % 3 == 0);
+			strings.push_back(std::string(i % 5, 'x'));
+		}
+		CSP_VERIFY(roundTrip(shorts));
+		CSP_VERIFY(roundTrip(words));
+		CSP_VERIFY(roundTrip(longs));
+		CSP_VERIFY(roundTrip(floats));
+		CSP_VERIFY(roundTrip(doubles));
+		CSP_VERIFY(roundTrip(vectors));
+		CSP_VERIFY(roundTrip(flags));
+		CSP_VERIFY(roundTrip(strings));
+		CSP_VERIFY(roundTrip(std::vector<double>()));
+	}
+
+	CSP_TESTCASE(Arrays) {
+		const uint16_t values[5] = { 1, 2, 0x1234, 0xfedc, 7 };
+		ArchiveStringWriter writer;
+		writer.writeArray(values, 5);
+		CSP_VERIFY_EQ(writer.str().size(), 10u);
+		// integers are stored little-endian on all hosts.
+		CSP_VERIFY_EQ(static_cast<unsigned char>(writer.str()[4]), 0x34u);
+		CSP_VERIFY_EQ(static_cast<unsigned char>(writer.str()[5]), 0x12u);
+		uint16_t result[5];
+		ArchiveReader reader(writer.str().data(), writer.str().size());
+		reader.readArray(result, 5);
+		CSP_VERIFY_EQ(result[3], 0xfedc);
+		CSP_VERIFY(reader.isComplete());
+	}
+
+	CSP_TESTCASE(Underflow) {
+		std::vector<double> values(100, 1.0);
+		ArchiveStringWriter writer;
+		writer << values;
+		ArchiveReader reader(writer.str().data(), writer.str().size() - 1);
+		std::vector<double> result;
+		CSP_VERIFY(underflows(reader, result));
+		// a count that would overflow the size computation.
+		ArchiveReader overflow(writer.str().data(), writer.str().size());
+		uint64_t word;
+		bool underflow = false;
+		try {
+			overflow.readArray(&word, 0x20000001);
+		} catch (DataUnderflow &e) {
+			e.clear();
+			underflow = true;
+		}
+		CSP_VERIFY(underflow);
+	}
+
+	bool underflows(Reader &reader, std::vector<double> &values) {
+		try {
+			reader >> values;
+		} catch (DataUnderflow &e) {
+			e.clear();
+			return true;
+		}
+		return false;
+	}
+};
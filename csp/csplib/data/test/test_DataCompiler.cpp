@@ -0,0 +1,180 @@
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+
+/**
+ * @file test_DataCompiler.cpp
+ * @brief Test compiling XML object definitions into a data archive.
+ */
+
+
+#include <csp/csplib/data/DataArchive.h>
+#include <csp/csplib/data/DataCompiler.h>
+#include <csp/csplib/data/InterfaceProxy.h>
+#include <csp/csplib/data/LUT.h>
+#include <csp/csplib/data/Link.h>
+#include <csp/csplib/data/Object.h>
+#include <csp/csplib/data/ObjectInterface.h>
+#include <csp/csplib/data/Vector3.h>
+#include <csp/csplib/util/Testing.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+
+class CompilerTestObject: public csp::Object
+{
+public:
+	CSP_DECLARE_OBJECT(CompilerTestObject)
+
+	CompilerTestObject(): _int(0), _float(0.0), _bool(false) {}
+	virtual ~CompilerTestObject() {}
+
+public:
+	int _int;
+	double _float;
+	bool _bool;
+	std::string _string;
+	csp::Vector3 _vector;
+	std::vector<float> _list;
+	csp::Table1 _table;
+	csp::Link<CompilerTestObject> _link;
+};
+
+CSP_XML_BEGIN(CompilerTestObject)
+	CSP_DEF("int", _int, true)
+	CSP_DEF("float", _float, false)
+	CSP_DEF("bool", _bool, false)
+	CSP_DEF("string", _string, false)
+	CSP_DEF("vector", _vector, false)
+	CSP_DEF("list", _list, false)
+	CSP_DEF("table", _table, false)
+	CSP_DEF("link", _link, false)
+CSP_XML_END
+
+
+CSP_TESTFIXTURE(DataCompiler) {
+public:
+
+	virtual void setupFixture() {
+		static CompilerTestObject::__csp_interface_proxy instance;
+		m_Source = "/tmp/csplib.datacompiler";
+		m_Archive = "/tmp/test.dar";
+		mkdir(m_Source.c_str(), 0755);
+		mkdir((m_Source + "/sub").c_str(), 0755);
+		std::remove(m_Archive.c_str());
+		std::remove((m_Archive + ".inputs").c_str());
+	}
+
+	void writeSource(std::string const &path, std::string const &xml) {
+		std::ofstream file((m_Source + "/" + path).c_str());
+		file << "<?xml version=\"1.0\" standalone=\"no\"?>\n" << xml << "\n";
+	}
+
+	void writeLeaf(int value) {
+		char xml[256];
+		snprintf(xml, sizeof(xml), "<Object class=\"CompilerTestObject\"><Int name=\"int\">%d</Int></Object>", value);
+		writeSource("sub/leaf.xml", xml);
+	}
+
+	CSP_TESTCASE(Compile) {
+		writeSource("sub/root.xml",
+			"<Object class=\"CompilerTestObject\">\n"
+			"  <Int name=\"int\">0x10</Int>\n"
+			"  <Float name=\"float\">2.5</Float>\n"
+			"  <Bool name=\"bool\">true</Bool>\n"
+			"  <String name=\"string\">hello</String>\n"
+			"  <Vector3 name=\"vector\">1 2 3</Vector3>\n"
+			"  <List name=\"list\" type=\"float\">1.5 2.5 3.5</List>\n"
+			"  <Table1 name=\"table\" method=\"linear\">\n"
+			"    <Breaks0 spacing=\"1.0\">0 2</Breaks0>\n"
+			"    <Values>0 4</Values>\n"
+			"  </Table1>\n"
+			"  <Path name=\"link\">leaf</Path>\n"
+			"</Object>");
+		writeSource("sub/other.xml",
+			"<Object class=\"CompilerTestObject\">\n"
+			"  <Int name=\"int\">7</Int>\n"
+			"  <Path name=\"link\">.sub.root</Path>\n"
+			"</Object>");
+		writeLeaf(42);
+
+		csp::DataCompiler compiler;
+		compiler.setThreads(2);
+		CSP_VERIFY(compiler.compile(m_Source, m_Archive));
+		CSP_VERIFY_EQ(compiler.numBuilt(), 3u);
+		CSP_VERIFY_EQ(compiler.numReused(), 0u);
+		CSP_VERIFY_EQ(compiler.numErrors(), 0u);
+		{
+			csp::DataArchive archive(m_Archive, /*read=*/true);
+			csp::Ref<CompilerTestObject> root = archive.getObject("test:sub.root");
+			CSP_VERIFY(root.valid());
+			CSP_VERIFY_EQ(root->_int, 16);
+			CSP_VERIFY_LT(std::abs(root->_float - 2.5), 1e-8);
+			CSP_VERIFY(root->_bool);
+			CSP_VERIFY_EQ(root->_string, "hello");
+			CSP_VERIFY_LT((root->_vector - csp::Vector3(1, 2, 3)).length(), 1e-8);
+			CSP_VERIFY_EQ(root->_list.size(), 3u);
+			CSP_VERIFY_LT(std::abs(root->_table.getValue(std::vector<float>(1, 1.0f)) - 2.0f), 1e-6);
+			CSP_VERIFY(root->_link.valid());
+			CSP_VERIFY_EQ(root->_link->_int, 42);
+			csp::Ref<CompilerTestObject> other = archive.getObject("test:sub.other");
+			CSP_VERIFY(other.valid());
+			CSP_VERIFY_EQ(other->_link->_int, 16);
+		}
+
+		// nothing changed; everything is copied from the previous archive.
+		CSP_VERIFY(compiler.compile(m_Source, m_Archive));
+		CSP_VERIFY_EQ(compiler.numBuilt(), 0u);
+		CSP_VERIFY_EQ(compiler.numReused(), 3u);
+
+		// only the modified object is rebuilt.
+		writeLeaf(43);
+		CSP_VERIFY(compiler.compile(m_Source, m_Archive));
+		CSP_VERIFY_EQ(compiler.numBuilt(), 1u);
+		CSP_VERIFY_EQ(compiler.numReused(), 2u);
+		{
+			csp::DataArchive archive(m_Archive, /*read=*/true);
+			csp::Ref<CompilerTestObject> leaf = archive.getObject("test:sub.leaf");
+			CSP_VERIFY(leaf.valid());
+			CSP_VERIFY_EQ(leaf->_int, 43);
+		}
+
+		// a broken path fails the compile and leaves the archive untouched.
+		writeSource("sub/broken.xml",
+			"<Object class=\"CompilerTestObject\">\n"
+			"  <Int name=\"int\">1</Int>\n"
+			"  <Path name=\"link\">.missing</Path>\n"
+			"</Object>");
+		CSP_VERIFY(!compiler.compile(m_Source, m_Archive));
+		CSP_VERIFY_EQ(compiler.numErrors(), 1u);
+		std::remove((m_Source + "/sub/broken.xml").c_str());
+		{
+			csp::DataArchive archive(m_Archive, /*read=*/true);
+			CSP_VERIFY(!archive.hasObject("test:sub.broken"));
+		}
+	}
+
+private:
+	std::string m_Source;
+	std::string m_Archive;
+};
@@ -16,8 +16,13 @@
  */
 
 #include <csp/csplib/data/GeoPos.h>
+#include <csp/csplib/util/Math.h>
 #include <csp/csplib/util/Testing.h>
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 using namespace csp;
 
 /*
@@ -66,3 +71,101 @@ CSP_TESTFIXTURE(GeoPos_LLA) {
 		CSP_EXPECT_EQ(5.5, lla.altitude());
 	}
 };
+
+// The batch conversions must agree with the single point conversions.  An odd
+// number of points is used so that both the vector and scalar paths are tested.
+CSP_TESTFIXTURE(GeoPos_Batch) {
+public:
+	virtual void setupFixture() {
+		m_Lat.clear();
+		m_Lon.clear();
+		m_Alt.clear();
+		for (int i = 0; i < 99; ++i) {
+			// UTM is defined between 80S and 84N.
+			m_Lat.push_back(toRadians(-79.5 + i * 1.63));
+			m_Lon.push_back(toRadians(-179.0 + i * 3.61));
+			m_Alt.push_back(i * 137.0);
+		}
+	}
+
+	CSP_TESTCASE(LLAToECEF) {
+		const unsigned n = m_Lat.size();
+		std::vector<double> x(n), y(n), z(n);
+		LLAtoECEF(n, &m_Lat[0], &m_Lon[0], &m_Alt[0], &x[0], &y[0], &z[0]);
+		double error = 0.0;
+		for (unsigned i = 0; i < n; ++i) {
+			ECEF ecef = LLAtoECEF(LLA(m_Lat[i], m_Lon[i], m_Alt[i]));
+			error = std::max(error, (ecef - Vector3(x[i], y[i], z[i])).length());
+		}
+		CSP_EXPECT_LT(error, 1e-6);
+	}
+
+	CSP_TESTCASE(ECEFToLLA) {
+		const unsigned n = m_Lat.size();
+		std::vector<double> x(n), y(n), z(n), lat(n), lon(n), alt(n);
+		LLAtoECEF(n, &m_Lat[0], &m_Lon[0], &m_Alt[0], &x[0], &y[0], &z[0]);
+		ECEFtoLLA(n, &x[0], &y[0], &z[0], &lat[0], &lon[0], &alt[0]);
+		double angle_error = 0.0;
+		double alt_error = 0.0;
+		double round_trip = 0.0;
+		for (unsigned i = 0; i < n; ++i) {
+			LLA lla = ECEFtoLLA(ECEF(x[i], y[i], z[i]));
+			angle_error = std::max(angle_error, std::max(std::abs(lla.latitude() - lat[i]), std::abs(lla.longitude() - lon[i])));
+			alt_error = std::max(alt_error, std::abs(lla.altitude() - alt[i]));
+			round_trip = std::max(round_trip, std::max(std::abs(m_Lat[i] - lat[i]), std::abs(m_Lon[i] - lon[i])));
+		}
+		CSP_EXPECT_LT(angle_error, 1e-12);
+		CSP_EXPECT_LT(alt_error, 1e-6);
+		CSP_EXPECT_LT(round_trip, 1e-9);
+	}
+
+	CSP_TESTCASE(LLAToUTM) {
+		const unsigned n = m_Lat.size();
+		std::vector<double> easting(n), northing(n), lat(n), lon(n);
+		std::vector<char> zone(n), designator(n);
+		LLAtoUTM(n, &m_Lat[0], &m_Lon[0], &easting[0], &northing[0], &zone[0], &designator[0]);
+		double error = 0.0;
+		for (unsigned i = 0; i < n; ++i) {
+			UTM utm = LLAtoUTM(LLA(m_Lat[i], m_Lon[i]));
+			CSP_EXPECT_EQ(utm.zone(), zone[i]);
+			CSP_EXPECT_EQ(utm.designator(), designator[i]);
+			error = std::max(error, std::max(std::abs(utm.easting() - easting[i]), std::abs(utm.northing() - northing[i])));
+		}
+		CSP_EXPECT_LT(error, 1e-6);
+
+		UTMtoLLA(n, &easting[0], &northing[0], &zone[0], &designator[0], &lat[0], &lon[0]);
+		error = 0.0;
+		for (unsigned i = 0; i < n; ++i) {
+			LLA lla = UTMtoLLA(UTM(easting[i], northing[i], zone[i], designator[i]));
+			error = std::max(error, std::max(std::abs(lla.latitude() - lat[i]), std::abs(lla.longitude() - lon[i])));
+		}
+		CSP_EXPECT_LT(error, 1e-12);
+	}
+
+	CSP_TESTCASE(ECEFToUTM) {
+		const unsigned n = m_Lat.size();
+		std::vector<double> x(n), y(n), z(n), easting(n), northing(n), alt(n);
+		std::vector<char> zone(n), designator(n);
+		LLAtoECEF(n, &m_Lat[0], &m_Lon[0], &m_Alt[0], &x[0], &y[0], &z[0]);
+		ECEFtoUTM(n, &x[0], &y[0], &z[0], &easting[0], &northing[0], &zone[0], &designator[0], &alt[0]);
+		double error = 0.0;
+		for (unsigned i = 0; i < n; ++i) {
+			UTM utm = ECEFtoUTM(ECEF(x[i], y[i], z[i]));
+			error = std::max(error, std::max(std::abs(utm.easting() - easting[i]), std::abs(utm.northing() - northing[i])));
+			error = std::max(error, std::abs(utm.altitude() - alt[i]));
+		}
+		CSP_EXPECT_LT(error, 1e-6);
+
+		std::vector<double> x2(n), y2(n), z2(n);
+		UTMtoECEF(n, &easting[0], &northing[0], &zone[0], &designator[0], &alt[0], &x2[0], &y2[0], &z2[0]);
+		error = 0.0;
+		for (unsigned i = 0; i < n; ++i) {
+			ECEF ecef = UTMtoECEF(UTM(easting[i], northing[i], zone[i], designator[i], alt[i]));
+			error = std::max(error, (ecef - Vector3(x2[i], y2[i], z2[i])).length());
+		}
+		CSP_EXPECT_LT(error, 1e-6);
+	}
+
+private:
+	std::vector<double> m_Lat, m_Lon, m_Alt;
+};
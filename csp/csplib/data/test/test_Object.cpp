@@ -24,6 +24,7 @@
 
 
 #include <csp/csplib/data/DataArchive.h>
+#include <csp/csplib/data/DataManager.h>
 #include <csp/csplib/data/InterfaceProxy.h>
 #include <csp/csplib/data/InterfaceRegistry.h>
 #include <csp/csplib/data/Link.h>
@@ -183,5 +184,47 @@ public:
 			CSP_VERIFY_LT(std::abs(sub2->_value - 3.14), 1e-8);
 		}
 	}
+
+	CSP_TESTCASE(Index) {
+		const std::string tmpfile1("/tmp/csplib.tmptest1.dar");
+		const std::string tmpfile2("/tmp/csplib.tmptest2.dar");
+		const int count = 1000;
+		for (int archive = 0; archive < 2; ++archive) {
+			csp::DataArchive ar(archive ? tmpfile2 : tmpfile1, /*read=*/false);
+			for (int i = 0; i < count; ++i) {
+				SubObject2 obj;
+				obj._value = archive * count + i;
+				ar.addObject(obj, std::string(archive ? "b" : "a") + ":objects.obj" + std::to_string(i));
+			}
+			ar.finalize();
+		}
+		{
+			csp::DataArchive ar(tmpfile1, /*read=*/true);
+			for (int i = 0; i < count; ++i) {
+				const std::string path = "a:objects.obj" + std::to_string(i);
+				CSP_VERIFY(ar.hasObject(path));
+				CSP_VERIFY_EQ(ar.getPathString(csp::ObjectID(path)), path);
+			}
+			CSP_VERIFY(!ar.hasObject("a:objects.missing"));
+			CSP_VERIFY(!ar.hasObject("b:objects.obj0"));
+			CSP_VERIFY_EQ(ar.getChildren("a:objects").size(), static_cast<std::size_t>(count));
+			csp::Ref<SubObject2> obj = ar.getObject("a:objects.obj17");
+			CSP_VERIFY(obj.valid());
+			CSP_VERIFY_EQ(obj->_value, 17.0);
+		}
+		{
+			csp::Ref<csp::DataManager> manager = new csp::DataManager;
+			manager->addArchive(new csp::DataArchive(tmpfile1, /*read=*/true));
+			manager->addArchive(new csp::DataArchive(tmpfile2, /*read=*/true));
+			CSP_VERIFY(manager->hasObject("a:objects.obj999"));
+			CSP_VERIFY(manager->hasObject("b:objects.obj0"));
+			CSP_VERIFY(!manager->hasObject("b:objects.missing"));
+			CSP_VERIFY_EQ(manager->getPathString(csp::ObjectID("b:objects.obj5")), "b:objects.obj5");
+			csp::Ref<SubObject2> obj = manager->getObject("b:objects.obj5");
+			CSP_VERIFY(obj.valid());
+			CSP_VERIFY_EQ(obj->_value, count + 5.0);
+			CSP_VERIFY(manager->getObjectInterface("a:objects.obj1") == csp::InterfaceRegistry::getInterfaceRegistry().getInterface("SubObject2"));
+		}
+	}
 };
 
@@ -0,0 +1,157 @@
+#pragma once
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+
+/**
+ * @file WorkerPool.h
+ * @brief A set of persistent threads for splitting loops across cores.
+ */
+
+#include <csp/csplib/util/Properties.h>
+#include <csp/csplib/thread/Thread.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace csp {
+
+
+/** A fixed set of worker threads that share the work of a loop with the
+ *  calling thread.
+ *
+ *  run() divides a number of jobs among the workers and the caller, and
+ *  returns once every job is complete.  The workers are started when the
+ *  pool is created and sleep between calls, so work that is repeated every
+ *  frame can be split across threads without starting new threads each
+ *  time.  Jobs must not throw, and run() must not be called by more than
+ *  one thread at a time.
+ */
+class WorkerPool: public NonCopyable {
+public:
+	typedef std::function<void(unsigned)> Job;
+
+	/** Create a pool.
+	 *
+	 *  @param workers the number of worker threads, in addition to the
+	 *    thread that calls run().  If zero, run() executes every job on
+	 *    the calling thread.
+	 */
+	explicit WorkerPool(unsigned workers): m_Job(0), m_Jobs(0), m_Next(0), m_Generation(0), m_Busy(0), m_Shutdown(false) {
+		for (unsigned i = 0; i < workers; ++i) {
+			m_Threads.push_back(new Thread(new Worker(this)));
+			m_Threads.back()->start();
+		}
+	}
+
+	/** Stop and join the worker threads.
+	 */
+	~WorkerPool() {
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Shutdown = true;
+		}
+		m_Wakeup.notify_all();
+		for (unsigned i = 0; i < m_Threads.size(); ++i) delete m_Threads[i];
+	}
+
+	/** The number of threads that execute jobs, including the caller.
+	 */
+	unsigned size() const { return m_Threads.size() + 1; }
+
+	/** Call job(i) for each i in [0, jobs), and wait for all the calls to
+	 *  complete.  Jobs are handed out in increasing order, but may run
+	 *  concurrently and complete in any order.
+	 */
+	void run(unsigned jobs, Job const &job) {
+		if (m_Threads.empty() || jobs <= 1) {
+			for (unsigned i = 0; i < jobs; ++i) job(i);
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Job = &job;
+			m_Jobs = jobs;
+			m_Next.store(0, std::memory_order_relaxed);
+			m_Busy = m_Threads.size();
+			++m_Generation;
+		}
+		m_Wakeup.notify_all();
+		execute(job, jobs);
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Done.wait(lock, [this]() { return m_Busy == 0; });
+		m_Job = 0;
+	}
+
+private:
+	class Worker: public Task {
+	public:
+		Worker(WorkerPool *pool): m_Pool(pool) { }
+	protected:
+		virtual void run() { m_Pool->serve(); }
+	private:
+		WorkerPool *m_Pool;
+	};
+
+	void execute(Job const &job, unsigned jobs) {
+		for (unsigned i = m_Next.fetch_add(1, std::memory_order_relaxed); i < jobs; i = m_Next.fetch_add(1, std::memory_order_relaxed)) {
+			job(i);
+		}
+	}
+
+	void serve() {
+		unsigned generation = 0;
+		for (;;) {
+			Job const *job;
+			unsigned jobs;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Wakeup.wait(lock, [&]() { return m_Shutdown || m_Generation != generation; });
+				if (m_Shutdown) return;
+				generation = m_Generation;
+				job = m_Job;
+				jobs = m_Jobs;
+			}
+			execute(*job, jobs);
+			bool last;
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				last = (--m_Busy == 0);
+			}
+			if (last) m_Done.notify_one();
+		}
+	}
+
+	std::vector<Thread*> m_Threads;
+	std::mutex m_Mutex;
+	std::condition_variable m_Wakeup;
+	std::condition_variable m_Done;
+	Job const *m_Job;
+	unsigned m_Jobs;
+	std::atomic<unsigned> m_Next;
+	unsigned m_Generation;
+	unsigned m_Busy;
+	bool m_Shutdown;
+};
+
+
+} // namespace csp
+
@@ -0,0 +1,63 @@
+/* Combat Simulator Project
+ * Copyright (C) 2025 Henrik Nilsson <nsmoooose@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+
+/**
+ * @file test_WorkerPool.cpp
+ * @brief Test for csplib/thread/WorkerPool.h.
+ */
+
+#include <csp/csplib/thread/WorkerPool.h>
+#include <csp/csplib/util/Testing.h>
+
+#include <atomic>
+#include <vector>
+
+using namespace csp;
+
+CSP_TESTFIXTURE(WorkerPool) {
+
+	CSP_TESTCASE(EveryJobRunsOnce) {
+		WorkerPool pool(3);
+		CSP_VERIFY_EQ(pool.size(), 4u);
+		std::vector<std::atomic<int> > counts(1000);
+		for (unsigned i = 0; i < counts.size(); ++i) counts[i] = 0;
+		// repeated calls reuse the same workers.
+		for (int repeat = 0; repeat < 50; ++repeat) {
+			pool.run(counts.size(), [&counts](unsigned i) { counts[i].fetch_add(1); });
+		}
+		for (unsigned i = 0; i < counts.size(); ++i) CSP_VERIFY_EQ(counts[i].load(), 50);
+	}
+
+	CSP_TESTCASE(NoWorkers) {
+		WorkerPool pool(0);
+		CSP_VERIFY_EQ(pool.size(), 1u);
+		std::vector<unsigned> order;
+		pool.run(5, [&order](unsigned i) { order.push_back(i); });
+		CSP_VERIFY_EQ(order.size(), 5u);
+		for (unsigned i = 0; i < order.size(); ++i) CSP_VERIFY_EQ(order[i], i);
+	}
+
+	CSP_TESTCASE(Empty) {
+		WorkerPool pool(2);
+		int calls = 0;
+		pool.run(0, [&calls](unsigned) { ++calls; });
+		CSP_VERIFY_EQ(calls, 0);
+	}
+};
+
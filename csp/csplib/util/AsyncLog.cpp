@@ -0,0 +1,516 @@
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+/**
+ * @file AsyncLog.cpp
+ * @brief Asynchronous binary logging backend for LogStream.
+ */
+
+
+#include <csp/csplib/util/AsyncLog.h>
+#include <csp/csplib/util/LogStream.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+namespace csp {
+
+namespace {
+
+// binary log file chunk types.
+enum { CHUNK_SITE = 1, CHUNK_THREAD = 2, CHUNK_RECORD = 3, CHUNK_DROPPED = 4 };
+
+const char BINARY_MAGIC[8] = { 'C', 'S', 'P', 'L', 'O', 'G', 'B', '1' };
+
+// records that do not fit before the end of a ring buffer are preceded by
+// a padding marker (a zero size) and written at the start of the buffer.
+const uint32_t PADDING = 0;
+
+inline uint32_t align8(uint32_t n) { return (n + 7) & ~7u; }
+
+template <typename T>
+inline void writeRaw(std::ostream &os, T const &value) {
+	os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+inline bool readRaw(std::istream &is, T &value) {
+	return static_cast<bool>(is.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+void writeString(std::ostream &os, const char *s, std::size_t n) {
+	const uint16_t length = static_cast<uint16_t>(std::min<std::size_t>(n, 0xffff));
+	writeRaw(os, length);
+	os.write(s, length);
+}
+
+bool readString(std::istream &is, std::string &s) {
+	uint16_t length;
+	if (!readRaw(is, length)) return false;
+	s.resize(length);
+	return length == 0 || static_cast<bool>(is.read(&s[0], length));
+}
+
+std::atomic<uint64_t> NextSerial(1);
+
+// round up to a power of two, with room for at least a few maximum size records.
+std::size_t ringSize(std::size_t size) {
+	std::size_t result = 4 * LogRecord::SIZE;
+	while (result < size) result <<= 1;
+	return result;
+}
+
+} // namespace
+
+
+void LogRecord::begin(int priority, int category, const char *file, int line) {
+	Header *header = reinterpret_cast<Header*>(m_Data);
+	header->priority = priority;
+	header->category = category;
+	header->line = line;
+	header->file = file;
+	header->time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	m_Size = sizeof(Header);
+}
+
+void LogRecord::putString(const char *s, std::size_t n) {
+	if (m_Size + 3 >= SIZE) return;
+	n = std::min<std::size_t>(n, SIZE - m_Size - 3);
+	memcpy(m_Data + m_Size + 3, s, n);
+	commitString(n);
+}
+
+void LogRecord::commitString(std::size_t n) {
+	const uint16_t length = static_cast<uint16_t>(n);
+	m_Data[m_Size] = static_cast<char>(ARG_STRING);
+	memcpy(m_Data + m_Size + 1, &length, sizeof(length));
+	m_Size += static_cast<uint32_t>(3 + n);
+}
+
+void LogRecord::format(char const *args, std::size_t size, std::ostream &os) {
+	const std::ios_base::fmtflags saved_flags = os.flags();
+	char const *end = args + size;
+	while (args < end) {
+		const uint8_t tag = static_cast<uint8_t>(*args++);
+		switch (tag) {
+			case ARG_BOOL: os << (*args != 0); args += 1; break;
+			case ARG_CHAR: os << *args; args += 1; break;
+			case ARG_INT: { int64_t x; memcpy(&x, args, sizeof(x)); os << x; args += sizeof(x); break; }
+			case ARG_UINT: { uint64_t x; memcpy(&x, args, sizeof(x)); os << x; args += sizeof(x); break; }
+			case ARG_DOUBLE: { double x; memcpy(&x, args, sizeof(x)); os << x; args += sizeof(x); break; }
+			case ARG_POINTER: { uint64_t x; memcpy(&x, args, sizeof(x)); os << reinterpret_cast<void*>(static_cast<uintptr_t>(x)); args += sizeof(x); break; }
+			case ARG_STRING: {
+				uint16_t length;
+				memcpy(&length, args, sizeof(length));
+				os.write(args + 2, length);
+				args += 2 + length;
+				break;
+			}
+			case ARG_HEX: os << std::hex; break;
+			case ARG_DEC: os << std::dec; break;
+			case ARG_OCT: os << std::oct; break;
+			case ARG_FIXED: os << std::fixed; break;
+			case ARG_SCIENTIFIC: os << std::scientific; break;
+			default:
+				os << "<corrupt log record>";
+				args = end;
+				break;
+		}
+	}
+	os.flags(saved_flags);
+}
+
+
+/** A single producer, single consumer ring buffer of LogRecords.  Positions
+ *  increase monotonically and are reduced modulo the (power of two) buffer
+ *  size when accessing the buffer.
+ */
+class AsyncLog::Ring {
+public:
+	Ring(std::size_t size, uint32_t index, const char *thread):
+			m_Storage((size + 7) / 8), m_Mask(size - 1), m_Index(index), m_Thread(thread ? thread : ""), m_Announced(false),
+			m_Head(0), m_Tail(0), m_Dropped(0) {
+		assert((size & (size - 1)) == 0);
+	}
+
+	enum { FULL, WRITTEN, HALF_FULL };
+
+	/** Called by the producing thread.  Returns FULL if there is not enough
+	 *  space for the record, otherwise WRITTEN or HALF_FULL (if the ring is
+	 *  more than half full after writing the record).
+	 */
+	int write(char const *data, uint32_t size) {
+		char *buffer = reinterpret_cast<char*>(&m_Storage[0]);
+		const uint64_t space = m_Mask + 1;
+		const uint64_t length = align8(size);
+		const uint64_t head = m_Head.load(std::memory_order_relaxed);
+		const uint64_t tail = m_Tail.load(std::memory_order_acquire);
+		uint64_t offset = head & m_Mask;
+		const uint64_t padding = (offset + length > space) ? space - offset : 0;
+		const uint64_t used = head + padding + length - tail;
+		if (used > space) return FULL;
+		if (padding > 0) {
+			memcpy(buffer + offset, &PADDING, sizeof(PADDING));
+			offset = 0;
+		}
+		memcpy(buffer + offset, data, size);
+		m_Head.store(head + padding + length, std::memory_order_release);
+		return (used > space / 2) ? HALF_FULL : WRITTEN;
+	}
+
+	/** Called by the consumer.  Appends all records currently in the ring
+	 *  to entries, and returns the position following the last record.
+	 */
+	uint64_t collect(std::vector<Entry> &entries) {
+		char const *buffer = reinterpret_cast<char const*>(&m_Storage[0]);
+		const uint64_t head = m_Head.load(std::memory_order_acquire);
+		uint64_t tail = m_Tail.load(std::memory_order_relaxed);
+		while (tail < head) {
+			const uint64_t offset = tail & m_Mask;
+			LogRecord::Header const *record = reinterpret_cast<LogRecord::Header const*>(buffer + offset);
+			if (record->size == PADDING) {
+				tail += (m_Mask + 1) - offset;
+				continue;
+			}
+			Entry entry = { record->time, this, record };
+			entries.push_back(entry);
+			tail += align8(record->size);
+		}
+		return head;
+	}
+
+	/** Called by the consumer to release records returned by collect.
+	 */
+	void release(uint64_t position) { m_Tail.store(position, std::memory_order_release); }
+
+	bool empty() const { return m_Head.load(std::memory_order_acquire) == m_Tail.load(std::memory_order_relaxed); }
+	void drop() { m_Dropped.fetch_add(1, std::memory_order_relaxed); }
+	uint32_t takeDropped() { return m_Dropped.exchange(0, std::memory_order_relaxed); }
+	uint32_t index() const { return m_Index; }
+	std::string const &thread() const { return m_Thread; }
+
+	/** Returns true the first time it is called; used by the consumer to
+	 *  write the thread label to binary logs.
+	 */
+	bool announce() {
+		const bool first = !m_Announced;
+		m_Announced = true;
+		return first;
+	}
+
+private:
+	std::vector<uint64_t> m_Storage;
+	const uint64_t m_Mask;
+	const uint32_t m_Index;
+	const std::string m_Thread;
+	bool m_Announced;
+	alignas(64) std::atomic<uint64_t> m_Head;
+	alignas(64) std::atomic<uint64_t> m_Tail;
+	std::atomic<uint32_t> m_Dropped;
+};
+
+
+AsyncLog::AsyncLog(LogStream &stream, std::size_t buffer_size, std::string const &binary_file):
+		m_Stream(stream),
+		m_BufferSize(ringSize(buffer_size)),
+		m_Serial(NextSerial.fetch_add(1)),
+		m_NextRingIndex(0),
+		m_FlushRequested(0),
+		m_FlushCompleted(0),
+		m_Shutdown(false),
+		m_Signaled(false),
+		m_DropWhenFull(false),
+		m_TotalDropped(0) {
+	if (!binary_file.empty()) {
+		m_Binary.open(binary_file.c_str(), std::ios::binary | std::ios::trunc);
+		if (m_Binary.is_open()) {
+			m_Binary.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+		} else {
+			std::cerr << "Unable to open binary log file " << binary_file << "; logging text\n";
+		}
+	}
+	m_Thread = std::thread([this]() { serve(); });
+}
+
+AsyncLog::~AsyncLog() {
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Shutdown = true;
+	}
+	m_Wakeup.notify_one();
+	m_Thread.join();
+}
+
+AsyncLog::Ring *AsyncLog::getRing() {
+	// the rings of the calling thread, one for each backend it has written
+	// to.  the references keep each ring alive until it has been drained,
+	// even if the thread exits first.  a thread usually writes to only one
+	// or two logs, so a linear search starting with the most recently used
+	// ring is sufficient.
+	struct Cache {
+		uint64_t serial;
+		RingRef ring;
+	};
+	static thread_local std::vector<Cache> cache;
+	static thread_local std::size_t last = 0;
+	if (last < cache.size() && cache[last].serial == m_Serial) return cache[last].ring.get();
+	for (std::size_t i = 0; i < cache.size(); ++i) {
+		if (cache[i].serial == m_Serial) {
+			last = i;
+			return cache[i].ring.get();
+		}
+	}
+	// rings that are only referenced here belong to deleted backends.
+	cache.erase(std::remove_if(cache.begin(), cache.end(), [](Cache const &c) { return c.ring.use_count() == 1; }), cache.end());
+	Cache entry = { m_Serial, RingRef() };
+	{
+		std::lock_guard<std::mutex> lock(m_RingMutex);
+		entry.ring = std::make_shared<Ring>(m_BufferSize, m_NextRingIndex++, m_Stream.getThreadLabel());
+		m_Rings.push_back(entry.ring);
+	}
+	cache.push_back(entry);
+	last = cache.size() - 1;
+	return entry.ring.get();
+}
+
+uint32_t AsyncLog::getThreadCount() {
+	std::lock_guard<std::mutex> lock(m_RingMutex);
+	return m_NextRingIndex;
+}
+
+void AsyncLog::push(LogRecord &record) {
+	record.finish();
+	Ring *ring = getRing();
+	for (;;) {
+		const int result = ring->write(record.data(), record.size());
+		if (result == Ring::WRITTEN) return;
+		wake();
+		if (result == Ring::HALF_FULL) return;
+		if (m_DropWhenFull || std::this_thread::get_id() == m_Thread.get_id()) {
+			ring->drop();
+			return;
+		}
+		// wait for the background thread to make room.
+		std::this_thread::yield();
+	}
+}
+
+void AsyncLog::wake() {
+	if (!m_Signaled.exchange(true)) m_Wakeup.notify_one();
+}
+
+void AsyncLog::flush() {
+	// the background thread never waits on itself.
+	if (std::this_thread::get_id() == m_Thread.get_id()) return;
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	const uint64_t ticket = ++m_FlushRequested;
+	m_Wakeup.notify_one();
+	m_Flushed.wait(lock, [&]() { return m_FlushCompleted >= ticket; });
+}
+
+void AsyncLog::serve() {
+	for (;;) {
+		bool shutdown;
+		uint64_t ticket;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Wakeup.wait_for(lock, std::chrono::milliseconds(10), [this]() { return m_Shutdown || m_Signaled.load() || m_FlushRequested > m_FlushCompleted; });
+			m_Signaled = false;
+			shutdown = m_Shutdown;
+			ticket = m_FlushRequested;
+		}
+		drain();
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_FlushCompleted = ticket;
+		}
+		m_Flushed.notify_all();
+		if (shutdown) break;
+	}
+}
+
+void AsyncLog::drain() {
+	std::vector<RingRef> rings;
+	{
+		std::lock_guard<std::mutex> lock(m_RingMutex);
+		rings = m_Rings;
+	}
+
+	m_Entries.clear();
+	std::vector<uint64_t> positions(rings.size());
+	for (unsigned i = 0; i < rings.size(); ++i) {
+		positions[i] = rings[i]->collect(m_Entries);
+	}
+
+	// records from different threads are interleaved in time stamp order.
+	std::stable_sort(m_Entries.begin(), m_Entries.end());
+	if (isBinary()) {
+		writeBinary(m_Entries);
+	} else {
+		writeText(m_Entries);
+	}
+
+	uint64_t dropped = 0;
+	for (unsigned i = 0; i < rings.size(); ++i) {
+		rings[i]->release(positions[i]);
+		const uint32_t count = rings[i]->takeDropped();
+		if (count > 0) {
+			dropped += count;
+			if (isBinary()) {
+				m_Binary.put(static_cast<char>(CHUNK_DROPPED));
+				writeRaw(m_Binary, rings[i]->index());
+				writeRaw(m_Binary, count);
+			}
+		}
+	}
+	if (dropped > 0) {
+		m_TotalDropped.fetch_add(dropped);
+		if (!isBinary()) {
+			m_Stream.lock();
+			m_Stream.getStream() << "[" << dropped << " log entries dropped]\n";
+			m_Stream.unlock();
+		}
+	}
+	if (isBinary()) m_Binary.flush();
+
+	// free the rings of threads that have exited, once they are empty.  the
+	// local references must be released first.
+	rings.clear();
+	std::lock_guard<std::mutex> lock(m_RingMutex);
+	for (std::vector<RingRef>::iterator iter = m_Rings.begin(); iter != m_Rings.end(); ) {
+		if (iter->use_count() == 1 && (*iter)->empty()) {
+			iter = m_Rings.erase(iter);
+		} else {
+			++iter;
+		}
+	}
+}
+
+void AsyncLog::writeText(std::vector<Entry> const &entries) {
+	if (entries.empty()) return;
+	const int flags = m_Stream.getFlags();
+	bool flush = m_Stream.autoflush();
+	// format the whole batch first, since log files are unbuffered.
+	m_Text.str("");
+	std::ostream &os = m_Text;
+	for (std::vector<Entry>::const_iterator iter = entries.begin(); iter != entries.end(); ++iter) {
+		LogRecord::Header const *record = iter->record;
+		const std::string &thread = iter->ring->thread();
+		LogStream::writePrefix(os, flags, record->priority, record->category, static_cast<time_t>(record->time / 1000000), thread.empty() ? 0 : thread.c_str(), record->file, record->line);
+		LogRecord::format(reinterpret_cast<char const*>(record + 1), record->size - sizeof(LogRecord::Header), os);
+		os << '\n';
+		if (record->priority >= LogStream::cWarning) flush = true;
+	}
+	const std::string text = m_Text.str();
+	m_Stream.lock();
+	m_Stream.getStream().write(text.data(), text.size());
+	if (flush) m_Stream.getStream().flush();
+	m_Stream.unlock();
+}
+
+uint32_t AsyncLog::getSiteId(const char *file, int line) {
+	const SiteMap::key_type key(file, line);
+	SiteMap::const_iterator iter = m_Sites.find(key);
+	if (iter != m_Sites.end()) return iter->second;
+	const uint32_t id = static_cast<uint32_t>(m_Sites.size());
+	m_Sites[key] = id;
+	m_Binary.put(static_cast<char>(CHUNK_SITE));
+	writeRaw(m_Binary, id);
+	writeRaw(m_Binary, static_cast<int32_t>(line));
+	writeString(m_Binary, file ? file : "", file ? strlen(file) : 0);
+	return id;
+}
+
+void AsyncLog::writeBinary(std::vector<Entry> const &entries) {
+	for (std::vector<Entry>::const_iterator iter = entries.begin(); iter != entries.end(); ++iter) {
+		LogRecord::Header const *record = iter->record;
+		Ring *ring = iter->ring;
+		if (ring->announce()) {
+			m_Binary.put(static_cast<char>(CHUNK_THREAD));
+			writeRaw(m_Binary, ring->index());
+			writeString(m_Binary, ring->thread().data(), ring->thread().size());
+		}
+		const uint32_t site = getSiteId(record->file, record->line);
+		m_Binary.put(static_cast<char>(CHUNK_RECORD));
+		writeRaw(m_Binary, site);
+		writeRaw(m_Binary, ring->index());
+		writeRaw(m_Binary, record->priority);
+		writeRaw(m_Binary, record->category);
+		writeRaw(m_Binary, record->time);
+		writeString(m_Binary, reinterpret_cast<char const*>(record + 1), record->size - sizeof(LogRecord::Header));
+	}
+}
+
+bool AsyncLog::decode(std::istream &is, std::ostream &os, int flags) {
+	char magic[sizeof(BINARY_MAGIC)];
+	if (!is.read(magic, sizeof(magic)) || memcmp(magic, BINARY_MAGIC, sizeof(magic)) != 0) return false;
+
+	struct Site {
+		std::string file;
+		int32_t line;
+	};
+	std::vector<Site> sites;
+	std::map<uint32_t, std::string> threads;
+	std::string buffer;
+
+	for (;;) {
+		const int chunk = is.get();
+		if (chunk == std::char_traits<char>::eof()) break;
+		switch (chunk) {
+			case CHUNK_SITE: {
+				uint32_t id;
+				Site site;
+				if (!readRaw(is, id) || !readRaw(is, site.line) || !readString(is, site.file)) return false;
+				if (id >= sites.size()) sites.resize(id + 1);
+				sites[id] = site;
+				break;
+			}
+			case CHUNK_THREAD: {
+				uint32_t id;
+				if (!readRaw(is, id) || !readString(is, threads[id])) return false;
+				break;
+			}
+			case CHUNK_RECORD: {
+				uint32_t site, thread;
+				int32_t priority, category;
+				int64_t time;
+				if (!readRaw(is, site) || !readRaw(is, thread) || !readRaw(is, priority) || !readRaw(is, category) || !readRaw(is, time) || !readString(is, buffer)) return false;
+				if (site >= sites.size()) return false;
+				std::string const &label = threads[thread];
+				LogStream::writePrefix(os, flags, priority, category, static_cast<time_t>(time / 1000000), label.empty() ? 0 : label.c_str(), sites[site].file.c_str(), sites[site].line);
+				LogRecord::format(buffer.data(), buffer.size(), os);
+				os << '\n';
+				break;
+			}
+			case CHUNK_DROPPED: {
+				uint32_t thread, count;
+				if (!readRaw(is, thread) || !readRaw(is, count)) return false;
+				os << "[" << count << " log entries dropped]\n";
+				break;
+			}
+			default:
+				return false;
+		}
+	}
+	return true;
+}
+
+} // namespace csp
@@ -0,0 +1,308 @@
+#pragma once
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+
+/**
+ * @file AsyncLog.h
+ * @brief Asynchronous binary logging backend for LogStream.
+ */
+
+#include <csp/csplib/util/Export.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace csp {
+
+class LogStream;
+
+
+/** A compact binary encoding of a single log entry.
+ *
+ *  Instead of formatting a log entry as text, LogRecord stores the source
+ *  location of the CSPLOG call (which serves as the format string id) and
+ *  the raw values of the streamed arguments, each preceded by a one byte
+ *  type tag.  Strings are copied; values of other types are formatted as
+ *  text in place using their stream operators.  The record is formatted
+ *  by the AsyncLog background thread, or offline by tools/logdecode.
+ *
+ *  Arguments that do not fit in the fixed size record are dropped.
+ */
+class CSPLIB_EXPORT LogRecord {
+public:
+	enum { SIZE = 512 };
+
+	/** Argument type tags. */
+	enum {
+		ARG_BOOL = 1, ARG_CHAR, ARG_INT, ARG_UINT, ARG_DOUBLE, ARG_STRING, ARG_POINTER,
+		ARG_HEX, ARG_DEC, ARG_OCT, ARG_FIXED, ARG_SCIENTIFIC
+	};
+
+	/** Record header; the encoded arguments follow immediately.
+	 */
+	struct Header {
+		uint32_t size;       // total size of the record in bytes, including the header.
+		int32_t priority;
+		int32_t category;
+		int32_t line;
+		int64_t time;        // microseconds since the epoch.
+		const char *file;    // source file (typically __FILE__).
+	};
+
+	LogRecord(): m_Size(0) { }
+
+	/** Start a new record, discarding any previous contents.
+	 */
+	void begin(int priority, int category, const char *file, int line);
+
+	/** Append a value to the record.
+	 */
+	template <typename T>
+	void put(T const &x) {
+		if constexpr (std::is_same<T, bool>::value) {
+			putValue(ARG_BOOL, static_cast<uint8_t>(x));
+		} else if constexpr (std::is_same<T, char>::value || std::is_same<T, signed char>::value || std::is_same<T, unsigned char>::value) {
+			putValue(ARG_CHAR, static_cast<char>(x));
+		} else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+			putValue(ARG_INT, static_cast<int64_t>(x));
+		} else if constexpr (std::is_integral<T>::value) {
+			putValue(ARG_UINT, static_cast<uint64_t>(x));
+		} else if constexpr (std::is_floating_point<T>::value) {
+			putValue(ARG_DOUBLE, static_cast<double>(x));
+		} else if constexpr (std::is_array<T>::value && std::is_same<typename std::remove_cv<typename std::remove_extent<T>::type>::type, char>::value) {
+			putString(x, strnlen(x, std::extent<T>::value));
+		} else if constexpr (std::is_same<T, const char*>::value || std::is_same<T, char*>::value) {
+			if (x) putString(x, strlen(x)); else putString("(null)", 6);
+		} else if constexpr (std::is_same<T, std::string>::value) {
+			putString(x.data(), x.size());
+		} else if constexpr (std::is_pointer<T>::value && std::is_void<typename std::remove_cv<typename std::remove_pointer<T>::type>::type>::value) {
+			putValue(ARG_POINTER, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(x)));
+		} else {
+			putFormatted(x);
+		}
+	}
+
+	/** Append a stream manipulator.  Only std::hex, std::dec, std::oct,
+	 *  std::fixed, std::scientific, and std::endl are recorded; other
+	 *  manipulators are ignored.
+	 */
+	template <typename T>
+	void manipulate(T& (*formatter)(T&)) {
+		if constexpr (std::is_same<T, std::ios_base>::value) {
+			if (formatter == &std::hex) putTag(ARG_HEX);
+			else if (formatter == &std::dec) putTag(ARG_DEC);
+			else if (formatter == &std::oct) putTag(ARG_OCT);
+			else if (formatter == &std::fixed) putTag(ARG_FIXED);
+			else if (formatter == &std::scientific) putTag(ARG_SCIENTIFIC);
+		} else if constexpr (std::is_same<T, std::ostream>::value) {
+			if (formatter == static_cast<std::ostream& (*)(std::ostream&)>(&std::endl)) put('\n');
+		}
+	}
+
+	/** Store the final size in the header.  Called by AsyncLog::push.
+	 */
+	void finish() { reinterpret_cast<Header*>(m_Data)->size = m_Size; }
+
+	char const *data() const { return m_Data; }
+	uint32_t size() const { return m_Size; }
+
+	/** Format encoded arguments as text.
+	 *
+	 *  @param args the encoded arguments (following the header).
+	 *  @param size the size of the encoded arguments in bytes.
+	 *  @param os the output stream.
+	 */
+	static void format(char const *args, std::size_t size, std::ostream &os);
+
+private:
+	/** A stream buffer that writes directly into the unused part of the record.
+	 */
+	class Buffer: public std::streambuf {
+	public:
+		Buffer(char *begin, char *end) { setp(begin, end); }
+		std::size_t count() const { return static_cast<std::size_t>(pptr() - pbase()); }
+	};
+
+	void putTag(uint8_t tag) {
+		if (m_Size < SIZE) m_Data[m_Size++] = static_cast<char>(tag);
+	}
+
+	template <typename V>
+	void putValue(uint8_t tag, V value) {
+		if (m_Size + 1 + sizeof(V) > SIZE) return;
+		m_Data[m_Size] = static_cast<char>(tag);
+		memcpy(m_Data + m_Size + 1, &value, sizeof(V));
+		m_Size += static_cast<uint32_t>(1 + sizeof(V));
+	}
+
+	void putString(const char *s, std::size_t n);
+
+	template <typename T>
+	void putFormatted(T const &x) {
+		if (m_Size + 3 >= SIZE) return;
+		Buffer buffer(m_Data + m_Size + 3, m_Data + SIZE);
+		std::ostream os(&buffer);
+		os << x;
+		commitString(buffer.count());
+	}
+
+	/** Finish a string whose bytes have already been written after a
+	 *  (not yet written) tag and length.
+	 */
+	void commitString(std::size_t n);
+
+	alignas(8) char m_Data[SIZE];
+	uint32_t m_Size;
+};
+
+
+/** Asynchronous logging backend for LogStream.
+ *
+ *  Threads that write log entries push LogRecords into private ring
+ *  buffers (one per thread, allocated on the first log entry written by
+ *  that thread) without taking any locks.  A background thread collects
+ *  the records from all the rings every few milliseconds, sorts them by
+ *  time stamp, and either formats them as text to the LogStream output
+ *  stream, or appends them to a binary log file that can be converted to
+ *  text offline by tools/logdecode.
+ *
+ *  The background thread is woken early when a ring buffer is half full.
+ *  If a ring buffer fills up completely the writing thread waits for space
+ *  by default; alternatively the record can be discarded, in which case the
+ *  number of discarded records is reported in the output.  Fatal log
+ *  entries flush the asynchronous log and are then written synchronously.
+ *
+ *  Binary log files use the native byte order, and should be decoded on
+ *  a machine of the same architecture.
+ */
+class CSPLIB_EXPORT AsyncLog {
+public:
+	/** Start a background thread writing to the specified LogStream.
+	 *
+	 *  @param stream the log stream that owns this backend.
+	 *  @param buffer_size the size of each per-thread ring buffer in bytes
+	 *    (rounded up to a power of two).
+	 *  @param binary_file if not empty, write binary records to this file
+	 *    rather than text to the log stream.
+	 */
+	AsyncLog(LogStream &stream, std::size_t buffer_size, std::string const &binary_file="");
+
+	/** Write all pending records and stop the background thread.
+	 */
+	~AsyncLog();
+
+	/** Queue a record for output.  Lock free, except for the first record
+	 *  written by each thread.
+	 */
+	void push(LogRecord &record);
+
+	/** Block until all records pushed before this call have been written.
+	 */
+	void flush();
+
+	/** If true, records are discarded when a ring buffer is full instead
+	 *  of waiting for space.  The default is false.
+	 */
+	void setDropWhenFull(bool drop) { m_DropWhenFull = drop; }
+
+	/** Returns true if writing binary records to a file.
+	 */
+	bool isBinary() const { return m_Binary.is_open(); }
+
+	/** The total number of records discarded because a ring buffer was full.
+	 */
+	uint64_t getDropped() const { return m_TotalDropped.load(); }
+
+	/** The number of threads that have written to this log.
+	 */
+	uint32_t getThreadCount();
+
+	/** Convert a binary log file to text.
+	 *
+	 *  @param is the binary log file.
+	 *  @param os the text output stream.
+	 *  @param flags LogStream flags controlling the prefix of each entry.
+	 *  @return false if the input is not a valid binary log file.
+	 */
+	static bool decode(std::istream &is, std::ostream &os, int flags);
+
+private:
+	class Ring;
+	typedef std::shared_ptr<Ring> RingRef;
+
+	struct Entry {
+		int64_t time;
+		Ring *ring;
+		LogRecord::Header const *record;
+		bool operator<(Entry const &other) const { return time < other.time; }
+	};
+
+	Ring *getRing();
+	void wake();
+	void serve();
+	void drain();
+	void writeText(std::vector<Entry> const &entries);
+	void writeBinary(std::vector<Entry> const &entries);
+	uint32_t getSiteId(const char *file, int line);
+
+	LogStream &m_Stream;
+	const std::size_t m_BufferSize;
+	const uint64_t m_Serial;
+
+	std::mutex m_RingMutex;
+	std::vector<RingRef> m_Rings;
+	uint32_t m_NextRingIndex;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Wakeup;
+	std::condition_variable m_Flushed;
+	uint64_t m_FlushRequested;
+	uint64_t m_FlushCompleted;
+	bool m_Shutdown;
+	std::atomic<bool> m_Signaled;
+
+	std::atomic<bool> m_DropWhenFull;
+	std::atomic<uint64_t> m_TotalDropped;
+
+	// owned by the background thread.
+	std::vector<Entry> m_Entries;
+	std::ostringstream m_Text;
+	std::ofstream m_Binary;
+	typedef std::map<std::pair<const char*, int>, uint32_t> SiteMap;
+	SiteMap m_Sites;
+
+	std::thread m_Thread;
+};
+
+
+} // namespace csp
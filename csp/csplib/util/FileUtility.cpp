@@ -41,6 +41,7 @@
 #else /* _WIN32 */
 #  include <unistd.h>
 #  include <sys/types.h>
+#  include <sys/stat.h>
 #  include <dirent.h>
 #endif
 
@@ -197,6 +198,16 @@ bool ospath::exists(const std::string &path) {
 	return access(path.c_str(), mode) == 0;
 }
 
+bool ospath::isdir(const std::string &path) {
+#ifdef _WIN32
+	const DWORD attributes = GetFileAttributes(path.c_str());
+	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else // POSIX (hopefully)
+	struct stat info;
+	return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+#endif
+}
+
 ospath::DirectoryContents ospath::getDirectoryContents(std::string const &path) {
 	DirectoryContents entries;
 #ifdef _WIN32
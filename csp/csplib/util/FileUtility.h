@@ -145,6 +145,10 @@ namespace ospath {
 	 */
 	extern CSPLIB_EXPORT bool exists(const std::string &path);
 
+	/** Test if a path refers to a directory.
+	 */
+	extern CSPLIB_EXPORT bool isdir(const std::string &path);
+
 	typedef std::vector<std::string> DirectoryContents;
 
 	/** Retrieve a list of entries (files and subdirectories) from the given
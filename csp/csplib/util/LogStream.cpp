@@ -34,6 +34,7 @@
 #include <cstdlib>
 #include <ctime>
 #include <map>
+#include <sstream>
 
 namespace csp {
 
@@ -49,7 +50,7 @@ CSPLIB_EXPORT LogStream& internal_log() {
 		// it is safe to log messages from static destructors.
 		log_stream = LogStream::getOrCreateNamedLog("CSP", &is_new);
 		if (is_new) {
-			log_stream->initFromEnvironment("CSPLOG_FILE", "CSPLOG_PRIORITY", "CSPLOG_FLAGS");
+			log_stream->initFromEnvironment("CSPLOG_FILE", "CSPLOG_PRIORITY", "CSPLOG_FLAGS", "CSPLOG_ASYNC");
 			log_stream->setNeverDeleted();
 		}
 	}
@@ -136,6 +137,11 @@ public:
 	}
 	~AutoFlushAtExitHelper() {
 		for (std::vector<LogStream*>::iterator iter = m_streams->begin(); iter != m_streams->end(); ++iter) {
+			// write any queued asynchronous records, since the stream is never
+			// deleted.  other threads may still be logging, so the backend is
+			// retired rather than deleted.  entries logged during the rest of
+			// static destruction are written synchronously.
+			(*iter)->retireAsync();
 			(*iter)->setAlwaysFlush(true);
 			(*iter)->flush();
 		}
@@ -157,7 +163,7 @@ void LogStream::setNeverDeleted() {
 	}
 }
 
-void LogStream::initFromEnvironment(const char *log_file, const char *log_priority, const char *log_flags) {
+void LogStream::initFromEnvironment(const char *log_file, const char *log_priority, const char *log_flags, const char *log_async) {
 	if (log_file) {
 		char *env_logfile = getenv(log_file);
 		if (env_logfile && *env_logfile) {
@@ -180,30 +186,33 @@ void LogStream::initFromEnvironment(const char *log_file, const char *log_priori
 			if (flags >= 0) setFlags(flags);
 		}
 	}
+	if (log_async) {
+		char *env_async = getenv(log_async);
+		if (env_async && *env_async && std::string(env_async) != "0") {
+			if (std::string(env_async) == "1") {
+				setAsync(true);
+			} else {
+				logToBinaryFile(env_async);
+			}
+		}
+	}
 }
 
-void LogStream::LogEntry::prefix(const char *filename, int linenum) {
-	const int flags = m_stream.getFlags();
+void LogStream::writePrefix(std::ostream &os, int flags, int priority, int category, time_t when, const char *thread, const char *filename, int linenum) {
 	if (flags & LogStream::cPriority) {
-		m_buffer << ((m_priority >= 0 && m_priority <= 4) ? "DIWEF"[m_priority] : '?') << " ";
+		os << ((priority >= 0 && priority <= 4) ? "DIWEF"[priority] : '?') << " ";
 	}
 	if (flags & LogStream::cCategory) {
-		m_buffer << getLogCategoryName(m_category) << " ";
+		os << getLogCategoryName(category) << " ";
 	}
 	if (flags & (LogStream::cTimestamp|LogStream::cDatestamp)) {
-		const time_t now = time(0);
 		char time_stamp[32];
-		logTime(now, time_stamp, (flags & LogStream::cTimestamp) != 0, (flags & LogStream::cDatestamp) != 0);
-		m_buffer << time_stamp << ' ';
+		logTime(when, time_stamp, (flags & LogStream::cTimestamp) != 0, (flags & LogStream::cDatestamp) != 0);
+		os << time_stamp << ' ';
 	}
-#ifndef CSP_NOTHREADS
-	if (flags & LogStream::cThread) {
-		auto thread_id = std::this_thread::get_id();
-		if (thread_id != m_stream.initialThread()) {
-			m_buffer << thread_id;
-		}
+	if (thread && (flags & LogStream::cThread)) {
+		os << thread;
 	}
-#endif
 	if (filename && (flags & LogStream::cLinestamp)) {
 		const char *basename = filename;
 		if ((flags & LogStream::cFullPath) == 0) {
@@ -211,21 +220,65 @@ void LogStream::LogEntry::prefix(const char *filename, int linenum) {
 				if (*scanner == ospath::DIR_SEPARATOR) basename = scanner + 1;
 			}
 		}
-		m_buffer << '(' << basename << ':' << linenum << ") ";
+		os << '(' << basename << ':' << linenum << ") ";
+	}
+}
+
+const char *LogStream::getThreadLabel() const {
+#ifndef CSP_NOTHREADS
+	// format the thread id once per thread.
+	static thread_local std::string label;
+	const std::thread::id thread_id = std::this_thread::get_id();
+	if (thread_id == m_initial_thread) return 0;
+	if (label.empty()) {
+		std::ostringstream os;
+		os << thread_id;
+		label = os.str();
+	}
+	return label.c_str();
+#else
+	return 0;
+#endif
+}
+
+void LogStream::LogEntry::start(const char *filename, int linenum) {
+	m_async = m_stream.getAsync();
+	if (m_async) {
+		if (m_priority < LogStream::cFatal) {
+			m_entry.emplace<LogRecord>().begin(m_priority, m_category, filename, linenum);
+			return;
+		}
+		// write everything queued so far before the fatal message.
+		m_async->flush();
+		m_async = 0;
 	}
+	m_entry.emplace<BufferStream>();
+	prefix(filename, linenum);
+}
+
+void LogStream::LogEntry::prefix(const char *filename, int linenum) {
+	const int flags = m_stream.getFlags();
+	const time_t now = (flags & (LogStream::cTimestamp|LogStream::cDatestamp)) ? time(0) : 0;
+	const char *thread = (flags & LogStream::cThread) ? m_stream.getThreadLabel() : 0;
+	writePrefix(std::get<BufferStream>(m_entry), flags, m_priority, m_category, now, thread, filename, linenum);
 }
 
 void LogStream::LogEntry::die() {
 	m_stream.flush();
 	m_stream.trace();
-	if (m_stream.getThrowOnFatal()) { throw FatalException(m_buffer.get()); }
+	if (m_stream.getThrowOnFatal()) { throw FatalException(std::get<BufferStream>(m_entry).get()); }
 	AutoTrace::inhibitAbortHandler();
 	::abort();
 }
 
 LogStream::LogEntry::~LogEntry() {
+	if (m_async) {
+		m_async->push(std::get<LogRecord>(m_entry));
+		if (m_stream.autoflush()) m_async->flush();
+		return;
+	}
 	m_stream.lock();
-	m_stream.getStream() << m_buffer.get() << "\n";
+	m_stream.getStream() << std::get<BufferStream>(m_entry).get() << "\n";
 	if (m_priority >= LogStream::cWarning || m_stream.autoflush()) m_stream.flush();
 	m_stream.unlock();
 	if (m_priority == LogStream::cFatal) die();
@@ -257,6 +310,7 @@ LogStream::LogStream():
 		m_stream(&std::cerr),
 		m_fstream(0),
 		m_mutex(0),
+		m_async(0),
 		m_throw_on_fatal(false),
 		m_autoflush(false),
 		m_never_deleted(false) {
@@ -270,12 +324,14 @@ LogStream::LogStream(std::ostream& stream):
 		m_stream(&stream),
 		m_fstream(0),
 		m_mutex(0),
+		m_async(0),
 		m_autoflush(false),
 		m_never_deleted(false) {
 	init();
 }
 
 LogStream::~LogStream() {
+	setAsync(false);
 	close();
 	delete m_mutex;
 	assert(!m_never_deleted);
@@ -284,12 +340,16 @@ LogStream::~LogStream() {
 void LogStream::setStream(std::ostream &stream) {
 	if (&stream != m_stream) {
 		close();
+		lock();
 		m_stream = &stream;
+		unlock();
 	}
 }
 
 void LogStream::close() {
 	flush();
+	// the asynchronous backend may be writing to the stream.
+	lock();
 	if (m_fstream) {
 		std::cout << "Closing logfile" << std::endl;
 		m_fstream->close();
@@ -297,6 +357,26 @@ void LogStream::close() {
 		m_fstream = 0;
 	}
 	m_stream = &std::cerr;
+	unlock();
+}
+
+void LogStream::setAsync(bool async, std::size_t buffer_size) {
+	delete m_async.exchange(0);  // writes all pending records.
+	if (async) {
+		m_async.store(new AsyncLog(*this, buffer_size), std::memory_order_release);
+	}
+}
+
+void LogStream::retireAsync() {
+	AsyncLog *async = m_async.exchange(0);
+	// entries that started before the exchange may still be pushed to the
+	// retired backend, so it is flushed but intentionally leaked.
+	if (async) async->flush();
+}
+
+void LogStream::logToBinaryFile(std::string const &filename, std::size_t buffer_size) {
+	setAsync(false);
+	m_async.store(new AsyncLog(*this, buffer_size, filename), std::memory_order_release);
 }
 
 void LogStream::logToFile(std::string const &filename) {
@@ -305,6 +385,7 @@ void LogStream::logToFile(std::string const &filename) {
 	  CSPLOG(Prio_ERROR, Cat_ALL) << "Unable to open log stream to file " << filename;
 	}
 	close();
+	lock();
 	if (target) {
 		target->rdbuf()->pubsetbuf(0, 0);
 		m_stream = target;
@@ -314,6 +395,7 @@ void LogStream::logToFile(std::string const &filename) {
 		m_filename = "";
 	}
 	m_fstream = target;
+	unlock();
 }
 
 void LogStream::endl() {
@@ -321,6 +403,7 @@ void LogStream::endl() {
 }
 
 void LogStream::flush() {
+	if (AsyncLog *async = getAsync()) async->flush();
 	if (m_stream) m_stream->flush();
 }
 
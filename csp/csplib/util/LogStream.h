@@ -23,16 +23,20 @@
  * @brief Stream based logging mechanism.
  */
 
+#include <csp/csplib/util/AsyncLog.h>
 #include <csp/csplib/util/Exception.h>
 #include <csp/csplib/util/Export.h>
 #include <csp/csplib/util/Uniform.h>
 
+#include <atomic>
 #include <iosfwd>
 #include <string>
 #include <ostream>
 #include <cassert>
+#include <ctime>
 #include <mutex>
 #include <thread>
+#include <variant>
 
 namespace csp {
 
@@ -74,8 +78,12 @@ public:
 	 *    priority threshold (e.g. "CSPLOG_PRIORITY").
 	 *  @param log_flags the environment variable specifying the log
 	 *    flags (e.g. "CSPLOG_FLAGS").
+	 *  @param log_async the environment variable enabling asynchronous
+	 *    logging (e.g. "CSPLOG_ASYNC").  A value of 1 selects asynchronous
+	 *    text output; any other value except 0 is the path of a binary log
+	 *    file.  See setAsync and logToBinaryFile.
 	 */
-	void initFromEnvironment(const char *log_file, const char *log_priority, const char *log_flags);
+	void initFromEnvironment(const char *log_file, const char *log_priority, const char *log_flags, const char *log_async=0);
 
 	void setFlags(int flags) { m_flags = flags; }
 	int getFlags() const { return m_flags; }
@@ -93,6 +101,36 @@ public:
 	 */
 	void logToFile(std::string const &filename);
 
+	/** Enable or disable asynchronous logging.  When enabled, log entries
+	 *  are encoded as binary records and formatted by a background thread;
+	 *  see AsyncLog.  Must not be called while other threads are logging.
+	 *
+	 *  @param async true to enable asynchronous logging.
+	 *  @param buffer_size the size of the ring buffer for each thread that
+	 *    writes to the log.
+	 */
+	void setAsync(bool async, std::size_t buffer_size=65536);
+	bool isAsync() const { return getAsync() != 0; }
+
+	/** Write binary log records asynchronously to the specified file.
+	 *  The file can be converted to text with tools/logdecode.  Fatal
+	 *  messages are still written to the text output stream.  Must not be
+	 *  called while other threads are logging.
+	 */
+	void logToBinaryFile(std::string const &filename, std::size_t buffer_size=65536);
+
+	/** Get the asynchronous logging backend, or NULL if not enabled.
+	 */
+	AsyncLog *getAsync() const { return m_async.load(std::memory_order_acquire); }
+
+	/** Stop asynchronous logging without deleting the backend.  Subsequent
+	 *  entries are written synchronously, and all records queued so far are
+	 *  written before returning.  Unlike setAsync(false), this is safe while
+	 *  other threads are logging, since the backend (and its thread) is
+	 *  never freed.  Used at program exit; see setNeverDeleted.
+	 */
+	void retireAsync();
+
 	void endl();
 	void flush();
 	void trace(StackTrace const *stacktrace=0);
@@ -103,6 +141,23 @@ public:
 
 	std::thread::id initialThread() const { return m_initial_thread; }
 
+	/** Get a label for the calling thread, or NULL for the initial thread.
+	 */
+	const char *getThreadLabel() const;
+
+	/** Write the metadata that precedes the text of each log entry.
+	 *
+	 *  @param os the output stream.
+	 *  @param flags log flags selecting the metadata to write.
+	 *  @param priority the priority of the entry.
+	 *  @param category the category of the entry.
+	 *  @param when the time of the entry (only used for cTimestamp and cDatestamp).
+	 *  @param thread the label of the writing thread, or NULL.
+	 *  @param filename the source file of the entry, or NULL.
+	 *  @param linenum the source line of the entry.
+	 */
+	static void writePrefix(std::ostream &os, int flags, int priority, int category, time_t when, const char *thread, const char *filename, int linenum);
+
 	/** Test whether FATAL log messages generate exceptions or cause an immediate abort.
 	 */
 	bool getThrowOnFatal() const  { return m_throw_on_fatal; }
@@ -138,7 +193,8 @@ public:
 
 	/** Call for logstreams that are allocated on the heap and never deleted
 	 *  to ensure that log messages will be properly flushed during static
-	 *  destruction at program exit.
+	 *  destruction at program exit.  Asynchronous logging is stopped at that
+	 *  point, after writing all pending records (see retireAsync).
 	 */
 	void setNeverDeleted();
 
@@ -166,6 +222,7 @@ private:
 
 	std::mutex *m_mutex;
 	bool m_threadsafe;
+	std::atomic<AsyncLog*> m_async;
 	std::thread::id m_initial_thread;
 	bool m_throw_on_fatal;
 
@@ -216,7 +273,7 @@ public:
 	 *  @param category category of this message.
 	 */
 	LogEntry(LogStream &stream, int priority, int category): m_stream(stream), m_priority(priority), m_category(category) {
-		prefix(NULL, 0);
+		start(NULL, 0);
 	}
 
 	/** Create a new log entry in the specified log stream.
@@ -232,26 +289,27 @@ public:
 	 *  @param linenum line number of the code that generated this message (typically __LINE__).
 	 */
 	LogEntry(LogStream &stream, int priority, int category, const char *filename, int linenum): m_stream(stream), m_priority(priority), m_category(category) {
-		prefix(filename, linenum);
+		start(filename, linenum);
 	}
 
 	/** Write the buffered log entry to the logstream.  Locks the stream during the
 	 *  write operation if running in a multithreaded environment.  If the priority
-	 *  is cFatal, records a stack trace and aborts the program.
+	 *  is cFatal, records a stack trace and aborts the program.  In asynchronous
+	 *  mode the entry is queued instead.
 	 */
 	~LogEntry();
 
 	/** Stream operator for recording messages in the log entry.
 	 */
 	template <typename T> LogEntry & operator<<(T const& x) {
-		m_buffer << x;
+		if (m_async) std::get<LogRecord>(m_entry).put(x); else std::get<BufferStream>(m_entry) << x;
 		return *this;
 	}
 
 	/** Handle various ios formating objects (e.g., std::hex).
 	 */
 	template <typename T> LogEntry & operator<<(T& (*formatter)(T&)) {
-		m_buffer << formatter;
+		if (m_async) std::get<LogRecord>(m_entry).manipulate(formatter); else std::get<BufferStream>(m_entry) << formatter;
 		return *this;
 	}
 
@@ -267,13 +325,19 @@ public:
 	};
 
 private:
+	void start(const char *file, int linenum);
 	void prefix(const char *file, int linenum);
 	void die();
 
 	LogStream &m_stream;
 	int m_priority;
 	int m_category;
-	BufferStream m_buffer;
+	AsyncLog *m_async;
+
+	// the binary record in asynchronous mode, otherwise the text buffer.
+	// both are constructed on demand in the same storage, since initializing
+	// an ostream is relatively expensive.
+	std::variant<std::monostate, LogRecord, BufferStream> m_entry;
 };
 
 
@@ -25,6 +25,13 @@
 
 #include <csp/csplib/util/Noise.h>
 #include <csp/csplib/util/Random.h>
+#include <csp/csplib/util/SimdMath.h>
+#include <csp/csplib/thread/WorkerPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 
 namespace csp {
@@ -115,5 +122,290 @@ std::vector<float> Perlin1D::generate(int n, bool periodic, double timescale, do
 }
 
 
+namespace {
+
+// Evaluates noise for one (float) or four (simd::Vec4f) samples.
+template <typename T> struct Lanes;
+
+template <> struct Lanes<float> {
+	enum { N = 1 };
+	static float load(float const *p) { return *p; }
+};
+
+#ifdef CSP_SIMD_SSE2
+template <> struct Lanes<simd::Vec4f> {
+	enum { N = 4 };
+	static simd::Vec4f load(float const *p) { return simd::Vec4f::load(p); }
+};
+#endif
+
+// The twelve edge directions of a cube, padded to sixteen (see Perlin,
+// "Improving Noise", 2002).  Two dimensional noise uses the x and y
+// components, none of which are both zero.
+const float Gradients[16][3] = {
+	{ 1, 1, 0}, {-1, 1, 0}, { 1,-1, 0}, {-1,-1, 0},
+	{ 1, 0, 1}, {-1, 0, 1}, { 1, 0,-1}, {-1, 0,-1},
+	{ 0, 1, 1}, { 0,-1, 1}, { 0, 1,-1}, { 0,-1,-1},
+	{ 1, 1, 0}, {-1, 1, 0}, { 0,-1, 1}, { 0,-1,-1}
+};
+
+// Offset between octaves, so that the lattice points of successive octaves
+// do not coincide at the origin.
+const double OctaveShift = 19.1919;
+
+// Below this many samples per tile, generate() does not use any other threads.
+const int MinimumParallelSamples = 16384;
+
+// Worker threads shared by all noise fields, with one thread per processor
+// in addition to the caller.  The pool can only run one loop at a time, so
+// a tile generated while another thread holds the lock is computed by the
+// calling thread alone.
+WorkerPool &sharedPool(std::unique_lock<std::mutex> &lock) {
+	static std::mutex mutex;
+	static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+	lock = std::unique_lock<std::mutex>(mutex, std::try_to_lock);
+	return pool;
+}
+
+inline void cell(double p, int &i, float &f) {
+	const double fl = floor(p);
+	i = static_cast<int>(fl) & 255;
+	f = static_cast<float>(p - fl);
+}
+
+template <typename T>
+inline T fade(T t) {
+	return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+template <typename T>
+inline T lerp(T t, T a, T b) {
+	return a + t * (b - a);
+}
+
+} // namespace
+
+
+NoiseField::NoiseField(unsigned long seed, Basis basis): m_Basis(basis), m_Octaves(1), m_Persistence(0.5f), m_Lacunarity(2.0) {
+	setSeed(seed);
+}
+
+void NoiseField::setSeed(unsigned long seed) {
+	m_Seed = seed;
+	rng::Taus2 random;
+	random.setSeed(seed);
+	for (int i = 0; i < 256; ++i) m_Perm[i] = static_cast<unsigned char>(i);
+	for (int i = 255; i > 0; --i) {
+		std::swap(m_Perm[i], m_Perm[random.uniformInt(i + 1)]);
+	}
+	for (int i = 0; i < 256; ++i) {
+		m_Perm[i + 256] = m_Perm[i];
+		// the gradients and values are indexed by hash, which is already random.
+		float const *gradient = Gradients[i & 15];
+		m_GradX[i] = gradient[0];
+		m_GradY[i] = gradient[1];
+		m_GradZ[i] = gradient[2];
+		m_Value[i] = static_cast<float>(random.unit() * 2.0 - 1.0);
+	}
+}
+
+void NoiseField::setFractal(int octaves, float persistence, double lacunarity) {
+	m_Octaves = octaves;
+	m_Persistence = persistence;
+	m_Lacunarity = lacunarity;
+}
+
+template <typename T>
+T NoiseField::sample2(double const *x, double y) const {
+	const int N = Lanes<T>::N;
+	T sum(0.0f);
+	float amplitude = 1.0f;
+	double frequency = 1.0;
+	for (int octave = 0; octave < m_Octaves; ++octave) {
+		const double shift = octave * OctaveShift;
+		int Y;
+		float fy;
+		cell(y * frequency + shift, Y, fy);
+		float fx[N];
+		int hash[4][N];
+		for (int k = 0; k < N; ++k) {
+			int X;
+			cell(x[k] * frequency + shift, X, fx[k]);
+			const int a = m_Perm[X] + Y;
+			const int b = m_Perm[X + 1] + Y;
+			hash[0][k] = m_Perm[a];
+			hash[1][k] = m_Perm[b];
+			hash[2][k] = m_Perm[a + 1];
+			hash[3][k] = m_Perm[b + 1];
+		}
+		const T u = Lanes<T>::load(fx);
+		const T v(fy);
+		T n[4];
+		if (m_Basis == GRADIENT) {
+			const T x1 = u - 1.0f;
+			const T y1 = v - 1.0f;
+			float gx[4][N], gy[4][N];
+			for (int c = 0; c < 4; ++c) {
+				for (int k = 0; k < N; ++k) {
+					gx[c][k] = m_GradX[hash[c][k]];
+					gy[c][k] = m_GradY[hash[c][k]];
+				}
+			}
+			n[0] = Lanes<T>::load(gx[0]) * u + Lanes<T>::load(gy[0]) * v;
+			n[1] = Lanes<T>::load(gx[1]) * x1 + Lanes<T>::load(gy[1]) * v;
+			n[2] = Lanes<T>::load(gx[2]) * u + Lanes<T>::load(gy[2]) * y1;
+			n[3] = Lanes<T>::load(gx[3]) * x1 + Lanes<T>::load(gy[3]) * y1;
+		} else {
+			float value[4][N];
+			for (int c = 0; c < 4; ++c) {
+				for (int k = 0; k < N; ++k) value[c][k] = m_Value[hash[c][k]];
+				n[c] = Lanes<T>::load(value[c]);
+			}
+		}
+		const T s = fade(u);
+		const T t = fade(v);
+		sum += T(amplitude) * lerp(t, lerp(s, n[0], n[1]), lerp(s, n[2], n[3]));
+		amplitude *= m_Persistence;
+		frequency *= m_Lacunarity;
+	}
+	return sum;
+}
+
+template <typename T>
+T NoiseField::sample3(double const *x, double y, double z) const {
+	const int N = Lanes<T>::N;
+	T sum(0.0f);
+	float amplitude = 1.0f;
+	double frequency = 1.0;
+	for (int octave = 0; octave < m_Octaves; ++octave) {
+		const double shift = octave * OctaveShift;
+		int Y, Z;
+		float fy, fz;
+		cell(y * frequency + shift, Y, fy);
+		cell(z * frequency + shift, Z, fz);
+		float fx[N];
+		int hash[8][N];
+		for (int k = 0; k < N; ++k) {
+			int X;
+			cell(x[k] * frequency + shift, X, fx[k]);
+			const int a = m_Perm[X] + Y;
+			const int b = m_Perm[X + 1] + Y;
+			const int aa = m_Perm[a] + Z;
+			const int ba = m_Perm[b] + Z;
+			const int ab = m_Perm[a + 1] + Z;
+			const int bb = m_Perm[b + 1] + Z;
+			hash[0][k] = m_Perm[aa];
+			hash[1][k] = m_Perm[ba];
+			hash[2][k] = m_Perm[ab];
+			hash[3][k] = m_Perm[bb];
+			hash[4][k] = m_Perm[aa + 1];
+			hash[5][k] = m_Perm[ba + 1];
+			hash[6][k] = m_Perm[ab + 1];
+			hash[7][k] = m_Perm[bb + 1];
+		}
+		const T u = Lanes<T>::load(fx);
+		const T v(fy);
+		const T w(fz);
+		T n[8];
+		if (m_Basis == GRADIENT) {
+			const T x1 = u - 1.0f;
+			const T y1 = v - 1.0f;
+			const T z1 = w - 1.0f;
+			float gx[8][N], gy[8][N], gz[8][N];
+			for (int c = 0; c < 8; ++c) {
+				for (int k = 0; k < N; ++k) {
+					gx[c][k] = m_GradX[hash[c][k]];
+					gy[c][k] = m_GradY[hash[c][k]];
+					gz[c][k] = m_GradZ[hash[c][k]];
+				}
+			}
+			// corner c is at (c & 1, (c >> 1) & 1, c >> 2).
+			for (int c = 0; c < 8; ++c) {
+				const T dx = (c & 1) ? x1 : u;
+				const T dy = (c & 2) ? y1 : v;
+				const T dz = (c & 4) ? z1 : w;
+				n[c] = Lanes<T>::load(gx[c]) * dx + Lanes<T>::load(gy[c]) * dy + Lanes<T>::load(gz[c]) * dz;
+			}
+		} else {
+			float value[8][N];
+			for (int c = 0; c < 8; ++c) {
+				for (int k = 0; k < N; ++k) value[c][k] = m_Value[hash[c][k]];
+				n[c] = Lanes<T>::load(value[c]);
+			}
+		}
+		const T s = fade(u);
+		const T t = fade(v);
+		const T r = fade(w);
+		const T lo = lerp(t, lerp(s, n[0], n[1]), lerp(s, n[2], n[3]));
+		const T hi = lerp(t, lerp(s, n[4], n[5]), lerp(s, n[6], n[7]));
+		sum += T(amplitude) * lerp(r, lo, hi);
+		amplitude *= m_Persistence;
+		frequency *= m_Lacunarity;
+	}
+	return sum;
+}
+
+float NoiseField::getValue(double x, double y) const {
+	return sample2<float>(&x, y);
+}
+
+float NoiseField::getValue(double x, double y, double z) const {
+	return sample3<float>(&x, y, z);
+}
+
+void NoiseField::generateRow(float *row, int n, double x0, double y, double z, double dx, bool volume) const {
+	double x[4];
+	int i = 0;
+#ifdef CSP_SIMD_SSE2
+	for (; i + 3 < n; i += 4) {
+		for (int k = 0; k < 4; ++k) x[k] = x0 + (i + k) * dx;
+		const simd::Vec4f value = volume ? sample3<simd::Vec4f>(x, y, z) : sample2<simd::Vec4f>(x, y);
+		value.store(row + i);
+	}
+#endif
+	for (; i < n; ++i) {
+		x[0] = x0 + i * dx;
+		row[i] = volume ? sample3<float>(x, y, z) : sample2<float>(x, y);
+	}
+}
+
+void NoiseField::generateRows(float *tile, int nx, int ny, int nz, double x0, double y0, double z0, double spacing, bool volume, unsigned threads) const {
+	const int rows = ny * nz;
+	if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+	if (nx * rows < MinimumParallelSamples) threads = 1;
+	threads = std::max(1u, std::min<unsigned>(threads, rows));
+	std::atomic<int> next(0);
+	auto job = [&](unsigned) {
+		for (int r = next++; r < rows; r = next++) {
+			const double y = y0 + (r % ny) * spacing;
+			const double z = z0 + (r / ny) * spacing;
+			generateRow(tile + r * nx, nx, x0, y, z, spacing, volume);
+		}
+	};
+	if (threads > 1) {
+		std::unique_lock<std::mutex> lock;
+		WorkerPool &pool = sharedPool(lock);
+		if (lock.owns_lock()) {
+			pool.run(std::min(threads, pool.size()), job);
+			return;
+		}
+	}
+	job(0);
+}
+
+void NoiseField::generate(std::vector<float> &tile, int nx, int ny, double x0, double y0, double spacing, unsigned threads) const {
+	tile.resize(std::max(0, nx * ny));
+	if (tile.empty()) return;
+	generateRows(&tile[0], nx, ny, 1, x0, y0, 0.0, spacing, false, threads);
+}
+
+void NoiseField::generate(std::vector<float> &tile, int nx, int ny, int nz, double x0, double y0, double z0, double spacing, unsigned threads) const {
+	tile.resize(std::max(0, nx * ny * nz));
+	if (tile.empty()) return;
+	generateRows(&tile[0], nx, ny, nz, x0, y0, z0, spacing, true, threads);
+}
+
+
+
 } // namespace csp
 
@@ -197,4 +197,104 @@ private:
 };
 
 
+/**
+ * @brief Two and three dimensional gradient and value noise.
+ *
+ * The noise is defined by a 256 cell lattice that repeats in each
+ * dimension.  The lattice is shuffled by a Taus2 generator with the given
+ * seed, so a seed shared between hosts (e.g., by the server) produces the
+ * same field everywhere.  Gradient noise is Perlin's improved noise, which
+ * is zero at the lattice points; value noise interpolates random values at
+ * the lattice points.  Both range roughly from -1 to 1 per octave.
+ *
+ * Multiple octaves are summed as fractal noise, with the amplitude scaled
+ * by the persistence and the frequency by the lacunarity between octaves.
+ *
+ * The generate() methods fill a rectangular tile of samples, evaluating
+ * four samples at a time with SSE instructions if available and splitting
+ * the rows between a pool of worker threads shared by all noise fields.  The results are identical to
+ * getValue() at the same positions, independent of the number of threads.
+ */
+class CSPLIB_EXPORT NoiseField {
+public:
+	typedef enum { GRADIENT, VALUE } Basis;
+
+	/**
+	 * Construct a noise field with a single octave.
+	 *
+	 * @param seed the seed used to generate the noise lattice
+	 * @param basis the type of noise
+	 */
+	NoiseField(unsigned long seed=0, Basis basis=GRADIENT);
+
+	/**
+	 * Regenerate the noise lattice from a new seed.
+	 */
+	void setSeed(unsigned long seed);
+	unsigned long getSeed() const { return m_Seed; }
+
+	void setBasis(Basis basis) { m_Basis = basis; }
+	Basis getBasis() const { return m_Basis; }
+
+	/**
+	 * Set the fractal sum parameters.
+	 *
+	 * @param octaves number of octaves to sum
+	 * @param persistence amplitude scale factor between succesive octaves
+	 * @param lacunarity frequency scale factor between succesive octaves
+	 */
+	void setFractal(int octaves, float persistence=0.5f, double lacunarity=2.0);
+
+	/**
+	 * Get the noise value at a point in the plane.  Coordinates are in
+	 * lattice units, and should be less than 2^31 in magnitude.
+	 */
+	float getValue(double x, double y) const;
+
+	/**
+	 * Get the noise value at a point in space.
+	 */
+	float getValue(double x, double y, double z) const;
+
+	/**
+	 * Generate a two dimensional tile of noise values.
+	 *
+	 * The sample at (i, j) is stored at tile[i + j * nx], and is equal to
+	 * getValue(x0 + i * spacing, y0 + j * spacing).
+	 *
+	 * @param tile Output: the noise values
+	 * @param nx, ny the number of samples in each dimension
+	 * @param x0, y0 the position of the first sample
+	 * @param spacing the distance between samples
+	 * @param threads the maximum number of threads to use, or 0 for one
+	 *   thread per processor
+	 */
+	void generate(std::vector<float> &tile, int nx, int ny, double x0, double y0, double spacing, unsigned threads=0) const;
+
+	/**
+	 * Generate a three dimensional tile of noise values.  The sample at
+	 * (i, j, k) is stored at tile[i + (j + k * ny) * nx].  See the two
+	 * dimensional version for details.
+	 */
+	void generate(std::vector<float> &tile, int nx, int ny, int nz, double x0, double y0, double z0, double spacing, unsigned threads=0) const;
+
+private:
+	template <typename T> T sample2(double const *x, double y) const;
+	template <typename T> T sample3(double const *x, double y, double z) const;
+	void generateRow(float *row, int n, double x0, double y, double z, double dx, bool volume) const;
+	void generateRows(float *tile, int nx, int ny, int nz, double x0, double y0, double z0, double spacing, bool volume, unsigned threads) const;
+
+	unsigned long m_Seed;
+	Basis m_Basis;
+	int m_Octaves;
+	float m_Persistence;
+	double m_Lacunarity;
+	unsigned char m_Perm[512];
+	float m_GradX[256];
+	float m_GradY[256];
+	float m_GradZ[256];
+	float m_Value[256];
+};
+
+
 } // namespace csp
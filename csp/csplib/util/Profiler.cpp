@@ -0,0 +1,423 @@
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+/**
+ * @file Profiler.cpp
+ * @brief Low overhead hierarchical profiler for real-time code.
+ */
+
+
+#include <csp/csplib/util/Profiler.h>
+#include <csp/csplib/util/Log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+
+namespace csp {
+
+namespace {
+
+// per-thread buffer size in events (must be a power of two).
+const uint32_t BUFFER_SIZE = 1 << 14;
+
+// statistics smoothing and peak hold intervals, in frames.
+const double AVERAGE_WEIGHT = 0.05;
+const uint64_t PEAK_WINDOW = 120;
+
+const std::chrono::steady_clock::time_point g_Epoch = std::chrono::steady_clock::now();
+
+void writeJsonString(std::ostream &os, std::string const &s) {
+	os << '"';
+	for (std::string::const_iterator iter = s.begin(); iter != s.end(); ++iter) {
+		const unsigned char c = static_cast<unsigned char>(*iter);
+		if (c == '"' || c == '\\') {
+			os << '\\' << *iter;
+		} else if (c < 0x20) {
+			char escape[8];
+			snprintf(escape, sizeof(escape), "\\u%04x", c);
+			os << escape;
+		} else {
+			os << *iter;
+		}
+	}
+	os << '"';
+}
+
+} // namespace
+
+
+/** A single producer, single consumer ring of events.  Written only by
+ *  the owning thread, and drained only by the thread calling frame().
+ */
+class Profiler::Buffer {
+public:
+	Buffer(uint32_t index): m_Events(BUFFER_SIZE), m_Head(0), m_Tail(0), m_Dropped(0), m_Index(index), m_Released(false) { }
+
+	void push(Event const &event) {
+		const uint32_t head = m_Head.load(std::memory_order_relaxed);
+		if (head - m_Tail.load(std::memory_order_acquire) >= BUFFER_SIZE) {
+			m_Dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		m_Events[head & (BUFFER_SIZE - 1)] = event;
+		m_Head.store(head + 1, std::memory_order_release);
+	}
+
+	template <class F>
+	void drain(F &f) {
+		uint32_t tail = m_Tail.load(std::memory_order_relaxed);
+		const uint32_t head = m_Head.load(std::memory_order_acquire);
+		for (; tail != head; ++tail) f.collect(m_Events[tail & (BUFFER_SIZE - 1)]);
+		m_Tail.store(tail, std::memory_order_release);
+	}
+
+	bool empty() const { return m_Head.load(std::memory_order_acquire) == m_Tail.load(std::memory_order_acquire); }
+	uint64_t dropped() const { return m_Dropped.load(std::memory_order_relaxed); }
+	uint32_t index() const { return m_Index; }
+
+	// the following are guarded by the profiler buffer mutex.
+	std::string name;
+	bool isReleased() const { return m_Released; }
+	void setReleased(bool released) { m_Released = released; }
+
+private:
+	std::vector<Event> m_Events;
+	std::atomic<uint32_t> m_Head;
+	std::atomic<uint32_t> m_Tail;
+	std::atomic<uint64_t> m_Dropped;
+	const uint32_t m_Index;
+	bool m_Released;
+};
+
+
+/** Holds the buffer of the current thread, and returns it to the profiler
+ *  for reuse when the thread exits.
+ */
+class Profiler::BufferHolder {
+public:
+	BufferHolder(): buffer(0) { }
+	~BufferHolder() {
+		if (buffer) {
+			Profiler &profiler = Profiler::getInstance();
+			std::lock_guard<std::mutex> lock(profiler.m_BufferMutex);
+			buffer->setReleased(true);
+		}
+	}
+	Buffer *buffer;
+};
+
+
+std::atomic<bool> Profiler::s_Enabled(false);
+
+Profiler &Profiler::getInstance() {
+	// never destroyed, since other threads may record events during exit.
+	static Profiler *instance = new Profiler;
+	return *instance;
+}
+
+Profiler::Profiler():
+	m_HistoryFrames(300),
+	m_FrameCount(0),
+	m_LastFrame(now()),
+	m_FrameTime(0.0),
+	m_PeakFrameTime(0.0),
+	m_WindowPeakFrameTime(0.0),
+	m_SpikeThreshold(0.0),
+	m_SpikeLimit(0),
+	m_SpikeCount(0)
+{
+}
+
+Profiler::~Profiler() {
+}
+
+int64_t Profiler::now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_Epoch).count();
+}
+
+void Profiler::setEnabled(bool enabled) {
+	s_Enabled.store(enabled);
+	CSPLOG(Prio_INFO, Cat_APP) << "Profiler " << (enabled ? "enabled" : "disabled");
+}
+
+Profiler::Buffer *Profiler::getBuffer() {
+	static thread_local BufferHolder holder;
+	if (!holder.buffer) holder.buffer = getInstance().allocateBuffer();
+	return holder.buffer;
+}
+
+Profiler::Buffer *Profiler::allocateBuffer() {
+	std::lock_guard<std::mutex> lock(m_BufferMutex);
+	// reuse the buffer of a thread that has exited, once it has been drained.
+	for (unsigned i = 0; i < m_Buffers.size(); ++i) {
+		Buffer *buffer = m_Buffers[i].get();
+		if (buffer->isReleased() && buffer->empty()) {
+			buffer->setReleased(false);
+			buffer->name.clear();
+			return buffer;
+		}
+	}
+	m_Buffers.push_back(std::unique_ptr<Buffer>(new Buffer(static_cast<uint32_t>(m_Buffers.size()))));
+	return m_Buffers.back().get();
+}
+
+void Profiler::push(uint32_t type, const void *key, double value) {
+	Buffer *buffer = getBuffer();
+	Event event;
+	event.time = now();
+	event.key = key;
+	event.value = value;
+	event.type = type;
+	event.thread = buffer->index();
+	buffer->push(event);
+}
+
+void Profiler::begin(ProfileZone const *zone) {
+	push(EVENT_BEGIN, zone, 0.0);
+}
+
+void Profiler::end(ProfileZone const *zone) {
+	push(EVENT_END, zone, 0.0);
+}
+
+void Profiler::counter(const char *name, double value) {
+	push(EVENT_COUNTER, name, value);
+}
+
+void Profiler::setThreadName(std::string const &name) {
+	Buffer *buffer = getBuffer();
+	Profiler &profiler = getInstance();
+	std::lock_guard<std::mutex> lock(profiler.m_BufferMutex);
+	buffer->name = name;
+}
+
+std::string Profiler::getThreadName(unsigned thread) const {
+	std::lock_guard<std::mutex> lock(m_BufferMutex);
+	return (thread < m_Buffers.size()) ? m_Buffers[thread]->name : std::string();
+}
+
+uint64_t Profiler::getDropped() const {
+	std::lock_guard<std::mutex> lock(m_BufferMutex);
+	uint64_t dropped = 0;
+	for (unsigned i = 0; i < m_Buffers.size(); ++i) dropped += m_Buffers[i]->dropped();
+	return dropped;
+}
+
+void Profiler::collect(Event const &event) {
+	m_Frame.push_back(event);
+	if (event.thread >= m_Stacks.size()) m_Stacks.resize(event.thread + 1);
+	std::vector<std::pair<ProfileZone const*, int64_t> > &stack = m_Stacks[event.thread];
+	if (event.type == EVENT_BEGIN) {
+		stack.push_back(std::make_pair(static_cast<ProfileZone const*>(event.key), event.time));
+	} else if (event.type == EVENT_END) {
+		// ignore unmatched ends, which occur if profiling is enabled inside
+		// a zone, and close any inner zones whose ends were dropped.
+		unsigned match = static_cast<unsigned>(stack.size());
+		while (match > 0 && stack[match - 1].first != event.key) --match;
+		if (match == 0) return;
+		stack.resize(match);
+		const unsigned depth = static_cast<unsigned>(stack.size() - 1);
+		const int64_t elapsed = event.time - stack.back().second;
+		stack.pop_back();
+		const NodeIndex::key_type key(std::make_pair(static_cast<ProfileZone const*>(event.key), event.thread), depth);
+		NodeIndex::iterator iter = m_NodeIndex.find(key);
+		if (iter == m_NodeIndex.end()) {
+			Node node;
+			node.stats.name = static_cast<ProfileZone const*>(event.key)->name;
+			node.stats.thread = event.thread;
+			node.stats.depth = depth;
+			node.stats.calls = 0;
+			node.stats.last = 0.0;
+			node.stats.average = 0.0;
+			node.stats.peak = 0.0;
+			node.total = 0;
+			node.window_peak = 0.0;
+			iter = m_NodeIndex.insert(std::make_pair(key, static_cast<unsigned>(m_Nodes.size()))).first;
+			m_Nodes.push_back(node);
+		}
+		Node &node = m_Nodes[iter->second];
+		node.total += elapsed;
+		++node.stats.calls;
+	}
+}
+
+void Profiler::frame() {
+	const int64_t time = now();
+	m_FrameTime = (time - m_LastFrame) * 1e-9;
+	m_LastFrame = time;
+	++m_FrameCount;
+
+	for (std::vector<Node>::iterator node = m_Nodes.begin(); node != m_Nodes.end(); ++node) {
+		node->total = 0;
+		node->stats.calls = 0;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_BufferMutex);
+		for (unsigned i = 0; i < m_Buffers.size(); ++i) m_Buffers[i]->drain(*this);
+	}
+	// events from different threads are interleaved by time for export.
+	std::stable_sort(m_Frame.begin(), m_Frame.end(), [](Event const &a, Event const &b) { return a.time < b.time; });
+
+	const bool new_window = (m_FrameCount % PEAK_WINDOW) == 0;
+	for (std::vector<Node>::iterator node = m_Nodes.begin(); node != m_Nodes.end(); ++node) {
+		const double last = node->total * 1e-9;
+		node->stats.last = last;
+		node->stats.average += AVERAGE_WEIGHT * (last - node->stats.average);
+		node->window_peak = std::max(node->window_peak, last);
+		node->stats.peak = std::max(node->stats.peak, last);
+		if (new_window) {
+			node->stats.peak = node->window_peak;
+			node->window_peak = 0.0;
+		}
+	}
+	m_WindowPeakFrameTime = std::max(m_WindowPeakFrameTime, m_FrameTime);
+	m_PeakFrameTime = std::max(m_PeakFrameTime, m_FrameTime);
+	if (new_window) {
+		m_PeakFrameTime = m_WindowPeakFrameTime;
+		m_WindowPeakFrameTime = 0.0;
+	}
+
+	if (isEnabled() || !m_Frame.empty()) {
+		Event marker;
+		marker.time = time;
+		marker.key = "frame";
+		marker.value = m_FrameTime;
+		marker.type = EVENT_FRAME;
+		marker.thread = getBuffer()->index();
+		m_Frame.push_back(marker);
+		m_History.push_back(std::vector<Event>());
+		m_History.back().swap(m_Frame);
+		while (m_History.size() > m_HistoryFrames) {
+			// recycle the oldest frame's storage.
+			m_Frame.swap(m_History.front());
+			m_Frame.clear();
+			m_History.pop_front();
+		}
+		if (m_SpikeThreshold > 0.0 && m_FrameTime > m_SpikeThreshold && m_FrameCount > 1 && isEnabled()) {
+			capture();
+		}
+	}
+}
+
+void Profiler::capture() {
+	if (m_SpikeCount >= m_SpikeLimit) return;
+	char path[512];
+	snprintf(path, sizeof(path), "%s-%03u.json", m_SpikePrefix.c_str(), m_SpikeCount++);
+	CSPLOG(Prio_WARNING, Cat_APP) << "Frame time " << (m_FrameTime * 1000.0) << " ms exceeded the profiler spike threshold, writing " << path;
+	if (!writeTrace(path)) {
+		CSPLOG(Prio_ERROR, Cat_APP) << "Unable to write profiler trace " << path;
+	}
+}
+
+void Profiler::getZoneStats(std::vector<ZoneStats> &stats) const {
+	stats.clear();
+	stats.reserve(m_Nodes.size());
+	for (std::vector<Node>::const_iterator node = m_Nodes.begin(); node != m_Nodes.end(); ++node) {
+		stats.push_back(node->stats);
+	}
+	std::stable_sort(stats.begin(), stats.end(), [](ZoneStats const &a, ZoneStats const &b) { return a.thread < b.thread; });
+}
+
+void Profiler::setHistory(unsigned frames) {
+	m_HistoryFrames = std::max(1u, frames);
+	while (m_History.size() > m_HistoryFrames) m_History.pop_front();
+}
+
+void Profiler::setSpikeCapture(double threshold, std::string const &prefix, unsigned limit) {
+	m_SpikeThreshold = threshold;
+	m_SpikePrefix = prefix;
+	m_SpikeLimit = limit;
+	m_SpikeCount = 0;
+}
+
+void Profiler::writeTrace(std::ostream &os) const {
+	std::vector<std::string> names;
+	{
+		std::lock_guard<std::mutex> lock(m_BufferMutex);
+		for (unsigned i = 0; i < m_Buffers.size(); ++i) names.push_back(m_Buffers[i]->name);
+	}
+
+	os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	for (unsigned i = 0; i < names.size(); ++i) {
+		if (names[i].empty()) continue;
+		os << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i << ",\"args\":{\"name\":";
+		writeJsonString(os, names[i]);
+		os << "}}";
+		first = false;
+	}
+
+	// drop ends of zones that began before the oldest retained frame.
+	std::vector<unsigned> depth(names.size(), 0);
+	const std::ios::fmtflags flags = os.flags();
+	os << std::fixed << std::setprecision(3);
+	for (std::deque<std::vector<Event> >::const_iterator frame = m_History.begin(); frame != m_History.end(); ++frame) {
+		for (std::vector<Event>::const_iterator event = frame->begin(); event != frame->end(); ++event) {
+			if (event->thread >= depth.size()) depth.resize(event->thread + 1, 0);
+			const char *name = 0;
+			const char *phase = 0;
+			switch (event->type) {
+				case EVENT_BEGIN:
+					name = static_cast<ProfileZone const*>(event->key)->name;
+					phase = "B";
+					++depth[event->thread];
+					break;
+				case EVENT_END:
+					if (depth[event->thread] == 0) continue;
+					name = static_cast<ProfileZone const*>(event->key)->name;
+					phase = "E";
+					--depth[event->thread];
+					break;
+				case EVENT_COUNTER:
+					name = static_cast<const char*>(event->key);
+					phase = "C";
+					break;
+				default:
+					name = "frame";
+					phase = "i";
+					break;
+			}
+			os << (first ? "" : ",\n") << "{\"name\":";
+			writeJsonString(os, name);
+			os << ",\"ph\":\"" << phase << "\",\"ts\":" << (event->time * 1e-3) << ",\"pid\":1,\"tid\":" << event->thread;
+			if (event->type == EVENT_COUNTER) {
+				os << ",\"args\":{\"value\":" << event->value << "}";
+			} else if (event->type == EVENT_FRAME) {
+				os << ",\"s\":\"g\",\"args\":{\"ms\":" << (event->value * 1000.0) << "}";
+			}
+			os << "}";
+			first = false;
+		}
+	}
+	os << "\n]}\n";
+	os.flags(flags);
+}
+
+bool Profiler::writeTrace(std::string const &path) const {
+	std::ofstream os(path.c_str());
+	if (!os) return false;
+	writeTrace(os);
+	return static_cast<bool>(os);
+}
+
+} // namespace csp
+
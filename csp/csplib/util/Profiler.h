@@ -0,0 +1,266 @@
+#pragma once
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+
+/**
+ * @file Profiler.h
+ * @brief Low overhead hierarchical profiler for real-time code.
+ *
+ * Place CSP_PROFILE_ZONE("name") at the start of a block to time the rest
+ * of that block.  Zones can be nested, and may be used from any thread.
+ * CSP_PROFILE_COUNTER("name", value) records a numeric value (e.g. the
+ * number of objects updated) alongside the zones.  The main loop calls
+ * Profiler::getInstance().frame() once per frame to collect the events.
+ *
+ * Profiling is disabled by default, in which case each zone costs a single
+ * relaxed atomic load.  Defining CSP_DISABLE_PROFILER removes the zones
+ * entirely at compile time.
+ */
+
+#include <csp/csplib/util/Export.h>
+#include <csp/csplib/util/Properties.h>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace csp {
+
+
+/** Static description of a profiling zone.  Instances are created by
+ *  CSP_PROFILE_ZONE, one per call site, and identify the zone in the
+ *  collected events.
+ */
+struct ProfileZone {
+	ProfileZone(const char *name_, const char *file_, int line_): name(name_), file(file_), line(line_) { }
+	const char *name;
+	const char *file;
+	int line;
+};
+
+
+/** Collects timing events from all threads, aggregates per-zone statistics
+ *  for each frame, and keeps a short history of raw events that can be
+ *  exported in the Chrome trace event format (load the file in
+ *  chrome://tracing or https://ui.perfetto.dev).
+ *
+ *  Each thread writes events to its own fixed size ring buffer without
+ *  locking; the buffer is allocated when the thread records its first
+ *  event.  The buffers are drained by frame(), which must be called
+ *  periodically by a single thread (normally the main loop).  Events are
+ *  discarded if a buffer fills up between calls to frame().  All the
+ *  methods that report statistics or write traces must be called from the
+ *  same thread as frame().
+ */
+class CSPLIB_EXPORT Profiler: public NonCopyable {
+public:
+	/** Statistics for one zone, aggregated over each frame.  Zones are
+	 *  distinguished by call site, thread, and nesting depth.  Times are
+	 *  in seconds.
+	 */
+	struct ZoneStats {
+		const char *name;
+		unsigned thread;
+		unsigned depth;
+		unsigned calls;    // number of times the zone ended in the last frame.
+		double last;       // total time spent in the zone in the last frame.
+		double average;    // smoothed time per frame.
+		double peak;       // maximum time per frame over the last few seconds.
+	};
+
+	/** Get the profiler instance.
+	 */
+	static Profiler &getInstance();
+
+	/** Returns true if events are being recorded.
+	 */
+	static bool isEnabled() { return s_Enabled.load(std::memory_order_relaxed); }
+
+	/** Enable or disable event recording.
+	 */
+	void setEnabled(bool enabled);
+
+	/** Record the start and end of a zone in the current thread.  Normally
+	 *  called by ProfileScope (see CSP_PROFILE_ZONE).
+	 */
+	static void begin(ProfileZone const *zone);
+	static void end(ProfileZone const *zone);
+
+	/** Record a named value.  The name must be a string literal, or
+	 *  otherwise remain valid for the lifetime of the program.
+	 */
+	static void counter(const char *name, double value);
+
+	/** Set the name of the current thread, as shown in traces.
+	 */
+	static void setThreadName(std::string const &name);
+
+	/** Get the name of a thread, as reported by ZoneStats::thread.
+	 *  Returns an empty string if the thread has not been named.
+	 */
+	std::string getThreadName(unsigned thread) const;
+
+	/** Mark the end of a frame.  Collects the events recorded by all
+	 *  threads since the previous call and updates the zone statistics.
+	 */
+	void frame();
+
+	/** The number of frames marked so far. */
+	uint64_t getFrameCount() const { return m_FrameCount; }
+
+	/** The duration of the last frame in seconds. */
+	double getFrameTime() const { return m_FrameTime; }
+
+	/** The longest frame over the last few seconds. */
+	double getPeakFrameTime() const { return m_PeakFrameTime; }
+
+	/** The number of events discarded because a thread buffer was full. */
+	uint64_t getDropped() const;
+
+	/** Get the statistics of all zones seen so far, ordered by thread and
+	 *  then by the order in which the zones were first seen.
+	 */
+	void getZoneStats(std::vector<ZoneStats> &stats) const;
+
+	/** Set the number of frames of raw events retained for export.  The
+	 *  default is 300.
+	 */
+	void setHistory(unsigned frames);
+
+	/** Write the retained events in Chrome trace event (JSON) format.
+	 */
+	void writeTrace(std::ostream &os) const;
+
+	/** Write the retained events to a file in Chrome trace event format.
+	 *  @return false if the file could not be written.
+	 */
+	bool writeTrace(std::string const &path) const;
+
+	/** Automatically write a trace whenever a frame takes longer than
+	 *  the specified time.  The traces are written to files named
+	 *  prefix-NNN.json, and at most limit traces are written.
+	 *
+	 *  @param threshold the frame time in seconds; zero disables capture.
+	 */
+	void setSpikeCapture(double threshold, std::string const &prefix="profile-spike", unsigned limit=10);
+
+private:
+	enum { EVENT_BEGIN, EVENT_END, EVENT_COUNTER, EVENT_FRAME };
+
+	struct Event {
+		int64_t time;        // nanoseconds since the profiler was created.
+		const void *key;     // ProfileZone, or counter name.
+		double value;
+		uint32_t type;
+		uint32_t thread;
+	};
+
+	class Buffer;
+	class BufferHolder;
+	friend class BufferHolder;
+
+	struct Node {
+		ZoneStats stats;
+		int64_t total;
+		double window_peak;
+	};
+
+	Profiler();
+	~Profiler();
+
+	static int64_t now();
+	static Buffer *getBuffer();
+	static void push(uint32_t type, const void *key, double value);
+	Buffer *allocateBuffer();
+	void collect(Event const &event);
+	void capture();
+
+	static std::atomic<bool> s_Enabled;
+
+	mutable std::mutex m_BufferMutex;
+	std::vector<std::unique_ptr<Buffer> > m_Buffers;
+
+	// collected state, owned by the thread calling frame().
+	std::vector<std::vector<std::pair<ProfileZone const*, int64_t> > > m_Stacks;
+	typedef std::map<std::pair<std::pair<ProfileZone const*, unsigned>, unsigned>, unsigned> NodeIndex;
+	NodeIndex m_NodeIndex;
+	std::vector<Node> m_Nodes;
+	std::deque<std::vector<Event> > m_History;
+	std::vector<Event> m_Frame;
+	unsigned m_HistoryFrames;
+	uint64_t m_FrameCount;
+	int64_t m_LastFrame;
+	double m_FrameTime;
+	double m_PeakFrameTime;
+	double m_WindowPeakFrameTime;
+	double m_SpikeThreshold;
+	std::string m_SpikePrefix;
+	unsigned m_SpikeLimit;
+	unsigned m_SpikeCount;
+};
+
+
+/** Records a zone for the lifetime of the instance.  See CSP_PROFILE_ZONE.
+ */
+class ProfileScope: public NonCopyable {
+public:
+	explicit ProfileScope(ProfileZone const *zone): m_Zone(Profiler::isEnabled() ? zone : 0) {
+		if (m_Zone) Profiler::begin(m_Zone);
+	}
+	~ProfileScope() {
+		if (m_Zone) Profiler::end(m_Zone);
+	}
+private:
+	ProfileZone const *m_Zone;
+};
+
+
+} // namespace csp
+
+
+#define CSP_PROFILE_CONCAT_(a, b) a##b
+#define CSP_PROFILE_CONCAT(a, b) CSP_PROFILE_CONCAT_(a, b)
+
+#ifndef CSP_DISABLE_PROFILER
+
+/** Time the remainder of the enclosing block as a profiling zone.  The
+ *  name must be a string literal.
+ */
+#define CSP_PROFILE_ZONE(name) \
+	static const csp::ProfileZone CSP_PROFILE_CONCAT(_csp_profile_zone_, __LINE__)(name, __FILE__, __LINE__); \
+	csp::ProfileScope CSP_PROFILE_CONCAT(_csp_profile_scope_, __LINE__)(&CSP_PROFILE_CONCAT(_csp_profile_zone_, __LINE__))
+
+/** Record a named value.  The name must be a string literal.
+ */
+#define CSP_PROFILE_COUNTER(name, value) \
+	if (!csp::Profiler::isEnabled()) ; else csp::Profiler::counter(name, static_cast<double>(value))
+
+#else
+
+#define CSP_PROFILE_ZONE(name)
+#define CSP_PROFILE_COUNTER(name, value)
+
+#endif // CSP_DISABLE_PROFILER
+
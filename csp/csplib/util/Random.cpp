@@ -24,23 +24,300 @@
  */
 
 #include <csp/csplib/util/Random.h>
+#include <csp/csplib/util/SimdMath.h>
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
 
 namespace csp {
+
+namespace {
+
+// Conversion of 32-bit words to the output types of the fill() methods.  Floats
+// use the upper 24 bits, so that the values are exact and less than one.
+const float FloatScale = 1.0f / 16777216.0f;
+
+inline void convert(uint32_t k, uint32_t &value) { value = k; }
+inline void convert(uint32_t k, float &value) { value = static_cast<float>(k >> 8) * FloatScale; }
+inline void convert(uint32_t k, double &value) { value = k / 4294967296.0; }
+
+#ifdef CSP_SIMD_SSE2
+
+inline simd::Vec4i temper4(simd::Vec4i k) {
+	k = k ^ (k >> 11);
+	k = k ^ ((k << 7) & simd::Vec4i(0x9d2c5680UL));
+	k = k ^ ((k << 15) & simd::Vec4i(0xefc60000UL));
+	return k ^ (k >> 18);
+}
+
+inline void store4(simd::Vec4i k, uint32_t *values) {
+	k.store(values);
+}
+
+inline void store4(simd::Vec4i k, float *values) {
+	(simd::toFloat(k >> 8) * simd::Vec4f(FloatScale)).store(values);
+}
+
+inline void store4(simd::Vec4i k, double *values) {
+	// there is no unsigned conversion, so offset the words into the signed range and back.
+	const simd::Vec2d offset(2147483648.0);
+	const simd::Vec2d scale(1.0 / 4294967296.0);
+	k = k ^ simd::Vec4i(0x80000000UL);
+	((simd::toDoubleLow(k) + offset) * scale).store(values);
+	((simd::toDoubleHigh(k) + offset) * scale).store(values + 2);
+}
+
+#endif // CSP_SIMD_SSE2
+
+// Polar (Box-Mueller) method; See Knuth v2, 3rd ed, p122
+template <class RNG>
+inline void polar(RNG &gen, double mean, double sigma, double &first, double &second) {
+	double x, y, r2;
+	do {
+		x = -1.0 + 2.0 * gen.unit();
+		y = -1.0 + 2.0 * gen.unit();
+		r2 = x*x + y*y;
+	} while (r2 > 1.0 || r2 == 0.0);
+	double f = sigma * ::sqrt(-2.0 * ::log(r2) / r2);
+	first = mean + y * f;
+	second = mean + x * f;
+}
+
+template <class RNG>
+void fillGaussian(RNG &gen, float *values, int n, double mean, double sigma) {
+	double first, second;
+	for (int i = 0; i < n; i += 2) {
+		polar(gen, mean, sigma, first, second);
+		values[i] = static_cast<float>(first);
+		if (i + 1 < n) values[i + 1] = static_cast<float>(second);
+	}
+}
+
+inline uint64_t parity(uint64_t x) {
+	x ^= x >> 32;
+	x ^= x >> 16;
+	x ^= x >> 8;
+	x ^= x >> 4;
+	x ^= x >> 2;
+	x ^= x >> 1;
+	return x & 1;
+}
+
+// Spread the bits of a 32-bit word over the even bits of a 64-bit word, which
+// squares the corresponding polynomial over GF(2).
+inline uint64_t spread(uint64_t x) {
+	x = (x | (x << 16)) & 0x0000ffff0000ffffULL;
+	x = (x | (x << 8)) & 0x00ff00ff00ff00ffULL;
+	x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	x = (x | (x << 2)) & 0x3333333333333333ULL;
+	x = (x | (x << 1)) & 0x5555555555555555ULL;
+	return x;
+}
+
+inline bool getBit(std::vector<uint64_t> const &bits, int i) { return (bits[i >> 6] >> (i & 63)) & 1; }
+inline void flipBit(std::vector<uint64_t> &bits, int i) { bits[i >> 6] ^= 1ULL << (i & 63); }
+
+// Linear map on 32-bit vectors over GF(2), stored by columns.
+struct BitMatrix {
+	uint32_t column[32];
+	uint32_t operator()(uint32_t v) const {
+		uint32_t result = 0;
+		for (int j = 0; v != 0; ++j, v >>= 1) {
+			if (v & 1) result ^= column[j];
+		}
+		return result;
+	}
+	BitMatrix operator*(BitMatrix const &other) const {
+		BitMatrix product;
+		for (int j = 0; j < 32; ++j) product.column[j] = (*this)(other.column[j]);
+		return product;
+	}
+};
+
+// Returns m ** (steps * 2**doublings).
+BitMatrix power(BitMatrix m, uint64_t steps, int doublings) {
+	for (int i = 0; i < doublings; ++i) m = m * m;
+	BitMatrix result;
+	for (int j = 0; j < 32; ++j) result.column[j] = 1UL << j;
+	for (; steps != 0; steps >>= 1) {
+		if (steps & 1) result = result * m;
+		m = m * m;
+	}
+	return result;
+}
+
+/** Exponents of the nonzero terms of the characteristic polynomial of MT19937,
+ *  in increasing order.  The polynomial is found with the Berlekamp-Massey
+ *  algorithm from the low bit of the first 2 * 19968 outputs of the generator
+ *  (twice the number of bits in the state).
+ */
+std::vector<int> findCharacteristic() {
+	const int Length = 2 * 19968;
+	const int Words = Length / 64 + 2;
+	std::vector<uint32_t> output(Length);
+	rng::MT19937 gen;
+	gen.fill(&output[0], Length);
+
+	// the sequence is stored in reverse, so that the discrepancy is the parity
+	// of the connection polynomial and with a window of the sequence.
+	std::vector<uint64_t> sequence(Words + 1, 0);
+	for (int i = 0; i < Length; ++i) {
+		if (output[i] & 1) flipBit(sequence, Length - 1 - i);
+	}
+
+	std::vector<uint64_t> c(Words, 0), b(Words, 0), t;
+	c[0] = b[0] = 1;
+	int L = 0;
+	int m = 1;
+	for (int n = 0; n < Length; ++n) {
+		const int offset = Length - 1 - n;
+		uint64_t d = 0;
+		for (int w = 0; w <= L / 64; ++w) {
+			const int q = (offset >> 6) + w;
+			const int r = offset & 63;
+			const uint64_t window = r ? (sequence[q] >> r) | (sequence[q + 1] << (64 - r)) : sequence[q];
+			d ^= c[w] & window;
+		}
+		if (parity(d)) {
+			if (2 * L <= n) t = c;
+			// c += b * x**m
+			const int shift = m >> 6;
+			const int r = m & 63;
+			for (int w = Words - 1; w >= shift; --w) {
+				uint64_t v = b[w - shift] << r;
+				if (r && w > shift) v |= b[w - shift - 1] >> (64 - r);
+				c[w] ^= v;
+			}
+			if (2 * L <= n) {
+				L = n + 1 - L;
+				b.swap(t);
+				m = 1;
+				continue;
+			}
+		}
+		++m;
+	}
+
+	// the characteristic polynomial is the reciprocal of the connection polynomial.
+	std::vector<int> terms;
+	for (int k = 0; k <= L; ++k) {
+		if (getBit(c, L - k)) terms.push_back(k);
+	}
+	assert(L == 19937);
+	return terms;
+}
+
+std::vector<int> const &characteristic() {
+	static const std::vector<int> terms = findCharacteristic();
+	return terms;
+}
+
+} // namespace
+
 namespace rng { // random number generators
 
-void MT19937::update() {
-	int kk;
+/** Polynomial over GF(2) of degree less than that of the characteristic
+ *  polynomial, stored as a bit vector (bit i is the coefficient of x**i).
+ *  Arithmetic is modulo the characteristic polynomial.
+ */
+class MT19937::JumpPolynomial {
+	std::vector<int> const &_terms;
+	int _degree;
+	std::vector<uint64_t> _bits;
+
+	// Subtract multiples of the characteristic polynomial to clear the bits at
+	// and above the degree.
+	void reduce(std::vector<uint64_t> &bits, int top) const {
+		for (int i = top; i >= _degree; --i) {
+			if (!getBit(bits, i)) continue;
+			for (unsigned j = 0; j < _terms.size(); ++j) flipBit(bits, i - _degree + _terms[j]);
+		}
+	}
 
-	for (kk = 0; kk < N - M; kk++) {
-		unsigned long y = (_mt[kk] & UPPER_MASK) | (_mt[kk + 1] & LOWER_MASK);
-		_mt[kk] = _mt[kk + M] ^ (y >> 1) ^ MAGIC(y);
+public:
+	/** Construct the polynomial x**power, for power less than the degree.
+	 */
+	explicit JumpPolynomial(int power): _terms(characteristic()), _degree(_terms.back()), _bits(_degree / 64 + 1, 0) {
+		flipBit(_bits, power);
 	}
-	for (; kk < N - 1; kk++) {
-		unsigned long y = (_mt[kk] & UPPER_MASK) | (_mt[kk + 1] & LOWER_MASK);
-		_mt[kk] = _mt[kk + (M - N)] ^ (y >> 1) ^ MAGIC(y);
+
+	/** Construct x**n modulo the characteristic polynomial.
+	 */
+	static JumpPolynomial power(uint64_t n) {
+		JumpPolynomial result(0);
+		for (int bit = 63; bit >= 0; --bit) {
+			result.square();
+			if ((n >> bit) & 1) result.multiplyX();
+		}
+		return result;
 	}
 
-	unsigned long y = (_mt[N - 1] & UPPER_MASK) | (_mt[0] & LOWER_MASK);
+	int degree() const { return _degree; }
+	bool coefficient(int i) const { return getBit(_bits, i); }
+
+	void square() {
+		std::vector<uint64_t> wide(2 * _bits.size(), 0);
+		for (unsigned w = 0; w < _bits.size(); ++w) {
+			wide[2 * w] = spread(_bits[w] & 0xffffffffULL);
+			wide[2 * w + 1] = spread(_bits[w] >> 32);
+		}
+		reduce(wide, 2 * _degree - 2);
+		wide.resize(_bits.size());
+		_bits.swap(wide);
+	}
+
+	void multiplyX() {
+		for (unsigned w = _bits.size() - 1; w > 0; --w) _bits[w] = (_bits[w] << 1) | (_bits[w - 1] >> 63);
+		_bits[0] <<= 1;
+		reduce(_bits, _degree);
+	}
+
+	// The characteristic polynomial has a nonzero constant term, so x is
+	// invertible: x**-1 = (p(x) + 1) / x.
+	void divideX() {
+		if (getBit(_bits, 0)) {
+			for (unsigned j = 0; j < _terms.size(); ++j) flipBit(_bits, _terms[j]);
+		}
+		for (unsigned w = 0; w + 1 < _bits.size(); ++w) _bits[w] = (_bits[w] >> 1) | (_bits[w + 1] << 63);
+		_bits.back() >>= 1;
+	}
+};
+
+void MT19937::update() {
+	// The first N - M words depend on words M positions ahead, the others on
+	// words N - M positions behind (which have already been updated).
+	const int offsets[2] = { M, M - N };
+	const int ends[2] = { N - M, N - 1 };
+	int kk = 0;
+
+#ifdef CSP_SIMD_SSE2
+	const simd::Vec4i upper(UPPER_MASK);
+	const simd::Vec4i lower(LOWER_MASK);
+	const simd::Vec4i magic(0x9908b0dfUL);
+	const simd::Vec4i one(1);
+#endif
+
+	for (int pass = 0; pass < 2; ++pass) {
+#ifdef CSP_SIMD_SSE2
+		// Four words at a time.  Each new word also depends on the following
+		// word, which is loaded before it is overwritten.
+		for (; kk + 4 <= ends[pass]; kk += 4) {
+			const simd::Vec4i a = simd::Vec4i::load(_mt + kk);
+			const simd::Vec4i b = simd::Vec4i::load(_mt + kk + 1);
+			const simd::Vec4i c = simd::Vec4i::load(_mt + kk + offsets[pass]);
+			const simd::Vec4i y = (a & upper) | (b & lower);
+			const simd::Vec4i mag = ((y & one) == one) & magic;
+			(c ^ (y >> 1) ^ mag).store(_mt + kk);
+		}
+#endif
+		for (; kk < ends[pass]; kk++) {
+			uint32_t y = (_mt[kk] & UPPER_MASK) | (_mt[kk + 1] & LOWER_MASK);
+			_mt[kk] = _mt[kk + offsets[pass]] ^ (y >> 1) ^ MAGIC(y);
+		}
+	}
+
+	uint32_t y = (_mt[N - 1] & UPPER_MASK) | (_mt[0] & LOWER_MASK);
 	_mt[N - 1] = _mt[M - 1] ^ (y >> 1) ^ MAGIC(y);
 
 	_mti = 0;
@@ -69,11 +346,107 @@ void MT19937::getState(State &state) const {
 
 void MT19937::setState(State const &state) {
 	for (int i = 0; i < N; i++) {
-		_mt[i] = state._mt[i];
+		_mt[i] = static_cast<uint32_t>(state._mt[i]);
 	}
 	_mti = state._mti;
 }
 
+template <typename T>
+void MT19937::fillValues(T *values, int n) {
+	while (n > 0) {
+		if (_mti >= N) update();
+		const int count = std::min(n, N - _mti);
+		const uint32_t *words = _mt + _mti;
+		int i = 0;
+#ifdef CSP_SIMD_SSE2
+		for (; i + 4 <= count; i += 4) {
+			store4(temper4(simd::Vec4i::load(words + i)), values + i);
+		}
+#endif
+		for (; i < count; ++i) convert(temper(words[i]), values[i]);
+		_mti += count;
+		values += count;
+		n -= count;
+	}
+}
+
+void MT19937::fill(uint32_t *values, int n) {
+	fillValues(values, n);
+}
+
+void MT19937::fill(float *values, int n) {
+	fillValues(values, n);
+}
+
+void MT19937::fill(double *values, int n) {
+	fillValues(values, n);
+}
+
+void MT19937::fillGauss(float *values, int n, double mean, double sigma) {
+	fillGaussian(*this, values, n, mean, sigma);
+}
+
+void MT19937::advance(JumpPolynomial const &jump) {
+	// The sequence of words as a circular window of N words, starting at the
+	// next word to be output.  Each step replaces the first word with the
+	// word N positions later.
+	struct Window {
+		uint32_t word[N];
+		int start;
+		void step() {
+			const int next = (start + 1 == N) ? 0 : start + 1;
+			uint32_t y = (word[start] & UPPER_MASK) | (word[next] & LOWER_MASK);
+			word[start] = word[(start + M) % N] ^ (y >> 1) ^ MAGIC(y);
+			start = next;
+		}
+		void add(Window const &other) {
+			for (int i = 0, a = start, b = other.start; i < N; ++i) {
+				word[a] ^= other.word[b];
+				if (++a == N) a = 0;
+				if (++b == N) b = 0;
+			}
+		}
+	};
+
+	if (_mti >= N) update();
+	Window state;
+	std::copy(_mt, _mt + N, state.word);
+	state.start = 0;
+	// the words before _mti have been output, so replace them with their successors.
+	for (int i = 0; i < _mti; ++i) state.step();
+
+	// evaluate the polynomial of the transition by Horner's rule.
+	Window sum;
+	std::fill(sum.word, sum.word + N, 0);
+	sum.start = 0;
+	for (int i = jump.degree() - 1; i >= 0; --i) {
+		sum.step();
+		if (jump.coefficient(i)) sum.add(state);
+	}
+	// The low bits of the first word in the window do not affect the rest of
+	// the sequence, and are not determined by the characteristic polynomial
+	// (which has degree 19937 rather than 32 * N).  One more step drops them.
+	sum.step();
+
+	for (int i = 0; i < N; ++i) _mt[i] = sum.word[(sum.start + i) % N];
+	_mti = 0;
+}
+
+void MT19937::jump(uint64_t steps) {
+	if (steps == 0) return;
+	advance(JumpPolynomial::power(steps - 1));
+}
+
+void MT19937::nextStream() {
+	static const JumpPolynomial stream = [] {
+		JumpPolynomial p(1);
+		for (int i = 0; i < 64; ++i) p.square();
+		p.divideX();
+		return p;
+	}();
+	advance(stream);
+}
+
 void Taus2::setSeed(unsigned long int s) {
 	if (s == 0) {
 		s = 1;	// default seed is 1
@@ -104,6 +477,48 @@ void Taus2::setState(State const &state) {
 	_s3 = state._s3;
 }
 
+template <typename T>
+void Taus2::fillValues(T *values, int n) {
+	for (int i = 0; i < n; ++i) convert(static_cast<uint32_t>(generate()), values[i]);
+}
+
+void Taus2::fill(uint32_t *values, int n) {
+	fillValues(values, n);
+}
+
+void Taus2::fill(float *values, int n) {
+	fillValues(values, n);
+}
+
+void Taus2::fill(double *values, int n) {
+	fillValues(values, n);
+}
+
+void Taus2::fillGauss(float *values, int n, double mean, double sigma) {
+	fillGaussian(*this, values, n, mean, sigma);
+}
+
+void Taus2::advance(uint64_t steps, int doublings) {
+	BitMatrix s1, s2, s3;
+	for (int j = 0; j < 32; ++j) {
+		const unsigned long bit = 1UL << j;
+		s1.column[j] = static_cast<uint32_t>(TAUSWORTHE(bit, 13, 19, 4294967294UL, 12));
+		s2.column[j] = static_cast<uint32_t>(TAUSWORTHE(bit, 2, 25, 4294967288UL, 4));
+		s3.column[j] = static_cast<uint32_t>(TAUSWORTHE(bit, 3, 11, 4294967280UL, 17));
+	}
+	_s1 = power(s1, steps, doublings)(static_cast<uint32_t>(_s1));
+	_s2 = power(s2, steps, doublings)(static_cast<uint32_t>(_s2));
+	_s3 = power(s3, steps, doublings)(static_cast<uint32_t>(_s3));
+}
+
+void Taus2::jump(uint64_t steps) {
+	advance(steps, 0);
+}
+
+void Taus2::nextStream() {
+	advance(1, 64);
+}
+
 } // namespace rng
 
 RandomInterface::~RandomInterface() {
@@ -117,17 +532,38 @@ double Gauss::sample() {
 	if (_odd) {
 		return _x;
 	}
-	// Polar (Box-Mueller) method; See Knuth v2, 3rd ed, p122
-	double x, y, r2;
-	do {
-		x = -1.0 + 2.0 * _gen.unit();
-		y = -1.0 + 2.0 * _gen.unit();
-		r2 = x*x + y*y;
-	} while (r2 > 1.0 || r2 == 0.0);
-	double f = _sigma * ::sqrt(-2.0 * ::log(r2) / r2);
 	// save one value for the next call and return the other
-	_x = _mean + x * f;
-	return _mean + y * f;
+	double value;
+	polar(_gen, _mean, _sigma, value, _x);
+	return value;
+}
+
+template <typename T>
+void Gauss::fillSamples(T *values, int n) {
+	int i = 0;
+	if (n > 0 && !_odd) {
+		values[i++] = static_cast<T>(_x);
+		_odd = true;
+	}
+	double first, second;
+	for (; i + 2 <= n; i += 2) {
+		polar(_gen, _mean, _sigma, first, second);
+		values[i] = static_cast<T>(first);
+		values[i + 1] = static_cast<T>(second);
+	}
+	if (i < n) {
+		polar(_gen, _mean, _sigma, first, _x);
+		values[i] = static_cast<T>(first);
+		_odd = false;
+	}
+}
+
+void Gauss::fill(float *values, int n) {
+	fillSamples(values, n);
+}
+
+void Gauss::fill(double *values, int n) {
+	fillSamples(values, n);
 }
 
 void Gauss::getState(State &state) const {
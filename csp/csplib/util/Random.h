@@ -24,7 +24,9 @@
 
 #include <csp/csplib/util/Ref.h>
 #include <csp/csplib/util/Export.h>
+#include <csp/csplib/util/Uniform.h>
 #include <cmath>
+#include <string>
 
 namespace csp {
 
@@ -79,6 +81,15 @@ namespace rng {
  *  You can obtain the paper directly from Makoto Matsumoto's web page.
  *
  *  The period of this generator is 2^{19937} - 1.
+ *
+ *  The fill() methods generate many values at once, tempering and
+ *  converting four words at a time with SSE2 where available.  The
+ *  sequence is the same as that of repeated calls to unit().  Independent
+ *  streams (e.g., one per thread) are obtained by jumping ahead in the
+ *  sequence with jump() or nextStream(), using the characteristic
+ *  polynomial of the generator (Haramoto et al., "Efficient Jump Ahead
+ *  for F2-Linear Random Number Generators", INFORMS Journal on Computing,
+ *  20, 3 (2008), 385--390).
  */
 class CSPLIB_EXPORT MT19937 {
 	static const int N = 624;	/* Period parameters */
@@ -91,17 +102,27 @@ class CSPLIB_EXPORT MT19937 {
 	static const unsigned long LOWER_MASK = 0x7fffffffUL;	
 
 	// state
-	unsigned long _mt[N];
+	uint32_t _mt[N];
 	int _mti;
 
-	static inline unsigned long MAGIC(unsigned long y) {
+	static inline uint32_t MAGIC(uint32_t y) {
 		return (((y)&0x1) ? 0x9908b0dfUL : 0);
 	}
 
 	/** Internal call to update the generator.
 	 */
 	void update();
-	
+
+	/** Tempering transformation applied to each word of the state.
+	 */
+	static inline uint32_t temper(uint32_t k) {
+		k ^= (k >> 11);
+		k ^= (k << 7) & 0x9d2c5680UL;
+		k ^= (k << 15) & 0xefc60000UL;
+		k ^= (k >> 18);
+		return k;
+	}
+
 	/** Internal generator.
 	 *
 	 *  This method returns a random integer in the range [0,2**32).
@@ -109,15 +130,24 @@ class CSPLIB_EXPORT MT19937 {
 	 */
 	inline unsigned long generate() {
 		if (_mti >= N) update(); // generate N words at one time
-		unsigned long k = _mt[_mti];
-		k ^= (k >> 11);
-		k ^= (k << 7) & 0x9d2c5680UL;
-		k ^= (k << 15) & 0xefc60000UL;
-		k ^= (k >> 18);
-		_mti++;
-		return k;
+		return temper(_mt[_mti++]);
 	}
 
+	/** Internal bulk generator used by the fill() methods.
+	 */
+	template <typename T>
+	void fillValues(T *values, int n);
+
+	/** Polynomial over GF(2) modulo the characteristic polynomial of the
+	 *  generator, used to jump ahead.
+	 */
+	class JumpPolynomial;
+
+	/** Advance the state by the power of the transition given by the
+	 *  jump polynomial, plus one.
+	 */
+	void advance(JumpPolynomial const &jump);
+
 public:
 	/** Structure for saving and restoring the internal state of the generator.
 	 */
@@ -182,6 +212,54 @@ public:
 	 *  following the corresponding getState() call.
 	 */
 	void setState(State const &state);
+
+	/** Fill an array with random integers in the range [0,2**32).
+	 *
+	 *  The values are the same as those returned by n successive calls to
+	 *  unit(), scaled by 2**32.
+	 */
+	void fill(uint32_t *values, int n);
+
+	/** Fill an array with random floating point values in the range [0,1).
+	 *
+	 *  Each value has 24 random bits and uses one value of the sequence.
+	 */
+	void fill(float *values, int n);
+
+	/** Fill an array with random floating point values in the range [0,1).
+	 *
+	 *  The values are identical to those returned by n successive calls to
+	 *  unit().
+	 */
+	void fill(double *values, int n);
+
+	/** Fill an array with samples of a gaussian distribution.
+	 *
+	 *  Samples are generated in pairs by the polar method (as by rd::Gauss);
+	 *  if n is odd the second sample of the last pair is discarded.
+	 *
+	 *  @param values the array to fill
+	 *  @param n the number of samples
+	 *  @param mean the mean value of the distribution
+	 *  @param sigma the standard deviation of the distribution
+	 */
+	void fillGauss(float *values, int n, double mean, double sigma);
+
+	/** Advance the generator by the given number of values.
+	 *
+	 *  The result is the same as discarding that many values, but the
+	 *  cost (tens of milliseconds) is independent of the distance.
+	 */
+	void jump(uint64_t steps);
+
+	/** Advance the generator by 2**64 values.
+	 *
+	 *  Successive calls divide the sequence into non-overlapping streams.
+	 *  To generate random numbers in parallel, seed one generator and give
+	 *  each thread a copy, calling nextStream() once more for each
+	 *  successive copy.
+	 */
+	void nextStream();
 };
 
 /**
@@ -251,6 +329,9 @@ public:
  * It affected the following seeds 254679140 1264751179 1519430319
  * 2274823218 2529502358 3284895257 3539574397 (s2 < 8).
  *
+ * Each of the three components is a linear map on 32-bit vectors, so
+ * jump() and nextStream() advance the generator by raising these maps
+ * to the required power.
  */
 class CSPLIB_EXPORT Taus2 {
 	// state
@@ -275,6 +356,15 @@ class CSPLIB_EXPORT Taus2 {
 		_s3 = TAUSWORTHE(_s3, 3, 11, 4294967280UL, 17);
 		return (_s1 ^ _s2 ^ _s3);
 	}
+
+	/** Internal bulk generator used by the fill() methods.
+	 */
+	template <typename T>
+	void fillValues(T *values, int n);
+
+	/** Advance the generator by steps * 2**doublings values.
+	 */
+	void advance(uint64_t steps, int doublings);
 public:
 	/** Structure for saving and restoring the internal state of the generator.
 	 */
@@ -338,6 +428,45 @@ public:
 	 *  following the corresponding getState() call.
 	 */
 	void setState(State const &state);
+
+	/** Fill an array with random integers in the range [0,2**32).
+	 *
+	 *  The values are the same as those returned by n successive calls to
+	 *  unit(), scaled by 2**32.
+	 */
+	void fill(uint32_t *values, int n);
+
+	/** Fill an array with random floating point values in the range [0,1).
+	 *
+	 *  Each value has 24 random bits and uses one value of the sequence.
+	 */
+	void fill(float *values, int n);
+
+	/** Fill an array with random floating point values in the range [0,1).
+	 *
+	 *  The values are identical to those returned by n successive calls to
+	 *  unit().
+	 */
+	void fill(double *values, int n);
+
+	/** Fill an array with samples of a gaussian distribution.
+	 *
+	 *  See MT19937::fillGauss().
+	 */
+	void fillGauss(float *values, int n, double mean, double sigma);
+
+	/** Advance the generator by the given number of values.
+	 *
+	 *  The result is the same as discarding that many values.
+	 */
+	void jump(uint64_t steps);
+
+	/** Advance the generator by 2**64 values.
+	 *
+	 *  See MT19937::nextStream().  The period of the generator allows
+	 *  about 2**24 streams.
+	 */
+	void nextStream();
 };
 
 
@@ -412,6 +541,18 @@ public:
 	/** Equivalent to uniformUInt(0, upper)
 	 */
 	virtual unsigned long uniformUInt(unsigned long upper)=0;
+
+	/** Fill an array with random numbers in the range [0,1).
+	 */
+	virtual void fill(float *values, int n)=0;
+
+	/** Fill an array with random numbers in the range [0,1).
+	 */
+	virtual void fill(double *values, int n)=0;
+
+	/** Fill an array with samples of a gaussian distribution.
+	 */
+	virtual void fillGauss(float *values, int n, double mean, double sigma)=0;
 };
 
 /** Random number generator wrapper.
@@ -420,7 +561,8 @@ public:
  *  generator interface.  These generics provide a uniform interface
  *  to the underlying generators and generator state data.  The
  *  performance penalty relative to using the raw generators is
- *  typically about 20%.
+ *  typically about 20%, and is avoided for large numbers of values by
+ *  the fill() methods.
  */
 template <class RNG>
 class CSPLIB_EXPORT RandomNumberGenerator: public RandomNumberGeneratorInterface {
@@ -507,6 +649,24 @@ public:
 		return _gen.uniformInt(upper);
 	}
 
+	/** Fill an array with random floating point values in the range [0,1).
+	 */
+	virtual void fill(float *values, int n) {
+		_gen.fill(values, n);
+	}
+
+	/** Fill an array with random floating point values in the range [0,1).
+	 */
+	virtual void fill(double *values, int n) {
+		_gen.fill(values, n);
+	}
+
+	/** Fill an array with samples of a gaussian distribution.
+	 */
+	virtual void fillGauss(float *values, int n, double mean, double sigma) {
+		_gen.fillGauss(values, n, mean, sigma);
+	}
+
 	/** Get the name of this generator
 	 */
 	virtual std::string getName() const {
@@ -534,6 +694,9 @@ class CSPLIB_EXPORT Gauss {
 	double _mean, _sigma;
 	double _x;
 	bool _odd;
+
+	template <typename T>
+	void fillSamples(T *values, int n);
 public:
 
 	/** Random number generator state.
@@ -577,6 +740,20 @@ public:
 	 */
 	double sample();
 
+	/** Fill an array with samples of the distribution.
+	 *
+	 *  The values are the same as those returned by n successive calls to
+	 *  sample().
+	 */
+	void fill(float *values, int n);
+
+	/** Fill an array with samples of the distribution.
+	 *
+	 *  The values are identical to those returned by n successive calls to
+	 *  sample().
+	 */
+	void fill(double *values, int n);
+
 	/** Reseed the underlying random number generator.
 	 *
 	 *  @param seed the new seed.
@@ -618,6 +795,14 @@ public:
 	/** Sample the distribution.
 	 */
 	virtual double sample()=0;
+
+	/** Fill an array with samples of the distribution.
+	 */
+	virtual void fill(float *values, int n)=0;
+
+	/** Fill an array with samples of the distribution.
+	 */
+	virtual void fill(double *values, int n)=0;
 };
 
 
@@ -642,6 +827,14 @@ public:
 	 */
 	double sample();
 
+	/** Fill an array with samples of the distribution.
+	 */
+	virtual void fill(float *values, int n);
+
+	/** Fill an array with samples of the distribution.
+	 */
+	virtual void fill(double *values, int n);
+
 	/** Reseed the random number generator.
 	 *
 	 *  @param seed the new seed.
@@ -679,6 +872,16 @@ double RandomDistribution<RD>::sample() {
 	return _dist.sample();
 }
 
+template <class RD>
+void RandomDistribution<RD>::fill(float *values, int n) {
+	_dist.fill(values, n);
+}
+
+template <class RD>
+void RandomDistribution<RD>::fill(double *values, int n) {
+	_dist.fill(values, n);
+}
+
 template <class RD>
 RandomInterface::State RandomDistribution<RD>::getState() const {
 	RDState *rd_state = new RDState;
@@ -0,0 +1,285 @@
+#pragma once
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+/**
+ * @file SimdMath.h
+ *
+ * @brief Double precision math functions for SSE2 vectors.
+ *
+ * These are used by the batch coordinate conversions (see GeoPos.h), which
+ * process two points at a time.  The polynomial approximations and range
+ * reductions are those of the Cephes math library (Stephen L. Moshier),
+ * evaluated on both lanes without branches.  The results agree with the
+ * C library functions to within a few units in the last place for
+ * arguments of magnitude less than about 1e8.
+ *
+ * Vec2d and Vec4f wrap vectors of two doubles and four floats with the usual
+ * arithmetic operators, and Vec4i wraps four 32-bit integers with bitwise
+ * operators and conversions.  Together with the scalar overloads below, this
+ * allows a formula to be written once as a template and evaluated either for
+ * a vector or for a single value (e.g., the last elements of an array whose
+ * length is not a multiple of the vector size).  The vector and scalar
+ * versions of the arithmetic operators give identical results.
+ *
+ * CSP_SIMD_SSE2 is defined if the vector functions are available.  Other
+ * code should use the wrappers in this header rather than intrinsics, so
+ * that the instruction set is selected in one place.
+ */
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CSP_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace csp {
+namespace simd {
+
+// Scalar versions of the vector functions, for use in templates.
+inline double sqrt(double x) { return std::sqrt(x); }
+inline double atan(double x) { return std::atan(x); }
+inline double atan2(double y, double x) { return std::atan2(y, x); }
+inline void sincos(double x, double &s, double &c) { s = std::sin(x); c = std::cos(x); }
+inline double select(bool mask, double a, double b) { return mask ? a : b; }
+inline float sqrt(float x) { return std::sqrt(x); }
+inline float select(bool mask, float a, float b) { return mask ? a : b; }
+inline float max(float a, float b) { return a < b ? b : a; }
+
+} // namespace simd
+} // namespace csp
+
+#ifdef CSP_SIMD_SSE2
+
+namespace csp {
+namespace simd {
+
+/** Both lanes set to the same value. */
+inline __m128d splat(double x) { return _mm_set1_pd(x); }
+
+/** Select a where the mask is set, and b elsewhere. */
+inline __m128d select(__m128d mask, __m128d a, __m128d b) {
+	return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+
+/** Sine and cosine of both lanes of x (in radians). */
+inline void sincos(__m128d x, __m128d &s, __m128d &c) {
+	const __m128d sign_mask = _mm_castsi128_pd(_mm_set1_epi64x(0x8000000000000000LL));
+	// k = nearest integer to x / (pi/2), using the rounding of the addition.
+	const __m128d round = splat(6755399441055744.0);  // 1.5 * 2^52
+	const __m128d t = _mm_add_pd(_mm_mul_pd(x, splat(0.63661977236758134308)), round);
+	const __m128d k = _mm_sub_pd(t, round);
+	// z = x - k * pi/2, with pi/2 split in three parts for extra precision.
+	__m128d z = _mm_sub_pd(x, _mm_mul_pd(k, splat(1.57079625129699707031)));
+	z = _mm_sub_pd(z, _mm_mul_pd(k, splat(7.54978941586159635335E-8)));
+	z = _mm_sub_pd(z, _mm_mul_pd(k, splat(5.39030285815811905290E-15)));
+	const __m128d zz = _mm_mul_pd(z, z);
+
+	__m128d ps = splat(1.58962301576546568060E-10);
+	ps = _mm_add_pd(_mm_mul_pd(ps, zz), splat(-2.50507477628578072866E-8));
+	ps = _mm_add_pd(_mm_mul_pd(ps, zz), splat(2.75573136213857245213E-6));
+	ps = _mm_add_pd(_mm_mul_pd(ps, zz), splat(-1.98412698295895385996E-4));
+	ps = _mm_add_pd(_mm_mul_pd(ps, zz), splat(8.33333333332211858878E-3));
+	ps = _mm_add_pd(_mm_mul_pd(ps, zz), splat(-1.66666666666666307295E-1));
+	const __m128d sin_z = _mm_add_pd(z, _mm_mul_pd(_mm_mul_pd(z, zz), ps));
+
+	__m128d pc = splat(-1.13585365213876817300E-11);
+	pc = _mm_add_pd(_mm_mul_pd(pc, zz), splat(2.08757008419747316778E-9));
+	pc = _mm_add_pd(_mm_mul_pd(pc, zz), splat(-2.75573141792967388112E-7));
+	pc = _mm_add_pd(_mm_mul_pd(pc, zz), splat(2.48015872888517045348E-5));
+	pc = _mm_add_pd(_mm_mul_pd(pc, zz), splat(-1.38888888888730564116E-3));
+	pc = _mm_add_pd(_mm_mul_pd(pc, zz), splat(4.16666666666665929218E-2));
+	const __m128d cos_z = _mm_add_pd(_mm_sub_pd(splat(1.0), _mm_mul_pd(splat(0.5), zz)), _mm_mul_pd(_mm_mul_pd(zz, zz), pc));
+
+	// the low bits of t hold k.  odd quadrants swap sine and cosine; the sine
+	// is negated in quadrants 2 and 3, and the cosine in quadrants 1 and 2.
+	const __m128i q = _mm_castpd_si128(t);
+	const __m128i odd = _mm_shuffle_epi32(_mm_srai_epi32(_mm_slli_epi64(q, 63), 31), _MM_SHUFFLE(3, 3, 1, 1));
+	const __m128d swap = _mm_castsi128_pd(odd);
+	const __m128d sin_sign = _mm_and_pd(_mm_castsi128_pd(_mm_slli_epi64(q, 62)), sign_mask);
+	const __m128d cos_sign = _mm_and_pd(_mm_castsi128_pd(_mm_slli_epi64(_mm_add_epi64(q, _mm_set_epi32(0, 1, 0, 1)), 62)), sign_mask);
+	s = _mm_xor_pd(select(swap, cos_z, sin_z), sin_sign);
+	c = _mm_xor_pd(select(swap, sin_z, cos_z), cos_sign);
+}
+
+/** Arctangent of both lanes of x. */
+inline __m128d atan(__m128d x) {
+	const __m128d sign_mask = _mm_castsi128_pd(_mm_set1_epi64x(0x8000000000000000LL));
+	const __m128d sign = _mm_and_pd(x, sign_mask);
+	const __m128d ax = _mm_andnot_pd(sign_mask, x);
+	// reduce to |x| <= 0.66 using atan(x) = pi/2 - atan(1/x) and
+	// atan(x) = pi/4 + atan((x-1)/(x+1)).
+	const __m128d large = _mm_cmpgt_pd(ax, splat(2.41421356237309504880));
+	const __m128d medium = _mm_andnot_pd(large, _mm_cmpgt_pd(ax, splat(0.66)));
+	const __m128d one = splat(1.0);
+	__m128d r = select(large, _mm_div_pd(splat(-1.0), ax), ax);
+	r = select(medium, _mm_div_pd(_mm_sub_pd(ax, one), _mm_add_pd(ax, one)), r);
+	__m128d y = _mm_and_pd(large, splat(1.57079632679489661923));
+	y = _mm_or_pd(y, _mm_and_pd(medium, splat(0.78539816339744830962)));
+	const __m128d more_bits = _mm_or_pd(_mm_and_pd(large, splat(6.123233995736765886130E-17)), _mm_and_pd(medium, splat(3.061616997868382943065E-17)));
+
+	const __m128d z = _mm_mul_pd(r, r);
+	__m128d p = splat(-8.750608600031904122785E-1);
+	p = _mm_add_pd(_mm_mul_pd(p, z), splat(-1.615753718733365076637E1));
+	p = _mm_add_pd(_mm_mul_pd(p, z), splat(-7.500855792314704667340E1));
+	p = _mm_add_pd(_mm_mul_pd(p, z), splat(-1.228866684490136173410E2));
+	p = _mm_add_pd(_mm_mul_pd(p, z), splat(-6.485021904942025371773E1));
+	__m128d q = _mm_add_pd(z, splat(2.485846490142306297962E1));
+	q = _mm_add_pd(_mm_mul_pd(q, z), splat(1.650270098316988542046E2));
+	q = _mm_add_pd(_mm_mul_pd(q, z), splat(4.328810604912902668951E2));
+	q = _mm_add_pd(_mm_mul_pd(q, z), splat(4.853903996359136964868E2));
+	q = _mm_add_pd(_mm_mul_pd(q, z), splat(1.945506571482613964425E2));
+	const __m128d w = _mm_add_pd(_mm_mul_pd(r, _mm_div_pd(_mm_mul_pd(z, p), q)), r);
+	y = _mm_add_pd(y, _mm_add_pd(w, more_bits));
+	return _mm_xor_pd(y, sign);
+}
+
+/** Four quadrant arctangent of y/x for both lanes, in the range [-pi, pi].
+ *  Unlike the C library function, the sign of zero is ignored: atan2(0, x)
+ *  is 0 for x >= 0 and pi for x < 0, and atan2(y, 0) is +/-pi/2.
+ */
+inline __m128d atan2(__m128d y, __m128d x) {
+	const __m128d sign_mask = _mm_castsi128_pd(_mm_set1_epi64x(0x8000000000000000LL));
+	const __m128d zero = _mm_setzero_pd();
+	const __m128d y_sign = _mm_and_pd(y, sign_mask);
+	const __m128d x_zero = _mm_cmpeq_pd(x, zero);
+	const __m128d y_zero = _mm_cmpeq_pd(y, zero);
+	__m128d a = atan(_mm_div_pd(y, x));
+	// add or subtract pi (with the sign of y) in the left half plane.
+	const __m128d pi = _mm_or_pd(splat(3.14159265358979323846), y_sign);
+	a = _mm_add_pd(a, _mm_and_pd(_mm_cmplt_pd(x, zero), _mm_andnot_pd(y_zero, pi)));
+	a = select(y_zero, _mm_and_pd(_mm_cmplt_pd(x, zero), splat(3.14159265358979323846)), a);
+	a = select(x_zero, _mm_andnot_pd(y_zero, _mm_or_pd(splat(1.57079632679489661923), y_sign)), a);
+	return a;
+}
+
+
+/** A pair of doubles.
+ */
+class Vec2d {
+public:
+	Vec2d() {}
+	Vec2d(double x): m_V(_mm_set1_pd(x)) {}
+	Vec2d(__m128d v): m_V(v) {}
+	static Vec2d load(double const *p) { return _mm_loadu_pd(p); }
+	void store(double *p) const { _mm_storeu_pd(p, m_V); }
+	__m128d v() const { return m_V; }
+private:
+	__m128d m_V;
+};
+
+inline Vec2d operator+(Vec2d a, Vec2d b) { return _mm_add_pd(a.v(), b.v()); }
+inline Vec2d operator-(Vec2d a, Vec2d b) { return _mm_sub_pd(a.v(), b.v()); }
+inline Vec2d operator*(Vec2d a, Vec2d b) { return _mm_mul_pd(a.v(), b.v()); }
+inline Vec2d operator/(Vec2d a, Vec2d b) { return _mm_div_pd(a.v(), b.v()); }
+inline Vec2d operator-(Vec2d a) { return _mm_xor_pd(a.v(), _mm_set1_pd(-0.0)); }
+inline Vec2d &operator+=(Vec2d &a, Vec2d b) { return a = a + b; }
+inline Vec2d &operator-=(Vec2d &a, Vec2d b) { return a = a - b; }
+inline Vec2d &operator*=(Vec2d &a, Vec2d b) { return a = a * b; }
+/** Comparison, returning a mask for select(). */
+inline Vec2d operator<(Vec2d a, Vec2d b) { return _mm_cmplt_pd(a.v(), b.v()); }
+
+inline Vec2d sqrt(Vec2d x) { return _mm_sqrt_pd(x.v()); }
+inline Vec2d atan(Vec2d x) { return atan(x.v()); }
+inline Vec2d atan2(Vec2d y, Vec2d x) { return atan2(y.v(), x.v()); }
+inline Vec2d select(Vec2d mask, Vec2d a, Vec2d b) { return select(mask.v(), a.v(), b.v()); }
+inline void sincos(Vec2d x, Vec2d &s, Vec2d &c) {
+	__m128d vs, vc;
+	sincos(x.v(), vs, vc);
+	s = vs;
+	c = vc;
+}
+
+
+/** Four floats.
+ */
+class Vec4f {
+public:
+	Vec4f() {}
+	Vec4f(float x): m_V(_mm_set1_ps(x)) {}
+	Vec4f(float x, float y, float z, float w): m_V(_mm_set_ps(w, z, y, x)) {}
+	Vec4f(__m128 v): m_V(v) {}
+	static Vec4f load(float const *p) { return _mm_loadu_ps(p); }
+	void store(float *p) const { _mm_storeu_ps(p, m_V); }
+	__m128 v() const { return m_V; }
+private:
+	__m128 m_V;
+};
+
+inline Vec4f operator+(Vec4f a, Vec4f b) { return _mm_add_ps(a.v(), b.v()); }
+inline Vec4f operator-(Vec4f a, Vec4f b) { return _mm_sub_ps(a.v(), b.v()); }
+inline Vec4f operator*(Vec4f a, Vec4f b) { return _mm_mul_ps(a.v(), b.v()); }
+inline Vec4f operator/(Vec4f a, Vec4f b) { return _mm_div_ps(a.v(), b.v()); }
+inline Vec4f &operator+=(Vec4f &a, Vec4f b) { return a = a + b; }
+/** Comparison, returning a mask for select(). */
+inline Vec4f operator<(Vec4f a, Vec4f b) { return _mm_cmplt_ps(a.v(), b.v()); }
+
+inline Vec4f sqrt(Vec4f x) { return _mm_sqrt_ps(x.v()); }
+inline Vec4f max(Vec4f a, Vec4f b) { return _mm_max_ps(b.v(), a.v()); }
+inline Vec4f select(Vec4f mask, Vec4f a, Vec4f b) {
+	return _mm_or_ps(_mm_and_ps(mask.v(), a.v()), _mm_andnot_ps(mask.v(), b.v()));
+}
+
+/** All four elements set to element I of a. */
+template <int I>
+inline Vec4f broadcast(Vec4f a) { return _mm_shuffle_ps(a.v(), a.v(), _MM_SHUFFLE(I, I, I, I)); }
+
+
+/** Four 32-bit integers.  Shifts are logical.
+ */
+class Vec4i {
+public:
+	Vec4i() {}
+	Vec4i(uint32_t x): m_V(_mm_set1_epi32(static_cast<int>(x))) {}
+	Vec4i(__m128i v): m_V(v) {}
+	static Vec4i load(uint32_t const *p) { return _mm_loadu_si128(reinterpret_cast<__m128i const*>(p)); }
+	void store(uint32_t *p) const { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), m_V); }
+	__m128i v() const { return m_V; }
+private:
+	__m128i m_V;
+};
+
+inline Vec4i operator&(Vec4i a, Vec4i b) { return _mm_and_si128(a.v(), b.v()); }
+inline Vec4i operator|(Vec4i a, Vec4i b) { return _mm_or_si128(a.v(), b.v()); }
+inline Vec4i operator^(Vec4i a, Vec4i b) { return _mm_xor_si128(a.v(), b.v()); }
+inline Vec4i operator<<(Vec4i a, int n) { return _mm_slli_epi32(a.v(), n); }
+inline Vec4i operator>>(Vec4i a, int n) { return _mm_srli_epi32(a.v(), n); }
+/** Comparison, returning all bits set where the elements are equal. */
+inline Vec4i operator==(Vec4i a, Vec4i b) { return _mm_cmpeq_epi32(a.v(), b.v()); }
+
+/** Load eight 16-bit integers, sign extended to 32 bits. */
+inline void loadInt16(int16_t const *p, Vec4i &low, Vec4i &high) {
+	const __m128i raw = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+	low = _mm_srai_epi32(_mm_unpacklo_epi16(raw, raw), 16);
+	high = _mm_srai_epi32(_mm_unpackhi_epi16(raw, raw), 16);
+}
+
+/** Convert (signed) integers to floats. */
+inline Vec4f toFloat(Vec4i a) { return _mm_cvtepi32_ps(a.v()); }
+
+/** Convert the first or last two (signed) integers to doubles. */
+inline Vec2d toDoubleLow(Vec4i a) { return _mm_cvtepi32_pd(a.v()); }
+inline Vec2d toDoubleHigh(Vec4i a) { return _mm_cvtepi32_pd(_mm_shuffle_epi32(a.v(), _MM_SHUFFLE(3, 2, 3, 2))); }
+
+} // namespace simd
+} // namespace csp
+
+#endif // CSP_SIMD_SSE2
+
@@ -25,6 +25,8 @@
 #include <csp/csplib/util/SynchronousUpdate.h>
 #include <csp/csplib/util/Log.h>
 
+#include <algorithm>
+
 
 namespace csp {
 
@@ -41,73 +43,172 @@ int UpdateProxy::update(double time) {
 }
 
 
+UpdateMaster::UpdateMaster(): m_Overflow(0), m_Immediate(0), m_ImmediateTail(0), m_Tick(0), m_Delayed(0), m_BaseCount(0), m_Time(0.0) {
+	std::fill(m_Base, m_Base + BaseSlots, static_cast<UpdateProxy*>(0));
+	for (int level = 0; level < Levels; ++level) {
+		std::fill(m_Levels[level], m_Levels[level] + LevelSlots, static_cast<UpdateProxy*>(0));
+	}
+}
+
+
+UpdateMaster::~UpdateMaster() {
+	for (int slot = 0; slot < BaseSlots; ++slot) release(m_Base[slot]);
+	for (int level = 0; level < Levels; ++level) {
+		for (int slot = 0; slot < LevelSlots; ++slot) release(m_Levels[level][slot]);
+	}
+	release(m_Overflow);
+	release(m_Immediate);
+}
+
+
+void UpdateMaster::release(UpdateProxy *list) {
+	while (list) {
+		UpdateProxy *proxy = list;
+		list = proxy->m_Next;
+		proxy->m_Next = 0;
+		proxy->_decref();
+	}
+}
+
+
 UpdateProxyRef UpdateMaster::registerUpdate(UpdateTarget *target, double delay) {
 	UpdateProxyRef proxy;
 	if (target) {
 		delay = std::max(0.0, delay);
 		proxy = new UpdateProxy(target, this, m_Time + delay);
+		// the lists hold a reference to each proxy until it is dead.
+		proxy->_incref();
 		if (delay > 0.0) {
-			m_DelayQueue.push_back(proxy);
-			std::push_heap(m_DelayQueue.begin(), m_DelayQueue.end(), m_Priority);
+			++m_Delayed;
+			schedule(proxy.get());
 		} else {
-			m_ShortList.push_back(proxy);
+			append(proxy.get());
 		}
 	}
 	return proxy;
 }
 
 
+void UpdateMaster::schedule(UpdateProxy *proxy) {
+	const uint64_t tick = std::max(m_Tick, toTick(proxy->nextUpdateTime()));
+	const uint64_t delta = tick - m_Tick;
+	UpdateProxy **slot;
+	if (delta < BaseSlots) {
+		slot = &m_Base[tick & (BaseSlots - 1)];
+		++m_BaseCount;
+	} else if (delta >= WheelSpan) {
+		slot = &m_Overflow;
+	} else {
+		int level = 0;
+		while (delta >= (uint64_t(1) << (BaseBits + (level + 1) * LevelBits))) ++level;
+		slot = &m_Levels[level][(tick >> (BaseBits + level * LevelBits)) & (LevelSlots - 1)];
+	}
+	proxy->m_Next = *slot;
+	*slot = proxy;
+}
+
+
+void UpdateMaster::append(UpdateProxy *proxy) {
+	proxy->m_Next = 0;
+	if (m_ImmediateTail) {
+		m_ImmediateTail->m_Next = proxy;
+	} else {
+		m_Immediate = proxy;
+	}
+	m_ImmediateTail = proxy;
+}
+
+
+void UpdateMaster::dispatch(UpdateProxy *proxy) {
+	switch (proxy->update(m_Time)) {
+		case UpdateProxy::DELAYED:
+			++m_Delayed;
+			schedule(proxy);
+			break;
+		case UpdateProxy::IMMEDIATE:
+			append(proxy);
+			break;
+		default:
+			proxy->m_Next = 0;
+			proxy->_decref();
+			break;
+	}
+}
+
+
+void UpdateMaster::cascade(UpdateProxy *&list) {
+	UpdateProxy *proxy = list;
+	list = 0;
+	while (proxy) {
+		UpdateProxy *next = proxy->m_Next;
+		schedule(proxy);
+		proxy = next;
+	}
+}
+
+
+void UpdateMaster::expire(bool all) {
+	UpdateProxy *&slot = m_Base[m_Tick & (BaseSlots - 1)];
+	UpdateProxy *proxy = slot;
+	slot = 0;
+	while (proxy) {
+		UpdateProxy *next = proxy->m_Next;
+		if (!all && proxy->nextUpdateTime() > m_Time) {
+			// due later in the current tick.
+			proxy->m_Next = slot;
+			slot = proxy;
+		} else {
+			--m_Delayed;
+			--m_BaseCount;
+			dispatch(proxy);
+		}
+		proxy = next;
+	}
+}
+
+
 void UpdateMaster::update(double dt) {
 	m_Time += dt;
-	m_Transfer.clear();
-	if (!m_ShortList.empty()) {
-		UpdateList::iterator iter = m_ShortList.begin();
-		UpdateList::iterator end = m_ShortList.end();
-		UpdateList::iterator remove;
-		while (iter != end) {
-			int op = (*iter)->update(m_Time);
-			switch (op) {
-				case UpdateProxy::IMMEDIATE:
-					++iter;
-					break;
-				case UpdateProxy::DELAYED:
-					m_Transfer.push_back(*iter);
-					// fall through
-				case UpdateProxy::DEAD:
-					remove = iter++;
-					m_ShortList.erase(remove);
-					break;
-				default:
-					break;
-			}
+
+	if (m_Immediate) {
+		UpdateProxy *proxy = m_Immediate;
+		m_Immediate = m_ImmediateTail = 0;
+		while (proxy) {
+			UpdateProxy *next = proxy->m_Next;
+			dispatch(proxy);
+			proxy = next;
 		}
 	}
-	if (!m_DelayQueue.empty()) {
-		while (m_DelayQueue.front()->nextUpdateTime() <= m_Time) {
-			std::pop_heap(m_DelayQueue.begin(), m_DelayQueue.end(), m_Priority);
-			int op = m_DelayQueue.back()->update(m_Time);
-			switch (op) {
-				case UpdateProxy::DELAYED:
-					std::push_heap(m_DelayQueue.begin(), m_DelayQueue.end(), m_Priority);
-					break;
-				case UpdateProxy::IMMEDIATE:
-					m_ShortList.push_back(m_DelayQueue.back());
-					// fall through
-				case UpdateProxy::DEAD:
-					m_DelayQueue.pop_back();
-					break;
-				default:
-					break;
+
+	const uint64_t now = toTick(m_Time);
+	if (m_Delayed == 0) {
+		// nothing is scheduled, so the wheel can skip ahead.
+		m_Tick = std::max(m_Tick, now);
+		return;
+	}
+	expire(m_Tick < now);
+	while (m_Tick < now) {
+		if (m_BaseCount == 0) {
+			// skip empty slots up to the next cascade.
+			const uint64_t last = m_Tick | (BaseSlots - 1);
+			if (last >= now) {
+				m_Tick = now;
+				break;
 			}
+			m_Tick = last;
 		}
-	}
-	if (!m_Transfer.empty()) {
-		UpdateVector::iterator iter = m_Transfer.begin();
-		UpdateVector::iterator end = m_Transfer.end();
-		for (; iter != end; ++iter) {
-			m_DelayQueue.push_back(*iter);
-			std::push_heap(m_DelayQueue.begin(), m_DelayQueue.end(), m_Priority);
+		++m_Tick;
+		// when a level wraps, move the callbacks in the next slot of the level above down.
+		if ((m_Tick & (BaseSlots - 1)) == 0) {
+			for (int level = 0; level < Levels; ++level) {
+				const int shift = BaseBits + level * LevelBits;
+				const int index = static_cast<int>((m_Tick >> shift) & (LevelSlots - 1));
+				cascade(m_Levels[level][index]);
+				if (index != 0) break;
+				if (level + 1 == Levels) cascade(m_Overflow);
+			}
 		}
+		expire(m_Tick < now);
 	}
 }
 
@@ -118,15 +219,17 @@ void UpdateTarget::detachUpdateProxy() {
 void UpdateTarget::disconnectFromUpdateMaster() {
 	if (m_UpdateProxy.valid()) {
 		m_UpdateProxy->targetSelfDetach();
+		m_UpdateProxy = 0;
 	}
 }
 
 void UpdateTarget::registerUpdate(UpdateMaster *master) {
-	// TODO disconnect when master == NULL?
 	if (master) {
 		if (m_UpdateProxy.valid()) m_UpdateProxy->targetSelfDetach();
 		m_UpdateProxy = master->registerUpdate(this);
 		CSPLOG(Prio_DEBUG, Cat_APP) << "Registering update with master (master=" << master << ", target=" << this << ")";
+	} else {
+		disconnectFromUpdateMaster();
 	}
 }
 
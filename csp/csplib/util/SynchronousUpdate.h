@@ -26,10 +26,7 @@
 #include <csp/csplib/util/Export.h>
 #include <csp/csplib/util/Ref.h>
 
-#include <algorithm>
-#include <vector>
-#include <list>
-#include <functional>
+#include <cstdint>
 
 
 namespace csp {
@@ -56,7 +53,7 @@ public:
 	 *  Note that the UpdateMaster itself must be updated in order
 	 *  for our onUpdate() method to be called.  The UpdateMaster
 	 *  instance is usually updated as part of the main simulation
-	 *  loop.
+	 *  loop.  A null master disconnects the current registration.
 	 */
 	virtual void registerUpdate(UpdateMaster *master);
 
@@ -128,6 +125,9 @@ private:
 	/// UpdateMaster time of next update.
 	double m_NextUpdateTime;
 
+	/// Next proxy in the same UpdateMaster list (immediate list or timing wheel slot).
+	UpdateProxy *m_Next;
+
 	/// Update return modes.
 	enum { DEAD, IMMEDIATE, DELAYED };
 
@@ -152,8 +152,8 @@ private:
 	 *  @param time The current (internal) time value of the master.
 	 */
 	UpdateProxy(UpdateTarget *target, UpdateMaster *master, double time): 
-		m_Master(master), m_Target(target), m_LastUpdateTime(time), m_NextUpdateTime(time) 
-	{ 
+		m_Master(master), m_Target(target), m_LastUpdateTime(time), m_NextUpdateTime(time), m_Next(0)
+	{
 	}
 
 	/** Test if connected to an UpdateTarget.
@@ -179,45 +179,36 @@ typedef Ref<UpdateProxy> UpdateProxyRef;
  *  UpdateTarget instances.  Attachments are made via UpdateProxy instances
  *  which automatically disconnect the callbacks if the target is destroyed.
  *  The UpdateMaster maintains a separate list for callbacks that require
- *  "immediate" updates (i.e. as soon as possible), and a priority queue for
- *  callbacks that only require delayed updates.  The minimum time until the
- *  next update callback is determined by the return value of onUpdate(),
- *  where <= 0 means immediate.  Of course callbacks can only occur as
- *  often as UpdateMaster::update is called, and this interval will also
- *  determine the granularity of delayed callback intervals.
+ *  "immediate" updates (i.e. as soon as possible), and a hierarchical timing
+ *  wheel for callbacks that only require delayed updates.  The minimum time
+ *  until the next update callback is determined by the return value of
+ *  onUpdate(), where <= 0 means immediate.  Of course callbacks can only
+ *  occur as often as UpdateMaster::update is called, and this interval will
+ *  also determine the granularity of delayed callback intervals.
+ *
+ *  The timing wheel divides time into ticks of 1/TicksPerSecond seconds.
+ *  The first level has one slot per tick for the next 256 ticks, and each
+ *  of the three higher levels has 64 slots spanning 64 times the range of
+ *  the level below (about 18 hours in total).  Callbacks due further out
+ *  are kept in an overflow list.  Scheduling a callback and expiring it
+ *  are constant time, and proxies are linked into the lists directly so
+ *  rescheduling never allocates.  Callbacks are only moved down a level
+ *  when the wheel reaches their slot in the higher level.  Delayed
+ *  callbacks are still made in the first update at or after their
+ *  scheduled time, but callbacks due in the same tick are not ordered.
  */
-class CSPLIB_EXPORT UpdateMaster {
-
-	/// Binary predicate for prioritizing delayed update callbacks.
-	struct UpdatePriority {
-		bool operator()(UpdateProxyRef &a, UpdateProxyRef &b) {
-			return (a->nextUpdateTime() > b->nextUpdateTime());
-		}
-	} m_Priority;
-
-	typedef std::vector<UpdateProxyRef> UpdateVector;
-	typedef std::list<UpdateProxyRef> UpdateList;
-
-	/// A priority queue of delayed callbacks
-	UpdateVector m_DelayQueue;
-
-	/// A list of callbacks requiring "immediate" service
-	UpdateList m_ShortList;
-
-	/// A list used to transfer callbacks from the short list to the delay queue
-	UpdateVector m_Transfer;
-
-	/// The current internal time used for prioritization
-	double m_Time;
-
+class CSPLIB_EXPORT UpdateMaster: public NonCopyable {
 public:
+	/// Resolution of the timing wheel.
+	static const int TicksPerSecond = 1024;
 
 	/** Default constructor.
 	 */
-	UpdateMaster(): m_Time(0.0) {
-		m_Transfer.reserve(64);
-		m_DelayQueue.reserve(64);
-	}
+	UpdateMaster();
+
+	/** Release all callbacks.
+	 */
+	~UpdateMaster();
 
 	/** Connect a new update callback.
 	 *
@@ -230,6 +221,61 @@ public:
 	 */
 	void update(double dt);
 
+private:
+	enum {
+		BaseBits = 8,
+		BaseSlots = 1 << BaseBits,
+		LevelBits = 6,
+		LevelSlots = 1 << LevelBits,
+		Levels = 3,
+		// ticks covered by the wheel; later callbacks go to the overflow list.
+		WheelSpan = 1 << (BaseBits + Levels * LevelBits)
+	};
+
+	/// Slots of the first level, one per tick.
+	UpdateProxy *m_Base[BaseSlots];
+
+	/// Slots of the higher levels.
+	UpdateProxy *m_Levels[Levels][LevelSlots];
+
+	/// Delayed callbacks beyond the range of the wheel.
+	UpdateProxy *m_Overflow;
+
+	/// A list of callbacks requiring "immediate" service
+	UpdateProxy *m_Immediate;
+	UpdateProxy *m_ImmediateTail;
+
+	/// The current tick of the wheel.  Callbacks in earlier ticks have been made.
+	uint64_t m_Tick;
+
+	/// The number of delayed callbacks in the wheel and overflow list.
+	unsigned m_Delayed;
+
+	/// The number of delayed callbacks in the first level.
+	unsigned m_BaseCount;
+
+	/// The current internal time used for prioritization
+	double m_Time;
+
+	static uint64_t toTick(double time) { return static_cast<uint64_t>(time * TicksPerSecond); }
+
+	/// Insert a delayed callback into the wheel.
+	void schedule(UpdateProxy *proxy);
+
+	/// Append a callback to the immediate list.
+	void append(UpdateProxy *proxy);
+
+	/// Make a callback and requeue or release the proxy.
+	void dispatch(UpdateProxy *proxy);
+
+	/// Make the callbacks in the current first level slot that are due.
+	void expire(bool all);
+
+	/// Redistribute the callbacks in a list after the wheel advances.
+	void cascade(UpdateProxy *&list);
+
+	/// Release the master's reference to all proxies in a list.
+	static void release(UpdateProxy *list);
 };
 
 } // namespace csp
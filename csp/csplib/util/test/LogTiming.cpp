@@ -0,0 +1,108 @@
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+// Measures the throughput of log calls with the synchronous text backend,
+// the asynchronous text backend, and the asynchronous binary backend.  Each
+// thread writes entries similar to a typical Cat_PACKET message.
+//
+// usage: log_timing [threads] [entries per thread]
+
+#include <csp/csplib/util/Log.h>
+#include <csp/csplib/util/Timing.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace csp;
+
+namespace {
+
+void writeEntries(LogStream *log, int thread, int entries) {
+	const std::string peer("192.168.0.17");
+	for (int i = 0; i < entries; ++i) {
+		LogStream::LogEntry(*log, Prio_INFO, Cat_PACKET, __FILE__, __LINE__) << "received packet " << i << " from " << peer << " thread " << thread << " size " << (i % 1400) << " rtt " << (0.001 * i);
+	}
+}
+
+double run(LogStream &log, int threads, int entries) {
+	Timer timer;
+	timer.start();
+	std::vector<std::thread> workers;
+	for (int i = 0; i < threads; ++i) workers.push_back(std::thread(writeEntries, &log, i, entries));
+	for (int i = 0; i < threads; ++i) workers[i].join();
+	const double elapsed = timer.stop();
+	// include the time to drain the queue in a separate measurement, since
+	// it happens off the logging threads.
+	log.flush();
+	return elapsed;
+}
+
+void report(const char *label, double elapsed, double total, int calls) {
+	std::cout << label << (calls / elapsed) << " calls/s (" << (calls / total) << " calls/s including drain)\n";
+}
+
+} // namespace
+
+
+int main(int argc, char **argv) {
+	const int threads = (argc > 1) ? atoi(argv[1]) : 4;
+	const int entries = (argc > 2) ? atoi(argv[2]) : 200000;
+	const int calls = threads * entries;
+	const char *text_file = "log_timing.txt";
+	const char *binary_file = "log_timing.bin";
+
+	{
+		LogStream log;
+		log.logToFile(text_file);
+		Timer total;
+		total.start();
+		const double elapsed = run(log, threads, entries);
+		report("synchronous:         ", elapsed, total.stop(), calls);
+	}
+	{
+		LogStream log;
+		log.logToFile(text_file);
+		log.setAsync(true, 1 << 22);
+		Timer total;
+		total.start();
+		const double elapsed = run(log, threads, entries);
+		report("asynchronous text:   ", elapsed, total.stop(), calls);
+		std::cout << "  dropped: " << log.getAsync()->getDropped() << "\n";
+		log.setAsync(false);
+	}
+	{
+		LogStream log;
+		log.logToFile(text_file);
+		log.logToBinaryFile(binary_file, 1 << 22);
+		Timer total;
+		total.start();
+		const double elapsed = run(log, threads, entries);
+		report("asynchronous binary: ", elapsed, total.stop(), calls);
+		std::cout << "  dropped: " << log.getAsync()->getDropped() << "\n";
+		log.setAsync(false);
+	}
+
+	std::remove(text_file);
+	std::remove(binary_file);
+	return 0;
+}
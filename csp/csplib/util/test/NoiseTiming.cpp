@@ -0,0 +1,119 @@
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+// Compares the throughput of sampling a fractal noise field point by point
+// with filling tiles of samples using the vectorized generator, with one
+// thread and with all available threads.
+//
+// usage: noise_timing [tile size] [octaves] [repeats]
+
+#include <csp/csplib/util/Noise.h>
+#include <csp/csplib/util/Timing.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace csp;
+
+namespace {
+
+void report(const char *label, double seconds, double reference, int samples) {
+	char line[256];
+	snprintf(line, sizeof(line), "%-16s %8.2f Msample/s (%.2fx)", label, samples * 1e-6 / seconds, reference / seconds);
+	std::cout << line << "\n";
+}
+
+} // namespace
+
+
+int main(int argc, char **argv) {
+	const int size = (argc > 1) ? atoi(argv[1]) : 512;
+	const int octaves = (argc > 2) ? atoi(argv[2]) : 6;
+	const int repeats = (argc > 3) ? atoi(argv[3]) : 10;
+	const int samples = size * size * repeats;
+	const int volume = size / 8;
+	const int volume_samples = volume * volume * volume * repeats;
+	const double spacing = 0.013;
+
+	NoiseField field(2007);
+	field.setFractal(octaves);
+	std::vector<float> tile(size * size);
+	Timer timer;
+	double single, serial, parallel;
+	float sum = 0.0f;
+
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		for (int j = 0; j < size; ++j) {
+			for (int i = 0; i < size; ++i) tile[i + j * size] = field.getValue(r + i * spacing, j * spacing);
+		}
+		sum += tile[r];
+	}
+	single = timer.stop();
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		field.generate(tile, size, size, r, 0.0, spacing, 1);
+		sum += tile[r];
+	}
+	serial = timer.stop();
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		field.generate(tile, size, size, r, 0.0, spacing);
+		sum += tile[r];
+	}
+	parallel = timer.stop();
+	std::cout << "2D tile " << size << "x" << size << ", " << octaves << " octaves\n";
+	report("getValue", single, single, samples);
+	report("generate (1)", serial, single, samples);
+	report("generate (all)", parallel, single, samples);
+
+	tile.resize(volume * volume * volume);
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		for (int k = 0; k < volume; ++k) {
+			for (int j = 0; j < volume; ++j) {
+				for (int i = 0; i < volume; ++i) tile[i + (j + k * volume) * volume] = field.getValue(r + i * spacing, j * spacing, k * spacing);
+			}
+		}
+		sum += tile[r];
+	}
+	single = timer.stop();
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		field.generate(tile, volume, volume, volume, r, 0.0, 0.0, spacing, 1);
+		sum += tile[r];
+	}
+	serial = timer.stop();
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		field.generate(tile, volume, volume, volume, r, 0.0, 0.0, spacing);
+		sum += tile[r];
+	}
+	parallel = timer.stop();
+	std::cout << "3D tile " << volume << "x" << volume << "x" << volume << ", " << octaves << " octaves\n";
+	report("getValue", single, single, volume_samples);
+	report("generate (1)", serial, single, volume_samples);
+	report("generate (all)", parallel, single, volume_samples);
+
+	std::cout << "threads:       " << std::thread::hardware_concurrency() << "\n";
+	std::cout << "checksum:      " << sum << "\n";
+	return 0;
+}
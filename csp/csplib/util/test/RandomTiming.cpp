@@ -0,0 +1,139 @@
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+// Compares the throughput of drawing random numbers one at a time through
+// the generator interface, directly from the generators, and in bulk with
+// the fill() methods, and the cost of splitting a generator into streams.
+//
+// usage: random_timing [values] [repeats]
+
+#include <csp/csplib/util/Random.h>
+#include <csp/csplib/util/Timing.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace csp;
+
+namespace {
+
+void report(const char *label, double seconds, double reference, int values) {
+	char line[256];
+	snprintf(line, sizeof(line), "%-32s %8.2f Mvalue/s (%.2fx)", label, values * 1e-6 / seconds, reference / seconds);
+	std::cout << line << "\n";
+}
+
+template <class RNG>
+void compare(const char *name, int count, int repeats) {
+	const int values = count * repeats;
+	std::vector<double> doubles(count);
+	std::vector<float> floats(count);
+	RandomNumberGenerator<RNG> wrapper;
+	RandomNumberGeneratorInterface &generator = wrapper;
+	RNG &raw = *wrapper.operator->();
+	Timer timer;
+	double sum = 0.0;
+
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		for (int i = 0; i < count; ++i) doubles[i] = generator.unit();
+		sum += doubles[r];
+	}
+	const double virtual_unit = timer.stop();
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		for (int i = 0; i < count; ++i) doubles[i] = raw.unit();
+		sum += doubles[r];
+	}
+	const double raw_unit = timer.stop();
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		generator.fill(&doubles[0], count);
+		sum += doubles[r];
+	}
+	const double fill_double = timer.stop();
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		generator.fill(&floats[0], count);
+		sum += floats[r];
+	}
+	const double fill_float = timer.stop();
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		for (int i = 0; i < count; ++i) floats[i] = static_cast<float>(rd::BoxMueller(generator, 0.0, 1.0));
+		sum += floats[r];
+	}
+	const double box_mueller = timer.stop();
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		generator.fillGauss(&floats[0], count, 0.0, 1.0);
+		sum += floats[r];
+	}
+	const double fill_gauss = timer.stop();
+	timer.start();
+	for (int r = 0; r < 8; ++r) raw.nextStream();
+	const double streams = timer.stop();
+
+	std::cout << name << "\n";
+	report("  unit (interface)", virtual_unit, virtual_unit, values);
+	report("  unit (generator)", raw_unit, virtual_unit, values);
+	report("  fill double", fill_double, virtual_unit, values);
+	report("  fill float", fill_float, virtual_unit, values);
+	report("  BoxMueller (interface)", box_mueller, box_mueller, values);
+	report("  fillGauss", fill_gauss, box_mueller, values);
+	char line[256];
+	snprintf(line, sizeof(line), "  nextStream                       %8.3f ms (checksum %g)", streams * 1000.0 / 8, sum);
+	std::cout << line << "\n";
+}
+
+} // namespace
+
+
+int main(int argc, char **argv) {
+	const int count = (argc > 1) ? atoi(argv[1]) : 100000;
+	const int repeats = (argc > 2) ? atoi(argv[2]) : 100;
+
+	compare<rng::MT19937>("MT19937", count, repeats);
+	compare<rng::Taus2>("Taus2", count, repeats);
+
+	RandomDistribution<rd::Gauss> wrapper;
+	RandomDistributionInterface &distribution = wrapper;
+	wrapper->setDistribution(0.0, 1.0);
+	std::vector<float> floats(count);
+	Timer timer;
+	double sum = 0.0;
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		for (int i = 0; i < count; ++i) floats[i] = static_cast<float>(distribution.sample());
+		sum += floats[r];
+	}
+	const double sample = timer.stop();
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		distribution.fill(&floats[0], count);
+		sum += floats[r];
+	}
+	const double fill = timer.stop();
+	std::cout << "Gauss\n";
+	report("  sample (interface)", sample, sample, count * repeats);
+	report("  fill", fill, sample, count * repeats);
+	std::cout << "checksum: " << sum << "\n";
+	return 0;
+}
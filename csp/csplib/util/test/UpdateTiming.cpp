@@ -0,0 +1,170 @@
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+// Compares the timing wheel in UpdateMaster with the binary heap and list
+// it replaced, for 10^3 to 10^6 update targets.  One in five targets asks
+// for immediate updates and the rest for periodic updates every 10 ms to
+// 5 s, similar to the mix of systems and unit update proxies in a large
+// battlefield.  Both schedulers are driven at 60 frames per second.
+//
+// usage: update_timing [frames] [max targets]
+
+#include <csp/csplib/util/SynchronousUpdate.h>
+#include <csp/csplib/util/Timing.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <vector>
+
+using namespace csp;
+
+namespace {
+
+class BenchmarkTarget: public UpdateTarget {
+public:
+	BenchmarkTarget(double interval): m_Interval(interval), m_Calls(0) {}
+	virtual double onUpdate(double) { ++m_Calls; return m_Interval; }
+	double interval() const { return m_Interval; }
+	unsigned calls() const { return m_Calls; }
+private:
+	double m_Interval;
+	unsigned m_Calls;
+};
+
+/** The previous UpdateMaster implementation, with a priority queue of
+ *  delayed callbacks and a list of immediate callbacks.
+ */
+class HeapUpdateMaster {
+	struct Proxy: public Referenced {
+		Proxy(BenchmarkTarget *target, double time): target(target), last(time), next(time) {}
+		BenchmarkTarget *target;
+		double last;
+		double next;
+		bool update(double time) {
+			const double dt = target->onUpdate(time - last);
+			last = time;
+			next = time + dt;
+			return dt > 0.0;
+		}
+	};
+	typedef Ref<Proxy> ProxyRef;
+	struct Priority {
+		bool operator()(ProxyRef const &a, ProxyRef const &b) const { return a->next > b->next; }
+	} m_Priority;
+	std::vector<ProxyRef> m_DelayQueue;
+	std::list<ProxyRef> m_ShortList;
+	std::vector<ProxyRef> m_Transfer;
+	double m_Time;
+
+public:
+	HeapUpdateMaster(): m_Time(0.0) {}
+
+	void registerUpdate(BenchmarkTarget *target) {
+		m_ShortList.push_back(new Proxy(target, m_Time));
+	}
+
+	void update(double dt) {
+		m_Time += dt;
+		m_Transfer.clear();
+		for (std::list<ProxyRef>::iterator iter = m_ShortList.begin(); iter != m_ShortList.end(); ) {
+			if ((*iter)->update(m_Time)) {
+				m_Transfer.push_back(*iter);
+				iter = m_ShortList.erase(iter);
+			} else {
+				++iter;
+			}
+		}
+		while (!m_DelayQueue.empty() && m_DelayQueue.front()->next <= m_Time) {
+			std::pop_heap(m_DelayQueue.begin(), m_DelayQueue.end(), m_Priority);
+			if (m_DelayQueue.back()->update(m_Time)) {
+				std::push_heap(m_DelayQueue.begin(), m_DelayQueue.end(), m_Priority);
+			} else {
+				m_ShortList.push_back(m_DelayQueue.back());
+				m_DelayQueue.pop_back();
+			}
+		}
+		for (unsigned i = 0; i < m_Transfer.size(); ++i) {
+			m_DelayQueue.push_back(m_Transfer[i]);
+			std::push_heap(m_DelayQueue.begin(), m_DelayQueue.end(), m_Priority);
+		}
+	}
+};
+
+void makeTargets(std::vector<BenchmarkTarget*> &targets, int count) {
+	srand(42);
+	for (int i = 0; i < count; ++i) {
+		const double interval = (i % 5 == 0) ? 0.0 : 0.01 + (rand() % 4990) * 0.001;
+		targets.push_back(new BenchmarkTarget(interval));
+	}
+}
+
+unsigned long countCalls(std::vector<BenchmarkTarget*> const &targets) {
+	unsigned long calls = 0;
+	for (unsigned i = 0; i < targets.size(); ++i) calls += targets[i]->calls();
+	return calls;
+}
+
+void deleteTargets(std::vector<BenchmarkTarget*> &targets) {
+	for (unsigned i = 0; i < targets.size(); ++i) delete targets[i];
+	targets.clear();
+}
+
+template <class MASTER>
+double run(MASTER &master, int frames) {
+	Timer timer;
+	timer.start();
+	for (int i = 0; i < frames; ++i) master.update(1.0 / 60.0);
+	return timer.stop();
+}
+
+} // namespace
+
+
+int main(int argc, char **argv) {
+	const int frames = (argc > 1) ? atoi(argv[1]) : 600;
+	const int max_targets = (argc > 2) ? atoi(argv[2]) : 1000000;
+
+	for (int count = 1000; count <= max_targets; count *= 10) {
+		std::vector<BenchmarkTarget*> targets;
+		double heap, wheel;
+		unsigned long heap_calls, wheel_calls;
+		{
+			makeTargets(targets, count);
+			HeapUpdateMaster master;
+			for (int i = 0; i < count; ++i) master.registerUpdate(targets[i]);
+			heap = run(master, frames);
+			heap_calls = countCalls(targets);
+			deleteTargets(targets);
+		}
+		{
+			makeTargets(targets, count);
+			UpdateMaster master;
+			for (int i = 0; i < count; ++i) targets[i]->registerUpdate(&master);
+			wheel = run(master, frames);
+			wheel_calls = countCalls(targets);
+			deleteTargets(targets);
+		}
+		char line[256];
+		snprintf(line, sizeof(line), "%8d targets: heap %8.3f ms/frame, wheel %8.3f ms/frame (%.2fx), %lu/%lu callbacks", count, heap * 1000.0 / frames, wheel * 1000.0 / frames, heap / wheel, heap_calls, wheel_calls);
+		std::cout << line << "\n";
+	}
+	return 0;
+}
@@ -0,0 +1,176 @@
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+
+/**
+ * @file test_AsyncLog.cpp
+ * @brief Test for csplib/util/AsyncLog.h.
+ */
+
+
+#include <csp/csplib/util/AsyncLog.h>
+#include <csp/csplib/util/Log.h>
+#include <csp/csplib/util/Testing.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace csp {
+
+namespace {
+
+struct Opaque { int value; };
+std::ostream &operator<<(std::ostream &os, Opaque const &x) { return os << "<" << x.value << ">"; }
+
+// Write a few entries covering all the argument encodings.
+void writeEntries(LogStream &log) {
+	const char *name = "delta";
+	char buffer[16] = "echo";
+	std::string text("foxtrot");
+	Opaque opaque = { 42 };
+	LogStream::LogEntry(log, Prio_INFO, Cat_TESTING, "a/b/test.cpp", 10) << "alpha " << 1 << ' ' << -2L << ' ' << 3u << ' ' << 4.5;
+	LogStream::LogEntry(log, Prio_WARNING, Cat_DATA, "a/b/test.cpp", 11) << name << buffer << text << true << opaque;
+	LogStream::LogEntry(log, Prio_ERROR, Cat_NETWORK, "a/b/test.cpp", 12) << std::hex << 255 << ' ' << std::dec << 255 << ' ' << std::fixed << 0.25;
+}
+
+std::string syncOutput(int flags) {
+	std::ostringstream os;
+	LogStream log(os);
+	log.setFlags(flags);
+	writeEntries(log);
+	return os.str();
+}
+
+} // namespace
+
+
+CSP_TESTFIXTURE(AsyncLog) {
+
+	CSP_TESTCASE(TextMatchesSynchronousOutput) {
+		const int flags = LogStream::cPriority | LogStream::cCategory | LogStream::cLinestamp;
+		std::ostringstream os;
+		LogStream log(os);
+		log.setFlags(flags);
+		log.setAsync(true);
+		CSP_EXPECT(log.isAsync());
+		writeEntries(log);
+		log.flush();
+		CSP_EXPECT_EQ(os.str(), syncOutput(flags));
+		log.setAsync(false);
+	}
+
+	CSP_TESTCASE(BinaryRoundTrip) {
+		const int flags = LogStream::cPriority | LogStream::cCategory | LogStream::cLinestamp;
+		const std::string path = "test_AsyncLog.bin";
+		{
+			std::ostringstream os;
+			LogStream log(os);
+			log.logToBinaryFile(path);
+			CSP_EXPECT(log.getAsync()->isBinary());
+			writeEntries(log);
+			writeEntries(log);
+			log.setAsync(false);
+			CSP_EXPECT_EQ(os.str(), "");
+		}
+		std::ifstream is(path.c_str(), std::ios::binary);
+		std::ostringstream decoded;
+		CSP_EXPECT(AsyncLog::decode(is, decoded, flags));
+		is.close();
+		std::remove(path.c_str());
+		CSP_EXPECT_EQ(decoded.str(), syncOutput(flags) + syncOutput(flags));
+	}
+
+	CSP_TESTCASE(AlternatingLogs) {
+		std::ostringstream os1, os2;
+		LogStream log1(os1), log2(os2);
+		log1.setFlags(LogStream::cTerse);
+		log2.setFlags(LogStream::cTerse);
+		log1.setAsync(true);
+		log2.setAsync(true);
+		for (int i = 0; i < 100; ++i) {
+			LogStream::LogEntry(log1, Prio_INFO, Cat_TESTING) << i;
+			LogStream::LogEntry(log2, Prio_INFO, Cat_TESTING) << i;
+		}
+		// each log allocates a single ring for this thread.
+		CSP_EXPECT_EQ(log1.getAsync()->getThreadCount(), 1u);
+		CSP_EXPECT_EQ(log2.getAsync()->getThreadCount(), 1u);
+		log1.setAsync(false);
+		log2.setAsync(false);
+		CSP_EXPECT_EQ(os1.str(), os2.str());
+	}
+
+	CSP_TESTCASE(StopWritesPendingRecords) {
+		std::ostringstream os;
+		LogStream log(os);
+		log.setFlags(LogStream::cTerse);
+		log.setAsync(true);
+		for (int i = 0; i < 1000; ++i) LogStream::LogEntry(log, Prio_INFO, Cat_TESTING) << i;
+		log.setAsync(false);
+		CSP_EXPECT(!log.isAsync());
+		LogStream::LogEntry(log, Prio_INFO, Cat_TESTING) << "done";
+		std::istringstream is(os.str());
+		std::string line, last;
+		int count = 0;
+		while (std::getline(is, line)) {
+			last = line;
+			++count;
+		}
+		CSP_EXPECT_EQ(count, 1001);
+		CSP_EXPECT_EQ(last, "done");
+	}
+
+	CSP_TESTCASE(MultipleThreads) {
+		const int threads = 4;
+		const int entries = 2000;
+		std::ostringstream os;
+		LogStream log(os);
+		log.setFlags(LogStream::cTerse);
+		log.setAsync(true, 1 << 20);
+		std::vector<std::thread> workers;
+		for (int i = 0; i < threads; ++i) {
+			workers.push_back(std::thread([&log, i]() {
+				for (int j = 0; j < entries; ++j) LogStream::LogEntry(log, Prio_INFO, Cat_TESTING) << i << ":" << j;
+			}));
+		}
+		for (int i = 0; i < threads; ++i) workers[i].join();
+		log.flush();
+		CSP_EXPECT_EQ(log.getAsync()->getDropped(), 0u);
+
+		// every entry is present, and entries from each thread are in order.
+		std::vector<int> next(threads, 0);
+		std::istringstream is(os.str());
+		std::string line;
+		int count = 0;
+		while (std::getline(is, line)) {
+			int i = -1, j = -1;
+			CSP_EXPECT_EQ(sscanf(line.c_str(), "%d:%d", &i, &j), 2);
+			if (i < 0 || i >= threads) continue;
+			CSP_EXPECT_EQ(j, next[i]);
+			next[i] = j + 1;
+			++count;
+		}
+		CSP_EXPECT_EQ(count, threads * entries);
+		log.setAsync(false);
+	}
+};
+
+} // namespace csp
@@ -0,0 +1,110 @@
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+
+/**
+ * @file test_Noise.cpp
+ * @brief Test for the NoiseField generator.
+ */
+
+
+#include <csp/csplib/util/Noise.h>
+#include <csp/csplib/util/Testing.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+CSP_TESTFIXTURE(NoiseField) {
+
+	CSP_TESTCASE(Seed) {
+		csp::NoiseField a(1234), b(1234), c(4321);
+		std::vector<float> ta, tb, tc;
+		a.generate(ta, 64, 64, -3.7, 12.25, 0.13);
+		b.generate(tb, 64, 64, -3.7, 12.25, 0.13);
+		c.generate(tc, 64, 64, -3.7, 12.25, 0.13);
+		CSP_VERIFY(ta == tb);
+		CSP_VERIFY(ta != tc);
+		b.setSeed(4321);
+		b.generate(tb, 64, 64, -3.7, 12.25, 0.13);
+		CSP_VERIFY(tb == tc);
+	}
+
+	CSP_TESTCASE(Lattice) {
+		// gradient noise is zero at the lattice points of a single octave.
+		csp::NoiseField field(7);
+		CSP_VERIFY_EQ(field.getValue(3.0, -5.0), 0.0f);
+		CSP_VERIFY_EQ(field.getValue(3.0, -5.0, 11.0), 0.0f);
+		CSP_VERIFY(field.getValue(3.5, -5.25) != 0.0f);
+		// and continuous.
+		CSP_VERIFY_LT(std::abs(field.getValue(3.5, 1.25) - field.getValue(3.5001, 1.25)), 1e-3f);
+		CSP_VERIFY_LT(std::abs(field.getValue(3.5, 1.25, 0.7) - field.getValue(3.5, 1.25, 0.7001)), 1e-3f);
+	}
+
+	CSP_TESTCASE(Tile2D) {
+		csp::NoiseField field(99);
+		field.setFractal(5, 0.5f, 2.0);
+		const int nx = 37, ny = 5;
+		std::vector<float> tile;
+		field.generate(tile, nx, ny, -100.3, 7.9, 0.071, 1);
+		CSP_VERIFY_EQ(tile.size(), static_cast<unsigned>(nx * ny));
+		bool same = true;
+		float limit = 0.0f;
+		for (int j = 0; j < ny; ++j) {
+			for (int i = 0; i < nx; ++i) {
+				const float value = field.getValue(-100.3 + i * 0.071, 7.9 + j * 0.071);
+				same = same && (tile[i + j * nx] == value);
+				limit = std::max(limit, std::abs(value));
+			}
+		}
+		CSP_VERIFY(same);
+		CSP_VERIFY_LT(limit, 2.0f);
+	}
+
+	CSP_TESTCASE(Tile3D) {
+		csp::NoiseField field(5, csp::NoiseField::VALUE);
+		field.setFractal(3, 0.6f, 2.1);
+		const int nx = 13, ny = 6, nz = 3;
+		std::vector<float> tile;
+		field.generate(tile, nx, ny, nz, 0.5, -0.25, 3.0, 0.37, 1);
+		bool same = true;
+		for (int k = 0; k < nz; ++k) {
+			for (int j = 0; j < ny; ++j) {
+				for (int i = 0; i < nx; ++i) {
+					const float value = field.getValue(0.5 + i * 0.37, -0.25 + j * 0.37, 3.0 + k * 0.37);
+					same = same && (tile[i + (j + k * ny) * nx] == value);
+				}
+			}
+		}
+		CSP_VERIFY(same);
+	}
+
+	CSP_TESTCASE(Threads) {
+		// large enough to be split between threads.
+		csp::NoiseField field(2007);
+		field.setFractal(4);
+		std::vector<float> serial, parallel;
+		field.generate(serial, 256, 256, 0.0, 0.0, 0.05, 1);
+		field.generate(parallel, 256, 256, 0.0, 0.0, 0.05, 4);
+		CSP_VERIFY(serial == parallel);
+		field.generate(serial, 32, 32, 32, 0.0, 0.0, 0.0, 0.05, 1);
+		field.generate(parallel, 32, 32, 32, 0.0, 0.0, 0.0, 0.05, 4);
+		CSP_VERIFY(serial == parallel);
+	}
+};
@@ -0,0 +1,137 @@
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+
+/**
+ * @file test_Profiler.cpp
+ * @brief Test for csplib/util/Profiler.h.
+ */
+
+
+#include <csp/csplib/util/Profiler.h>
+#include <csp/csplib/util/Testing.h>
+
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace csp {
+
+namespace {
+
+void spin(double seconds) {
+	const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::microseconds(static_cast<int64_t>(seconds * 1e+6));
+	while (std::chrono::steady_clock::now() < end);
+}
+
+void inner() {
+	CSP_PROFILE_ZONE("test.inner");
+	spin(0.001);
+}
+
+void outer() {
+	CSP_PROFILE_ZONE("test.outer");
+	inner();
+	inner();
+	CSP_PROFILE_COUNTER("test.counter", 42);
+}
+
+Profiler::ZoneStats const *find(std::vector<Profiler::ZoneStats> const &stats, const char *name) {
+	for (unsigned i = 0; i < stats.size(); ++i) {
+		if (strcmp(stats[i].name, name) == 0) return &stats[i];
+	}
+	return 0;
+}
+
+} // namespace
+
+
+CSP_TESTFIXTURE(Profiler) {
+
+	CSP_TESTCASE(NestedZones) {
+		Profiler &profiler = Profiler::getInstance();
+		profiler.setEnabled(true);
+		profiler.frame();
+		outer();
+		profiler.frame();
+		profiler.setEnabled(false);
+
+		std::vector<Profiler::ZoneStats> stats;
+		profiler.getZoneStats(stats);
+		Profiler::ZoneStats const *outer_stats = find(stats, "test.outer");
+		Profiler::ZoneStats const *inner_stats = find(stats, "test.inner");
+		CSP_ENSURE_NOTNULL(outer_stats);
+		CSP_ENSURE_NOTNULL(inner_stats);
+		CSP_EXPECT_EQ(outer_stats->calls, 1u);
+		CSP_EXPECT_EQ(inner_stats->calls, 2u);
+		CSP_EXPECT_EQ(inner_stats->depth, outer_stats->depth + 1);
+		CSP_EXPECT_GE(inner_stats->last, 0.002);
+		CSP_EXPECT_GE(outer_stats->last, inner_stats->last);
+		CSP_EXPECT_GE(profiler.getFrameTime(), outer_stats->last);
+	}
+
+	CSP_TESTCASE(DisabledRecordsNothing) {
+		Profiler &profiler = Profiler::getInstance();
+		profiler.frame();
+		outer();
+		profiler.frame();
+		std::vector<Profiler::ZoneStats> stats;
+		profiler.getZoneStats(stats);
+		for (unsigned i = 0; i < stats.size(); ++i) CSP_EXPECT_EQ(stats[i].calls, 0u);
+	}
+
+	CSP_TESTCASE(ThreadsAndTrace) {
+		Profiler &profiler = Profiler::getInstance();
+		profiler.setEnabled(true);
+		profiler.frame();
+		std::vector<std::thread> workers;
+		for (int i = 0; i < 3; ++i) {
+			workers.push_back(std::thread([i]() {
+				Profiler::setThreadName("worker " + std::to_string(i));
+				outer();
+			}));
+		}
+		for (unsigned i = 0; i < workers.size(); ++i) workers[i].join();
+		profiler.frame();
+		profiler.setEnabled(false);
+
+		std::vector<Profiler::ZoneStats> stats;
+		profiler.getZoneStats(stats);
+		unsigned outer_calls = 0;
+		for (unsigned i = 0; i < stats.size(); ++i) {
+			if (strcmp(stats[i].name, "test.outer") == 0) outer_calls += stats[i].calls;
+		}
+		CSP_EXPECT_EQ(outer_calls, 3u);
+		CSP_EXPECT_EQ(profiler.getDropped(), 0u);
+
+		std::ostringstream os;
+		profiler.writeTrace(os);
+		const std::string trace = os.str();
+		CSP_EXPECT(trace.find("\"traceEvents\"") != std::string::npos);
+		CSP_EXPECT(trace.find("{\"name\":\"test.outer\",\"ph\":\"B\"") != std::string::npos);
+		CSP_EXPECT(trace.find("{\"name\":\"test.counter\",\"ph\":\"C\"") != std::string::npos);
+		CSP_EXPECT(trace.find("\"args\":{\"name\":\"worker 2\"}") != std::string::npos);
+		CSP_EXPECT(trace.find("{\"name\":\"frame\",\"ph\":\"i\"") != std::string::npos);
+		CSP_EXPECT_EQ(trace.substr(trace.size() - 4), std::string("\n]}\n"));
+	}
+};
+
+} // namespace csp
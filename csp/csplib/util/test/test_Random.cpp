@@ -0,0 +1,156 @@
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+
+/**
+ * @file test_Random.cpp
+ * @brief Test the bulk generation and jump ahead of the random number generators.
+ */
+
+
+#include <csp/csplib/util/Random.h>
+#include <csp/csplib/util/Testing.h>
+
+#include <cmath>
+#include <vector>
+
+using namespace csp;
+
+
+CSP_TESTFIXTURE(Random) {
+public:
+	// fill() returns the same values as unit(), across calls of any size.
+	template <class RNG>
+	bool fillMatchesUnit() {
+		RNG a, b;
+		a.setSeed(2007);
+		b.setSeed(2007);
+		std::vector<double> values(5000);
+		bool same = true;
+		for (int start = 0, n = 1; start + n <= 5000; start += n, n = n * 3 + 1) {
+			a.fill(&values[start], n);
+			for (int i = 0; i < n; ++i) same = same && (values[start + i] == b.unit());
+		}
+		std::vector<float> floats(1000);
+		a.fill(&floats[0], 1000);
+		for (int i = 0; i < 1000; ++i) {
+			same = same && (floats[i] == static_cast<float>(static_cast<unsigned long>(b.unit() * 4294967296.0) >> 8) / 16777216.0f);
+			same = same && floats[i] >= 0.0f && floats[i] < 1.0f;
+		}
+		std::vector<uint32_t> words(700);
+		a.fill(&words[0], 700);
+		for (int i = 0; i < 700; ++i) same = same && (words[i] == static_cast<uint32_t>(b.unit() * 4294967296.0));
+		return same;
+	}
+
+	// jump() gives the same state as discarding values.
+	template <class RNG>
+	bool jumpMatchesDiscard(int skip, int steps) {
+		RNG a, b;
+		a.setSeed(17);
+		b.setSeed(17);
+		for (int i = 0; i < skip; ++i) a.unit();
+		for (int i = 0; i < skip + steps; ++i) b.unit();
+		a.jump(steps);
+		bool same = true;
+		for (int i = 0; i < 2000; ++i) same = same && (a.unit() == b.unit());
+		return same;
+	}
+
+	// two jumps of 2**63 are one stream.
+	template <class RNG>
+	bool streamMatchesJump() {
+		RNG a, b;
+		a.setSeed(5);
+		b.setSeed(5);
+		a.unit();
+		b.unit();
+		a.nextStream();
+		b.jump(1ULL << 63);
+		b.jump(1ULL << 63);
+		bool same = true;
+		for (int i = 0; i < 1000; ++i) same = same && (a.unit() == b.unit());
+		RNG c;
+		c.setSeed(5);
+		c.unit();
+		c.nextStream();
+		c.nextStream();
+		return same && (a.unit() != c.unit());
+	}
+
+	CSP_TESTCASE(Fill) {
+		CSP_VERIFY(fillMatchesUnit<rng::MT19937>());
+		CSP_VERIFY(fillMatchesUnit<rng::Taus2>());
+	}
+
+	CSP_TESTCASE(State) {
+		rng::MT19937 gen;
+		gen.setSeed(99);
+		std::vector<float> first(1000), second(1000);
+		gen.fill(&first[0], 300);
+		rng::MT19937::State state;
+		gen.getState(state);
+		gen.fill(&first[0], 1000);
+		gen.setState(state);
+		gen.fill(&second[0], 1000);
+		CSP_VERIFY(first == second);
+	}
+
+	CSP_TESTCASE(JumpTaus2) {
+		CSP_VERIFY(jumpMatchesDiscard<rng::Taus2>(0, 1));
+		CSP_VERIFY(jumpMatchesDiscard<rng::Taus2>(3, 12345));
+		CSP_VERIFY(streamMatchesJump<rng::Taus2>());
+	}
+
+	CSP_TESTCASE(JumpMT19937) {
+		CSP_VERIFY(jumpMatchesDiscard<rng::MT19937>(0, 1));
+		CSP_VERIFY(jumpMatchesDiscard<rng::MT19937>(0, 624));
+		CSP_VERIFY(jumpMatchesDiscard<rng::MT19937>(100, 1000));
+		CSP_VERIFY(jumpMatchesDiscard<rng::MT19937>(624, 100000));
+		CSP_VERIFY(streamMatchesJump<rng::MT19937>());
+	}
+
+	CSP_TESTCASE(Gauss) {
+		rd::Gauss a(1.0, 2.0), b(1.0, 2.0);
+		a.setSeed(3);
+		b.setSeed(3);
+		std::vector<double> values(101);
+		bool same = true;
+		a.sample();
+		b.sample();
+		a.fill(&values[0], 51);
+		a.fill(&values[51], 50);
+		for (int i = 0; i < 101; ++i) same = same && (values[i] == b.sample());
+		CSP_VERIFY(same);
+		CSP_VERIFY_EQ(a.sample(), b.sample());
+
+		// wrapped generators.
+		random::MersenneTwister mt;
+		mt.setSeed(8);
+		std::vector<float> samples(100001);
+		mt.fillGauss(&samples[0], 100001, 3.0, 0.5);
+		double sum = 0.0, sum2 = 0.0;
+		for (unsigned i = 0; i < samples.size(); ++i) {
+			sum += samples[i];
+			sum2 += samples[i] * samples[i];
+		}
+		const double mean = sum / samples.size();
+		CSP_VERIFY_LT(std::abs(mean - 3.0), 0.01);
+		CSP_VERIFY_LT(std::abs(std::sqrt(sum2 / samples.size() - mean * mean) - 0.5), 0.01);
+	}
+};
@@ -0,0 +1,195 @@
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+
+/**
+ * @file test_SynchronousUpdate.cpp
+ * @brief Test for the UpdateMaster callback scheduling.
+ */
+
+
+#include <csp/csplib/util/SynchronousUpdate.h>
+#include <csp/csplib/util/Testing.h>
+
+#include <cstdlib>
+#include <vector>
+
+namespace csp {
+
+namespace {
+
+/** A target that requests a fixed sequence of delays and records when it
+ *  is called.  Every callback checks that it was made in the first update
+ *  at or after the requested time.
+ */
+class Target: public UpdateTarget {
+public:
+	Target(double const &now, double const &previous, double delay): m_Now(now), m_Previous(previous), m_Delay(delay), m_Due(now), m_Immediate(true), m_Calls(0), m_Early(0), m_Late(0) {}
+	virtual double onUpdate(double) {
+		if (m_Now < m_Due) ++m_Early;
+		// immediate callbacks (including the first) are due in the next update.
+		if (!m_Immediate && m_Previous >= m_Due) ++m_Late;
+		++m_Calls;
+		m_Due = m_Now + m_Delay;
+		m_Immediate = (m_Delay <= 0.0);
+		return m_Delay;
+	}
+	void setDelay(double delay) { m_Delay = delay; }
+	int calls() const { return m_Calls; }
+	int early() const { return m_Early; }
+	int late() const { return m_Late; }
+	bool pending() const { return m_Immediate || m_Due > m_Now; }
+private:
+	double const &m_Now;
+	double const &m_Previous;
+	double m_Delay;
+	double m_Due;
+	bool m_Immediate;
+	int m_Calls;
+	int m_Early;
+	int m_Late;
+};
+
+} // namespace
+
+
+CSP_TESTFIXTURE(SynchronousUpdate) {
+public:
+	void step(UpdateMaster &master, double dt) {
+		m_Previous = m_Now;
+		m_Now += dt;
+		master.update(dt);
+	}
+
+	virtual void setup() {
+		m_Now = 0.0;
+		m_Previous = -1.0;
+	}
+
+	CSP_TESTCASE(Immediate) {
+		UpdateMaster master;
+		Target target(m_Now, m_Previous, 0.0);
+		target.registerUpdate(&master);
+		for (int i = 0; i < 10; ++i) step(master, 0.02);
+		CSP_VERIFY_EQ(target.calls(), 10);
+		target.setDelay(-1.0);
+		step(master, 0.02);
+		step(master, 0.02);
+		CSP_VERIFY_EQ(target.calls(), 11);
+	}
+
+	CSP_TESTCASE(Delayed) {
+		UpdateMaster master;
+		Target target(m_Now, m_Previous, 0.5);
+		target.registerUpdate(&master);
+		for (int i = 0; i < 101; ++i) step(master, 0.125);
+		// once immediately after registration, then every four updates.
+		CSP_VERIFY_EQ(target.calls(), 26);
+		CSP_VERIFY_EQ(target.early(), 0);
+		CSP_VERIFY_EQ(target.late(), 0);
+		// switching between delayed and immediate updates takes effect after
+		// the pending callback.
+		target.setDelay(0.0);
+		for (int i = 0; i < 10; ++i) step(master, 0.125);
+		CSP_VERIFY_EQ(target.calls(), 33);
+		target.setDelay(0.3);
+		for (int i = 0; i < 10; ++i) step(master, 0.125);
+		CSP_VERIFY_EQ(target.calls(), 37);
+		CSP_VERIFY_EQ(target.early(), 0);
+		CSP_VERIFY_EQ(target.late(), 0);
+	}
+
+	CSP_TESTCASE(Disconnect) {
+		UpdateMaster master;
+		Target target(m_Now, m_Previous, 0.25);
+		target.registerUpdate(&master);
+		step(master, 0.1);
+		CSP_VERIFY_EQ(target.calls(), 1);
+		// a null master detaches the pending callback.
+		target.registerUpdate(0);
+		for (int i = 0; i < 10; ++i) step(master, 0.1);
+		CSP_VERIFY_EQ(target.calls(), 1);
+		target.registerUpdate(&master);
+		step(master, 0.1);
+		CSP_VERIFY_EQ(target.calls(), 2);
+	}
+
+	CSP_TESTCASE(Destroyed) {
+		UpdateMaster master;
+		Target *target = new Target(m_Now, m_Previous, 0.25);
+		target->registerUpdate(&master);
+		Target *other = new Target(m_Now, m_Previous, 0.0);
+		other->registerUpdate(&master);
+		step(master, 0.1);
+		CSP_VERIFY_EQ(target->calls(), 1);
+		delete target;
+		delete other;
+		for (int i = 0; i < 10; ++i) step(master, 0.1);
+	}
+
+	CSP_TESTCASE(LongDelays) {
+		// delays in each level of the wheel and beyond its range.
+		const double delays[] = { 0.001, 0.2, 3.0, 200.0, 5000.0, 20000.0, 70000.0, 150000.0 };
+		const int n = sizeof(delays) / sizeof(delays[0]);
+		UpdateMaster master;
+		std::vector<Target*> targets;
+		for (int i = 0; i < n; ++i) {
+			targets.push_back(new Target(m_Now, m_Previous, delays[i]));
+			targets.back()->registerUpdate(&master);
+		}
+		const double dt = 7.3;
+		for (double t = 0.0; t < 160000.0; t += dt) step(master, dt);
+		for (int i = 0; i < n; ++i) {
+			CSP_VERIFY_EQ(targets[i]->early(), 0);
+			CSP_VERIFY_EQ(targets[i]->late(), 0);
+			CSP_VERIFY(targets[i]->pending());
+			CSP_VERIFY_EQ(targets[i]->calls() > 1, delays[i] < m_Now);
+			delete targets[i];
+		}
+	}
+
+	CSP_TESTCASE(Random) {
+		UpdateMaster master;
+		std::vector<Target*> targets;
+		srand(17);
+		for (int i = 0; i < 2000; ++i) {
+			const double delay = (i % 5 == 0) ? 0.0 : (rand() % 100000) * 0.0001;
+			targets.push_back(new Target(m_Now, m_Previous, delay));
+			targets.back()->registerUpdate(&master);
+		}
+		for (int i = 0; i < 2000; ++i) {
+			step(master, 0.001 + (rand() % 1000) * 0.00005);
+		}
+		int early = 0, late = 0, overdue = 0;
+		for (unsigned i = 0; i < targets.size(); ++i) {
+			early += targets[i]->early();
+			late += targets[i]->late();
+			if (!targets[i]->pending()) ++overdue;
+			delete targets[i];
+		}
+		CSP_VERIFY_EQ(early, 0);
+		CSP_VERIFY_EQ(late, 0);
+		CSP_VERIFY_EQ(overdue, 0);
+	}
+
+private:
+	double m_Now;
+	double m_Previous;
+};
+
+} // namespace csp
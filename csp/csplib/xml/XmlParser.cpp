@@ -950,7 +950,8 @@ XMLNode XMLNode::createXMLTopNode_WOSD(CSP_XMLCSTR lpszName, int isDeclaration)
 XMLNode XMLNode::createXMLTopNode(CSP_XMLCSTR lpszName, int isDeclaration) { return XMLNode(NULL,stringDup(lpszName),isDeclaration); }
 
 #define MEMORYINCREASE 50
-static int memoryIncrease=0;
+// thread local, so that documents can be parsed concurrently.
+static thread_local int memoryIncrease=0;
 
 static void *myRealloc(void *p, int newsize, int memInc, int sizeofElem)
 {
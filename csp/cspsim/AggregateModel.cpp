@@ -0,0 +1,122 @@
+// Combat Simulator Project
+// Copyright (C) 2002 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/**
+ * @file AggregateModel.cpp
+ *
+ **/
+
+#include <csp/cspsim/AggregateModel.h>
+
+#include <csp/csplib/util/Math.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace csp {
+
+namespace {
+
+/** Coarse performance limits shared by all aggregated vehicles. */
+const double MaxTurnRate = toRadians(3.0);  // rad/s
+const double MaxClimbRate = 20.0;           // m/s
+const double MaxAcceleration = 5.0;         // m/s^2
+
+/** Distance at which a leg of the route is considered complete (m). */
+const double CaptureRadius = 500.0;
+
+/** Speed below which a vehicle without a route is considered parked (m/s). */
+const double MinSpeed = 0.1;
+
+} // namespace
+
+
+AggregateModel::AggregateModel(Vector3 const &position, Vector3 const &velocity, Quat const &attitude, Ref<AggregateRoute> const &route, double fuel_flow):
+	m_Position(position),
+	m_Speed(velocity.length()),
+	m_ClimbRate(velocity.z()),
+	m_Attitude(attitude),
+	m_Moved(false),
+	m_Route(route),
+	m_Leg(0),
+	m_FuelFlow(fuel_flow),
+	m_FuelUsed(0.0),
+	m_Elapsed(0.0)
+{
+	if (velocity.x() * velocity.x() + velocity.y() * velocity.y() > MinSpeed * MinSpeed) {
+		m_Heading = std::atan2(velocity.x(), velocity.y());
+	} else {
+		const Vector3 direction = attitude.rotate(Vector3::YAXIS);
+		m_Heading = std::atan2(direction.x(), direction.y());
+	}
+}
+
+void AggregateModel::update(double dt) {
+	if (dt <= 0.0) return;
+	m_Elapsed += dt;
+	m_FuelUsed += m_FuelFlow * dt;
+
+	const bool has_leg = m_Route.valid() && m_Leg < m_Route->legs.size();
+	if (has_leg) {
+		AggregateRoute::Leg const &leg = m_Route->legs[m_Leg];
+		const Vector3 delta = leg.position - m_Position;
+		const double distance = std::sqrt(delta.x() * delta.x() + delta.y() * delta.y());
+		if (distance < std::max(CaptureRadius, m_Speed * dt)) {
+			++m_Leg;
+		} else {
+			double turn = std::atan2(delta.x(), delta.y()) - m_Heading;
+			if (turn > PI) turn -= 2.0 * PI;
+			if (turn < -PI) turn += 2.0 * PI;
+			m_Heading += clampTo(turn, -MaxTurnRate * dt, MaxTurnRate * dt);
+			m_Speed += clampTo(leg.speed - m_Speed, -MaxAcceleration * dt, MaxAcceleration * dt);
+			const double time_to_go = distance / std::max(m_Speed, 1.0);
+			m_ClimbRate = clampTo(delta.z() / time_to_go, -MaxClimbRate, MaxClimbRate);
+		}
+	} else {
+		if (m_Speed < MinSpeed) return;
+		// end of the route; hold altitude and orbit (or circle in place, for ground vehicles).
+		m_Heading += MaxTurnRate * dt;
+		m_ClimbRate = 0.0;
+	}
+	if (m_Heading > PI) m_Heading -= 2.0 * PI;
+	if (m_Heading < -PI) m_Heading += 2.0 * PI;
+
+	m_Position.x() += std::sin(m_Heading) * m_Speed * dt;
+	m_Position.y() += std::cos(m_Heading) * m_Speed * dt;
+	m_Position.z() += m_ClimbRate * dt;
+	m_Moved = true;
+}
+
+Vector3 AggregateModel::velocity() const {
+	return Vector3(std::sin(m_Heading) * m_Speed, std::cos(m_Heading) * m_Speed, m_ClimbRate);
+}
+
+Quat AggregateModel::attitude() const {
+	if (!m_Moved) return m_Attitude;
+	const double pitch = std::atan2(m_ClimbRate, std::max(m_Speed, MinSpeed));
+	return Quat(-m_Heading, Vector3::ZAXIS) * Quat(pitch, Vector3::XAXIS);
+}
+
+void AggregateModel::saveProgress() {
+	if (!m_Route.valid() || !m_Moved) return;
+	m_Route->progress = m_Leg;
+	m_Route->resume = true;
+}
+
+} // namespace csp
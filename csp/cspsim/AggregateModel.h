@@ -0,0 +1,125 @@
+#pragma once
+// Combat Simulator Project
+// Copyright (C) 2002 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/**
+ * @file AggregateModel.h
+ *
+ **/
+
+#include <csp/csplib/data/Quat.h>
+#include <csp/csplib/data/Vector3.h>
+#include <csp/csplib/util/Ref.h>
+#include <csp/csplib/util/Referenced.h>
+
+#include <vector>
+
+namespace csp {
+
+
+/** The remaining route of an agent, published on the agent's bus (see
+ *  bus::Navigation::Route) so that the route can be followed while the
+ *  vehicle is aggregated.
+ */
+class AggregateRoute: public Referenced {
+public:
+	struct Leg {
+		Leg(Vector3 const &position_, double speed_): position(position_), speed(speed_) { }
+		Vector3 position;   // global coordinates (m).
+		double speed;       // (m/s)
+	};
+
+	AggregateRoute(): progress(0), resume(false) { }
+
+	std::vector<Leg> legs;
+
+	/** The number of legs completed while aggregated.  Set by the
+	 *  AggregateModel when the vehicle is deaggregated, and reset by
+	 *  the agent once it has skipped ahead.
+	 */
+	unsigned progress;
+
+	/** Set by the AggregateModel if the vehicle moved along the route while
+	 *  aggregated.  The agent then continues the route from the current
+	 *  position, rather than resuming the phase it was in when aggregated
+	 *  (such as takeoff), and resets the flag.
+	 */
+	bool resume;
+};
+
+
+/** A low fidelity model of a vehicle, used while the vehicle is
+ *  aggregated (far from any human player).  The vehicle is reduced to a
+ *  point mass moving at constant speed along its route, with a limited
+ *  turn and climb rate, and a constant fuel flow.  No systems, bus, or
+ *  physics models are evaluated.
+ *
+ *  The model is created from the state of the full model when the vehicle
+ *  is aggregated, and its state is copied back to the full model when the
+ *  vehicle is deaggregated.
+ */
+class AggregateModel: public Referenced {
+public:
+	/** Capture the state of the full model.
+	 *
+	 *  @param position the model origin in global coordinates.
+	 *  @param velocity the velocity (m/s).
+	 *  @param attitude the attitude of the vehicle.
+	 *  @param route the route to follow; may be null.
+	 *  @param fuel_flow the nominal fuel flow (kg/s).
+	 */
+	AggregateModel(Vector3 const &position, Vector3 const &velocity, Quat const &attitude, Ref<AggregateRoute> const &route, double fuel_flow);
+
+	/** Advance the model.
+	 */
+	void update(double dt);
+
+	/** Set the altitude, e.g. to keep a ground vehicle on the terrain. */
+	void setAltitude(double z) { m_Position.z() = z; }
+
+	Vector3 const &position() const { return m_Position; }
+	Vector3 velocity() const;
+	Quat attitude() const;
+
+	/** The fuel burned since the model was created (kg). */
+	double fuelUsed() const { return m_FuelUsed; }
+
+	/** The time since the model was created (s). */
+	double elapsed() const { return m_Elapsed; }
+
+	/** Record the progress along the route, for the agent to pick up after
+	 *  deaggregation.
+	 */
+	void saveProgress();
+
+private:
+	Vector3 m_Position;
+	double m_Speed;
+	double m_Heading;       // radians clockwise from north (+y).
+	double m_ClimbRate;     // (m/s)
+	Quat m_Attitude;        // captured attitude, retained while the model is not moving.
+	bool m_Moved;
+	Ref<AggregateRoute> m_Route;
+	unsigned m_Leg;
+	double m_FuelFlow;
+	double m_FuelUsed;
+	double m_Elapsed;
+};
+
+} // namespace csp
@@ -22,20 +22,43 @@
  **/
 
 #include <csp/cspsim/Bus.h>
+#include <csp/csplib/util/HashUtility.h>
 #include <csp/csplib/util/StringTools.h>
 
+#include <algorithm>
+
 namespace csp {
 
-Bus::Bus(std::string const &name): m_Bound(false), m_Enabled(true), m_Name(name), m_Status(1.0) {
+namespace {
+/** Alignment of the channel arena (one cache line). */
+const std::size_t ArenaAlignment = 64;
+}
+
+Bus::Bus(std::string const &name): m_Arena(0), m_ArenaSize(0), m_ArenaLayout(0), m_RegisteredLayout(0), m_Record(0), m_Replay(0), m_ReplayNext(0), m_ReplayMissing(0), m_ReplayDiverged(false), m_Bound(false), m_Enabled(true), m_Name(name), m_Status(1.0) {
 	CSPLOG(Prio_DEBUG, Cat_OBJECT) << "Bus(" << name << ") created.";
 }
 
+Bus::~Bus() {
+	for (unsigned i = 0; i < m_ArenaChannels.size(); ++i) {
+		m_ArenaChannels[i]->moveFromArena();
+	}
+}
+
 ChannelBase* Bus::registerChannel(ChannelBase *channel, std::string const &groups) {
 	assert(channel);
 	std::string name = channel->getName();
 	CSPLOG(Prio_DEBUG, Cat_OBJECT) << "Bus::registerChannel(" << name << ")";
 	assert(m_Channels.find(name) == m_Channels.end());
 	m_Channels[name] = channel;
+	m_Registered.push_back(channel);
+	m_RegisteredLayout = make_ordered_fingerprint(m_RegisteredLayout, fingerprint(name));
+	DataChannelBase *data = dynamic_cast<DataChannelBase*>(channel);
+	if (data) {
+		m_DataChannels.push_back(data);
+		if (m_Arena) {
+			CSPLOG(Prio_DEBUG, Cat_OBJECT) << "Bus::registerChannel: " << name << " registered after layout; not added to the arena";
+		}
+	}
 	CSPLOG(Prio_DEBUG, Cat_OBJECT) << "Bus::registerChannel: groups = " << groups;
 	TokenQueue grouplist(groups, " ");
 	for (TokenQueue::iterator group = grouplist.begin(); group != grouplist.end(); ++group) {
@@ -45,20 +68,59 @@ ChannelBase* Bus::registerChannel(ChannelBase *channel, std::string const &group
 	return channel;
 }
 
-ChannelBase::RefT Bus::getSharedChannel(std::string const &name, bool required, bool override) {
+ChannelBase *Bus::findChannel(std::string const &name) {
+	if (m_Replay) {
+		// the recorded indices only apply if the same channels were registered.
+		const bool same_channels = m_ReplayNext > 0 || (m_Replay->m_Registered == m_Registered.size() && m_Replay->m_Layout == m_RegisteredLayout);
+		if (same_channels && m_ReplayNext < m_Replay->m_Channels.size()) {
+			const uint32_t index = m_Replay->m_Channels[m_ReplayNext];
+			if (index == ChannelBindings::MISSING) {
+				if (m_ReplayMissing < m_Replay->m_Missing.size() && m_Replay->m_Missing[m_ReplayMissing] == name && m_Channels.find(name) == m_Channels.end()) {
+					++m_ReplayNext;
+					++m_ReplayMissing;
+					return 0;
+				}
+			} else if (index < m_Registered.size() && m_Registered[index]->getName() == name) {
+				++m_ReplayNext;
+				return m_Registered[index];
+			}
+		}
+		CSPLOG(Prio_DEBUG, Cat_OBJECT) << "Bus(" << m_Name << ") lookup of " << name << " differs from the recorded bindings; binding by name";
+		m_Replay = 0;
+		m_ReplayDiverged = true;
+	}
 	ChannelMap::iterator iter = m_Channels.find(name);
-	if (iter == m_Channels.end()) {
+	ChannelBase *channel = (iter == m_Channels.end()) ? 0 : iter->second.get();
+	if (m_Record) {
+		if (m_Record->m_Channels.empty()) {
+			m_Record->m_Registered = static_cast<uint32_t>(m_Registered.size());
+			m_Record->m_Layout = m_RegisteredLayout;
+		}
+		if (channel) {
+			const std::size_t index = std::find(m_Registered.begin(), m_Registered.end(), channel) - m_Registered.begin();
+			m_Record->m_Channels.push_back(static_cast<uint32_t>(index));
+		} else {
+			m_Record->m_Channels.push_back(ChannelBindings::MISSING);
+			m_Record->m_Missing.push_back(name);
+		}
+	}
+	return channel;
+}
+
+ChannelBase::RefT Bus::getSharedChannel(std::string const &name, bool required, bool override) {
+	ChannelBase *channel = findChannel(name);
+	if (!channel) {
 		CSPLOG(Prio_DEBUG, Cat_OBJECT) << "Bus::getSharedChannel(" << name << ") failed.";
 		assert(!required);
 		return 0;
 	}
-	assert(iter->second->isShared() || override);
-	return iter->second;
+	assert(channel->isShared() || override);
+	return channel;
 }
 
 ChannelBase::CRefT Bus::getChannel(std::string const &name, bool required) {
-	ChannelMap::iterator iter = m_Channels.find(name);
-	if (iter == m_Channels.end()) {
+	ChannelBase *channel = findChannel(name);
+	if (!channel) {
 		if (required) {
 			CSPLOG(Prio_ERROR, Cat_OBJECT) << "Bus::getChannel(" << name << ") failed.";
 			assert(0);
@@ -67,7 +129,78 @@ ChannelBase::CRefT Bus::getChannel(std::string const &name, bool required) {
 		}
 		return 0;
 	}
-	return iter->second;
+	return channel;
+}
+
+void Bus::recordBindings(ChannelBindings &bindings) {
+	bindings.m_Channels.clear();
+	bindings.m_Missing.clear();
+	bindings.m_Registered = 0;
+	bindings.m_Layout = 0;
+	m_Record = &bindings;
+	m_Replay = 0;
+	m_ReplayDiverged = false;
+}
+
+void Bus::replayBindings(ChannelBindings const &bindings) {
+	m_Record = 0;
+	m_Replay = &bindings;
+	m_ReplayNext = 0;
+	m_ReplayMissing = 0;
+	m_ReplayDiverged = false;
+}
+
+bool Bus::finishBindings() {
+	const bool complete = !m_ReplayDiverged && (!m_Replay || m_ReplayNext == m_Replay->m_Channels.size());
+	m_Record = 0;
+	m_Replay = 0;
+	m_ReplayDiverged = false;
+	return complete;
+}
+
+void Bus::layoutChannels() {
+	if (m_Arena) return;
+	std::vector<std::size_t> offsets;
+	std::size_t size = 0;
+	fprint32 layout = 0;
+	for (unsigned i = 0; i < m_DataChannels.size(); ++i) {
+		DataChannelBase *channel = m_DataChannels[i];
+		const std::size_t channel_size = channel->arenaSize();
+		if (channel_size == 0) continue;
+		const std::size_t alignment = std::min(channel->arenaAlignment(), ArenaAlignment);
+		size = (size + alignment - 1) & ~(alignment - 1);
+		offsets.push_back(size);
+		m_ArenaChannels.push_back(channel);
+		layout = make_ordered_fingerprint(layout, make_ordered_fingerprint(fingerprint(channel->getName()), fingerprint(static_cast<uint32_t>(channel_size))));
+		size += channel_size;
+	}
+	if (m_ArenaChannels.empty()) return;
+	m_ArenaBlock.resize(size + ArenaAlignment);
+	const std::size_t address = reinterpret_cast<std::size_t>(&m_ArenaBlock[0]);
+	m_Arena = &m_ArenaBlock[0] + ((ArenaAlignment - address % ArenaAlignment) % ArenaAlignment);
+	m_ArenaSize = size;
+	m_ArenaLayout = layout;
+	for (unsigned i = 0; i < m_ArenaChannels.size(); ++i) {
+		m_ArenaChannels[i]->moveToArena(m_Arena + offsets[i]);
+	}
+	CSPLOG(Prio_DEBUG, Cat_OBJECT) << "Bus(" << m_Name << ") arena holds " << m_ArenaChannels.size() << " of " << m_DataChannels.size() << " data channels in " << size << " bytes";
+}
+
+bool Bus::saveState(ChannelState &state) const {
+	if (!m_Arena) return false;
+	state.m_Layout = m_ArenaLayout;
+	state.m_Data.resize(m_ArenaSize);
+	std::memcpy(&state.m_Data[0], m_Arena, m_ArenaSize);
+	return true;
+}
+
+bool Bus::restoreState(ChannelState const &state) {
+	if (!m_Arena || state.m_Layout != m_ArenaLayout || state.m_Data.size() != m_ArenaSize) {
+		CSPLOG(Prio_WARNING, Cat_OBJECT) << "Bus(" << m_Name << ") cannot restore channel state with a different layout";
+		return false;
+	}
+	std::memcpy(m_Arena, &state.m_Data[0], m_ArenaSize);
+	return true;
 }
 
 void Bus::setEnabled(bool enabled) {
@@ -52,12 +52,31 @@
 #include <csp/cspsim/Export.h>
 
 #include <sigc++/sigc++.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <map>  // TODO move to .cpp
+#include <type_traits>
+#include <vector>
 
 namespace csp {
 
 class Bus;
 
+
+/** Determines which data channel values can be moved into the contiguous
+ *  value arena of a bus (see Bus::layoutChannels).  Values in the arena are
+ *  saved and restored with memcpy, so only types that can be copied bitwise
+ *  qualify.  Pointers are excluded since a restored pointer would refer to
+ *  objects of the original vehicle.  Value classes such as Vector3 and
+ *  Matrix3 qualify by defaulting their copy operations.
+ */
+template <typename T>
+struct ChannelArenaTraits {
+	enum { Storable = std::is_trivially_copyable<T>::value && !std::is_pointer<T>::value };
+};
+
+
 /** Base class for channels on a bus.
  *
  *  Channels are reference counted objects that are stored in a bus and can be
@@ -218,10 +237,25 @@ public:
  *  system that creates the channel.
  */
 class DataChannelBase: public ChannelBase {
+friend class Bus;
 private:
 	/** Callback signal for push/pull channels.*/
 	mutable sigc::signal<void> m_Signal;
 
+	/** The size of the channel value if it can be stored in the bus arena,
+	 *  otherwise zero.
+	 */
+	virtual std::size_t arenaSize() const { return 0; }
+
+	/** The alignment of the channel value in the bus arena. */
+	virtual std::size_t arenaAlignment() const { return 1; }
+
+	/** Move the channel value to a slot in the bus arena. */
+	virtual void moveToArena(void *) { }
+
+	/** Move the channel value from the bus arena back to the channel. */
+	virtual void moveFromArena() { }
+
 	enum {
 		MASK_HANDLER = 0x00010000,
 		MASK_PUSH    = 0x00020000,
@@ -353,9 +387,14 @@ class DataChannel: public DataChannelBase {
 	mutable sigc::signal<bool, T const&> m_RequestSetSignal;
 	bool m_HasRequestSetHandler;
 
-	/** The data value provided by the channel.*/
+	/** The data value provided by the channel (unless moved to the bus arena).*/
 	T m_Value;
 
+	/** The current location of the data value; either m_Value or a slot in the
+	 *  bus arena.
+	 */
+	T *m_Storage;
+
 	void pull() const {
 		if (isDirty() && hasHandler() && !isPush()) {
 			signal();
@@ -386,7 +425,7 @@ public:
 	 *  Should only be called for push channels (asserts false otherwise).
 	 */
 	void push(const T& value) {
-		m_Value = value;
+		*m_Storage = value;
 		push();
 	}
 
@@ -396,8 +435,8 @@ public:
 	 *  Should only be called for push channels (asserts false otherwise).
 	 */
 	void pushOnChange(const T& value) {
-		if (m_Value != value) {
-			m_Value = value;
+		if (*m_Storage != value) {
+			*m_Storage = value;
 			push();
 		}
 	}
@@ -431,7 +470,7 @@ public:
 	 * channel, so for push channels you may need to call push() explicitly.
 	 */
 	inline T &value() {
-		return m_Value;
+		return *m_Storage;
 	}
 
 	/** Get the value of a channel.
@@ -441,7 +480,7 @@ public:
 	 */
 	inline T const &value() const {
 		if (isPull()) pull();
-		return m_Value;
+		return *m_Storage;
 	}
 
 	/** Construct and initialize a new channel.
@@ -455,7 +494,7 @@ public:
 	 *  @param shared Create a shared (or non-shared) channel.
 	 *  @param signal_ The signaling mechanism of the channel (push/pull/none).
 	 */
-	DataChannel(std::string const &name, T const &val, AccessType access_=ACCESS_LOCAL, SignalType signal_=NO_SIGNAL): DataChannelBase(name, access_, signal_), m_HasRequestSetHandler(false), m_Value(val) {}
+	DataChannel(std::string const &name, T const &val, AccessType access_=ACCESS_LOCAL, SignalType signal_=NO_SIGNAL): DataChannelBase(name, access_, signal_), m_HasRequestSetHandler(false), m_Value(val), m_Storage(&m_Value) {}
 
 	/** Construct and initialize a new channel.  The initial value is
 	 *  determined by the default constructor for the channel data type.
@@ -465,7 +504,7 @@ public:
 	 *  @param shared_ Create a shared (or non-shared) channel.
 	 *  @param signal_ The signaling mechanism of the channel (push/pull/none).
 	 */
-	DataChannel(std::string const &name, AccessType access_=ACCESS_LOCAL, SignalType signal_=NO_SIGNAL): DataChannelBase(name, access_, signal_), m_HasRequestSetHandler(false), m_Value() {}
+	DataChannel(std::string const &name, AccessType access_=ACCESS_LOCAL, SignalType signal_=NO_SIGNAL): DataChannelBase(name, access_, signal_), m_HasRequestSetHandler(false), m_Value(), m_Storage(&m_Value) {}
 
 	static DataChannel<T> *newLocal(std::string const &name, T const &val) {
 		return new DataChannel(name, val, ACCESS_LOCAL, NO_SIGNAL);
@@ -485,6 +524,74 @@ public:
 	static DataChannel<T> *newSharedPush(std::string const &name, T const &val) {
 		return new DataChannel(name, val, ACCESS_SHARED, PUSH_SIGNAL);
 	}
+
+private:
+	virtual std::size_t arenaSize() const {
+		return ChannelArenaTraits<T>::Storable ? sizeof(T) : 0;
+	}
+
+	virtual std::size_t arenaAlignment() const {
+		return alignof(T);
+	}
+
+	// only called for types that can be copied bitwise.
+	virtual void moveToArena(void *slot) {
+		std::memcpy(slot, static_cast<void*>(m_Storage), sizeof(T));
+		m_Storage = static_cast<T*>(slot);
+	}
+
+	virtual void moveFromArena() {
+		if (m_Storage != &m_Value) {
+			std::memcpy(static_cast<void*>(&m_Value), static_cast<void*>(m_Storage), sizeof(T));
+			m_Storage = &m_Value;
+		}
+	}
+};
+
+
+/** A copy of the values of all data channels in the arena of a bus.  See
+ *  Bus::saveState and Bus::restoreState.
+ */
+class CSPSIM_EXPORT ChannelState {
+friend class Bus;
+	uint32_t m_Layout;
+	std::vector<unsigned char> m_Data;
+public:
+	ChannelState(): m_Layout(0) { }
+
+	/** Test if the state has been saved. */
+	bool empty() const { return m_Data.empty(); }
+
+	/** The size of the saved state in bytes. */
+	std::size_t size() const { return m_Data.size(); }
+};
+
+
+/** The channels returned by the bus lookups made while binding a systems
+ *  model, in the order of the lookups.  Channels are identified by their
+ *  order of registration, so the bindings recorded for one instance of a
+ *  systems model can be replayed to bind other instances of the same model
+ *  without searching the bus by name.  See Bus::recordBindings and
+ *  Bus::replayBindings.
+ */
+class CSPSIM_EXPORT ChannelBindings {
+friend class Bus;
+	enum { MISSING = 0xffffffff };
+	/** Registration index of each channel returned, or MISSING. */
+	std::vector<uint32_t> m_Channels;
+	/** Names of the channels that were not found, in lookup order. */
+	std::vector<std::string> m_Missing;
+	/** Number and fingerprint of the channels registered at the first lookup. */
+	uint32_t m_Registered;
+	uint32_t m_Layout;
+public:
+	ChannelBindings(): m_Registered(0), m_Layout(0) { }
+
+	/** Test if any bindings have been recorded. */
+	bool empty() const { return m_Channels.empty(); }
+
+	/** The number of recorded lookups. */
+	std::size_t size() const { return m_Channels.size(); }
 };
 
 
@@ -508,6 +615,39 @@ class CSPSIM_EXPORT Bus: public Referenced {
 	typedef std::map<std::string, std::vector<ChannelBase::RefT> > GroupMap;
 	GroupMap m_Groups;
 
+	/** Data channels in order of registration.  The references are held by m_Channels. */
+	std::vector<DataChannelBase*> m_DataChannels;
+
+	/** Data channels with values in the arena.  The references are held by m_Channels. */
+	std::vector<DataChannelBase*> m_ArenaChannels;
+
+	/** Storage for the arena, with extra space for alignment. */
+	std::vector<unsigned char> m_ArenaBlock;
+
+	/** The (cache line aligned) arena within m_ArenaBlock. */
+	unsigned char *m_Arena;
+
+	/** The size of the arena in bytes. */
+	std::size_t m_ArenaSize;
+
+	/** Fingerprint of the names and sizes of the channels in the arena. */
+	uint32_t m_ArenaLayout;
+
+	/** All channels in order of registration.  The references are held by m_Channels. */
+	std::vector<ChannelBase*> m_Registered;
+
+	/** Fingerprint of the names of the registered channels, in order. */
+	uint32_t m_RegisteredLayout;
+
+	/** Channel lookups are appended to these bindings, if not null. */
+	ChannelBindings *m_Record;
+
+	/** Channel lookups are taken from these bindings, if not null. */
+	ChannelBindings const *m_Replay;
+	unsigned m_ReplayNext;
+	unsigned m_ReplayMissing;
+	bool m_ReplayDiverged;
+
 	/** Internal flag to help ensure proper bus construction. */
 	bool m_Bound;
 
@@ -520,6 +660,11 @@ class CSPSIM_EXPORT Bus: public Referenced {
 	/** The status [0, 1] used for damage modelling.*/
 	float m_Status;
 
+	/** Find a channel by name, or return null.  Lookups are recorded or
+	 *  replayed if requested.
+	 */
+	ChannelBase *findChannel(std::string const &name);
+
 public:
 	/** Construct a new Bus.
 	 *
@@ -527,6 +672,10 @@ public:
 	 */
 	Bus(std::string const &name);
 
+	/** Move all channel values out of the arena before the channels are released.
+	 */
+	virtual ~Bus();
+
 	/** Test if a particular data channel is available.
 	 *
 	 *  @param name the name of the channel.
@@ -687,6 +836,66 @@ public:
 		return channel.isNull() ? fallback : channel->value();
 	}
 
+	/** Move the values of all registered data channels that can be copied
+	 *  bitwise (see ChannelArenaTraits) into a single contiguous block.
+	 *  Called by SystemsModel::bindSystems(), after all systems have
+	 *  registered their channels.  The channels keep their identities, so
+	 *  existing channel references remain valid, but references to channel
+	 *  values obtained earlier must not be retained.  Values are laid out in
+	 *  order of registration, which keeps the channels of each system
+	 *  together.  Channels registered after the layout keep their own
+	 *  storage and are not included in saved states.
+	 */
+	void layoutChannels();
+
+	/** Test if the channel values have been moved to the arena. */
+	bool hasArena() const { return m_Arena != 0; }
+
+	/** The size of the channel arena in bytes. */
+	std::size_t getArenaSize() const { return m_ArenaSize; }
+
+	/** Save the values of all data channels in the arena.  This is a single
+	 *  memcpy, suitable for capturing the channel state of a vehicle every
+	 *  frame (e.g. for replay or rollback).  Push handlers are not
+	 *  signaled, and pull channels are not updated before saving.
+	 *
+	 *  @returns false if the bus has no arena.
+	 */
+	bool saveState(ChannelState &state) const;
+
+	/** Restore the values of all data channels in the arena from a saved
+	 *  state.  The state may be saved from another bus with the same
+	 *  channel layout, such as the bus of another instance of the same
+	 *  systems model.  Push handlers are not signaled.
+	 *
+	 *  @returns false if the bus has no arena or the layouts differ.
+	 */
+	bool restoreState(ChannelState const &state);
+
+	/** Record the channel lookups made while binding the systems of this
+	 *  bus, until finishBindings() is called.  Any previous contents of the
+	 *  bindings are discarded.
+	 */
+	void recordBindings(ChannelBindings &bindings);
+
+	/** Satisfy channel lookups from bindings recorded by another bus with
+	 *  the same systems, until finishBindings() is called.  The bindings
+	 *  are only used if the same channels were registered, in the same
+	 *  order, as on the recording bus at its first lookup.  Each lookup is
+	 *  checked against the name of the recorded channel (missing channels
+	 *  are confirmed in the channel map), and the bus reverts to lookups by
+	 *  name at the first difference.  The bindings must remain valid until
+	 *  finishBindings() is called.
+	 */
+	void replayBindings(ChannelBindings const &bindings);
+
+	/** Stop recording or replaying channel lookups.
+	 *
+	 *  @returns false if replayed bindings did not match the lookups made
+	 *    since replayBindings() was called.
+	 */
+	bool finishBindings();
+
 	/** Get the bus status value.
 	 *
 	 *  Bus degradation is not currently implemented.
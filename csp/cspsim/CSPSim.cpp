@@ -43,6 +43,7 @@
 #include <csp/cspsim/Profile.h>
 #include <csp/cspsim/Shader.h>
 #include <csp/cspsim/SimpleSceneManager.h>
+#include <csp/cspsim/SystemsModelPrototype.h>
 #include <csp/cspsim/TerrainObject.h>
 #include <csp/cspsim/Theater.h>
 #include <csp/cspsim/VirtualScene.h>
@@ -127,6 +128,13 @@ CSPSim::CSPSim():
 
 	g_DisableRender = g_Config.getBool("Debug", "DisableRender", false, false);
 
+	Profiler::setThreadName("main");
+	Profiler::getInstance().setEnabled(g_Config.getBool("Debug", "Profiler", false, false));
+	const int spike_threshold = g_Config.getInt("Debug", "ProfilerSpikeThreshold", 0, false);
+	if (spike_threshold > 0) {
+		Profiler::getInstance().setSpikeCapture(spike_threshold * 0.001);
+	}
+
 	CSPLOG(Prio_DEBUG, Cat_APP) << "Constructing CSPSim object";
 
 	m_Clean = true;
@@ -395,6 +403,7 @@ void CSPSim::cleanup() {
 	m_Scene = NULL;
 
 	StoresDatabase::getInstance().reset();
+	SystemsModelFactory::getInstance().reset();
 
 	/**
 	 * release cached objects.  this must be done before the sound engine is shut
@@ -618,6 +627,7 @@ void CSPSim::unloadSimulationNow() {
 	m_Atmosphere = NULL;
 
 	StoresDatabase::getInstance().reset();
+	SystemsModelFactory::getInstance().reset();
 
 	if(m_Terrain.valid()) {
 		m_Terrain->deactivate();
@@ -658,20 +668,23 @@ void CSPSim::run() {
 			Ref<BaseScreen> currentScreen = m_CurrentScreen;
 
 			if (m_NetworkClient.valid()) {
+				CSP_PROFILE_ZONE("network");
 				m_NetworkClient->processIncoming(0.01);
 			}
 
-			PROF0(_simloop);
-
 			updateTime();
 
 			m_Viewer->frame();
 
+			// load spare vehicle systems between frames, one at a time.
+			SystemsModelFactory::getInstance().update();
+
 			if (m_NetworkClient.valid()) {
+				CSP_PROFILE_ZONE("network");
 				m_NetworkClient->processOutgoing(0.01);
 			}
 
-			PROF1(_simloop, 30);
+			Profiler::getInstance().frame();
 
 			/**
 			 * Check if someone has requested that the simulation should be
@@ -94,6 +94,7 @@ namespace bus {
 	const char *ControlInputs::SteeringInput = "ControlInputs.SteeringInput";
 
 	const char *Navigation::ActiveSteerpoint = "Navigation.ActiveSteerpoint";
+	const char *Navigation::Route = "Navigation.Route";
 
 	const char *LandingGear::WOW = "LandingGear.WOW";
 	const char *LandingGear::FullyExtended = "LandingGear.FullyExtended";
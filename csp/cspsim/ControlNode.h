@@ -27,11 +27,13 @@
 #include <csp/csplib/data/Key.h>
 #include <csp/csplib/data/Object.h>
 #include <map>
+#include <vector>
 
 namespace csp {
 
 class Bus;
 class DataRecorder;
+struct ControlInstruction;
 
 
 /** Abstract base class for nodes in a flight control network.
@@ -55,6 +57,8 @@ class DataRecorder;
  */
 class ControlNode: public Object {
 
+friend class ControlTape;
+
 public:
 	/** Helper class for synchronizing updates across a flight control
 	 *  system network.  Each update is assigned a sequential count and
@@ -122,7 +126,26 @@ public:
 	virtual void importChannels(Bus*) { }
 	virtual void bindRecorder(DataRecorder*) const { }
 
+	/** Get the nodes that this node reads during evaluation.  Used to sort the
+	 *  network when compiling it into a ControlTape.  Custom nodes that call
+	 *  step() on other nodes must list those nodes here.
+	 */
+	virtual void getInputs(std::vector<ControlNode*> &) const { }
+
+	/** Describe this node as a ControlTape instruction.  The operands are
+	 *  taken from getInputs(), in order; the tape assigns the value slots.
+	 *  Custom nodes can leave the default implementation, in which case the
+	 *  tape evaluates them by calling step().
+	 *
+	 *  @return true if the instruction was set, false otherwise.
+	 */
+	virtual bool compile(ControlInstruction &) const { return false; }
+
 protected:
+	/** Copy the output limits of this node to a compiled instruction.
+	 */
+	void compileLimits(ControlInstruction &op) const;
+
 	/** A helper method allowing subclasses to set an initial output value.
 	 */
 	void setInitialOutput(double output) { m_Output0 = clamp(output); }
@@ -169,6 +192,14 @@ private:
 		return false;
 	}
 
+	/** Set the output of a node evaluated by a ControlTape, marking it as up
+	 *  to date for the current time step.
+	 */
+	void setCompiledOutput(double output, Timer const &timer) {
+		m_Output0 = output;
+		m_Count = timer.count();
+	}
+
 	double m_Output0;
 	double m_ClampLo;
 	double m_ClampHi;
@@ -0,0 +1,325 @@
+// Combat Simulator Project
+// Copyright (C) 2005 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/**
+ * @file ControlTape.cpp
+ *
+ **/
+
+#include <csp/cspsim/ControlTape.h>
+#include <csp/csplib/util/Log.h>
+
+#include <algorithm>
+#include <iterator>
+
+
+namespace csp {
+
+
+ControlInstruction::ControlInstruction():
+	op(EXTERNAL),
+	out(0),
+	memory(0.0),
+	clamp_lo(-1e+30),
+	clamp_hi(1e+30),
+	rate_limit_dec(-1e+30),
+	rate_limit_inc(1e+30),
+	jump(0),
+	scalar(0),
+	vector(0),
+	flag(0),
+	output(0),
+	table(0),
+	node(0)
+{
+	for (unsigned i = 0; i < 3; ++i) {
+		in[i] = 0;
+		gain[i] = 1.0;
+		offset[i] = 0.0;
+		param[i] = 0.0;
+	}
+}
+
+
+void ControlNode::compileLimits(ControlInstruction &op) const {
+	op.clamp_lo = m_ClampLo;
+	op.clamp_hi = m_ClampHi;
+	op.rate_limit_dec = m_RateLimitDec;
+	op.rate_limit_inc = m_RateLimitInc;
+}
+
+
+void ControlTape::compile(std::vector<ControlNode::RefT> const &outputs) {
+	m_Code.clear();
+	m_Values.clear();
+	m_Slots.clear();
+	m_Observed.clear();
+	m_External = 0;
+
+	findExclusiveNodes(outputs);
+	for (std::vector<ControlNode::RefT>::const_iterator iter = outputs.begin(); iter != outputs.end(); ++iter) {
+		visit(iter->get());
+	}
+
+	// compiled nodes that are read by black box nodes must keep their own
+	// output up to date.
+	for (std::vector<ControlInstruction>::iterator op = m_Code.begin(); op != m_Code.end(); ++op) {
+		if (op->op == ControlInstruction::EXTERNAL) continue;
+		if (std::find(m_Observed.begin(), m_Observed.end(), op->node) == m_Observed.end()) op->node = 0;
+	}
+	m_Slots.clear();
+	m_Observed.clear();
+	m_Exclusive.clear();
+
+	CSPLOG(Prio_INFO, Cat_APP) << "Compiled flight control network: " << m_Code.size() << " instructions, " << m_External << " external nodes";
+}
+
+unsigned ControlTape::visit(ControlNode *node) {
+	assert(node);
+	SlotMap::const_iterator iter = m_Slots.find(node);
+	if (iter != m_Slots.end()) return iter->second;
+
+	// assign the slot before visiting the inputs so that feedback loops read
+	// the value from the previous time step.
+	const unsigned slot = static_cast<unsigned>(m_Values.size());
+	m_Slots[node] = slot;
+	m_Values.push_back(node->getOutput());
+
+	ControlInstruction op;
+	const bool compiled = node->compile(op);
+	if (compiled) node->compileLimits(op);
+
+	std::vector<ControlNode*> inputs;
+	node->getInputs(inputs);
+	assert(!compiled || inputs.size() <= 3);
+	std::vector<unsigned> reads(inputs.size());
+	if (compiled && (op.op == ControlInstruction::SWITCH || op.op == ControlInstruction::BOOLEAN_SWITCH)) {
+		// visit the selector first, as in Switch::evaluate, so that the tape
+		// can skip the input that is not selected.
+		if (op.op == ControlInstruction::SWITCH) reads[2] = visit(inputs[2]);
+		for (unsigned i = 0; i < 2; ++i) {
+			reads[i] = visitBranch(inputs[i], op, i, reads.size() > 2 ? reads[2] : 0, m_Exclusive[SwitchInput(node, i)]);
+		}
+	} else {
+		for (unsigned i = 0; i < inputs.size(); ++i) reads[i] = visit(inputs[i]);
+	}
+	for (unsigned i = 0; i < inputs.size(); ++i) {
+		if (compiled) {
+			op.in[i] = reads[i];
+		} else {
+			m_Observed.push_back(inputs[i]);
+		}
+	}
+
+	if (!compiled) {
+		op.op = ControlInstruction::EXTERNAL;
+		++m_External;
+	}
+	op.out = slot;
+	op.node = node;
+	m_Code.push_back(op);
+	return slot;
+}
+
+unsigned ControlTape::visitBranch(ControlNode *node, ControlInstruction const &op, unsigned input, unsigned select, NodeSet const &exclusive) {
+	if (exclusive.count(node) == 0 || m_Slots.count(node) > 0) return visit(node);
+
+	// the nodes that are also read elsewhere are updated regardless of the
+	// switch, so they go before the branch.
+	NodeSet seen;
+	visitShared(node, exclusive, seen);
+
+	const unsigned index = static_cast<unsigned>(m_Code.size());
+	ControlInstruction branch;
+	branch.op = (input == 0) ? ControlInstruction::BRANCH_A : ControlInstruction::BRANCH_B;
+	branch.in[2] = select;
+	branch.gain[2] = op.gain[2];
+	branch.offset[2] = op.offset[2];
+	branch.param[0] = op.param[0];
+	branch.flag = op.flag;
+	m_Code.push_back(branch);
+
+	const unsigned slot = visit(node);
+	m_Code[index].jump = static_cast<unsigned>(m_Code.size());
+	return slot;
+}
+
+void ControlTape::visitShared(ControlNode *node, NodeSet const &exclusive, NodeSet &seen) {
+	if (!seen.insert(node).second) return;
+	std::vector<ControlNode*> inputs;
+	node->getInputs(inputs);
+	for (unsigned i = 0; i < inputs.size(); ++i) {
+		if (exclusive.count(inputs[i]) > 0) {
+			visitShared(inputs[i], exclusive, seen);
+		} else {
+			visit(inputs[i]);
+		}
+	}
+}
+
+void ControlTape::findExclusiveNodes(std::vector<ControlNode::RefT> const &outputs) {
+	// a node is exclusive to a switch input if every path from the outputs
+	// to the node passes through that input.
+	NodeSet all;
+	reach(outputs, SwitchInput(0, 0), all);
+	for (NodeSet::const_iterator iter = all.begin(); iter != all.end(); ++iter) {
+		ControlInstruction op;
+		if (!(*iter)->compile(op)) continue;
+		if (op.op != ControlInstruction::SWITCH && op.op != ControlInstruction::BOOLEAN_SWITCH) continue;
+		for (unsigned i = 0; i < 2; ++i) {
+			const SwitchInput cut(*iter, i);
+			NodeSet reached;
+			reach(outputs, cut, reached);
+			NodeSet &exclusive = m_Exclusive[cut];
+			std::set_difference(all.begin(), all.end(), reached.begin(), reached.end(), std::inserter(exclusive, exclusive.begin()));
+		}
+	}
+}
+
+void ControlTape::reach(std::vector<ControlNode::RefT> const &outputs, SwitchInput const &cut, NodeSet &reached) {
+	std::vector<ControlNode*> pending;
+	for (std::vector<ControlNode::RefT>::const_iterator iter = outputs.begin(); iter != outputs.end(); ++iter) {
+		pending.push_back(iter->get());
+	}
+	while (!pending.empty()) {
+		ControlNode *node = pending.back();
+		pending.pop_back();
+		if (!reached.insert(node).second) continue;
+		std::vector<ControlNode*> inputs;
+		node->getInputs(inputs);
+		for (unsigned i = 0; i < inputs.size(); ++i) {
+			if (node != cut.first || i != cut.second) pending.push_back(inputs[i]);
+		}
+	}
+}
+
+void ControlTape::run(ControlNode::Timer const &timer) {
+	const double dt = timer.dt();
+	double *value = &m_Values[0];
+	const std::vector<ControlInstruction>::iterator end = m_Code.end();
+	for (std::vector<ControlInstruction>::iterator op = m_Code.begin(); op != end; ++op) {
+		const double a = value[op->in[0]] * op->gain[0] + op->offset[0];
+		const double b = value[op->in[1]] * op->gain[1] + op->offset[1];
+		const double c = value[op->in[2]] * op->gain[2] + op->offset[2];
+		const double last = value[op->out];
+		double x;
+		switch (op->op) {
+			case ControlInstruction::CONSTANT:
+				continue;
+			case ControlInstruction::INPUT_SCALAR:
+				x = op->scalar->value() * op->param[0];
+				break;
+			case ControlInstruction::INPUT_VECTOR_X:
+				x = op->vector->value().x() * op->param[0];
+				break;
+			case ControlInstruction::INPUT_VECTOR_Y:
+				x = op->vector->value().y() * op->param[0];
+				break;
+			case ControlInstruction::INPUT_VECTOR_Z:
+				x = op->vector->value().z() * op->param[0];
+				break;
+			case ControlInstruction::SCALE:
+			case ControlInstruction::OUTPUT:
+				x = a;
+				break;
+			case ControlInstruction::LAG_FILTER: {
+				double f = dt * op->param[0];
+				f = f / (2.0 + f);
+				x = last + f * ((a + op->memory) - 2.0 * last);
+				op->memory = a;
+				break;
+			}
+			case ControlInstruction::LEAD_LAG_FILTER: {
+				const double input = a * op->param[2];
+				const double fa = op->param[0] * dt;
+				const double fb = op->param[1] * dt;
+				x = ((2.0 - fb) * last + (fa + 2.0) * input + (fa - 2.0) * op->memory) / (2.0 + fb);
+				op->memory = input;
+				break;
+			}
+			case ControlInstruction::LEAD_FILTER: {
+				const double g = op->param[0] * dt;
+				const double d = 1.0 / (2.0 + g);
+				x = (2.0 - g) * d * last + 2.0 * d * (a - op->memory);
+				op->memory = a;
+				break;
+			}
+			case ControlInstruction::INTEGRATOR:
+				x = last + dt * a;
+				break;
+			case ControlInstruction::MULTIPLY:
+				x = a * b;
+				break;
+			case ControlInstruction::DIVIDE:
+				x = a / b;
+				break;
+			case ControlInstruction::ADD:
+				x = a + b;
+				break;
+			case ControlInstruction::ADD3:
+				x = a + b + c;
+				break;
+			case ControlInstruction::SCHEDULE1:
+				x = (*op->table)[static_cast<float>(a)];
+				break;
+			case ControlInstruction::SCHEDULE2:
+				x = a * (*op->table)[static_cast<float>(b)];
+				break;
+			case ControlInstruction::SWITCH:
+				x = (c < op->param[0]) ? a : b;
+				break;
+			case ControlInstruction::BOOLEAN_SWITCH:
+				x = op->flag->value() ? a : b;
+				break;
+			case ControlInstruction::BRANCH_A:
+			case ControlInstruction::BRANCH_B: {
+				// skip the instructions of the input that the switch does not select.
+				const bool select_a = op->flag ? op->flag->value() : (c < op->param[0]);
+				if (select_a != (op->op == ControlInstruction::BRANCH_A)) op = m_Code.begin() + (op->jump - 1);
+				continue;
+			}
+			case ControlInstruction::GREATER:
+				x = std::max(a, b);
+				break;
+			case ControlInstruction::LESSER:
+				x = std::min(a, b);
+				break;
+			case ControlInstruction::EXTERNAL:
+			default:
+				value[op->out] = op->node->step(timer);
+				continue;
+		}
+
+		// output clamping and rate limiting; see ControlNode::setOutput.
+		x = clampTo(x, op->clamp_lo, op->clamp_hi);
+		const double delta = x - last;
+		if (delta > op->rate_limit_inc * dt) {
+			x = last + op->rate_limit_inc * dt;
+		} else
+		if (delta < op->rate_limit_dec * dt) {
+			x = last + op->rate_limit_dec * dt;
+		}
+		value[op->out] = x;
+
+		if (op->output) op->output->value() = x;
+		if (op->node) op->node->setCompiledOutput(x, timer);
+	}
+}
+
+} // namespace csp
@@ -0,0 +1,160 @@
+#pragma once
+// Combat Simulator Project
+// Copyright (C) 2005 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/**
+ * @file ControlTape.h
+ *
+ **/
+
+#include <csp/cspsim/Bus.h>
+#include <csp/cspsim/ControlNode.h>
+#include <csp/cspsim/Export.h>
+#include <csp/csplib/data/LUT.h>
+#include <csp/csplib/data/Vector3.h>
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace csp {
+
+
+/** A single step of a compiled control node network.  Each instruction
+ *  corresponds to one ControlNode, and reads its operands from (and writes
+ *  its result to) slots in the value array of the ControlTape.  Bus
+ *  channels and lookup tables are resolved to pointers when the network
+ *  is compiled, and filter state is stored inline.
+ */
+struct ControlInstruction {
+	typedef enum {
+		CONSTANT,
+		INPUT_SCALAR,
+		INPUT_VECTOR_X,
+		INPUT_VECTOR_Y,
+		INPUT_VECTOR_Z,
+		SCALE,
+		LAG_FILTER,
+		LEAD_LAG_FILTER,
+		LEAD_FILTER,
+		INTEGRATOR,
+		MULTIPLY,
+		DIVIDE,
+		ADD,
+		ADD3,
+		SCHEDULE1,
+		SCHEDULE2,
+		SWITCH,
+		BOOLEAN_SWITCH,
+		BRANCH_A,
+		BRANCH_B,
+		GREATER,
+		LESSER,
+		OUTPUT,
+		EXTERNAL
+	} OpCode;
+
+	ControlInstruction();
+
+	OpCode op;
+	unsigned out;
+	unsigned in[3];
+	double gain[3];
+	double offset[3];
+	double param[3];
+	double memory;
+	double clamp_lo;
+	double clamp_hi;
+	double rate_limit_dec;
+	double rate_limit_inc;
+	unsigned jump;  // BRANCH_A/B: the first instruction after the branch.
+	DataChannel<double> const *scalar;
+	DataChannel<Vector3> const *vector;
+	DataChannel<bool> const *flag;
+	DataChannel<double> *output;
+	Table1 const *table;
+	ControlNode *node;
+};
+
+
+/** A control node network flattened into a contiguous list of instructions.
+ *
+ *  The network is sorted topologically (depth first from the output nodes,
+ *  in the same order as the recursive ControlNode::step evaluation), so that
+ *  a single pass over the instructions updates every node exactly once with
+ *  no virtual dispatch.  Feedback loops read the output of the previous time
+ *  step, just as in the recursive evaluation.
+ *
+ *  Nodes that cannot be compiled (custom "black box" nodes) are evaluated
+ *  by calling ControlNode::step from the tape.  Compiled nodes that feed a
+ *  black box (see ControlNode::getInputs) copy their output back to the node
+ *  so that the black box sees the current value.
+ *
+ *  The nodes that only feed one input of a switch are preceded by a branch
+ *  that skips them when the switch selects the other input, so that their
+ *  filters and integrators hold their state as they do in the recursive
+ *  evaluation.  Nodes that are also read elsewhere are evaluated before the
+ *  branch and updated on every step.
+ */
+class CSPSIM_EXPORT ControlTape {
+public:
+	ControlTape(): m_External(0) { }
+
+	/** Build the tape from the nodes reachable from the specified outputs.
+	 *  The nodes must be linked and bound to the bus.
+	 */
+	void compile(std::vector<ControlNode::RefT> const &outputs);
+
+	/** Advance the network by one time step.
+	 */
+	void run(ControlNode::Timer const &timer);
+
+	/** Test if compile() has been called.
+	 */
+	bool isCompiled() const { return !m_Code.empty(); }
+
+	/** The number of instructions in the tape.
+	 */
+	unsigned size() const { return static_cast<unsigned>(m_Code.size()); }
+
+	/** The number of black box nodes evaluated through ControlNode::step.
+	 */
+	unsigned getExternalCount() const { return m_External; }
+
+private:
+	typedef std::set<ControlNode const*> NodeSet;
+	typedef std::pair<ControlNode const*, unsigned> SwitchInput;
+
+	unsigned visit(ControlNode *node);
+	unsigned visitBranch(ControlNode *node, ControlInstruction const &op, unsigned input, unsigned select, NodeSet const &exclusive);
+	void visitShared(ControlNode *node, NodeSet const &exclusive, NodeSet &seen);
+	void findExclusiveNodes(std::vector<ControlNode::RefT> const &outputs);
+	static void reach(std::vector<ControlNode::RefT> const &outputs, SwitchInput const &cut, NodeSet &reached);
+
+	typedef std::map<ControlNode const*, unsigned> SlotMap;
+	SlotMap m_Slots;
+	std::vector<ControlNode*> m_Observed;
+	std::map<SwitchInput, NodeSet> m_Exclusive;
+	std::vector<ControlInstruction> m_Code;
+	std::vector<double> m_Values;
+	unsigned m_External;
+};
+
+} // namespace csp
@@ -60,5 +60,79 @@ CSP_XML_BEGIN(DamageModifier)
 	CSP_DEF("electric_shock", m_ElectricShock, false)
 CSP_XML_END
 
+
+DamageModifier::DamageModifier():
+	m_Incendiary(100),
+	m_HighExplosive(100),
+	m_Penetrating(100),
+	m_ArmorPiercing(100),
+	m_SmallArms(100),
+	m_HighExplosiveAntiTank(100),
+	m_Sabot(100),
+	m_SmallArmsSoftPoint(100),
+	m_SmallArmsFullMetalJacket(100),
+	m_SmallArmsArmorPiercing(100),
+	m_SmallArmsExplosive(100),
+	m_SmallArmsHydroshock(100),
+	m_GenericSmallArms(100),
+	m_LessThanLethalBluntForce(100),
+	m_LessThanLethalElectricity(100),
+	m_LessThanLethalChemical(100),
+	m_LessThanLethalSonic(100),
+	m_GenericLethalChemical(100),
+	m_Radiological(100),
+	m_BluntImpact(100),
+	m_PiercingImpact(100),
+	m_Shockwave(100),
+	m_Shrapnel(100),
+	m_Biological(100),
+	m_Electromagnetic(100),
+	m_MechanicalFlooding(100),
+	m_MaterialOverstress(100),
+	m_Asphyxiation(100),
+	m_Bleeding(100),
+	m_Drowning(100),
+	m_ElectricShock(100) {
+}
+
+double DamageModifier::getFactor(DamageType type) const {
+	char value = 100;
+	switch (type) {
+		case INCENDIARY: value = m_Incendiary; break;
+		case HIGH_EXPLOSIVE: value = m_HighExplosive; break;
+		case PENETRATING: value = m_Penetrating; break;
+		case ARMOR_PIERCING: value = m_ArmorPiercing; break;
+		case SMALL_ARMS: value = m_SmallArms; break;
+		case HIGH_EXPLOSIVE_ANTI_TANK: value = m_HighExplosiveAntiTank; break;
+		case SABOT: value = m_Sabot; break;
+		case SMALL_ARMS_SOFT_POINT: value = m_SmallArmsSoftPoint; break;
+		case SMALL_ARMS_FULL_METAL_JACKET: value = m_SmallArmsFullMetalJacket; break;
+		case SMALL_ARMS_ARMOR_PIERCING: value = m_SmallArmsArmorPiercing; break;
+		case SMALL_ARMS_EXPLOSIVE: value = m_SmallArmsExplosive; break;
+		case SMALL_ARMS_HYDROSHOCK: value = m_SmallArmsHydroshock; break;
+		case GENERIC_SMALL_ARMS: value = m_GenericSmallArms; break;
+		case LESS_THAN_LETHAL_BLUNT_FORCE: value = m_LessThanLethalBluntForce; break;
+		case LESS_THAN_LETHAL_ELECTRICITY: value = m_LessThanLethalElectricity; break;
+		case LESS_THAN_LETHAL_CHEMICAL: value = m_LessThanLethalChemical; break;
+		case LESS_THAN_LETHAL_SONIC: value = m_LessThanLethalSonic; break;
+		case GENERIC_LETHAL_CHEMICAL: value = m_GenericLethalChemical; break;
+		case RADIOLOGICAL: value = m_Radiological; break;
+		case BLUNT_IMPACT: value = m_BluntImpact; break;
+		case PIERCING_IMPACT: value = m_PiercingImpact; break;
+		case SHOCKWAVE: value = m_Shockwave; break;
+		case SHRAPNEL: value = m_Shrapnel; break;
+		case BIOLOGICAL: value = m_Biological; break;
+		case ELECTROMAGNETIC: value = m_Electromagnetic; break;
+		case MECHANICAL_FLOODING: value = m_MechanicalFlooding; break;
+		case MATERIAL_OVERSTRESS: value = m_MaterialOverstress; break;
+		case ASPHYXIATION: value = m_Asphyxiation; break;
+		case BLEEDING: value = m_Bleeding; break;
+		case DROWNING: value = m_Drowning; break;
+		case ELECTRIC_SHOCK: value = m_ElectricShock; break;
+		default: break;
+	}
+	return value * 0.01;
+}
+
 } // namespace csp
 
@@ -33,11 +33,51 @@ namespace csp {
  * Damage modifiers reflect the resistance of an object to
  * various types of weapons.
  *
+ * Each modifier is a percentage of the nominal damage inflicted by the
+ * corresponding weapon effect: 100 (the default) for no resistance, and 0
+ * for immunity.
+ *
  * @todo add more modifiers if needed
  * @todo depreciate m_SmallArms in favor of more specific small arms options.
  */
 class DamageModifier: public Object {
 public:
+	/** Weapon effects, one per modifier. */
+	typedef enum {
+		INCENDIARY,
+		HIGH_EXPLOSIVE,
+		PENETRATING,
+		ARMOR_PIERCING,
+		SMALL_ARMS,
+		HIGH_EXPLOSIVE_ANTI_TANK,
+		SABOT,
+		SMALL_ARMS_SOFT_POINT,
+		SMALL_ARMS_FULL_METAL_JACKET,
+		SMALL_ARMS_ARMOR_PIERCING,
+		SMALL_ARMS_EXPLOSIVE,
+		SMALL_ARMS_HYDROSHOCK,
+		GENERIC_SMALL_ARMS,
+		LESS_THAN_LETHAL_BLUNT_FORCE,
+		LESS_THAN_LETHAL_ELECTRICITY,
+		LESS_THAN_LETHAL_CHEMICAL,
+		LESS_THAN_LETHAL_SONIC,
+		GENERIC_LETHAL_CHEMICAL,
+		RADIOLOGICAL,
+		BLUNT_IMPACT,
+		PIERCING_IMPACT,
+		SHOCKWAVE,
+		SHRAPNEL,
+		BIOLOGICAL,
+		ELECTROMAGNETIC,
+		MECHANICAL_FLOODING,
+		MATERIAL_OVERSTRESS,
+		ASPHYXIATION,
+		BLEEDING,
+		DROWNING,
+		ELECTRIC_SHOCK,
+		NUMBER_OF_DAMAGE_TYPES
+	} DamageType;
+
 	char m_Incendiary;
 	char m_HighExplosive;
 	char m_Penetrating;
@@ -73,9 +113,14 @@ public:
 	
 	CSP_DECLARE_STATIC_OBJECT(DamageModifier)
 
-	DamageModifier() {}
+	DamageModifier();
 	virtual ~DamageModifier() {}
 
+	/** The fraction of the nominal damage inflicted by the specified
+	 *  weapon effect.
+	 */
+	double getFactor(DamageType type) const;
+
 	virtual void postCreate() {}
 };
 
@@ -26,17 +26,141 @@
 
 #include <csp/cspsim/DataRecorder.h>
 #include <csp/cspsim/Bus.h>
+#include <csp/csplib/thread/Thread.h>
+#include <csp/csplib/util/Log.h>
 
+#include <condition_variable>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
 
 namespace csp {
 
-struct DataRecorder::File {
-	File(FILE *file): fptr(file) { }
-	~File() { if (fptr) fclose(fptr); }
-	FILE *fptr;
+namespace {
+
+// A block is also flushed after this many samples or this much elapsed time
+// (in seconds), even if few values changed, so that the sample columns stay
+// bounded and seeks through the block index remain fine grained.
+const unsigned MaxBlockSamples = 4096;
+const float MaxBlockTime = 10.0f;
+
+// Output is written in little endian byte order regardless of the host.
+void putU32(std::vector<unsigned char> &out, uint32_t value) {
+	for (unsigned i = 0; i < 4; ++i) out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+}
+
+void putU64(std::vector<unsigned char> &out, uint64_t value) {
+	for (unsigned i = 0; i < 8; ++i) out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+}
+
+void putVarint(std::vector<unsigned char> &out, uint32_t value) {
+	while (value >= 0x80) {
+		out.push_back(static_cast<unsigned char>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<unsigned char>(value));
+}
+
+void putBytes(std::vector<unsigned char> &out, std::vector<unsigned char> const &bytes) {
+	putVarint(out, static_cast<uint32_t>(bytes.size()));
+	out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+inline uint32_t floatBits(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+inline unsigned leadingZeros(uint32_t x) {
+	unsigned n = 0;
+	if (!(x & 0xffff0000u)) { n += 16; x <<= 16; }
+	if (!(x & 0xff000000u)) { n += 8; x <<= 8; }
+	if (!(x & 0xf0000000u)) { n += 4; x <<= 4; }
+	if (!(x & 0xc0000000u)) { n += 2; x <<= 2; }
+	if (!(x & 0x80000000u)) { n += 1; }
+	return n;
+}
+
+inline unsigned trailingZeros(uint32_t x) {
+	unsigned n = 0;
+	if (!(x & 0x0000ffffu)) { n += 16; x >>= 16; }
+	if (!(x & 0x000000ffu)) { n += 8; x >>= 8; }
+	if (!(x & 0x0000000fu)) { n += 4; x >>= 4; }
+	if (!(x & 0x00000003u)) { n += 2; x >>= 2; }
+	if (!(x & 0x00000001u)) { n += 1; }
+	return n;
+}
+
+/** Packs bit fields into bytes, most significant bit first.
+ */
+class BitWriter {
+public:
+	BitWriter(std::vector<unsigned char> &out): m_Out(out), m_Bits(0), m_Count(0) { }
+	void write(uint32_t value, unsigned bits) {
+		const uint64_t mask = (static_cast<uint64_t>(1) << bits) - 1;
+		m_Bits = (m_Bits << bits) | (value & mask);
+		m_Count += bits;
+		while (m_Count >= 8) {
+			m_Count -= 8;
+			m_Out.push_back(static_cast<unsigned char>(m_Bits >> m_Count));
+		}
+	}
+	void finish() {
+		if (m_Count > 0) write(0, 8 - m_Count);
+	}
+private:
+	std::vector<unsigned char> &m_Out;
+	uint64_t m_Bits;
+	unsigned m_Count;
 };
 
+/** Compress a sequence of floats by xor'ing each value with its predecessor.
+ *  Slowly varying values share the sign, exponent, and high mantissa bits
+ *  of the previous value, so the xor has many leading zeros, and values
+ *  that are quantized or rounded produce trailing zeros.  Each value is
+ *  encoded as:
+ *
+ *    0                    same as the previous value
+ *    1 0 <bits>           significant bits fit the previous window
+ *    1 1 <5> <5> <bits>   new window: leading zeros, length - 1, bits
+ *
+ *  The first value is stored verbatim (as a new window of 32 bits).
+ */
+void encodeValues(std::vector<float> const &values, std::vector<unsigned char> &out) {
+	BitWriter bits(out);
+	uint32_t last = 0;
+	unsigned lead = 33, trail = 0;  // no window yet
+	for (unsigned i = 0; i < values.size(); ++i) {
+		const uint32_t value = floatBits(values[i]);
+		const uint32_t x = value ^ last;
+		last = value;
+		if (i > 0 && x == 0) {
+			bits.write(0, 1);
+			continue;
+		}
+		const unsigned l = (x == 0) ? 31 : leadingZeros(x);
+		const unsigned t = (x == 0) ? 0 : trailingZeros(x);
+		if (i > 0 && lead + trail <= 32 && l >= lead && t >= trail) {
+			bits.write(2, 2);
+			bits.write(x >> trail, 32 - lead - trail);
+		} else {
+			const unsigned length = 32 - l - t;
+			bits.write(3, 2);
+			bits.write(l, 5);
+			bits.write(length - 1, 5);
+			bits.write(x >> t, length);
+			lead = l;
+			trail = t;
+		}
+	}
+	bits.finish();
+}
+
+} // namespace
+
 
 struct DataRecorder::DataEntry {
 	unsigned int id;
@@ -46,6 +170,260 @@ struct DataRecorder::DataEntry {
 };
 
 
+/** A cache of recorded samples, in the order they were recorded.  Filled
+ *  by the simulation thread and encoded by the writer thread.
+ */
+struct DataRecorder::Block {
+	std::vector<float> times;
+	std::vector<uint32_t> rows;  // index of the first entry of each sample
+	std::vector<DataEntry> entries;
+	std::vector<std::pair<uint32_t, unsigned char> > events;  // (sample index, event)
+	float elapsed;  // elapsed time when the block was flushed
+
+	Block(): elapsed(0.0) { }
+	bool empty() const { return times.empty() && events.empty(); }
+	void clear() {
+		times.clear();
+		rows.clear();
+		entries.clear();
+		events.clear();
+	}
+};
+
+
+/** The output file and the state used by the writer thread to encode it.
+ */
+struct DataRecorder::File {
+	struct IndexEntry {
+		uint64_t offset;
+		float start;
+		float end;
+		uint32_t samples;
+	};
+
+	File(FILE *file): fptr(file), offset(0), busy(false) { }
+	~File() { if (fptr) fclose(fptr); }
+
+	void writeHeader();
+	void writeBlock(Block const &block);
+	void writeIndex(std::vector<std::string> const &channels);
+
+	FILE *fptr;
+	uint64_t offset;
+	Block blocks[2];
+	std::vector<IndexEntry> index;
+	bool busy;  // a block is queued or being written; guarded by the writer mutex.
+
+	// scratch space used by the writer thread.
+	std::vector<unsigned char> buffer;
+	std::vector<unsigned char> column;
+	std::vector<float> values;
+	std::vector<uint32_t> counts;
+	std::vector<uint32_t> starts;
+	std::vector<uint32_t> next;
+	std::vector<std::pair<uint32_t, float> > order;  // (sample index, value)
+
+private:
+	void write(std::vector<unsigned char> const &data) {
+		if (!data.empty()) fwrite(&data[0], 1, data.size(), fptr);
+		offset += data.size();
+	}
+};
+
+
+void DataRecorder::File::writeHeader() {
+	buffer.assign(reinterpret_cast<const unsigned char*>("CSPREC02"), reinterpret_cast<const unsigned char*>("CSPREC02") + 8);
+	write(buffer);
+}
+
+void DataRecorder::File::writeBlock(Block const &block) {
+	const uint32_t samples = static_cast<uint32_t>(block.times.size());
+	IndexEntry entry;
+	entry.offset = offset;
+	entry.start = samples > 0 ? block.times.front() : block.elapsed;
+	entry.end = samples > 0 ? block.times.back() : block.elapsed;
+	entry.samples = samples;
+	index.push_back(entry);
+
+	// the payload follows an eight byte header with the sample count and
+	// the payload size.
+	buffer.assign(8, 0);
+
+	column.clear();
+	encodeValues(block.times, column);
+	putBytes(buffer, column);
+
+	putVarint(buffer, static_cast<uint32_t>(block.events.size()));
+	for (unsigned i = 0; i < block.events.size(); ++i) {
+		putVarint(buffer, block.events[i].first);
+		buffer.push_back(block.events[i].second);
+	}
+
+	// transpose the entries into one column per channel using a counting
+	// sort, which preserves the sample order within each channel.
+	const uint32_t entries = static_cast<uint32_t>(block.entries.size());
+	counts.clear();
+	for (uint32_t i = 0; i < entries; ++i) {
+		const unsigned id = block.entries[i].id;
+		if (id >= counts.size()) counts.resize(id + 1, 0);
+		++counts[id];
+	}
+	uint32_t channels = 0;
+	starts.assign(counts.size() + 1, 0);
+	for (unsigned id = 0; id < counts.size(); ++id) {
+		starts[id + 1] = starts[id] + counts[id];
+		if (counts[id] > 0) ++channels;
+	}
+	order.resize(entries);
+	next.assign(starts.begin(), starts.end() - 1);
+	for (uint32_t sample = 0; sample < samples; ++sample) {
+		const uint32_t end = (sample + 1 < samples) ? block.rows[sample + 1] : entries;
+		for (uint32_t i = block.rows[sample]; i < end; ++i) {
+			order[next[block.entries[i].id]++] = std::make_pair(sample, block.entries[i].value);
+		}
+	}
+
+	putVarint(buffer, channels);
+	for (unsigned id = 0; id < counts.size(); ++id) {
+		if (counts[id] == 0) continue;
+		putVarint(buffer, id);
+		putVarint(buffer, counts[id]);
+		column.clear();
+		values.clear();
+		uint32_t last = 0;
+		for (uint32_t i = starts[id]; i < starts[id + 1]; ++i) {
+			// samples are stored as the gap since the previous change.
+			putVarint(column, order[i].first - last);
+			last = order[i].first + 1;
+			values.push_back(order[i].second);
+		}
+		putBytes(buffer, column);
+		column.clear();
+		encodeValues(values, column);
+		putBytes(buffer, column);
+	}
+
+	const uint32_t size = static_cast<uint32_t>(buffer.size() - 8);
+	for (unsigned i = 0; i < 4; ++i) {
+		buffer[i] = static_cast<unsigned char>(samples >> (8 * i));
+		buffer[i + 4] = static_cast<unsigned char>(size >> (8 * i));
+	}
+	write(buffer);
+}
+
+void DataRecorder::File::writeIndex(std::vector<std::string> const &channels) {
+	const uint64_t index_offset = offset;
+	buffer.clear();
+	putU32(buffer, static_cast<uint32_t>(channels.size()));
+	for (unsigned i = 0; i < channels.size(); ++i) {
+		putVarint(buffer, static_cast<uint32_t>(channels[i].size()));
+		buffer.insert(buffer.end(), channels[i].begin(), channels[i].end());
+	}
+	putU32(buffer, static_cast<uint32_t>(index.size()));
+	for (unsigned i = 0; i < index.size(); ++i) {
+		putU64(buffer, index[i].offset);
+		putU32(buffer, floatBits(index[i].start));
+		putU32(buffer, floatBits(index[i].end));
+		putU32(buffer, index[i].samples);
+	}
+	putU64(buffer, index_offset);
+	buffer.insert(buffer.end(), reinterpret_cast<const unsigned char*>("CSPRECIX"), reinterpret_cast<const unsigned char*>("CSPRECIX") + 8);
+	write(buffer);
+}
+
+
+/** A background thread that encodes and writes blocks for all recorders.
+ *  Only one block per recorder is in flight at a time.
+ */
+class DataRecorder::Writer: public Referenced {
+public:
+	/** Get the shared writer, starting the thread if necessary.  Recorders
+	 *  are created and destroyed by the simulation thread, so no locking
+	 *  is needed here.
+	 */
+	static Ref<Writer> instance() {
+		if (!s_Instance) s_Instance = new Writer;
+		return s_Instance;
+	}
+
+	/** Queue a block for writing, first waiting for any previous block of
+	 *  the same file to be written.
+	 */
+	void submit(File *file, Block *block) {
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Done.wait(lock, [file]() { return !file->busy; });
+		file->busy = true;
+		m_Queue.push_back(Job(file, block));
+		lock.unlock();
+		m_Wakeup.notify_one();
+	}
+
+	/** Wait until all blocks queued for a file have been written.
+	 */
+	void wait(File *file) {
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Done.wait(lock, [file]() { return !file->busy; });
+	}
+
+private:
+	typedef std::pair<File*, Block*> Job;
+
+	class Task: public csp::Task {
+	public:
+		Task(Writer *writer): m_Writer(writer) { }
+	protected:
+		virtual void run() { m_Writer->serve(); }
+	private:
+		Writer *m_Writer;
+	};
+
+	Writer(): m_Shutdown(false) {
+		m_Thread.start(new Task(this));
+	}
+
+	virtual ~Writer() {
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Shutdown = true;
+		}
+		m_Wakeup.notify_one();
+		m_Thread.join();
+		s_Instance = 0;
+	}
+
+	void serve() {
+		for (;;) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Wakeup.wait(lock, [this]() { return !m_Queue.empty() || m_Shutdown; });
+				if (m_Queue.empty()) return;
+				job = m_Queue.front();
+				m_Queue.pop_front();
+			}
+			job.first->writeBlock(*job.second);
+			job.second->clear();
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				job.first->busy = false;
+			}
+			m_Done.notify_all();
+		}
+	}
+
+	static Writer *s_Instance;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Wakeup;
+	std::condition_variable m_Done;
+	std::deque<Job> m_Queue;
+	bool m_Shutdown;
+	Thread m_Thread;
+};
+
+DataRecorder::Writer *DataRecorder::Writer::s_Instance = 0;
+
+
 class DataRecorder::DataSource: public Referenced {
 protected:
 	mutable bool m_Dirty;
@@ -104,11 +482,17 @@ DataRecorder::DataRecorder(std::string const &filename, unsigned char level, int
 	FILE *file = (FILE *) fopen(filename.c_str(), "wb");
 	if (!file) throw "unable to open flight data recorder output"; // XXX improve the error handling
 	m_File.reset(new File(file));
-	m_Cache.resize(cache);
+	m_File->writeHeader();
+	for (unsigned i = 0; i < 2; ++i) {
+		m_File->blocks[i].entries.reserve(cache);
+		m_File->blocks[i].times.reserve(MaxBlockSamples);
+		m_File->blocks[i].rows.reserve(MaxBlockSamples);
+	}
+	m_Current = &m_File->blocks[0];
+	m_Writer = Writer::instance();
 	m_Sources.reserve(16);
-	m_Count = 0;
 	m_Level = level;
-	m_Limit = cache;
+	m_Limit = static_cast<unsigned>(cache);
 	m_ElapsedTime = 0.0;
 	m_Enabled = true;
 }
@@ -144,61 +528,65 @@ bool DataRecorder::addSource(Ref<const DataChannelBase> channel) {
 void DataRecorder::timeStamp(float dt) {
 	if (!isEnabled()) return;
 	m_ElapsedTime += dt;
-	_record(TIME, m_ElapsedTime);
+	// the first sample of each block records every channel, so that blocks
+	// can be decoded independently.
+	const bool keyframe = m_Current->times.empty();
+	m_Current->times.push_back(m_ElapsedTime);
+	m_Current->rows.push_back(static_cast<uint32_t>(m_Current->entries.size()));
 	unsigned int idx = 0;
 	unsigned int n = m_Sources.size();
 	for (; idx < n; ++idx) {
 		m_Sources[idx]->refresh();
-		if (m_Sources[idx]->isDirty()) {
+		if (keyframe || m_Sources[idx]->isDirty()) {
 			_record(idx, m_Sources[idx]->getValue());
 		}
 	}
+	if (m_Current->entries.size() >= m_Limit || m_Current->times.size() >= MaxBlockSamples || m_ElapsedTime - m_Current->times.front() >= MaxBlockTime) {
+		_flush();
+	}
 }
 
 void DataRecorder::setEnabled(bool on) {
+	if (isClosed()) return;
 	if (m_Enabled && !on) {
-		_record(PAUSE, 0.0);
+		m_Current->events.push_back(std::make_pair(static_cast<uint32_t>(m_Current->times.size()), static_cast<unsigned char>(PAUSE)));
 		m_Enabled = false;
 	} else
 	if (on && !m_Enabled) {
 		m_Enabled = true;
-		_record(RESUME, 0.0);
+		m_Current->events.push_back(std::make_pair(static_cast<uint32_t>(m_Current->times.size()), static_cast<unsigned char>(RESUME)));
 	}
 }
 
 void DataRecorder::close() {
 	if (m_File.valid()) {
-		m_Enabled = true;
-		_record(END, 0.0); /** end of data */
-		_flush();
-		size_t source_start = ftell(m_File->fptr);
-		int n = m_Sources.size();
-		fwrite(&n, sizeof(n), 1, m_File->fptr);
+		if (!m_Current->empty()) _flush();
+		m_Writer->wait(m_File.get());
+		std::vector<std::string> channels;
+		channels.reserve(m_Sources.size());
 		for (size_t i = 0; i < m_Sources.size(); i++) {
-			char source_name[100];
-			memset(source_name, 0, 100);
-			strncpy(source_name, m_Sources[i]->getName().c_str(), 99);
-			fwrite(source_name, 100, 1, m_File->fptr);
+			channels.push_back(m_Sources[i]->getName());
 		}
-		fwrite(&source_start, sizeof(source_start), 1, m_File->fptr);
+		m_File->writeIndex(channels);
+		CSPLOG(Prio_INFO, Cat_APP) << "Data recorder closed: " << m_File->index.size() << " blocks, " << m_File->offset << " bytes";
 		m_File.reset(0);
+		m_Current = 0;
+		m_Writer = 0;
 	}
 }
 
 void DataRecorder::_record(unsigned int id, float value) {
 	if (m_Enabled && m_File.valid()) {
-		m_Cache[m_Count] = DataEntry(id, value);
-		if (++m_Count >= m_Limit) {
-			_flush();
-		}
+		m_Current->entries.push_back(DataEntry(id, value));
 	}
 }
 
 void DataRecorder::_flush() {
-	fwrite(&(m_Cache[0]), sizeof(DataEntry), m_Count, m_File->fptr);
-	m_Count = 0;
+	m_Current->elapsed = m_ElapsedTime;
+	Block *next = (m_Current == &m_File->blocks[0]) ? &m_File->blocks[1] : &m_File->blocks[0];
+	m_Writer->submit(m_File.get(), m_Current);
+	m_Current = next;
 }
 
 } // namespace csp
 
-
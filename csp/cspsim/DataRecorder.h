@@ -23,11 +23,14 @@
  *
  **/
 
+#include <csp/csplib/util/Ref.h>
 #include <csp/csplib/util/Referenced.h>
 #include <csp/csplib/util/ScopedPointer.h>
 #include <csp/csplib/data/Vector3.h>
 
 #include <cstdio>
+#include <string>
+#include <vector>
 
 namespace csp {
 
@@ -38,6 +41,23 @@ class DataChannelBase;
  * A very preliminary flight data recorder class aimed primarily at flight
  * model testing and validation rather than anything approaching a full acmi
  * recorder.
+ *
+ * Channel values are collected in a cache on the simulation thread and
+ * handed off in blocks to a background writer thread shared by all
+ * recorders, which compresses and writes them to disk.  Two caches are
+ * used per recorder, so the simulation thread only waits for the writer
+ * if a whole block is still being written when the next one fills up.
+ *
+ * The output format (version 2) is a sequence of self-contained blocks,
+ * followed by a channel table and a block index.  Within each block the
+ * sample times and the values of each channel are stored as separate
+ * columns.  Each column holds only the samples at which the channel value
+ * changed, except for the first sample of the block which includes every
+ * channel so that decoding can start at any block.  Sample indices are
+ * delta and varint coded, and float values are xor coded against the
+ * previous value with variable length bit fields for the significant bits.
+ * The block index maps time ranges to file offsets for random seeks.  See
+ * tools/recorder/decode.py for a decoder.
  */
 class DataRecorder: public Referenced {
 public:
@@ -52,8 +72,11 @@ public:
 	 *
 	 * @param filename The output filename for the data recording.
 	 * @param cache The number of values that can be recorded before
-	 *              flushing the data to the output files.  Each cached
-	 *              value currently requires 8 bytes.
+	 *              passing the data to the writer thread.  Each cached
+	 *              value currently requires 8 bytes, and two caches are
+	 *              allocated.  The data is also passed on after a fixed
+	 *              number of samples or interval of time, whichever
+	 *              comes first.
 	 */
 	DataRecorder(std::string const &filename, unsigned char level=LEVEL_VEHICLE, int cache=20000);
 	
@@ -93,9 +116,9 @@ public:
 	inline bool isClosed() const { return !m_File; }
 
 	/**
-	 * Close the recorder, flushing the cache to disk and finalizing the output
-	 * file.  Once closed a DataRecorder instance cannot be reopened and will
-	 * not record any further data.
+	 * Close the recorder, waiting for all cached data to be written and
+	 * finalizing the output file.  Once closed a DataRecorder instance
+	 * cannot be reopened and will not record any further data.
 	 */
 	void close();
 
@@ -103,15 +126,15 @@ protected:
 
 	/**
 	 * Write an output channel entry to the cache.  Does nothing if
-	 * the recorder is disabled or closed, and takes care to flush
-	 * the cache to disk when it is full.
+	 * the recorder is disabled or closed.
 	 */
 	void _record(unsigned int id, float value);
 	
 	/**
-	 * Flush the internal cache to disk.
+	 * Pass the current cache to the writer thread and switch to the
+	 * other cache, waiting for it to be written if necessary.
 	 */
-	inline void _flush();
+	void _flush();
 
 	/**
 	 * Close the recorder output if it is open before destruction.
@@ -120,7 +143,8 @@ protected:
 
 private:
 	struct DataEntry;
-	std::vector<DataEntry> m_Cache;
+	struct Block;
+	class Writer;
 
 	class DataSource;
 	class SingleSource;
@@ -129,14 +153,16 @@ private:
 	std::vector<Ref<DataSource> > m_Sources;
 
 	unsigned char m_Level;
-	int m_Limit, m_Count;
+	unsigned m_Limit;
 	bool m_Enabled;
 	float m_ElapsedTime;
 
 	struct File;
 	ScopedPointer<File> m_File;
+	Block *m_Current;
+	Ref<Writer> m_Writer;
 
-	enum {TIME=250, PAUSE=251, RESUME=252, END=255};
+	enum { PAUSE=1, RESUME=2 };
 };
 
 
@@ -23,16 +23,22 @@
  **/
 
 #include <csp/cspsim/DynamicObject.h>
+#include <csp/cspsim/AggregateModel.h>
 #include <csp/cspsim/Animation.h>
 #include <csp/cspsim/Controller.h>
 #include <csp/cspsim/CSPSim.h>
+#include <csp/cspsim/Config.h>
 #include <csp/cspsim/DataRecorder.h>
+#include <csp/cspsim/FuelManagementSystem.h>
 #include <csp/cspsim/KineticsChannels.h>
+#include <csp/cspsim/NavigationChannels.h>
 #include <csp/cspsim/ObjectModel.h>
 #include <csp/cspsim/PhysicsModel.h>
+#include <csp/cspsim/Profile.h>
 #include <csp/cspsim/SceneModel.h>
 #include <csp/cspsim/Station.h>
 #include <csp/cspsim/SystemsModel.h>
+#include <csp/cspsim/SystemsModelPrototype.h>
 #include <csp/cspsim/TerrainObject.h>
 #include <csp/cspsim/hud/HUD.h>
 #include <csp/cspsim/stores/StoresManagementSystem.h>
@@ -45,6 +51,8 @@
 
 #include <osg/Group>
 
+#include <algorithm>
+
 namespace csp {
 
 CSP_XML_BEGIN(DynamicObject)
@@ -55,6 +63,8 @@ CSP_XML_BEGIN(DynamicObject)
 	CSP_DEF("agent_systems", m_AgentModel, false)
 	CSP_DEF("remote_systems", m_RemoteModel, false)
 	CSP_DEF("reference_center_of_mass_offset", m_ReferenceCenterOfMassOffset, false)
+	CSP_DEF("damage_modifier", m_DamageModifier, false)
+	CSP_DEF("aggregate_fuel_flow", m_AggregateFuelFlow, false)
 CSP_XML_END
 
 DEFINE_INPUT_INTERFACE(DynamicObject)
@@ -83,6 +93,8 @@ DynamicObject::DynamicObject(TypeId type): SimObject(type) {
 
 	m_InternalView = false;
 	m_GroundHint = 0;
+	m_AggregateFuelFlow = 0.0;
+	m_AggregateInterval = g_Config.getFloat("Simulation", "AggregateUpdateInterval", 1.0, true);
 	m_ReferenceMass = 1.0;
 	m_ReferenceInertia = Matrix3::IDENTITY;
 	m_ReferenceCenterOfMassOffset = Vector3::ZERO;
@@ -230,6 +242,7 @@ void DynamicObject::onRemote() {
 
 /** Update the dynamic object. */
 double DynamicObject::onUpdate(double dt) {
+	if (m_AggregateModel.valid()) return updateAggregate(dt);
 	/** Save the objects old cm position */
 	m_PrevPosition = b_Position->value();
 	/**
@@ -252,6 +265,61 @@ double DynamicObject::onUpdate(double dt) {
 	return 0.0;
 }
 
+double DynamicObject::updateAggregate(double dt) {
+	CSP_PROFILE_ZONE("aggregate");
+	m_AggregateModel->update(dt);
+	if (!isAir()) {
+		// keep ground vehicles on the terrain.
+		CSPSim *sim = CSPSim::theSim;
+		TerrainObject *terrain = sim ? sim->getTerrain() : 0;
+		if (terrain) {
+			const Vector3 &position = m_AggregateModel->position();
+			m_AggregateModel->setAltitude(terrain->getGroundElevation(position.x(), position.y(), m_GroundHint));
+		}
+	}
+	b_Attitude->value() = m_AggregateModel->attitude();
+	setGlobalPosition(m_AggregateModel->position());
+	setVelocity(m_AggregateModel->velocity());
+	return m_AggregateInterval;
+}
+
+void DynamicObject::onAggregate() {
+	CSPLOG(Prio_INFO, Cat_OBJECT) << "aggregate @ " << *this;
+	if (m_AggregateModel.valid() || isHuman() || isRemote()) return;
+	Ref<AggregateRoute> route;
+	Bus *bus = getBus();
+	if (bus) {
+		DataChannel<Ref<AggregateRoute> >::CRefT channel = bus->getChannel(bus::Navigation::Route, false);
+		if (channel.valid()) route = channel->value();
+	}
+	m_AggregateModel = new AggregateModel(getGlobalPosition(), getVelocity(), getAttitude(), route, m_AggregateFuelFlow);
+	setAngularVelocity(Vector3::ZERO);
+	// no system updates until onDeaggregate restores the registration.
+	if (m_SystemsModel.valid()) m_SystemsModel->registerUpdate(0);
+}
+
+void DynamicObject::onDeaggregate() {
+	CSPLOG(Prio_INFO, Cat_OBJECT) << "deaggregate @ " << *this;
+	if (!m_AggregateModel) return;
+	Ref<AggregateModel> model = m_AggregateModel;
+	m_AggregateModel = 0;
+	model->saveProgress();
+	setAttitude(model->attitude());
+	setGlobalPosition(model->position());
+	setVelocity(model->velocity());
+	setAngularVelocity(Vector3::ZERO);
+	m_PrevPosition = b_Position->value();
+	Bus *bus = getBus();
+	if (bus && model->fuelUsed() > 0.0) {
+		DataChannel<Ref<FuelManagementSystem> >::CRefT channel = bus->getChannel(FuelManagementSystem::Channel, false);
+		if (channel.valid() && channel->value().valid()) {
+			// the elapsed time sets the limit on the flow rate out of the tanks.
+			channel->value()->drawFuel(model->elapsed(), model->fuelUsed());
+		}
+	}
+	if (m_SystemsModel.valid()) m_SystemsModel->copyRegistration(this);
+}
+
 void DynamicObject::updateDynamics(StoresManagementSystem *sms) {
 	StoresDynamics &dynamics = b_StoresDynamics->value();
 	sms->getDynamics(dynamics);
@@ -270,6 +338,7 @@ void DynamicObject::doControl(double dt) {
 
 void DynamicObject::doPhysics(double dt) {
 	if (m_PhysicsModel.valid()) {
+		CSP_PROFILE_ZONE("physics");
 		m_PhysicsModel->doSimStep(dt);
 	}
 }
@@ -514,12 +583,12 @@ void DynamicObject::selectVehicleCore() {
 	if (!systems && !path.isNone()) {
 		CSPSim *sim = CSPSim::theSim;
 		if (sim) {
-			DataManager &manager = sim->getDataManager();
-			systems = manager.getObject(path);
+			SystemsModelPrototype *prototype = SystemsModelFactory::getInstance().getPrototype(sim->getDataManager(), path);
+			systems = prototype->create();
 			if (systems.valid()) {
 				CSPLOG(Prio_INFO, Cat_OBJECT) << "registering channels and binding systems for " << *this << " " << this;
 				registerChannels(systems->getBus());
-				systems->bindSystems();
+				prototype->bind(systems.get());
 			}
 		}
 	}
@@ -598,5 +667,15 @@ void DynamicObject::toggleMarkers() {
 	m_Model->showDebugMarkers(!m_Model->getDebugMarkersVisible());
 }
 
+void DynamicObject::onHit(DamageModifier::DamageType type, double damage, Vector3 const &point) {
+	if (m_DamageModifier.valid()) damage *= m_DamageModifier->getFactor(type);
+	if (damage <= 0.0) return;
+	CSPLOG(Prio_INFO, Cat_OBJECT) << "Object " << *this << " hit at " << point << ", damage " << damage;
+	Bus *bus = getBus();
+	if (bus) {
+		bus->setStatus(static_cast<float>(std::max(0.0, bus->getStatus() - damage)));
+	}
+}
+
 } // namespace csp
 
@@ -24,6 +24,7 @@
  **/
 
 #include <csp/cspsim/Bus.h>
+#include <csp/cspsim/DamageModifier.h>
 #include <csp/cspsim/input/InputInterface.h>
 #include <csp/cspsim/TerrainObject.h>
 #include <csp/cspsim/stores/StoresDynamics.h>
@@ -41,6 +42,7 @@ namespace osgParticle {
 
 namespace csp {
 
+class AggregateModel;
 class DataRecorder;
 class LocalController;
 class ObjectModel;
@@ -134,8 +136,21 @@ public:
 	virtual Vector3 getNominalViewPointBody() const;
 	virtual void setViewPointBody(Vector3 const &point);
 
-	virtual void onAggregate() { CSPLOG(Prio_INFO, Cat_APP) << "aggregate @ " << *this; }
-	virtual void onDeaggregate() { CSPLOG(Prio_INFO, Cat_APP) << "deaggregate @ " << *this; }
+	/**
+	 * Switch a local agent to a low fidelity AggregateModel.  The systems model
+	 * is disconnected from the update master, and the object moves as a point
+	 * mass along the route published by its agent (bus::Navigation::Route).
+	 */
+	virtual void onAggregate();
+
+	/**
+	 * Copy the state of the AggregateModel back to the full model, charge the
+	 * fuel burned while aggregated, and reconnect the systems model.
+	 */
+	virtual void onDeaggregate();
+
+	/** True if the object is currently simulated by an AggregateModel. */
+	bool hasAggregateModel() const { return m_AggregateModel.valid(); }
 
 	bool isNearGround();
 
@@ -175,6 +190,18 @@ public:
 
 	void toggleMarkers();
 
+	/**
+	 * Apply a weapon hit to the object.  The damage is scaled by the object's
+	 * damage modifier for the specified weapon effect, and then subtracted from
+	 * the status of the systems bus (1 for an undamaged object, 0 for a destroyed
+	 * one).
+	 *
+	 * @param type the weapon effect.
+	 * @param damage the nominal damage, as a fraction of the object's integrity.
+	 * @param point the point of impact in global coordinates.
+	 */
+	virtual void onHit(DamageModifier::DamageType type, double damage, Vector3 const &point);
+
 protected:
 
 	virtual void postCreate();
@@ -226,6 +253,7 @@ protected:
 	Ref<PhysicsModel> m_PhysicsModel;
 	Ref<LocalController> m_LocalController;
 	Ref<RemoteController> m_RemoteController;
+	Ref<AggregateModel> m_AggregateModel;
 
 	void createStationSceneModel();
 	void activateStation(int index);
@@ -247,6 +275,11 @@ private:
 	Path m_HumanModel;
 	Path m_AgentModel;
 	Path m_RemoteModel;
+	Link<DamageModifier> m_DamageModifier;
+	double m_AggregateFuelFlow;
+	double m_AggregateInterval;
+
+	double updateAggregate(double dt);
 };
 
 } // namespace csp
@@ -30,6 +30,7 @@
  **/
 
 #include <csp/cspsim/ControlNode.h>
+#include <csp/cspsim/ControlTape.h>
 #include <csp/cspsim/FlightControlSystem.h>
 #include <csp/cspsim/System.h>
 #include <csp/cspsim/DataRecorder.h>
@@ -43,6 +44,14 @@
 
 namespace csp {
 
+namespace {
+bool g_CompileFlightControlSystems = true;
+}
+
+void setFlightControlSystemCompilation(bool enable) {
+	g_CompileFlightControlSystems = enable;
+}
+
 /** @bug circuits can create circular references.  need to add an "unlink" function to zero all references, and call that for each node when the fcs system is destroyed (otherwise we leak memory). */
 
 //namespace fcsnode {
@@ -65,7 +74,16 @@ class Junction1: public ControlNode {
 public:
 	CSP_DECLARE_ABSTRACT_OBJECT(Junction1)
 	Junction1(): m_Gain(1.0), m_Offset(0.0) {}
+	virtual void getInputs(std::vector<ControlNode*> &inputs) const {
+		inputs.push_back(m_Input.get());
+	}
 protected:
+	bool compileJunction(ControlInstruction &op, ControlInstruction::OpCode code) const {
+		op.op = code;
+		op.gain[0] = m_Gain;
+		op.offset[0] = m_Offset;
+		return true;
+	}
 	void link(MapID &map) {
 		m_Input = map[m_InputID];
 		if (!m_Input) {
@@ -94,7 +112,19 @@ class Junction2: public ControlNode {
 public:
 	CSP_DECLARE_ABSTRACT_OBJECT(Junction2)
 	Junction2(): m_GainA(1.0), m_GainB(1.0), m_OffsetA(0.0), m_OffsetB(0.0) {}
+	virtual void getInputs(std::vector<ControlNode*> &inputs) const {
+		inputs.push_back(m_InputA.get());
+		inputs.push_back(m_InputB.get());
+	}
 protected:
+	bool compileJunction(ControlInstruction &op, ControlInstruction::OpCode code) const {
+		op.op = code;
+		op.gain[0] = m_GainA;
+		op.offset[0] = m_OffsetA;
+		op.gain[1] = m_GainB;
+		op.offset[1] = m_OffsetB;
+		return true;
+	}
 	void link(MapID &map) {
 		m_InputA = map[m_InputIDA];
 		m_InputB = map[m_InputIDB];
@@ -134,7 +164,22 @@ class Junction3: public ControlNode {
 public:
 	CSP_DECLARE_ABSTRACT_OBJECT(Junction3)
 	Junction3(): m_GainA(1.0), m_GainB(1.0), m_GainC(1.0), m_OffsetA(0.0), m_OffsetB(0.0), m_OffsetC(0.0) { }
+	virtual void getInputs(std::vector<ControlNode*> &inputs) const {
+		inputs.push_back(m_InputA.get());
+		inputs.push_back(m_InputB.get());
+		inputs.push_back(m_InputC.get());
+	}
 protected:
+	bool compileJunction(ControlInstruction &op, ControlInstruction::OpCode code) const {
+		op.op = code;
+		op.gain[0] = m_GainA;
+		op.offset[0] = m_OffsetA;
+		op.gain[1] = m_GainB;
+		op.offset[1] = m_OffsetB;
+		op.gain[2] = m_GainC;
+		op.offset[2] = m_OffsetC;
+		return true;
+	}
 	void link(MapID &map) {
 		m_InputA = map[m_InputIDA];
 		m_InputB = map[m_InputIDB];
@@ -196,6 +241,11 @@ protected:
 		//m_Chi *= 0.1592;
 	}
 private:
+	virtual bool compile(ControlInstruction &op) const {
+		op.param[0] = m_Chi;
+		op.memory = m_Input0;
+		return compileJunction(op, ControlInstruction::LAG_FILTER);
+	}
 	virtual void evaluate(Timer const &timer) {
 		double input = getInput(timer);
 		double output = getOutput();
@@ -221,6 +271,13 @@ public:
 	CSP_DECLARE_OBJECT(LeadLagFilter)
 	LeadLagFilter(): m_A(0.0), m_B(0.0), m_C(0.0), m_Input0(0.0) { }
 private:
+	virtual bool compile(ControlInstruction &op) const {
+		op.param[0] = m_A;
+		op.param[1] = m_B;
+		op.param[2] = m_C;
+		op.memory = m_Input0;
+		return compileJunction(op, ControlInstruction::LEAD_LAG_FILTER);
+	}
 	void evaluate(Timer const &timer) {
 		const double input = getInput(timer) * m_C;
 		const double output = getOutput();
@@ -247,6 +304,11 @@ public:
 	CSP_DECLARE_OBJECT(LeadFilter)
 	LeadFilter(): m_A(1.0), m_Input0(0.0) { }
 private:
+	virtual bool compile(ControlInstruction &op) const {
+		op.param[0] = m_A;
+		op.memory = m_Input0;
+		return compileJunction(op, ControlInstruction::LEAD_FILTER);
+	}
 	void evaluate(Timer const &timer) {
 		double input = getInput(timer);
 		double output = getOutput();
@@ -271,6 +333,9 @@ public:
 	CSP_DECLARE_OBJECT(Integrator)
 	Integrator() { }
 private:
+	virtual bool compile(ControlInstruction &op) const {
+		return compileJunction(op, ControlInstruction::INTEGRATOR);
+	}
 	void evaluate(Timer const &timer) {
 		setOutput(getOutput() + timer.dt() * getInput(timer), timer);
 	}
@@ -286,6 +351,9 @@ class Multiply: public Junction2 {
 public:
 	CSP_DECLARE_OBJECT(Multiply)
 private:
+	virtual bool compile(ControlInstruction &op) const {
+		return compileJunction(op, ControlInstruction::MULTIPLY);
+	}
 	virtual void evaluate(Timer const &timer) {
 		setOutput(getInputA(timer) * getInputB(timer), timer);
 	}
@@ -302,6 +370,9 @@ class Divide: public Junction2 {
 public:
 	CSP_DECLARE_OBJECT(Divide)
 private:
+	virtual bool compile(ControlInstruction &op) const {
+		return compileJunction(op, ControlInstruction::DIVIDE);
+	}
 	virtual void evaluate(Timer const &timer) {
 		setOutput(getInputA(timer) / getInputB(timer), timer);
 	}
@@ -317,6 +388,9 @@ class Adder: public Junction2 {
 public:
 	CSP_DECLARE_OBJECT(Adder)
 private:
+	virtual bool compile(ControlInstruction &op) const {
+		return compileJunction(op, ControlInstruction::ADD);
+	}
 	virtual void evaluate(Timer const &timer) {
 		setOutput(getInputA(timer) + getInputB(timer), timer);
 	}
@@ -332,6 +406,9 @@ class Adder3: public Junction3 {
 public:
 	CSP_DECLARE_OBJECT(Adder3)
 private:
+	virtual bool compile(ControlInstruction &op) const {
+		return compileJunction(op, ControlInstruction::ADD3);
+	}
 	virtual void evaluate(Timer const &timer) {
 		setOutput(getInputA(timer) + getInputB(timer) + getInputC(timer), timer);
 	}
@@ -347,6 +424,9 @@ class Scale: public Junction1 {
 public:
 	CSP_DECLARE_OBJECT(Scale)
 private:
+	virtual bool compile(ControlInstruction &op) const {
+		return compileJunction(op, ControlInstruction::SCALE);
+	}
 	virtual void evaluate(Timer const &timer) {
 		setOutput(getInput(timer), timer);
 	}
@@ -368,6 +448,10 @@ public:
 	CSP_DECLARE_OBJECT(Schedule1)
 	Schedule1() {}
 private:
+	virtual bool compile(ControlInstruction &op) const {
+		op.table = &m_Schedule;
+		return compileJunction(op, ControlInstruction::SCHEDULE1);
+	}
 	virtual void evaluate(Timer const &timer) {
 		setOutput(m_Schedule[static_cast<float>(getInput(timer))], timer);
 	}
@@ -390,6 +474,10 @@ public:
 	CSP_DECLARE_OBJECT(Schedule2)
 	Schedule2() {}
 private:
+	virtual bool compile(ControlInstruction &op) const {
+		op.table = &m_Schedule;
+		return compileJunction(op, ControlInstruction::SCHEDULE2);
+	}
 	virtual void evaluate(Timer const &timer) {
 		setOutput(getInputA(timer) * m_Schedule[static_cast<float>(getInputB(timer))], timer);
 	}
@@ -414,6 +502,10 @@ class Switch: public Junction3 {
 public:
 	CSP_DECLARE_OBJECT(Switch)
 private:
+	virtual bool compile(ControlInstruction &op) const {
+		op.param[0] = m_Compare;
+		return compileJunction(op, ControlInstruction::SWITCH);
+	}
 	virtual void evaluate(Timer const &timer) {
 		if (getInputC(timer) < m_Compare) {
 			setOutput(getInputA(timer), timer);
@@ -446,6 +538,10 @@ public:
 		m_InputC = bus->getChannel(m_SwitchChannel);
 	}
 private:
+	virtual bool compile(ControlInstruction &op) const {
+		op.flag = m_InputC.get();
+		return compileJunction(op, ControlInstruction::BOOLEAN_SWITCH);
+	}
 	virtual void evaluate(Timer const &timer) {
 		setOutput(m_InputC->value() ? getInputA(timer) : getInputB(timer), timer);
 	}
@@ -470,6 +566,10 @@ protected:
 	}
 
 private:
+	virtual bool compile(ControlInstruction &op) const {
+		op.op = ControlInstruction::CONSTANT;
+		return true;
+	}
 	virtual void evaluate(Timer const &) { }
 };
 
@@ -498,6 +598,7 @@ public:
 protected:
 	virtual double getChannelValue() const = 0;
 	virtual void setChannel(DataChannelBase::CRefT &channel)=0;
+	double getScale() const { return m_Scale; }
 private:
 	virtual void evaluate(Timer const &timer) {
 		setOutput(getChannelValue() * m_Scale, timer);
@@ -517,6 +618,13 @@ class InputVectorXChannel: public InputChannel {
 	DataChannel<Vector3>::CRefT m_Channel;
 public:
 	CSP_DECLARE_OBJECT(InputVectorXChannel)
+private:
+	virtual bool compile(ControlInstruction &op) const {
+		op.op = ControlInstruction::INPUT_VECTOR_X;
+		op.vector = m_Channel.get();
+		op.param[0] = getScale();
+		return true;
+	}
 protected:
 	virtual double getChannelValue() const { return m_Channel->value().x(); }
 	virtual void setChannel(DataChannelBase::CRefT &channel) { m_Channel = channel; }
@@ -533,6 +641,13 @@ class InputVectorYChannel: public InputChannel {
 	DataChannel<Vector3>::CRefT m_Channel;
 public:
 	CSP_DECLARE_OBJECT(InputVectorYChannel)
+private:
+	virtual bool compile(ControlInstruction &op) const {
+		op.op = ControlInstruction::INPUT_VECTOR_Y;
+		op.vector = m_Channel.get();
+		op.param[0] = getScale();
+		return true;
+	}
 protected:
 	virtual double getChannelValue() const { return m_Channel->value().y(); }
 	virtual void setChannel(DataChannelBase::CRefT &channel) { m_Channel = channel; }
@@ -549,6 +664,13 @@ class InputVectorZChannel: public InputChannel {
 	DataChannel<Vector3>::CRefT m_Channel;
 public:
 	CSP_DECLARE_OBJECT(InputVectorZChannel)
+private:
+	virtual bool compile(ControlInstruction &op) const {
+		op.op = ControlInstruction::INPUT_VECTOR_Z;
+		op.vector = m_Channel.get();
+		op.param[0] = getScale();
+		return true;
+	}
 protected:
 	virtual double getChannelValue() const { return m_Channel->value().z(); }
 	virtual void setChannel(DataChannelBase::CRefT &channel) { m_Channel = channel; }
@@ -564,6 +686,13 @@ class InputScalarChannel: public InputChannel {
 	DataChannel<double>::CRefT m_Channel;
 public:
 	CSP_DECLARE_OBJECT(InputScalarChannel)
+private:
+	virtual bool compile(ControlInstruction &op) const {
+		op.op = ControlInstruction::INPUT_SCALAR;
+		op.scalar = m_Channel.get();
+		op.param[0] = getScale();
+		return true;
+	}
 protected:
 	virtual double getChannelValue() const { return m_Channel->value(); }
 	virtual void setChannel(DataChannelBase::CRefT &channel) { m_Channel = channel; }
@@ -595,6 +724,10 @@ public:
 		}
 	}
 private:
+	virtual bool compile(ControlInstruction &op) const {
+		op.output = m_Channel.get();
+		return compileJunction(op, ControlInstruction::OUTPUT);
+	}
 	virtual void evaluate(Timer const &timer) {
 		setOutput(getInput(timer), timer);
 		m_Channel->value() = getOutput();
@@ -613,6 +746,9 @@ class Greater: public Junction2 {
 public:
 	CSP_DECLARE_OBJECT(Greater)
 private:
+	virtual bool compile(ControlInstruction &op) const {
+		return compileJunction(op, ControlInstruction::GREATER);
+	}
 	virtual void evaluate(Timer const &timer) {
 		setOutput(std::max(getInputA(timer),getInputB(timer)), timer);
 	}
@@ -629,6 +765,9 @@ class Lesser: public Junction2 {
 public:
 	CSP_DECLARE_OBJECT(Lesser)
 private:
+	virtual bool compile(ControlInstruction &op) const {
+		return compileJunction(op, ControlInstruction::LESSER);
+	}
 	virtual void evaluate(Timer const &timer) {
 		setOutput(std::min(getInputA(timer),getInputB(timer)), timer);
 	}
@@ -644,6 +783,10 @@ CSP_XML_END
  * input nodes that read values from the vehicle system bus, and output nodes
  * that write values to the bus.  The output values are generated by
  * periodically re-evaluating the control node network.
+ *
+ * On the first update the network is compiled into a ControlTape, which
+ * evaluates all nodes in a single pass without virtual dispatch.  See
+ * setFlightControlSystemCompilation to use recursive evaluation instead.
  */
 class FlightControlSystem: public System {
 	typedef Link<ControlNode>::vector ControlNodeList;
@@ -651,11 +794,13 @@ class FlightControlSystem: public System {
 	ControlNodeList m_ControlNodes;
 	OutputList m_Outputs;
 	ControlNode::Timer m_Timer;
+	ControlTape m_Tape;
+	bool m_Compile;
 
 public:
 	CSP_DECLARE_OBJECT(FlightControlSystem)
 
-	FlightControlSystem(): System() {}
+	FlightControlSystem(): System(), m_Compile(g_CompileFlightControlSystems) {}
 
 protected:
 
@@ -724,7 +869,13 @@ protected:
 	 */
 	double onUpdate(double dt) {
 		m_Timer.set(dt);
-		std::for_each(m_Outputs.begin(), m_Outputs.end(), ControlNodeUpdateOp(m_Timer));
+		if (m_Compile) {
+			// compile lazily, once all the nodes have been bound to the bus.
+			if (!m_Tape.isCompiled()) m_Tape.compile(m_Outputs);
+			m_Tape.run(m_Timer);
+		} else {
+			std::for_each(m_Outputs.begin(), m_Outputs.end(), ControlNodeUpdateOp(m_Timer));
+		}
 		return 0.0;  // request immediate callback
 	}
 
@@ -2,4 +2,11 @@
 
 namespace csp {
 	void registerFlightControlSystemObjects();
+
+	/** Enable or disable compiling flight control networks into a flat
+	 *  ControlTape (enabled by default).  When disabled, the control nodes
+	 *  are evaluated recursively.  Only affects systems created afterwards;
+	 *  intended for testing and benchmarking.
+	 */
+	void setFlightControlSystemCompilation(bool enable);
 } // namespace csp
@@ -39,6 +39,7 @@
 
 #include <csp/csplib/util/FileUtility.h>
 #include <csp/csplib/util/Log.h>
+#include <csp/csplib/util/Profiler.h>
 
 #include <csp/cspwf/WindowManager.h>
 
@@ -96,7 +97,8 @@ GameScreen::GameScreen(int screenWidth, int screenHeight):
 	m_screenHeight(screenHeight),
 	m_ActiveObject(0),
 	m_CameraAgent(new CameraAgent(ViewFactory())),
-	m_CameraCommands(new CameraCommands)
+	m_CameraCommands(new CameraCommands),
+	m_ProfilerEnabled(false)
 {
 	m_OnPlayerJoin.init(this, &GameScreen::onPlayerJoin);
 	m_OnPlayerQuit.init(this, &GameScreen::onPlayerQuit);
@@ -118,6 +120,7 @@ void GameScreen::onInit() {
 	// Set general stats and object statistics to not visisble as default.
 	m_ScreenInfoManager->setStatus("GENERAL STATS", false);
 	m_ScreenInfoManager->setStatus("OBJECT STATS", false);
+	m_ScreenInfoManager->setStatus("PROFILER", false);
 
 	CSPLOG(Prio_DEBUG, Cat_APP) << "attach ScreenInfoManager to scene";
 	osg::Group *info = ScreenInfoNode::getGroup(CSPSim::theSim->getSceneData());
@@ -272,6 +275,28 @@ void GameScreen::on_Stats() {
 	m_ScreenInfoManager->setStatus("OBJECT STATS", !m_ScreenInfoManager->getStatus("OBJECT STATS"));
 }
 
+void GameScreen::on_Profiler() {
+	const bool visible = !m_ScreenInfoManager->getStatus("PROFILER");
+	if (visible) {
+		m_ProfilerEnabled = Profiler::isEnabled();
+		Profiler::getInstance().setEnabled(true);
+	} else {
+		Profiler::getInstance().setEnabled(m_ProfilerEnabled);
+	}
+	m_ScreenInfoManager->setStatus("PROFILER", visible);
+}
+
+void GameScreen::on_ProfilerTrace() {
+	static int n = 0;
+	char fn[128];
+	sprintf(fn, "profile-%03d.json", n++);
+	if (Profiler::getInstance().writeTrace(fn)) {
+		m_ScreenInfoManager->addMessage(std::string("Profiler trace saved to ") + fn);
+	} else {
+		CSPLOG(Prio_ERROR, Cat_APP) << "Unable to write profiler trace " << fn;
+	}
+}
+
 void GameScreen::on_ChangeVehicle() {
 	LocalBattlefield *battlefield = CSPSim::theSim->getBattlefield();
 	if (battlefield) {
@@ -65,6 +65,8 @@ public:
 		BIND_ACTION("TOGGLE_RECORDER", on_ToggleRecorder);
 		BIND_ACTION("TOGGLE_WIREFRAME", on_ToggleWireframe);
 		BIND_ACTION("STATS", on_Stats);
+		BIND_ACTION("PROFILER", on_Profiler);
+		BIND_ACTION("PROFILER_TRACE", on_ProfilerTrace);
 		BIND_ACTION("CHANGE_VEHICLE", on_ChangeVehicle);
 		BIND_ACTION("CAMERA_VIEW_0", on_View0);
 		BIND_ACTION("CAMERA_VIEW_1", on_View1);
@@ -117,6 +119,8 @@ public:
 	void on_ToggleRecorder();
 	void on_ToggleWireframe();
 	void on_Stats();
+	void on_Profiler();
+	void on_ProfilerTrace();
 	void on_ChangeVehicle();
 	void on_LookForward();
 	void on_LookBackward();
@@ -180,6 +184,9 @@ private:
 	Ref<DataRecorder> m_DataRecorder;
 	void setRecorder(bool on);
 
+	// profiler state to restore when the profiler overlay is hidden
+	bool m_ProfilerEnabled;
+
 	// camera management by a command
 	ScopedPointer<CameraAgent> m_CameraAgent;
 	ScopedPointer<CameraCommands> m_CameraCommands;
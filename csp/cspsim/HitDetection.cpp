@@ -0,0 +1,312 @@
+// Combat Simulator Project
+// Copyright (C) 2002 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/**
+ * @file HitDetection.cpp
+ *
+ **/
+
+#include <csp/cspsim/HitDetection.h>
+#include <csp/cspsim/Config.h>
+#include <csp/cspsim/DynamicObject.h>
+#include <csp/cspsim/ObjectModel.h>
+
+#include <csp/csplib/util/Log.h>
+#include <csp/csplib/util/Profiler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace csp {
+
+namespace {
+
+/** Cell coordinates are packed into 21 bits each. */
+const uint64_t CellMask = (1 << 21) - 1;
+
+inline int cellCoordinate(double x, double inverse_cell_size) {
+	return static_cast<int>(std::floor(x * inverse_cell_size));
+}
+
+/** Squared distance from the origin to the segment ab. */
+inline double distance2(Vector3 const &a, Vector3 const &b) {
+	const Vector3 d = b - a;
+	const double length2 = d.length2();
+	double t = (length2 > 0.0) ? -dot(a, d) / length2 : 0.0;
+	t = std::max(0.0, std::min(1.0, t));
+	return (a + d * t).length2();
+}
+
+} // namespace
+
+
+HitDetection::Query::Query():
+	radius(0.0),
+	owner(0),
+	type(DamageModifier::SMALL_ARMS),
+	damage(0.0) {
+}
+
+HitDetection::HitDetection() {
+	m_CellSize = std::max(10.0, g_Config.getFloat("Simulation", "HitDetectionCellSize", 250.0, true));
+	m_InverseCellSize = 1.0 / m_CellSize;
+	m_MaxCells = 64;
+	int threads = g_Config.getInt("Simulation", "HitDetectionThreads", 0, true);
+	if (threads <= 0) {
+		threads = std::min(4, std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+	}
+	m_Threads = threads;
+	m_MinQueriesPerThread = 1024;
+}
+
+HitDetection::~HitDetection() {
+}
+
+bool HitDetection::isEnabled() {
+	return g_Config.getBool("Simulation", "HitDetection", true, true);
+}
+
+void HitDetection::clear() {
+	m_Queries.clear();
+	m_Targets.clear();
+	m_Cells.clear();
+	m_Hits.clear();
+}
+
+unsigned HitDetection::addQuery(Query const &query) {
+	m_Queries.push_back(query);
+	return m_Queries.size() - 1;
+}
+
+void HitDetection::addTarget(Ref<DynamicObject> const &object) {
+	Ref<ObjectModel> model = object->getModel();
+	if (!model.valid()) return;
+	Vector3 box_min = model->getBoundingBoxMin();
+	Vector3 box_max = model->getBoundingBoxMax();
+	if (box_min == box_max) {
+		// no geometry; fall back to a cube enclosing the bounding sphere.
+		const double r = model->getBoundingSphereRadius();
+		box_min = Vector3(-r, -r, -r);
+		box_max = Vector3(r, r, r);
+	}
+	addTarget(object, object->id(), object->getGlobalPosition(), object->getVelocity(), object->getAttitude(), box_min, box_max);
+}
+
+void HitDetection::addTarget(Ref<DynamicObject> const &object, SimObject::ObjectId id, Vector3 const &position, Vector3 const &velocity, Quat const &attitude, Vector3 const &box_min, Vector3 const &box_max) {
+	Target target;
+	target.object = object;
+	target.id = id;
+	target.position = position;
+	target.velocity = velocity;
+	target.attitude = attitude;
+	target.box_min = box_min;
+	target.box_max = box_max;
+	// radius of the sphere about the model origin enclosing the box.
+	const Vector3 &a = target.box_min, &b = target.box_max;
+	const double x = std::max(std::abs(a.x()), std::abs(b.x()));
+	const double y = std::max(std::abs(a.y()), std::abs(b.y()));
+	const double z = std::max(std::abs(a.z()), std::abs(b.z()));
+	target.radius = std::sqrt(x * x + y * y + z * z);
+	m_Targets.push_back(target);
+}
+
+uint64_t HitDetection::key(int x, int y, int z) const {
+	return ((static_cast<uint64_t>(x) & CellMask) << 42) | ((static_cast<uint64_t>(y) & CellMask) << 21) | (static_cast<uint64_t>(z) & CellMask);
+}
+
+void HitDetection::buildGrid() {
+	m_Cells.clear();
+	Cell cell;
+	for (unsigned i = 0; i < m_Targets.size(); ++i) {
+		Target const &target = m_Targets[i];
+		const Vector3 start = target.position - target.displacement;
+		const Vector3 &end = target.position;
+		const int x0 = cellCoordinate(std::min(start.x(), end.x()) - target.radius, m_InverseCellSize);
+		const int y0 = cellCoordinate(std::min(start.y(), end.y()) - target.radius, m_InverseCellSize);
+		const int z0 = cellCoordinate(std::min(start.z(), end.z()) - target.radius, m_InverseCellSize);
+		const int x1 = cellCoordinate(std::max(start.x(), end.x()) + target.radius, m_InverseCellSize);
+		const int y1 = cellCoordinate(std::max(start.y(), end.y()) + target.radius, m_InverseCellSize);
+		const int z1 = cellCoordinate(std::max(start.z(), end.z()) + target.radius, m_InverseCellSize);
+		cell.target = i;
+		for (int x = x0; x <= x1; ++x) {
+			for (int y = y0; y <= y1; ++y) {
+				for (int z = z0; z <= z1; ++z) {
+					cell.key = key(x, y, z);
+					m_Cells.push_back(cell);
+				}
+			}
+		}
+	}
+	std::sort(m_Cells.begin(), m_Cells.end());
+}
+
+bool HitDetection::testTarget(Query const &query, Target const &target, double &fraction) const {
+	// the path of the projectile relative to the target.
+	const Vector3 a = query.start - target.position + target.displacement;
+	const Vector3 b = query.end - target.position;
+
+	const double reach = target.radius + query.radius;
+	if (distance2(a, b) > reach * reach) return false;
+
+	// slab test against the bounding box (expanded by the proximity radius) in model coordinates.
+	const Vector3 ma = target.attitude.invrotate(a);
+	const Vector3 mb = target.attitude.invrotate(b);
+	const double start[3] = { ma.x(), ma.y(), ma.z() };
+	const double delta[3] = { mb.x() - ma.x(), mb.y() - ma.y(), mb.z() - ma.z() };
+	const double lower[3] = { target.box_min.x() - query.radius, target.box_min.y() - query.radius, target.box_min.z() - query.radius };
+	const double upper[3] = { target.box_max.x() + query.radius, target.box_max.y() + query.radius, target.box_max.z() + query.radius };
+	double t0 = 0.0;
+	double t1 = 1.0;
+	for (int k = 0; k < 3; ++k) {
+		if (std::abs(delta[k]) < 1e-9) {
+			if (start[k] < lower[k] || start[k] > upper[k]) return false;
+			continue;
+		}
+		const double inverse = 1.0 / delta[k];
+		double ta = (lower[k] - start[k]) * inverse;
+		double tb = (upper[k] - start[k]) * inverse;
+		if (ta > tb) std::swap(ta, tb);
+		t0 = std::max(t0, ta);
+		t1 = std::min(t1, tb);
+		if (t0 > t1) return false;
+	}
+	fraction = t0;
+	return true;
+}
+
+void HitDetection::testRange(unsigned begin, unsigned end, std::vector<Contact> &contacts) const {
+	CSP_PROFILE_ZONE("HitDetection::testRange");
+	const unsigned n_targets = m_Targets.size();
+	// the query that last tested each target, to avoid repeating tests for
+	// targets that span several cells.
+	std::vector<unsigned> stamp(n_targets, std::numeric_limits<unsigned>::max());
+	Cell probe;
+	probe.target = 0;
+
+	for (unsigned q = begin; q < end; ++q) {
+		Query const &query = m_Queries[q];
+		// rounds without damage (such as released stores in the flyout) are
+		// inert; they detonate, if at all, on impact or after promotion.
+		if (query.damage <= 0.0) continue;
+		const double r = query.radius;
+		const int x0 = cellCoordinate(std::min(query.start.x(), query.end.x()) - r, m_InverseCellSize);
+		const int y0 = cellCoordinate(std::min(query.start.y(), query.end.y()) - r, m_InverseCellSize);
+		const int z0 = cellCoordinate(std::min(query.start.z(), query.end.z()) - r, m_InverseCellSize);
+		const int x1 = cellCoordinate(std::max(query.start.x(), query.end.x()) + r, m_InverseCellSize);
+		const int y1 = cellCoordinate(std::max(query.start.y(), query.end.y()) + r, m_InverseCellSize);
+		const int z1 = cellCoordinate(std::max(query.start.z(), query.end.z()) + r, m_InverseCellSize);
+		const double n_cells = (x1 - x0 + 1.0) * (y1 - y0 + 1.0) * (z1 - z0 + 1.0);
+
+		double best = 2.0;
+		unsigned best_target = 0;
+		double fraction;
+		if (n_cells > m_MaxCells) {
+			// very long segments (or a very small cell size); test every target.
+			for (unsigned t = 0; t < n_targets; ++t) {
+				Target const &target = m_Targets[t];
+				if (target.id == query.owner) continue;
+				if (testTarget(query, target, fraction) && fraction < best) {
+					best = fraction;
+					best_target = t;
+				}
+			}
+		} else {
+			for (int x = x0; x <= x1; ++x) {
+				for (int y = y0; y <= y1; ++y) {
+					for (int z = z0; z <= z1; ++z) {
+						probe.key = key(x, y, z);
+						std::vector<Cell>::const_iterator iter = std::lower_bound(m_Cells.begin(), m_Cells.end(), probe);
+						for (; iter != m_Cells.end() && iter->key == probe.key; ++iter) {
+							const unsigned t = iter->target;
+							if (stamp[t] == q) continue;
+							stamp[t] = q;
+							Target const &target = m_Targets[t];
+							if (target.id == query.owner) continue;
+							if (testTarget(query, target, fraction) && fraction < best) {
+								best = fraction;
+								best_target = t;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		if (best <= 1.0) {
+			Contact contact;
+			contact.query = q;
+			contact.target = best_target;
+			contact.fraction = best;
+			contacts.push_back(contact);
+		}
+	}
+}
+
+void HitDetection::run(double dt) {
+	m_Hits.clear();
+	if (m_Queries.empty() || m_Targets.empty()) return;
+	CSP_PROFILE_ZONE("HitDetection::run");
+
+	for (unsigned i = 0; i < m_Targets.size(); ++i) {
+		m_Targets[i].displacement = m_Targets[i].velocity * dt;
+	}
+	buildGrid();
+
+	const unsigned n = m_Queries.size();
+	const unsigned threads = std::max(1u, std::min(m_Threads, n / m_MinQueriesPerThread));
+	// each thread tests a contiguous range of queries, so concatenating the
+	// results keeps the hits ordered by query.
+	std::vector<std::vector<Contact> > contacts(threads);
+	if (threads == 1) {
+		testRange(0, n, contacts[0]);
+	} else {
+		if (!m_Pool.valid()) m_Pool.reset(new WorkerPool(m_Threads - 1));
+		const unsigned chunk = (n + threads - 1) / threads;
+		m_Pool->run(threads, [this, n, chunk, &contacts](unsigned i) {
+			testRange(std::min(n, i * chunk), std::min(n, (i + 1) * chunk), contacts[i]);
+		});
+	}
+	for (unsigned i = 0; i < threads; ++i) {
+		for (unsigned j = 0; j < contacts[i].size(); ++j) {
+			Contact const &contact = contacts[i][j];
+			Query const &query = m_Queries[contact.query];
+			Hit hit;
+			hit.query = contact.query;
+			hit.target = m_Targets[contact.target].object;
+			hit.fraction = contact.fraction;
+			hit.point = query.start + (query.end - query.start) * contact.fraction;
+			m_Hits.push_back(hit);
+		}
+	}
+	CSP_PROFILE_COUNTER("hit queries", n);
+	CSP_PROFILE_COUNTER("hits", m_Hits.size());
+}
+
+void HitDetection::report() {
+	for (unsigned i = 0; i < m_Hits.size(); ++i) {
+		Hit const &hit = m_Hits[i];
+		if (!hit.target.valid()) continue;
+		Query const &query = m_Queries[hit.query];
+		hit.target->onHit(query.type, query.damage, hit.point);
+	}
+}
+
+} // namespace csp
@@ -0,0 +1,184 @@
+#pragma once
+// Combat Simulator Project
+// Copyright (C) 2002 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/**
+ * @file HitDetection.h
+ *
+ **/
+
+#include <csp/cspsim/DamageModifier.h>
+#include <csp/cspsim/battlefield/SimObject.h>
+
+#include <csp/csplib/data/Quat.h>
+#include <csp/csplib/data/Vector3.h>
+#include <csp/csplib/thread/WorkerPool.h>
+#include <csp/csplib/util/Properties.h>
+#include <csp/csplib/util/Ref.h>
+#include <csp/csplib/util/ScopedPointer.h>
+
+#include <stdint.h>
+#include <vector>
+
+namespace csp {
+
+class DynamicObject;
+
+
+/**
+ * Batched hit detection between projectile paths and dynamic objects.
+ *
+ * Each frame the caller adds one query per projectile (the segment swept
+ * by the projectile during the frame, and a proximity radius) and one
+ * target per object that can be hit, then calls run() and report().
+ *
+ * The broad phase sorts the bounding spheres of the targets (swept over
+ * the frame) into a uniform grid of Simulation.HitDetectionCellSize
+ * meters, rebuilt on every run.  Each query visits only the cells
+ * overlapped by its segment, so the cost grows with the number of
+ * projectiles plus the number of targets rather than their product.
+ * The narrow phase tests the segment, in the frame of each candidate
+ * target, against the bounding box of the target's ObjectModel.  Large
+ * batches of queries are divided among a pool of worker threads; the
+ * first hit along each segment is kept.  Queries never hit their owner,
+ * and queries without damage are not tested at all.
+ *
+ * Hits are applied to the targets by report(), which must be called from
+ * the simulation thread.  The damage of each hit is scaled by the
+ * DamageModifier of the target (see DynamicObject::onHit).
+ */
+class HitDetection: public NonCopyable {
+public:
+	/** A projectile path to test. */
+	struct Query {
+		Query();
+		Vector3 start;           // position at the start of the frame (global coordinates).
+		Vector3 end;             // position at the end of the frame (global coordinates).
+		double radius;           // proximity radius (m); zero for a point.
+		SimObject::ObjectId owner;  // the object that fired the projectile, which is never hit.
+		DamageModifier::DamageType type;
+		double damage;           // nominal damage (see DynamicObject::onHit); queries without damage never hit.
+	};
+
+	/** The first object hit by a query. */
+	struct Hit {
+		unsigned query;          // index of the query.
+		Ref<DynamicObject> target;
+		Vector3 point;           // point of impact (global coordinates).
+		double fraction;         // position of the impact along the segment, from 0 to 1.
+	};
+
+	HitDetection();
+	~HitDetection();
+
+	/** Returns true if hit detection is enabled (Simulation.HitDetection).
+	 */
+	static bool isEnabled();
+
+	/** Remove all queries, targets, and hits.
+	 */
+	void clear();
+
+	/** Add a query.  Returns the index of the query.
+	 */
+	unsigned addQuery(Query const &query);
+
+	/** Add an object that can be hit.  Objects without an ObjectModel are
+	 *  ignored.
+	 */
+	void addTarget(Ref<DynamicObject> const &object);
+
+	/** Add a target with an explicit state and bounding box (in model
+	 *  coordinates).  The object may be null, in which case hits on the
+	 *  target are found but not applied by report().
+	 */
+	void addTarget(Ref<DynamicObject> const &object, SimObject::ObjectId id, Vector3 const &position, Vector3 const &velocity, Quat const &attitude, Vector3 const &box_min, Vector3 const &box_max);
+
+	/** Get a query by index. */
+	Query const &getQuery(unsigned i) const { return m_Queries[i]; }
+
+	/** The number of queries. */
+	unsigned numQueries() const { return m_Queries.size(); }
+
+	/** The number of targets. */
+	unsigned numTargets() const { return m_Targets.size(); }
+
+	/** Test all queries against all targets.
+	 *
+	 *  @param dt the duration of the frame (s), used to account for the
+	 *    motion of the targets.
+	 */
+	void run(double dt);
+
+	/** The hits found by the last run, ordered by query index.  At most one
+	 *  hit is reported per query.
+	 */
+	std::vector<Hit> const &getHits() const { return m_Hits; }
+
+	/** Apply the damage of each hit to the target.
+	 */
+	void report();
+
+private:
+	struct Target {
+		Ref<DynamicObject> object;
+		SimObject::ObjectId id;
+		Vector3 position;       // model origin at the end of the frame.
+		Vector3 velocity;
+		Vector3 displacement;   // motion during the frame.
+		Quat attitude;
+		Vector3 box_min;        // bounding box in model coordinates.
+		Vector3 box_max;
+		double radius;          // bounding sphere radius about the model origin.
+	};
+
+	struct Cell {
+		uint64_t key;
+		unsigned target;
+		bool operator<(Cell const &other) const { return key < other.key; }
+	};
+
+	/** A hit found by a worker thread.  Workers don't touch reference counts,
+	 *  so the target is identified by index until the results are merged.
+	 */
+	struct Contact {
+		unsigned query;
+		unsigned target;
+		double fraction;
+	};
+
+	void buildGrid();
+	void testRange(unsigned begin, unsigned end, std::vector<Contact> &contacts) const;
+	bool testTarget(Query const &query, Target const &target, double &fraction) const;
+	uint64_t key(int x, int y, int z) const;
+
+	ScopedPointer<WorkerPool> m_Pool;  // created on the first run that needs more than one thread.
+	double m_CellSize;
+	double m_InverseCellSize;
+	unsigned m_MaxCells;
+	unsigned m_Threads;
+	unsigned m_MinQueriesPerThread;
+
+	std::vector<Query> m_Queries;
+	std::vector<Target> m_Targets;
+	std::vector<Cell> m_Cells;
+	std::vector<Hit> m_Hits;
+};
+
+} // namespace csp
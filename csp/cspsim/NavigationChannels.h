@@ -29,6 +29,7 @@ namespace bus {
 
 struct Navigation {
 	static const char *ActiveSteerpoint;
+	static const char *Route;
 };
 
 } // namespace bus
@@ -32,6 +32,7 @@
 #include <csp/csplib/util/FileUtility.h>
 #include <csp/csplib/util/HashUtility.h>
 #include <csp/csplib/util/Log.h>
+#include <csp/csplib/util/Math.h>
 #include <csp/csplib/util/osg.h>
 #include <csp/csplib/util/StringTools.h>
 #include <csp/csplib/util/Timing.h>
@@ -47,6 +48,10 @@
 #include <osgUtil/SmoothingVisitor>
 #include <osgUtil/GLObjectsVisitor>
 #include <osgUtil/Optimizer>
+#include <osgUtil/Simplifier>
+#include <osg/AlphaFunc>
+#include <osg/Camera>
+#include <osg/ComputeBoundsVisitor>
 #include <osg/CullFace>
 #include <osg/NodeVisitor>
 #include <osg/Geometry>
@@ -56,10 +61,13 @@
 #include <osg/PolygonOffset>
 #include <osg/Switch>
 #include <osg/Group>
+#include <osg/LOD>
 #include <osg/MatrixTransform>
 #include <osg/PositionAttitudeTransform>
+#include <osg/Texture2D>
 
 #include <algorithm>
+#include <cmath>
 #include <vector>
 #include <utility>
 
@@ -92,6 +100,10 @@ CSP_XML_BEGIN(ObjectModel)
 	CSP_DEF("lighting", m_Lighting, false)
 	CSP_DEF("animations", m_Animations, false)
 	CSP_DEF("stations", m_Stations, false)
+	CSP_DEF("lod_ratios", m_LodRatios, false)
+	CSP_DEF("lod_screen_sizes", m_LodScreenSizes, false)
+	CSP_DEF("impostor_screen_size", m_ImpostorScreenSize, false)
+	CSP_DEF("impostor_resolution", m_ImpostorResolution, false)
 CSP_XML_END
 
 
@@ -328,6 +340,47 @@ public:
 };
 
 
+/**
+ * Prepare a copy of a model prototype for use as a static lower detail mesh.
+ * Removes cockpit interiors and animation bindings, which are only needed
+ * by the full detail model.
+ */
+class LodStripVisitor: public osg::NodeVisitor {
+public:
+	LodStripVisitor(): NodeVisitor(TRAVERSE_ALL_CHILDREN) { }
+
+	virtual void apply(osg::Group &node) {
+		if (dynamic_cast<AnimationBinding const*>(node.getUserData())) {
+			node.setUserData(0);
+			node.setDataVariance(osg::Object::STATIC);
+		}
+		for (unsigned i = node.getNumChildren(); i > 0; --i) {
+			if (node.getChild(i - 1)->getName() == "__PITS__") node.removeChild(i - 1);
+		}
+		traverse(node);
+	}
+};
+
+
+/**
+ * Cull callback for impostor cameras.  Traverses the camera (and hence
+ * renders the impostor texture) only once.  Impostor cameras are shared by
+ * all copies of a model, so the texture is rendered the first time any copy
+ * of the model is drawn as an impostor.
+ */
+class RenderOnceCallback: public osg::NodeCallback {
+	bool m_Done;
+public:
+	RenderOnceCallback(): m_Done(false) { }
+	virtual void operator()(osg::Node *node, osg::NodeVisitor *nv) {
+		if (!m_Done) {
+			m_Done = true;
+			traverse(node, nv);
+		}
+	}
+};
+
+
 std::string g_ModelPath = "";
 
 ObjectModel::ObjectModel(): Object() {
@@ -348,6 +401,9 @@ ObjectModel::ObjectModel(): Object() {
 	m_CullFace = -1;
 	m_Lighting = true;
 	m_Effect = "None";
+	m_ImpostorScreenSize = 0.0f;
+	m_ImpostorResolution = 128;
+	m_ImpostorThreshold = 0.0f;
 }
 
 ObjectModel::~ObjectModel() {
@@ -505,6 +561,17 @@ void ObjectModel::loadModel() {
 	osg::BoundingSphere s = m_Model->getBound();
 	m_BoundingSphereRadius = s.radius();
 
+	// model space bounding box, used as the narrow phase volume for hit detection.
+	osg::ComputeBoundsVisitor bounds;
+	m_Model->accept(bounds);
+	osg::BoundingBox const &box = bounds.getBoundingBox();
+	if (box.valid()) {
+		m_BoundingBoxMin = Vector3(box.xMin(), box.yMin(), box.zMin());
+		m_BoundingBoxMax = Vector3(box.xMax(), box.yMax(), box.zMax());
+	} else {
+		m_BoundingBoxMin = m_BoundingBoxMax = Vector3::ZERO;
+	}
+
 	/** 
 	 * Set the default shader to visibly mark nodes that don't have a
 	 * shader specified.
@@ -564,6 +631,8 @@ void ObjectModel::loadModel() {
 	 *	CSPLOG(Prio_DEBUG, Cat_OBJECT) << "LoadModel: Optimizer done";
 	 *	@endcode
 	 */
+	generateLodLevels();
+
 	if (!m_GroundShadowPath.asString().empty()) {
 		CSPLOG(Prio_DEBUG, Cat_OBJECT) << "Loading ground shadow " << m_GroundShadowPath.asString();
 		m_GroundShadow = osgDB::readNodeFile(m_GroundShadowPath.asString());
@@ -631,6 +700,184 @@ void ObjectModel::processModel() {
 		"shader " << shader_time << " us)";
 }
 
+void ObjectModel::generateLodLevels() {
+	m_LodLevels.clear();
+	m_LodThresholds.clear();
+	m_Impostor = 0;
+	m_ImpostorThreshold = 0.0f;
+	m_LodModel = m_Model;
+
+	if (m_LodRatios.empty() && m_ImpostorScreenSize <= 0.0f) return;
+	if (!g_Config.getBool("Graphics", "ModelLod", true, true)) return;
+
+	/** scales the screen size thresholds; larger values switch to lower detail sooner. */
+	const float scale = static_cast<float>(g_Config.getFloat("Graphics", "ModelLodScale", 1.0, true));
+
+	/** default thresholds (in pixels) if lod_screen_sizes is not specified. */
+	static const float DefaultScreenSizes[] = { 160.0f, 60.0f, 25.0f };
+	static const unsigned NumDefaultScreenSizes = sizeof(DefaultScreenSizes) / sizeof(DefaultScreenSizes[0]);
+
+	if (!m_LodScreenSizes.empty() && m_LodScreenSizes.size() != m_LodRatios.size()) {
+		CSPLOG(Prio_WARNING, Cat_OBJECT) << "lod_screen_sizes and lod_ratios have different lengths in " << m_ModelPath.getSource();
+	}
+
+	Timer timer;
+	timer.start();
+
+	const osg::CopyOp deep_copy(osg::CopyOp::DEEP_COPY_NODES | osg::CopyOp::DEEP_COPY_DRAWABLES | osg::CopyOp::DEEP_COPY_ARRAYS | osg::CopyOp::DEEP_COPY_PRIMITIVES);
+	float upper = 1e+6f;
+	for (unsigned i = 0; i < m_LodRatios.size(); ++i) {
+		const float ratio = m_LodRatios[i];
+		if (ratio <= 0.0f || ratio >= 1.0f) {
+			CSPLOG(Prio_WARNING, Cat_OBJECT) << "Ignoring invalid lod ratio " << ratio << " in " << m_ModelPath.getSource();
+			continue;
+		}
+		float threshold = (i < m_LodScreenSizes.size()) ? m_LodScreenSizes[i] : DefaultScreenSizes[std::min(i, NumDefaultScreenSizes - 1)];
+		threshold *= scale;
+		if (threshold >= upper) {
+			CSPLOG(Prio_WARNING, Cat_OBJECT) << "Lod screen sizes should decrease in " << m_ModelPath.getSource();
+			threshold = 0.5f * upper;
+		}
+		osg::ref_ptr<osg::Node> level = static_cast<osg::Node*>(m_Model->clone(deep_copy));
+		LodStripVisitor strip;
+		level->accept(strip);
+		osgUtil::Simplifier simplifier(ratio);
+		level->accept(simplifier);
+		level->setName(m_Model->getName() + ":lod");
+		m_LodLevels.push_back(level);
+		m_LodThresholds.push_back(threshold);
+		upper = threshold;
+	}
+
+	if (m_ImpostorScreenSize > 0.0f) {
+		osg::ref_ptr<osg::Node> source;
+		if (m_LodLevels.empty()) {
+			/** share the geometry, but strip the cockpit interiors. */
+			source = static_cast<osg::Node*>(m_Model->clone(osg::CopyOp::DEEP_COPY_NODES));
+			LodStripVisitor strip;
+			source->accept(strip);
+		} else {
+			source = m_LodLevels.back();
+		}
+		m_Impostor = generateImpostor(source.get());
+		m_ImpostorThreshold = std::min(m_ImpostorScreenSize * scale, 0.5f * upper);
+	}
+
+	m_LodModel = makeLod(m_Model.get());
+	timer.stop();
+
+	CSPLOG(Prio_INFO, Cat_OBJECT) << "Generated " << m_LodLevels.size() << " lod levels" << (m_Impostor.valid() ? " and impostor" : "") << " in " << (timer.elapsed() * 1e3) << " ms";
+}
+
+osg::Node *ObjectModel::generateImpostor(osg::Node *source) const {
+	osg::ComputeBoundsVisitor bounds;
+	source->accept(bounds);
+	osg::BoundingBox const &box = bounds.getBoundingBox();
+	if (!box.valid()) {
+		CSPLOG(Prio_WARNING, Cat_OBJECT) << "Unable to create impostor for empty model " << m_ModelPath.getSource();
+		return 0;
+	}
+
+	const osg::Vec3 center = box.center();
+	const osg::Vec3 half = (box._max - box._min) * 0.5f;
+	const int resolution = clampTo(m_ImpostorResolution, 16, 1024);
+
+	/** view direction and up vector for each of the three cards (side, front, and top). */
+	static const osg::Vec3 views[3][2] = {
+		{ osg::Vec3(1, 0, 0), osg::Vec3(0, 0, 1) },
+		{ osg::Vec3(0, 1, 0), osg::Vec3(0, 0, 1) },
+		{ osg::Vec3(0, 0, -1), osg::Vec3(0, 1, 0) },
+	};
+
+	osg::Group *impostor = new osg::Group;
+	impostor->setName("impostor");
+	osg::Geode *cards = new osg::Geode;
+
+	for (unsigned i = 0; i < 3; ++i) {
+		const osg::Vec3 dir = views[i][0];
+		const osg::Vec3 up = views[i][1];
+		const osg::Vec3 right = dir ^ up;
+		const float w = std::max(0.01f, std::abs(right.x()) * half.x() + std::abs(right.y()) * half.y() + std::abs(right.z()) * half.z());
+		const float h = std::max(0.01f, std::abs(up.x()) * half.x() + std::abs(up.y()) * half.y() + std::abs(up.z()) * half.z());
+		const float d = std::abs(dir.x()) * half.x() + std::abs(dir.y()) * half.y() + std::abs(dir.z()) * half.z() + 1.0f;
+
+		osg::Texture2D *texture = new osg::Texture2D;
+		texture->setTextureSize(resolution, resolution);
+		texture->setInternalFormat(GL_RGBA);
+		texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR);
+		texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
+		texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+		texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+
+		osg::Camera *camera = new osg::Camera;
+		camera->setReferenceFrame(osg::Transform::ABSOLUTE_RF);
+		camera->setRenderOrder(osg::Camera::PRE_RENDER);
+		camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+		camera->setComputeNearFarMode(osg::CullSettings::DO_NOT_COMPUTE_NEAR_FAR);
+		camera->setClearColor(osg::Vec4(0.0f, 0.0f, 0.0f, 0.0f));
+		camera->setClearMask(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		camera->setViewport(0, 0, resolution, resolution);
+		camera->setProjectionMatrixAsOrtho(-w, w, -h, h, 0.0, 2.0 * d);
+		camera->setViewMatrixAsLookAt(center - dir * d, center, up);
+		camera->attach(osg::Camera::COLOR_BUFFER, texture);
+		camera->setCullCallback(new RenderOnceCallback);
+		camera->addChild(source);
+		impostor->addChild(camera);
+
+		osg::Vec3Array *vertices = new osg::Vec3Array(4);
+		(*vertices)[0] = center - right * w - up * h;
+		(*vertices)[1] = center + right * w - up * h;
+		(*vertices)[2] = center + right * w + up * h;
+		(*vertices)[3] = center - right * w + up * h;
+		osg::Vec2Array *coords = new osg::Vec2Array(4);
+		(*coords)[0].set(0.0f, 0.0f);
+		(*coords)[1].set(1.0f, 0.0f);
+		(*coords)[2].set(1.0f, 1.0f);
+		(*coords)[3].set(0.0f, 1.0f);
+		osg::Vec4Array *color = new osg::Vec4Array(1);
+		(*color)[0].set(1.0f, 1.0f, 1.0f, 1.0f);
+
+		osg::Geometry *card = new osg::Geometry;
+		card->setVertexArray(vertices);
+		card->setTexCoordArray(0, coords);
+		card->setColorArray(color);
+		card->setColorBinding(osg::Geometry::BIND_OVERALL);
+		card->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::QUADS, 0, 4));
+		card->getOrCreateStateSet()->setTextureAttributeAndModes(0, texture, osg::StateAttribute::ON);
+		cards->addDrawable(card);
+	}
+
+	osg::StateSet *ss = cards->getOrCreateStateSet();
+	ss->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+	ss->setMode(GL_CULL_FACE, osg::StateAttribute::OFF);
+	ss->setAttributeAndModes(new osg::AlphaFunc(osg::AlphaFunc::GREATER, 0.5f), osg::StateAttribute::ON);
+	Shader::instance()->applyShader("none", ss);
+	impostor->addChild(cards);
+
+	return impostor;
+}
+
+osg::Node *ObjectModel::makeLod(osg::Node *detail) const {
+	if (m_LodLevels.empty() && !m_Impostor) return detail;
+	const float impostor_threshold = m_Impostor.valid() ? m_ImpostorThreshold : 0.0f;
+	osg::LOD *lod = new osg::LOD;
+	lod->setName("lod");
+	lod->setRangeMode(osg::LOD::PIXEL_SIZE_ON_SCREEN);
+	lod->addChild(detail, m_LodThresholds.empty() ? impostor_threshold : m_LodThresholds[0], 1e+6f);
+	for (unsigned i = 0; i < m_LodLevels.size(); ++i) {
+		const float lower = (i + 1 < m_LodThresholds.size()) ? m_LodThresholds[i + 1] : impostor_threshold;
+		lod->addChild(m_LodLevels[i].get(), lower, m_LodThresholds[i]);
+	}
+	if (m_Impostor.valid()) {
+		lod->addChild(m_Impostor.get(), 0.0f, m_ImpostorThreshold);
+	}
+	return lod;
+}
+
+osg::ref_ptr<osg::Node> ObjectModel::getLodModel() {
+	return m_LodModel.get();
+}
+
 void ObjectModel::addDebugMarkers() {
 	m_ContactMarkers = new osg::Switch;
 	osg::CullFace *cf = new osg::CullFace;
@@ -671,6 +918,10 @@ std::string ObjectModel::getModelPath() const {
 	return m_ModelPath.getSource();
 }
 
+std::string ObjectModel::getGroundShadowPath() const {
+	return m_GroundShadowPath.asString();
+}
+
 void ObjectModel::setModelPath(const External& path) {
 	m_ModelPath = path;
 }
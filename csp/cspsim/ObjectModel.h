@@ -57,7 +57,15 @@ class Station;
  * One ObjectModel instance is created for each type of model, and shared by
  * many SceneModel instances.
  *
- * TODO: add LOD support here.
+ * Models can optionally provide a chain of lower detail meshes and an
+ * impostor for distant viewing.  The lower detail meshes are generated when
+ * the model is loaded by simplifying the full detail model according to the
+ * "lod_ratios" hints, and are selected by their projected size on screen
+ * ("lod_screen_sizes", in pixels).  Below "impostor_screen_size" pixels the
+ * model is replaced by three orthogonal textured cards, rendered from the
+ * lowest detail mesh the first time the impostor is drawn.  Lower detail
+ * meshes and impostors are static: animations and cockpit interiors are
+ * only present in the full detail model.
  *
  */
 class CSPSIM_EXPORT ObjectModel: public Object {
@@ -78,6 +86,7 @@ public:
 
 	std::string getModelPath() const;
 	void setModelPath(const External& path);
+	std::string getGroundShadowPath() const;
 
 	bool getSmooth() const;
 	void setSmooth(bool smooth);
@@ -88,6 +97,26 @@ public:
 
 	osg::ref_ptr<osg::Node> getModel();
 	osg::ref_ptr<osg::Node> getDebugMarkers();
+
+	/** Get a shared node that selects between the full detail model, the
+	 *  lower detail meshes, and the impostor.  Returns the full detail
+	 *  model if no lower detail levels are defined.  Suitable for static
+	 *  objects that do not need a private copy of the model.
+	 */
+	osg::ref_ptr<osg::Node> getLodModel();
+
+	/** Create a new LOD node with the specified full detail node (typically
+	 *  a copy of getModel()) as the highest level, followed by the shared
+	 *  lower detail meshes and impostor.  Returns the detail node if no
+	 *  lower detail levels are defined.
+	 */
+	osg::Node *makeLod(osg::Node *detail) const;
+
+	/** The number of lower detail meshes (excluding the full detail model
+	 *  and the impostor).
+	 */
+	unsigned numLodLevels() const { return m_LodLevels.size(); }
+	bool hasImpostor() const { return m_Impostor.valid(); }
 	osg::ref_ptr<osg::Node> getGroundShadow();
 
 	const Vector3 &getAxis0() const { return m_Axis0; }
@@ -104,6 +133,9 @@ public:
 	}
 
 	double getBoundingSphereRadius() const { return m_BoundingSphereRadius; }
+	/** The corners of the axis aligned bounding box of the model, in model coordinates. */
+	Vector3 const &getBoundingBoxMin() const { return m_BoundingBoxMin; }
+	Vector3 const &getBoundingBoxMax() const { return m_BoundingBoxMax; }
 	PointList const &getContacts() const { return m_Contacts; }
 	std::string const &getLabel() const { return m_Label; }
 
@@ -144,15 +176,24 @@ protected:
 	PointList m_Contacts;
 	PointList m_DebugPoints;
 
+	std::vector<float> m_LodRatios;
+	std::vector<float> m_LodScreenSizes;
+	float m_ImpostorScreenSize;
+	int m_ImpostorResolution;
+
 	Link<Animation>::vector m_Animations;
 	Link<Station>::vector m_Stations;
 
 	virtual void postCreate();
 	void processModel();
 	void addDebugMarkers();
+	void generateLodLevels();
+	osg::Node *generateImpostor(osg::Node *source) const;
 	void generateStationMasks(std::map<std::string, unsigned> const &interior_map) const;
 
 	double m_BoundingSphereRadius;
+	Vector3 m_BoundingBoxMin;
+	Vector3 m_BoundingBoxMax;
 
 	enum { DEBUG_MARKERS };
 
@@ -163,6 +204,12 @@ private:
 	osg::ref_ptr<osg::Node> m_GroundShadow;
 	osg::ref_ptr<osg::Switch> m_DebugMarkers;
 	osg::ref_ptr<osg::Switch> m_ContactMarkers;
+
+	std::vector<osg::ref_ptr<osg::Node> > m_LodLevels;
+	std::vector<float> m_LodThresholds;
+	osg::ref_ptr<osg::Node> m_Impostor;
+	float m_ImpostorThreshold;
+	osg::ref_ptr<osg::Node> m_LodModel;
 };
 
 } // namespace csp
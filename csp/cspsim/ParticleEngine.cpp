@@ -0,0 +1,434 @@
+// Combat Simulator Project
+// Copyright (C) 2002 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/**
+ * @file ParticleEngine.cpp
+ *
+ **/
+
+
+#include <csp/cspsim/ParticleEngine.h>
+#include <csp/cspsim/Config.h>
+
+#include <csp/csplib/util/Profiler.h>
+#include <csp/csplib/util/SimdMath.h>
+
+#include <osg/BlendFunc>
+#include <osg/Depth>
+#include <osg/Drawable>
+#include <osg/FrameStamp>
+#include <osg/Geode>
+#include <osg/NodeCallback>
+#include <osg/NodeVisitor>
+#include <osg/State>
+#include <osg/Texture2D>
+#include <osgDB/ReadFile>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace csp {
+
+namespace fx {
+
+namespace {
+
+// Size of a VortexExpander particle older than one second (see
+// VortexExpander::operate), for one (float) or four (simd::Vec4f) ages.
+template <typename T>
+inline T vortexSize(T age) {
+	const T d = age - T(1.0f);
+	const T r = simd::select(age < T(2.0f), T(0.25f) + d * d, T(1.25f) + simd::sqrt(simd::max(age - T(2.0f), T(0.0f))));
+	return r * T(5.0f) / age;
+}
+
+} // namespace
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// ParticleStyle
+
+
+ParticleStyle::ParticleStyle():
+	color0(1.0, 1.0, 1.0, 1.0),
+	color1(1.0, 1.0, 1.0, 1.0),
+	alpha0(1.0),
+	alpha1(0.0),
+	size0(0.2f),
+	size1(0.2f),
+	lifetime(1.0),
+	emissive(false),
+	light(true),
+	operators(0) {
+}
+
+bool ParticleStyle::operator==(ParticleStyle const &other) const {
+	return texture == other.texture && color0 == other.color0 && color1 == other.color1 &&
+		alpha0 == other.alpha0 && alpha1 == other.alpha1 && size0 == other.size0 && size1 == other.size1 &&
+		lifetime == other.lifetime && emissive == other.emissive && light == other.light && operators == other.operators;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// ParticleEngine::Batch
+
+
+/** Draws all particles that share a texture and blending mode as camera
+ *  facing quads, using a single draw call.
+ */
+class ParticleEngine::Batch: public osg::Drawable {
+public:
+	META_Object(csp, Batch);
+
+	Batch(): m_Engine(0) { }
+	Batch(ParticleEngine const *engine, ParticleStyle const &style): m_Engine(engine), m_Texture(style.texture), m_Emissive(style.emissive), m_Light(style.light) {
+		setUseDisplayList(false);
+		setDataVariance(osg::Object::DYNAMIC);
+		osg::StateSet *state = getOrCreateStateSet();
+		osg::Texture2D *texture = new osg::Texture2D;
+		texture->setImage(osgDB::readImageFile(m_Texture));
+		texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+		texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+		state->setTextureAttributeAndModes(0, texture, osg::StateAttribute::ON);
+		if (m_Emissive) {
+			state->setAttributeAndModes(new osg::BlendFunc(osg::BlendFunc::SRC_ALPHA, osg::BlendFunc::ONE), osg::StateAttribute::ON);
+		} else {
+			state->setAttributeAndModes(new osg::BlendFunc(osg::BlendFunc::SRC_ALPHA, osg::BlendFunc::ONE_MINUS_SRC_ALPHA), osg::StateAttribute::ON);
+		}
+		state->setAttributeAndModes(new osg::Depth(osg::Depth::LESS, 0.0, 1.0, false), osg::StateAttribute::ON);
+		state->setMode(GL_LIGHTING, m_Light ? osg::StateAttribute::ON : osg::StateAttribute::OFF);
+		state->setRenderingHint(osg::StateSet::TRANSPARENT_BIN);
+	}
+	Batch(Batch const &other, osg::CopyOp const &copyop): osg::Drawable(other, copyop), m_Engine(other.m_Engine), m_Texture(other.m_Texture), m_Emissive(other.m_Emissive), m_Light(other.m_Light) { }
+
+	bool matches(ParticleStyle const &style) const {
+		return style.texture == m_Texture && style.emissive == m_Emissive && style.light == m_Light;
+	}
+
+	std::vector<unsigned> &indices() { return m_Indices; }
+
+	void setBound(osg::BoundingBox const &bound) {
+		m_Bound = bound;
+		dirtyBound();
+	}
+
+	virtual osg::BoundingBox computeBound() const { return m_Bound; }
+
+	virtual void drawImplementation(osg::RenderInfo &info) const {
+		const unsigned n = m_Indices.size();
+		if (n == 0 || !m_Engine) return;
+
+		osg::State &state = *info.getState();
+		osg::Matrix const &mv = state.getModelViewMatrix();
+		osg::Vec3 right(mv(0, 0), mv(1, 0), mv(2, 0));
+		osg::Vec3 up(mv(0, 1), mv(1, 1), mv(2, 1));
+		right.normalize();
+		up.normalize();
+
+		m_Vertices.resize(4 * n);
+		m_Colors.resize(4 * n);
+		if (m_TexCoords.size() < 4 * n) {
+			const unsigned old_size = m_TexCoords.size();
+			m_TexCoords.resize(4 * n);
+			for (unsigned i = old_size; i < 4 * n; i += 4) {
+				m_TexCoords[i + 0].set(0.0, 0.0);
+				m_TexCoords[i + 1].set(1.0, 0.0);
+				m_TexCoords[i + 2].set(1.0, 1.0);
+				m_TexCoords[i + 3].set(0.0, 1.0);
+			}
+		}
+
+		ParticleEngine const &e = *m_Engine;
+		osg::Vec3 *vertex = &m_Vertices.front();
+		osg::Vec4 *color = &m_Colors.front();
+		for (unsigned i = 0; i < n; ++i) {
+			const unsigned index = m_Indices[i];
+			ParticleStyle const &style = e.m_Styles[e.m_Style[index]];
+			const float t = e.m_Age[index] / e.m_LifeTime[index];
+			const float size = e.m_Size0[index] + (e.m_Size1[index] - e.m_Size0[index]) * t;
+			const osg::Vec3 p1 = right * size;
+			const osg::Vec3 p2 = up * size;
+			const osg::Vec3 center(e.m_X[index], e.m_Y[index], e.m_Z[index]);
+			*vertex++ = center - p1 - p2;
+			*vertex++ = center + p1 - p2;
+			*vertex++ = center + p1 + p2;
+			*vertex++ = center - p1 + p2;
+			osg::Vec4 c = style.color0 + (style.color1 - style.color0) * t;
+			c.w() *= style.alpha0 + (style.alpha1 - style.alpha0) * t;
+			*color++ = c;
+			*color++ = c;
+			*color++ = c;
+			*color++ = c;
+		}
+
+		state.unbindVertexBufferObject();
+		state.disableAllVertexArrays();
+		state.setVertexPointer(3, GL_FLOAT, 0, &m_Vertices.front());
+		state.setColorPointer(4, GL_FLOAT, 0, &m_Colors.front());
+		state.setTexCoordPointer(0, 2, GL_FLOAT, 0, &m_TexCoords.front());
+		glDrawArrays(GL_QUADS, 0, 4 * n);
+		state.disableAllVertexArrays();
+	}
+
+private:
+	ParticleEngine const *m_Engine;
+	std::string m_Texture;
+	bool m_Emissive;
+	bool m_Light;
+	std::vector<unsigned> m_Indices;
+	osg::BoundingBox m_Bound;
+	mutable std::vector<osg::Vec3> m_Vertices;
+	mutable std::vector<osg::Vec4> m_Colors;
+	mutable std::vector<osg::Vec2> m_TexCoords;
+};
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// ParticleEngine::UpdateCallback
+
+
+class ParticleEngine::UpdateCallback: public osg::NodeCallback {
+public:
+	explicit UpdateCallback(ParticleEngine *engine): m_Engine(engine), m_LastTime(-1.0) { }
+	virtual void operator()(osg::Node *node, osg::NodeVisitor *nv) {
+		osg::FrameStamp const *stamp = nv->getFrameStamp();
+		if (stamp) {
+			const double time = stamp->getSimulationTime();
+			if (m_LastTime >= 0.0 && time > m_LastTime) {
+				m_Engine->update(time - m_LastTime);
+			}
+			m_LastTime = time;
+		}
+		traverse(node, nv);
+	}
+private:
+	ParticleEngine *m_Engine;
+	double m_LastTime;
+};
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// ParticleEngine
+
+
+ParticleEngine::ParticleEngine():
+	m_Capacity(std::max(1024, g_Config.getInt("Graphics", "ParticleCapacity", 32768, true))),
+	m_Count(0),
+	m_VortexCounter(0) {
+	m_X.resize(m_Capacity);
+	m_Y.resize(m_Capacity);
+	m_Z.resize(m_Capacity);
+	m_VX.resize(m_Capacity);
+	m_VY.resize(m_Capacity);
+	m_VZ.resize(m_Capacity);
+	m_Age.resize(m_Capacity);
+	m_LifeTime.resize(m_Capacity);
+	m_Size0.resize(m_Capacity);
+	m_Size1.resize(m_Capacity);
+	m_Style.resize(m_Capacity);
+	m_Geode = new osg::Geode;
+	m_Geode->setName("particle_engine");
+	m_Geode->setUpdateCallback(new UpdateCallback(this));
+}
+
+ParticleEngine::~ParticleEngine() {
+}
+
+bool ParticleEngine::isEnabled() {
+	return g_Config.getBool("Graphics", "ParticleEngine", true, true);
+}
+
+osg::Node *ParticleEngine::getNode() {
+	return m_Geode.get();
+}
+
+unsigned ParticleEngine::getBatch(ParticleStyle const &style) {
+	for (unsigned i = 0; i < m_Batches.size(); ++i) {
+		if (m_Batches[i]->matches(style)) return i;
+	}
+	m_Batches.push_back(new Batch(this, style));
+	m_Geode->addDrawable(m_Batches.back().get());
+	return m_Batches.size() - 1;
+}
+
+unsigned ParticleEngine::addStyle(ParticleStyle const &style) {
+	std::vector<ParticleStyle>::const_iterator iter = std::find(m_Styles.begin(), m_Styles.end(), style);
+	if (iter != m_Styles.end()) return iter - m_Styles.begin();
+	assert(m_Styles.size() < 65536);
+	m_Styles.push_back(style);
+	m_StyleBatch.push_back(getBatch(style));
+	return m_Styles.size() - 1;
+}
+
+float ParticleEngine::getEmissionScale() const {
+	// full emission up to half capacity, then falling linearly to 10%.
+	const float load = static_cast<float>(m_Count) / m_Capacity;
+	return (load < 0.5f) ? 1.0f : std::max(0.1f, 1.0f - 1.8f * (load - 0.5f));
+}
+
+void ParticleEngine::emit(unsigned style, unsigned count, osg::Vec3 const &start, osg::Vec3 const &end, osg::Vec3 const &velocity_start, osg::Vec3 const &velocity_end) {
+	if (count == 0 || style >= m_Styles.size()) return;
+
+	// dither the scaled count so that on average the requested fraction is emitted.
+	const float scaled = count * getEmissionScale() + static_cast<float>(m_Random.unit());
+	const unsigned n = std::min(static_cast<unsigned>(scaled), m_Capacity - m_Count);
+	CSP_PROFILE_COUNTER("particles dropped", count - n);
+	if (n == 0) return;
+
+	ParticleStyle const &s = m_Styles[style];
+	const osg::Vec3 d_place = (end - start) / n;
+	const osg::Vec3 d_velocity = (velocity_end - velocity_start) / n;
+	for (unsigned i = 0; i < n; ++i) {
+		const unsigned index = m_Count++;
+		const osg::Vec3 place = start + d_place * i;
+		const osg::Vec3 velocity = velocity_start + d_velocity * i;
+		m_X[index] = place.x();
+		m_Y[index] = place.y();
+		m_Z[index] = place.z();
+		m_VX[index] = velocity.x() + static_cast<float>(m_Random.uniform(-0.4, 0.4));
+		m_VY[index] = velocity.y() + static_cast<float>(m_Random.uniform(-0.4, 0.4));
+		m_VZ[index] = velocity.z() + static_cast<float>(m_Random.uniform(-0.4, 0.4));
+		m_Age[index] = 0.0;
+		m_LifeTime[index] = s.lifetime;
+		m_Size0[index] = s.size0;
+		m_Size1[index] = s.size1;
+		m_Style[index] = static_cast<unsigned short>(style);
+		if (s.operators & ParticleStyle::SMOKE_THINNER) {
+			// see SmokeThinner::operate; applied once, when the particle is created.
+			float x = static_cast<float>(m_Random.unit());
+			x *= x;
+			x *= x;
+			const float max = 10.0;
+			const float lifetime = x * x * (max - 0.5f) + 0.5f;
+			const float scale = (s.lifetime > 0.0) ? lifetime / (1.0f + s.lifetime) : 1.0f;
+			m_LifeTime[index] = lifetime;
+			m_Size1[index] *= scale;
+		}
+	}
+}
+
+void ParticleEngine::update(double dt) {
+	CSP_PROFILE_ZONE("ParticleEngine::update");
+	const unsigned n = m_Count;
+	const float t = static_cast<float>(dt);
+
+	// integration, four particles at a time.
+	{
+		float *x = &m_X.front(), *y = &m_Y.front(), *z = &m_Z.front();
+		float const *vx = &m_VX.front(), *vy = &m_VY.front(), *vz = &m_VZ.front();
+		float *age = &m_Age.front();
+		unsigned i = 0;
+#ifdef CSP_SIMD_SSE2
+		const simd::Vec4f step(t);
+		for (; i + 3 < n; i += 4) {
+			(simd::Vec4f::load(x + i) + simd::Vec4f::load(vx + i) * step).store(x + i);
+			(simd::Vec4f::load(y + i) + simd::Vec4f::load(vy + i) * step).store(y + i);
+			(simd::Vec4f::load(z + i) + simd::Vec4f::load(vz + i) * step).store(z + i);
+			(simd::Vec4f::load(age + i) + step).store(age + i);
+		}
+#endif
+		for (; i < n; ++i) {
+			x[i] += vx[i] * t;
+			y[i] += vy[i] * t;
+			z[i] += vz[i] * t;
+			age[i] += t;
+		}
+	}
+
+	// VortexExpander: grow particles older than one second along a fixed
+	// profile (see VortexExpander::operate).
+	bool vortex = false;
+	for (unsigned i = 0; i < m_Styles.size(); ++i) {
+		if (m_Styles[i].operators & ParticleStyle::VORTEX_EXPANDER) vortex = true;
+	}
+	if (vortex) {
+		float const *age = &m_Age.front();
+		float *size0 = &m_Size0.front();
+		float *size1 = &m_Size1.front();
+		float *lifetime = &m_LifeTime.front();
+		auto expand = [this, age, size0, size1, lifetime](unsigned i, float size) {
+			if (!(m_Styles[m_Style[i]].operators & ParticleStyle::VORTEX_EXPANDER) || !(age[i] > 1.0f)) return;
+			size0[i] = 0.0f;
+			size1[i] = size;
+			// expire a small fraction of the older particles.
+			if (++m_VortexCounter % 300 == 0) lifetime[i] = age[i];
+		};
+		// the sizes are computed four at a time, and applied to the
+		// particles that are expanding.
+		unsigned i = 0;
+#ifdef CSP_SIMD_SSE2
+		float size[4];
+		for (; i + 3 < n; i += 4) {
+			vortexSize(simd::Vec4f::load(age + i)).store(size);
+			for (unsigned k = 0; k < 4; ++k) expand(i + k, size[k]);
+		}
+#endif
+		for (; i < n; ++i) expand(i, vortexSize(age[i]));
+	}
+
+	expire();
+	sort();
+	CSP_PROFILE_COUNTER("particles", m_Count);
+}
+
+void ParticleEngine::expire() {
+	unsigned j = 0;
+	for (unsigned i = 0; i < m_Count; ++i) {
+		if (m_Age[i] >= m_LifeTime[i]) continue;
+		if (i != j) {
+			m_X[j] = m_X[i];
+			m_Y[j] = m_Y[i];
+			m_Z[j] = m_Z[i];
+			m_VX[j] = m_VX[i];
+			m_VY[j] = m_VY[i];
+			m_VZ[j] = m_VZ[i];
+			m_Age[j] = m_Age[i];
+			m_LifeTime[j] = m_LifeTime[i];
+			m_Size0[j] = m_Size0[i];
+			m_Size1[j] = m_Size1[i];
+			m_Style[j] = m_Style[i];
+		}
+		++j;
+	}
+	m_Count = j;
+}
+
+void ParticleEngine::sort() {
+	const unsigned batches = m_Batches.size();
+	std::vector<osg::BoundingBox> bounds(batches);
+	for (unsigned b = 0; b < batches; ++b) {
+		m_Batches[b]->indices().clear();
+	}
+	for (unsigned i = 0; i < m_Count; ++i) {
+		const unsigned b = m_StyleBatch[m_Style[i]];
+		m_Batches[b]->indices().push_back(i);
+		const float size = std::max(std::fabs(m_Size0[i]), std::fabs(m_Size1[i]));
+		bounds[b].expandBy(osg::BoundingSphere(osg::Vec3(m_X[i], m_Y[i], m_Z[i]), size));
+	}
+	for (unsigned b = 0; b < batches; ++b) {
+		m_Batches[b]->setBound(bounds[b]);
+	}
+}
+
+
+} // namespace fx
+
+} // namespace csp
+
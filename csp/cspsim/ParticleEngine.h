@@ -0,0 +1,155 @@
+#pragma once
+// Combat Simulator Project
+// Copyright (C) 2002 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/**
+ * @file ParticleEngine.h
+ *
+ **/
+
+#include <osg/Referenced>
+#include <osg/Vec3>
+#include <osg/Vec4>
+#include <osg/ref_ptr>
+
+#include <csp/csplib/util/Random.h>
+
+#include <string>
+#include <vector>
+
+namespace osg {
+	class Geode;
+	class Node;
+}
+
+namespace csp {
+
+namespace fx {
+
+
+/** The appearance and behavior of a class of particles.  Particles are
+ *  drawn as camera facing quads; size, color, and alpha are interpolated
+ *  linearly over the lifetime of each particle.
+ */
+struct ParticleStyle {
+	/** Operators applied by the engine; see VortexExpander and SmokeThinner. */
+	enum { VORTEX_EXPANDER = 1, SMOKE_THINNER = 2 };
+
+	ParticleStyle();
+	bool operator==(ParticleStyle const &other) const;
+
+	std::string texture;
+	osg::Vec4 color0, color1;
+	float alpha0, alpha1;
+	float size0, size1;
+	float lifetime;
+	bool emissive;
+	bool light;
+	unsigned operators;
+};
+
+
+/** A shared particle engine for smoke and other simple effects.
+ *
+ *  All particles live in a single fixed capacity pool, stored as a
+ *  structure of arrays so that the per-frame update (integration, the
+ *  built-in operators, and expiration) runs as a few tight loops over
+ *  contiguous data.  Particles are drawn with one drawable per texture and
+ *  blending mode, regardless of the number of effects using it.
+ *
+ *  The pool capacity is set by Graphics.ParticleCapacity.  As the pool
+ *  fills, the engine emits progressively fewer particles (thinning out
+ *  trails rather than truncating them), and new particles are dropped
+ *  once the pool is full.
+ *
+ *  Particle positions are in global coordinates; the engine node must be
+ *  added to the global frame of the scene (see VirtualScene).
+ */
+class ParticleEngine: public osg::Referenced {
+public:
+	ParticleEngine();
+
+	/** Returns true if effects should use the shared engine
+	 *  (Graphics.ParticleEngine).
+	 */
+	static bool isEnabled();
+
+	/** Register a particle style, returning an identifier for emit().
+	 *  Equivalent styles share the same identifier.
+	 */
+	unsigned addStyle(ParticleStyle const &style);
+
+	/** Emit particles evenly spaced along a segment, with velocities
+	 *  interpolated between the endpoints plus a small random component.
+	 *  The number of particles emitted is reduced when the pool is
+	 *  heavily loaded.
+	 */
+	void emit(unsigned style, unsigned count, osg::Vec3 const &start, osg::Vec3 const &end, osg::Vec3 const &velocity_start, osg::Vec3 const &velocity_end);
+
+	/** Advance all particles.  Called automatically during the update
+	 *  traversal of the engine node.
+	 */
+	void update(double dt);
+
+	/** The scene graph node that updates and draws the particles. */
+	osg::Node *getNode();
+
+	unsigned getCount() const { return m_Count; }
+	unsigned getCapacity() const { return m_Capacity; }
+
+	/** The fraction of requested particles currently being emitted. */
+	float getEmissionScale() const;
+
+protected:
+	virtual ~ParticleEngine();
+
+private:
+	class Batch;
+	class UpdateCallback;
+
+	unsigned getBatch(ParticleStyle const &style);
+	void expire();
+	void sort();
+
+	const unsigned m_Capacity;
+	unsigned m_Count;
+
+	// particle pool, one entry per live particle in each array.
+	std::vector<float> m_X, m_Y, m_Z;
+	std::vector<float> m_VX, m_VY, m_VZ;
+	std::vector<float> m_Age;
+	std::vector<float> m_LifeTime;
+	std::vector<float> m_Size0;
+	std::vector<float> m_Size1;
+	std::vector<unsigned short> m_Style;
+
+	std::vector<ParticleStyle> m_Styles;
+	std::vector<unsigned> m_StyleBatch;
+	std::vector<osg::ref_ptr<Batch> > m_Batches;
+	osg::ref_ptr<osg::Geode> m_Geode;
+
+	unsigned m_VortexCounter;
+	random::Taus2 m_Random;
+};
+
+
+} // namespace fx
+
+} // namespace csp
+
@@ -21,30 +21,29 @@
 /**
  * @file Profile.h
  *
- * Very simple profiling macros.  Place PROF0(id) / PROF1(id, n) pairs
- * around the code you want to time.  The 'id' parameter must be a unique
- * identifier (valid C identifier) that will be used to label the test.
- * The 'n' parameter is the number of times to average before recording
- * the result to the log file.  Logging goes to the PROFILE target, so
- * you must enable this (--log=PROFILE on the CSPSim.py command line) to
- * see the timing results.  Each log entry contains the 'id' identifier
- * and the average execution time in milliseconds.
+ * Profiling support for the simulation.  Place CSP_PROFILE_ZONE("name")
+ * at the start of a block to time the rest of the block; see
+ * csplib/util/Profiler.h for details.  The main loop in CSPSim::run marks
+ * the frames, and the following top level zones are defined:
+ *
+ *   network       processing of incoming and outgoing network messages
+ *   atmosphere    low priority atmosphere updates
+ *   battlefield   unit updates, including
+ *     physics     the physics model of each dynamic object
+ *   scene         virtual scene and terrain updates
+ *   screen        updates of the current screen
+ *   scene graph   the osg update traversal
+ *   render        the osg cull and draw traversals
+ *   terrain sync  exchange of chunk lod terrain requests with the loader
+ *   terrain load  chunk lod terrain and texture loading (in the terrain
+ *                 loader thread if enabled)
+ *
+ * Profiling is enabled with the Debug.Profiler configuration option or
+ * the in-game profiler overlay, and Debug.ProfilerSpikeThreshold (in
+ * milliseconds) automatically saves a Chrome trace of the preceding
+ * frames whenever a frame takes longer than the threshold.
  *
  **/
 
-#include <csp/csplib/util/Log.h>
-#include <csp/csplib/data/Date.h>
-
-#define PROF0(id) \
-	static int id##_c = 0; \
-	static csp::SimTime id##_t = 0.0;			\
-	csp::SimTime id##_t0;						\
-	id##_t0 = csp::SimDate::getSystemTime();
+#include <csp/csplib/util/Profiler.h>
 
-#define PROF1(id, n) \
-	id##_t += csp::SimDate::getSystemTime() - id##_t0;	\
-	if (++id##_c >= n) { \
-		CSPLOG(Prio_DEBUG, Cat_TIMING) << "PROF " << #id << ": " << (1000.0*id##_t/id##_c) << " ms"; \
-		id##_t = 0; \
-		id##_c = 0; \
-	}
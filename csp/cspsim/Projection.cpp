@@ -27,12 +27,61 @@
 
 
 #include <csp/cspsim/Projection.h>
+#include <csp/csplib/util/SimdMath.h>
 
 #include <cstdio>
 #include <iostream>
 
 namespace csp {
 
+void Projection::project(unsigned n, double const *lat, double const *lon, double *x, double *y) const {
+	for (unsigned i = 0; i < n; ++i) {
+		Vector3 pos = convert(LLA(lat[i], lon[i]));
+		x[i] = pos.x();
+		y[i] = pos.y();
+	}
+}
+
+void Projection::unproject(unsigned n, double const *x, double const *y, double *lat, double *lon) const {
+	for (unsigned i = 0; i < n; ++i) {
+		LLA pos = convert(Vector3(x[i], y[i], 0.0));
+		lat[i] = pos.latitude();
+		lon[i] = pos.longitude();
+	}
+}
+
+
+namespace {
+
+// Batch versions of GnomonicProjection::convert, evaluated for pairs of points
+// (simd::Vec2d) and for single points.
+template <typename T>
+void _gnomonicProject(T lat, T lon, T &x, T &y, double lon0, double s0, double c0, double radius) {
+	T splat, cplat, sy, cy;
+	simd::sincos(lat, splat, cplat);
+	simd::sincos(lon - lon0, sy, cy);
+	const T u = cplat * sy;
+	const T v = -s0 * cplat * cy + c0 * splat;
+	T su, cu, sv, cv;
+	simd::sincos(u, su, cu);
+	simd::sincos(v, sv, cv);
+	x = su / cu * radius;
+	y = sv / cv * radius;
+}
+
+template <typename T>
+void _gnomonicUnproject(T x, T y, T &lat, T &lon, double lon0, double s0, double c0, double radius) {
+	const T x0 = simd::atan(x / radius);
+	const T y0 = simd::atan(y / radius);
+	const T w = simd::sqrt(1.0 - x0 * x0 - y0 * y0);
+	const T z = s0 * w + c0 * y0;
+	// asin(z)
+	lat = simd::atan2(z, simd::sqrt(1.0 - z * z));
+	lon = simd::atan2(x0, c0 * w - s0 * y0) + lon0;
+}
+
+} // namespace
+
 LLA GnomonicProjection::getCenter() const {
 	return LLA(m_Lat0, m_Lon0);
 }
@@ -78,6 +127,36 @@ LLA GnomonicProjection::convert(Vector3 const &pos) const {
 	return LLA(asin(z), atan2(x0, x) + m_Lon0, pos.z());
 }
 
+void GnomonicProjection::project(unsigned n, double const *lat, double const *lon, double *x, double *y) const {
+	unsigned i = 0;
+#ifdef CSP_SIMD_SSE2
+	for (; i + 1 < n; i += 2) {
+		simd::Vec2d x2, y2;
+		_gnomonicProject(simd::Vec2d::load(lat + i), simd::Vec2d::load(lon + i), x2, y2, m_Lon0, m_S, m_C, m_R);
+		x2.store(x + i);
+		y2.store(y + i);
+	}
+#endif
+	for (; i < n; ++i) {
+		_gnomonicProject(lat[i], lon[i], x[i], y[i], m_Lon0, m_S, m_C, m_R);
+	}
+}
+
+void GnomonicProjection::unproject(unsigned n, double const *x, double const *y, double *lat, double *lon) const {
+	unsigned i = 0;
+#ifdef CSP_SIMD_SSE2
+	for (; i + 1 < n; i += 2) {
+		simd::Vec2d lat2, lon2;
+		_gnomonicUnproject(simd::Vec2d::load(x + i), simd::Vec2d::load(y + i), lat2, lon2, m_Lon0, m_S, m_C, m_R);
+		lat2.store(lat + i);
+		lon2.store(lon + i);
+	}
+#endif
+	for (; i < n; ++i) {
+		_gnomonicUnproject(x[i], y[i], lat[i], lon[i], m_Lon0, m_S, m_C, m_R);
+	}
+}
+
 Vector3 GnomonicProjection::getNorth(LLA const &pos) const {
 	double y = pos.longitude() - m_Lon0;
 	double splat = sin(pos.latitude());
@@ -51,6 +51,17 @@ public:
 	virtual Vector3 getNorth(LLA const &pos) const = 0;
 	virtual Vector3 getNorth(Vector3 const &pos) const = 0;
 	virtual Vector3 getUp(Vector3 const &pos) const = 0;
+
+	/** Convert arrays of latitude and longitude (in radians) to 2D world
+	 *  coordinates.  Altitude is unchanged by the projection, and is not
+	 *  passed.  The default implementation converts one point at a time.
+	 */
+	virtual void project(unsigned n, double const *lat, double const *lon, double *x, double *y) const;
+
+	/** Convert arrays of 2D world coordinates to latitude and longitude (in
+	 *  radians).  The default implementation converts one point at a time.
+	 */
+	virtual void unproject(unsigned n, double const *x, double const *y, double *lat, double *lon) const;
 };
 
 
@@ -79,6 +90,12 @@ public:
 	virtual LLA convert(Vector3 const &pos) const;
 	virtual Vector3 getNorth(LLA const &pos) const;
 	virtual Vector3 getNorth(Vector3 const &pos) const;
+
+	/** Batch conversions, which evaluate two points at a time using SSE2
+	 *  instructions if available.
+	 */
+	virtual void project(unsigned n, double const *lat, double const *lon, double *x, double *y) const;
+	virtual void unproject(unsigned n, double const *x, double const *y, double *lat, double *lon) const;
 };
 
 
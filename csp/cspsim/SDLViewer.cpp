@@ -20,6 +20,7 @@
 #include <csp/cspsim/SDLGraphicsWindow.h>
 #include <csp/cspsim/CSPSim.h>
 #include <csp/cspsim/Config.h>
+#include <csp/cspsim/Profile.h>
 #include <csp/cspsim/BaseScreen.h>
 #include <csp/cspsim/SDLEventHandler.h>
 #include <csp/cspsim/VirtualScene.h>
@@ -85,9 +86,16 @@ void SDLViewer::updateTraversal()
 	updateCurrentScreen();
 
 	// Traverse osg updaters
+	CSP_PROFILE_ZONE("scene graph");
 	osgViewer::Viewer::updateTraversal();
 }
 
+void SDLViewer::renderingTraversals()
+{
+	CSP_PROFILE_ZONE("render");
+	osgViewer::Viewer::renderingTraversals();
+}
+
 void SDLViewer::pollSdlEvents()
 {
 	SDL_Event event;
@@ -111,6 +119,7 @@ void SDLViewer::updateAtmosphere()
 
 	if ( low_priority > 0.66 )
 	{
+		CSP_PROFILE_ZONE("atmosphere");
 		auto atmosphere = CSPSim::theSim->getAtmosphere();
 		if(atmosphere) {
 			atmosphere->update(low_priority);
@@ -124,10 +133,18 @@ void SDLViewer::updateObjects()
 	if ( CSPSim::theSim->isPaused() ) return;
 
 	LocalBattlefield * battlefield = CSPSim::theSim->getBattlefield();
-	if ( battlefield ) battlefield->update( CSPSim::theSim->getFrameTime() );
+	if ( battlefield )
+	{
+		CSP_PROFILE_ZONE("battlefield");
+		battlefield->update( CSPSim::theSim->getFrameTime() );
+	}
 
 	VirtualScene * scene = CSPSim::theSim->getScene();
-	if ( scene ) scene->onUpdate( CSPSim::theSim->getFrameTime() );
+	if ( scene )
+	{
+		CSP_PROFILE_ZONE("scene");
+		scene->onUpdate( CSPSim::theSim->getFrameTime() );
+	}
 }
 
 void SDLViewer::updateCurrentScreen()
@@ -135,6 +152,7 @@ void SDLViewer::updateCurrentScreen()
 	Ref<BaseScreen> currentScreen = CSPSim::theSim->getCurrentScreen();
 	if ( !currentScreen ) return;
 
+	CSP_PROFILE_ZONE("screen");
 	currentScreen->onUpdate( CSPSim::theSim->getFrameTime() );
 }
 
@@ -33,6 +33,7 @@ protected:
 	bool setUpViewerAsOSGGraphicsWindow(const char *caption, const ScreenSettings & screenSettings);
 	virtual void eventTraversal();
 	virtual void updateTraversal();
+	virtual void renderingTraversals();
 
 	void pollSdlEvents();
 
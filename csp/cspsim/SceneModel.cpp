@@ -266,7 +266,8 @@ SceneModel::SceneModel(Ref<ObjectModel> const & model) {
 	m_CenterOfMassOffset->setName("cm_offset");
 	m_PositionTransform->addChild(m_AttitudeTransform.get());
 	m_AttitudeTransform->addChild(m_CenterOfMassOffset.get());
-	m_CenterOfMassOffset->addChild(m_ModelCopy.get());
+	// select between the model copy and the shared lower detail meshes by screen size.
+	m_CenterOfMassOffset->addChild(m_Model->makeLod(m_ModelCopy.get()));
 	m_CenterOfMassOffset->addChild(m_Model->getDebugMarkers().get());
 	m_CenterOfMassOffset->addChild(label);
 	m_Station = -1;
@@ -29,6 +29,7 @@
 #include <csp/cspsim/VirtualScene.h>
 
 #include <csp/csplib/util/Conversions.h>
+#include <csp/csplib/util/Profiler.h>
 #include <csp/csplib/util/Timing.h>
 
 #include <osg/Texture2D>
@@ -237,6 +238,74 @@ void ObjectStats::update() {
 	}
 }
 
+ProfilerStats::ProfilerStats(int posx, int posy)
+	: ScreenInfo(posx, posy, "PROFILER"), m_PosX(posx), m_PosY(posy), m_LastUpdate(0)
+{
+	m_Skip = static_cast<int>(m_CharacterSize);
+	if (m_Text.valid()) {
+		m_InfoGeode->removeDrawable(m_Text.get());
+	}
+	if (!getUpdateCallback()) {
+		setUpdateCallback(new UpdateCallback);
+	}
+}
+
+ProfilerStats::~ProfilerStats() {
+}
+
+void ProfilerStats::update() {
+	Profiler const &profiler = Profiler::getInstance();
+	// relayout is expensive, so only refresh the text a few times a second.
+	const unsigned long frame = static_cast<unsigned long>(profiler.getFrameCount());
+	if (frame < m_LastUpdate + 15 && frame >= m_LastUpdate) return;
+	m_LastUpdate = frame;
+
+	std::vector<std::string> lines;
+	std::ostringstream line;
+	line.precision(2);
+	line.setf(std::ios::fixed);
+	line << "frame " << setw(7) << profiler.getFrameTime() * 1000.0 << " ms  peak " << setw(7) << profiler.getPeakFrameTime() * 1000.0 << " ms";
+	if (!Profiler::isEnabled()) line << "  (profiler disabled)";
+	lines.push_back(line.str());
+
+	std::vector<Profiler::ZoneStats> stats;
+	profiler.getZoneStats(stats);
+	unsigned thread = ~0u;
+	for (std::vector<Profiler::ZoneStats>::const_iterator iter = stats.begin(); iter != stats.end(); ++iter) {
+		if (iter->thread != thread) {
+			thread = iter->thread;
+			std::string name = profiler.getThreadName(thread);
+			lines.push_back(name.empty() ? "thread " + std::to_string(thread) : name);
+		}
+		line.str("");
+		std::string label = std::string(2 * (iter->depth + 1), ' ') + iter->name;
+		label.resize(std::max<std::size_t>(label.size(), 24), ' ');
+		line << label << setw(7) << iter->last * 1000.0 << "  avg " << setw(7) << iter->average * 1000.0 << "  peak " << setw(7) << iter->peak * 1000.0 << "  x" << iter->calls;
+		lines.push_back(line.str());
+	}
+
+	const int n = static_cast<int>(m_Lines.size());
+	const int m = static_cast<int>(lines.size());
+	if (m < n) {
+		for (int i = m; i < n; ++i) {
+			m_InfoGeode->removeDrawable(m_Lines[i].get());
+		}
+		m_Lines.resize(m);
+	} else
+	if (m > n) {
+		m_Lines.resize(m);
+		for (int i = n; i < m; ++i) {
+			m_Lines[i] = makeText(m_PosX, m_PosY - (i + 1) * m_Skip);
+			m_Lines[i]->setUseDisplayList(false);
+			m_InfoGeode->addDrawable(m_Lines[i].get());
+		}
+	}
+	for (int i = 0; i < m; ++i) {
+		m_Lines[i]->setText(lines[i]);
+	}
+}
+
+
 MessageList::MessageList(int posx, int posy, int lines, float delay)
 	: ScreenInfo(posx, posy, "MESSAGE BOX"), m_Lines(lines), m_Delay(delay), m_Alpha(1.0), m_LastUpdate(0)
 {
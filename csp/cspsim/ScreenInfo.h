@@ -91,6 +91,24 @@ protected:
 };
 
 
+/** Displays the per-zone timings collected by the Profiler.  Zones are
+ *  listed by thread, indented by nesting depth, with the time spent in the
+ *  last frame and the smoothed and peak times per frame.
+ */
+class ProfilerStats: public ScreenInfo {
+	std::vector<osg::ref_ptr<osgText::Text> > m_Lines;
+	int m_PosX;
+	int m_PosY;
+	int m_Skip;
+	unsigned long m_LastUpdate;
+public:
+	ProfilerStats(int posx, int posy);
+	virtual void update();
+protected:
+	virtual ~ProfilerStats();
+};
+
+
 class MessageList: public ScreenInfo {
 	std::vector<osg::ref_ptr<osgText::Text> > m_Messages;
 	int m_Lines;
@@ -36,11 +36,13 @@ void set2dScene(osg::Group *root_node, int screen_width, int screen_height) {
 	osg::ref_ptr<ScreenInfo> record = new ScreenInfo(screen_width-15*offsetpos, screen_height-offsetpos, "RECORD", "RECORD");
 	osg::ref_ptr<GeneralStats> generalStats = new GeneralStats(offsetpos, screen_height / 3);
 	osg::ref_ptr<MessageList> messageBox = new MessageList(offsetpos, screen_height / 2, 4, 4.0);
+	osg::ref_ptr<ProfilerStats> profilerStats = new ProfilerStats(screen_width / 2, screen_height - offsetpos);
 
 	root_node->addChild(framerate.get());
 	root_node->addChild(record.get());
 	root_node->addChild(generalStats.get());
 	root_node->addChild(messageBox.get());
+	root_node->addChild(profilerStats.get());
 
 	osg::StateSet *rootState = root_node->getOrCreateStateSet();
 	rootState->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
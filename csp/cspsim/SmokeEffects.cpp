@@ -90,6 +90,11 @@ namespace csp {
 
 namespace fx {
 
+// emission rate of smoke trails, in particles per meter, and the maximum
+// number of particles emitted per trail per frame.
+const float SmokeTrailDensity = 4.0;
+const int SmokeTrailMaxCount = 8;
+
 
 class WindEmitter: public osgParticle::Emitter {
 	Atmosphere const *m_Atmosphere;
@@ -251,11 +256,13 @@ void SmokeThinner::operate(osgParticle::Particle *p, double /*dt*/) {
 
 ParticleEffect::ParticleEffect() {
 	m_Created = false;
+	m_Enabled = true;
+	m_Style = 0;
 	setDefault();
 }
 
 ParticleEffect::~ParticleEffect() {
-	if (m_Created) {
+	if (m_Created && !m_Engine) {
 		CSPSim::theSim->getScene()->removeParticleSystem(m_Geode.get(), m_Program.get());
 		CSPSim::theSim->getScene()->removeParticleEmitter(m_Emitter.get());
 	}
@@ -307,9 +314,48 @@ void ParticleEffect::setLight(bool light) {
 }
 
 void ParticleEffect::setEnabled(bool on) {
+	m_Enabled = on;
 	if (m_Emitter.valid()) m_Emitter->setEnabled(on);
 }
 
+bool ParticleEffect::makeStyle(ParticleStyle &style) const {
+	style.texture = m_TextureFile;
+	style.color0 = m_Prototype.getColorRange().minimum;
+	style.color1 = m_Prototype.getColorRange().maximum;
+	style.alpha0 = m_Prototype.getAlphaRange().minimum;
+	style.alpha1 = m_Prototype.getAlphaRange().maximum;
+	style.size0 = m_Prototype.getSizeRange().minimum;
+	style.size1 = m_Prototype.getSizeRange().maximum;
+	style.lifetime = m_Prototype.getLifeTime();
+	style.emissive = m_Emissive;
+	style.light = m_Light;
+	style.operators = 0;
+	// the engine implements the built-in operators directly; effects with
+	// any other operators need their own particle system.
+	for (OperatorList::const_iterator iter = m_Operators.begin(); iter != m_Operators.end(); ++iter) {
+		if (dynamic_cast<VortexExpander const*>(iter->get())) {
+			style.operators |= ParticleStyle::VORTEX_EXPANDER;
+		} else if (dynamic_cast<SmokeThinner const*>(iter->get())) {
+			style.operators |= ParticleStyle::SMOKE_THINNER;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ParticleEffect::attachToEngine() {
+	if (m_Created) return m_Engine.valid();
+	if (!canUseEngine()) return false;
+	ParticleEngine *engine = CSPSim::theSim->getScene()->getParticleEngine();
+	ParticleStyle style;
+	if (!engine || !makeStyle(style)) return false;
+	m_Engine = engine;
+	m_Style = engine->addStyle(style);
+	m_Created = true;
+	return true;
+}
+
 osgParticle::Emitter* ParticleEffect::getEmitter() {
 	osgParticle::ModularEmitter* emitter = new osgParticle::ModularEmitter;
 	emitter->setParticleSystem(this);
@@ -347,7 +393,7 @@ void ParticleEffect::create() {
 }
 
 void ParticleEffect::addOperator(osgParticle::Operator* op) {
-	if (m_Created) {
+	if (m_Created && !m_Engine) {
 		m_Program->addOperator(op);
 	}
 	m_Operators.push_back(op);
@@ -402,7 +448,7 @@ void ParticleEffectUpdater::destroy() {
 // SmokeTrail
 
 
-SmokeTrail::SmokeTrail(): ParticleEffect() {
+SmokeTrail::SmokeTrail(): ParticleEffect(), m_HasSource(false) {
 	//m_Speed = 0;
 }
 
@@ -412,7 +458,7 @@ SmokeTrail::~SmokeTrail() {
 osgParticle::Emitter* SmokeTrail::getEmitter() {
 	WindEmitter *emitter = new WindEmitter();
 	//emitter->setDensity(20.0, 10, 1000);
-	emitter->setDensity(4.0, 4, 8);
+	emitter->setDensity(SmokeTrailDensity, 4, SmokeTrailMaxCount);
 	emitter->setParticleSystem(this);
 	return emitter;
 }
@@ -458,10 +504,26 @@ void SmokeTrail::update(double dt, Vector3 const &position, Quat const &attitude
 }
 */
 
-void SmokeTrail::update(double /*dt*/, Vector3 const &position, Quat const &attitude) {
+void SmokeTrail::update(double dt, Vector3 const &position, Quat const &attitude) {
+	Vector3 place = position + attitude.rotate(m_Offset);
+	if (m_Engine.valid()) {
+		// same distribution as WindEmitter: particles are placed between the
+		// current source and the previous source carried along by the wind.
+		Atmosphere const *atmosphere = CSPSim::theSim->getAtmosphere();
+		Vector3 wind = atmosphere ? atmosphere->getWind(place) : Vector3::ZERO;
+		if (m_HasSource && m_Enabled) {
+			const int count = std::min(int((place - m_LastPlace).length() * SmokeTrailDensity), SmokeTrailMaxCount);
+			if (count > 0) {
+				m_Engine->emit(m_Style, count, toOSG(place), toOSG(m_LastPlace + m_LastWind * dt), toOSG(wind), toOSG(m_LastWind));
+			}
+		}
+		m_LastPlace = place;
+		m_LastWind = wind;
+		m_HasSource = true;
+		return;
+	}
 	WindEmitter *emitter = dynamic_cast<WindEmitter*>(m_Emitter.get());
 	if (emitter) {
-		Vector3 place = position + attitude.rotate(m_Offset);
 		emitter->setSource(place);
 	}
 }
@@ -485,6 +547,11 @@ SmokeTrailSystem::~SmokeTrailSystem() {
 }
 
 void SmokeTrailSystem::addSmokeTrail(SmokeTrail *trail) {
+	assert(trail);
+	if (trail->attachToEngine()) {
+		m_Trails.push_back(trail);
+		return;
+	}
 	if (!m_Updater) {
 		m_Updater = new ParticleEffectUpdater;
 		VirtualScene *scene = CSPSim::theSim->getScene();
@@ -28,6 +28,8 @@
  * @brief 3D special effects.
  */
 
+#include <csp/cspsim/ParticleEngine.h>
+
 #include <csp/csplib/data/Quat.h>
 #include <csp/csplib/data/Vector3.h>
 
@@ -122,8 +124,21 @@ public:
 	virtual void removeOperator(osgParticle::Operator* op);
 	virtual void setEnabled(bool on);
 
+	/** Draw the effect using the shared particle engine, if the engine is
+	 *  enabled and supports the effect.  Must be called before the effect is
+	 *  added to a ParticleEffectUpdater; returns false if the effect must be
+	 *  added to an updater as a separate particle system.
+	 */
+	bool attachToEngine();
+
 protected:
 
+	/** Returns true if the effect can emit particles through the shared
+	 *  particle engine.
+	 */
+	virtual bool canUseEngine() const { return false; }
+	bool makeStyle(ParticleStyle &style) const;
+
 	virtual osgParticle::Counter* getCounter() { return NULL; }
 	virtual osgParticle::Shooter* getShooter() { return NULL; }
 	virtual osgParticle::Placer* getPlacer()  { return NULL; } 
@@ -139,10 +154,14 @@ protected:
 	osg::ref_ptr<osgParticle::ModularProgram> m_Program;
 	osg::ref_ptr<osg::Geode> m_Geode;
 
+	osg::ref_ptr<ParticleEngine> m_Engine;
+	unsigned m_Style;
+
 	std::string m_TextureFile;
 	bool m_Emissive;
 	bool m_Light;
 	bool m_Created;
+	bool m_Enabled;
 };
 
 
@@ -168,9 +187,12 @@ protected:
 	osg::ref_ptr<WindShooter> m_Shooter;
 	*/
 
+	virtual bool canUseEngine() const { return true; }
+
 	Vector3 m_Offset;
-	//Vector3 m_LastPlace;
-	//Vector3 m_LastWind;
+	Vector3 m_LastPlace;
+	Vector3 m_LastWind;
+	bool m_HasSource;
 	//float m_Speed;
 };
 
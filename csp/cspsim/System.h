@@ -175,7 +175,8 @@ public:
 
 	/** Connect this node and all children (recursively) to an update
 	 *  master.  The update master provides periodic callbacks to the
-	 *  onUpdate() method.  See UpdateMaster for details.
+	 *  onUpdate() method.  See UpdateMaster for details.  A null master
+	 *  disconnects the systems until they are registered again.
 	 */
 	void registerUpdate(UpdateMaster *master) {
 		accept(new UpdateMasterVisitor(master));
@@ -26,6 +26,7 @@
 
 
 #include <csp/cspsim/SystemsModel.h>
+#include <csp/cspsim/Config.h>
 #include <csp/cspsim/DataRecorder.h>
 #include <csp/cspsim/sound/SoundModel.h>
 #include <csp/cspsim/stores/StoresManagementSystem.h>
@@ -179,6 +180,10 @@ void SystemsModel::bindSystems() {
 	accept(new InitVisitor(getModel()));
 	Ref<BindVisitor> binder = new BindVisitor(getBus());
 	accept(binder);
+	// all channels are registered now, so pack their values into one block.
+	if (g_Config.getBool("Simulation", "ChannelArena", true, true)) {
+		getBus()->layoutChannels();
+	}
 	m_Bound = true;
 }
 
@@ -0,0 +1,128 @@
+// Combat Simulator Project
+// Copyright (C) 2007 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/**
+ * @file SystemsModelPrototype.cpp
+ *
+ **/
+
+#include <csp/cspsim/SystemsModelPrototype.h>
+#include <csp/cspsim/Config.h>
+#include <csp/cspsim/SystemsModel.h>
+
+#include <csp/csplib/data/DataManager.h>
+#include <csp/csplib/util/Log.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace csp {
+
+SystemsModelPrototype::SystemsModelPrototype(DataManager &manager, Path const &path, unsigned spares):
+	m_DataManager(&manager),
+	m_Path(path),
+	m_Recorded(false),
+	m_Target(spares) {
+}
+
+SystemsModelPrototype::~SystemsModelPrototype() {
+}
+
+Ref<SystemsModel> SystemsModelPrototype::load() {
+	Ref<SystemsModel> model;
+	model = m_DataManager->getObject(m_Path);
+	if (!model) {
+		CSPLOG(Prio_WARNING, Cat_OBJECT) << "SystemsModelPrototype: unable to load systems model " << m_Path.getPath();
+	}
+	return model;
+}
+
+Ref<SystemsModel> SystemsModelPrototype::create() {
+	if (m_Spares.empty()) return load();
+	Ref<SystemsModel> model = m_Spares.back();
+	m_Spares.pop_back();
+	return model;
+}
+
+void SystemsModelPrototype::bind(SystemsModel *model) {
+	assert(model);
+	Bus *bus = model->getBus();
+	const bool replay = m_Recorded;
+	if (replay) {
+		bus->replayBindings(m_Bindings);
+	} else {
+		bus->recordBindings(m_Bindings);
+	}
+	model->bindSystems();
+	if (!bus->finishBindings()) {
+		// the systems of this model looked up different channels than the
+		// recorded model did; record again with the next model.
+		CSPLOG(Prio_DEBUG, Cat_OBJECT) << "SystemsModelPrototype: channel bindings of " << m_Path.getPath() << " changed";
+		m_Recorded = false;
+	} else if (!replay) {
+		CSPLOG(Prio_DEBUG, Cat_OBJECT) << "SystemsModelPrototype: recorded " << m_Bindings.size() << " channel bindings for " << m_Path.getPath();
+		m_Recorded = true;
+	}
+}
+
+bool SystemsModelPrototype::refill() {
+	if (m_Spares.size() >= m_Target) return false;
+	Ref<SystemsModel> model = load();
+	if (!model) {
+		// don't retry every frame.
+		m_Target = 0;
+		return false;
+	}
+	m_Spares.push_back(model);
+	return true;
+}
+
+void SystemsModelPrototype::setSpares(unsigned spares) {
+	m_Target = spares;
+	if (m_Spares.size() > m_Target) m_Spares.resize(m_Target);
+}
+
+
+SystemsModelFactory::SystemsModelFactory() {
+}
+
+SystemsModelFactory::~SystemsModelFactory() {
+}
+
+SystemsModelPrototype *SystemsModelFactory::getPrototype(DataManager &manager, Path const &path) {
+	Ref<SystemsModelPrototype> &prototype = m_Prototypes[path.getPath()];
+	if (!prototype) {
+		const int spares = g_Config.getInt("Simulation", "SystemsModelSpares", 2, true);
+		prototype = new SystemsModelPrototype(manager, path, static_cast<unsigned>(std::max(0, spares)));
+	}
+	return prototype.get();
+}
+
+void SystemsModelFactory::update() {
+	for (PrototypeMap::iterator iter = m_Prototypes.begin(); iter != m_Prototypes.end(); ++iter) {
+		if (iter->second->refill()) return;
+	}
+}
+
+void SystemsModelFactory::reset() {
+	m_Prototypes.clear();
+}
+
+} // namespace csp
+
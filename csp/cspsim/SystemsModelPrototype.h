@@ -0,0 +1,135 @@
+#pragma once
+// Combat Simulator Project
+// Copyright (C) 2007 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/**
+ * @file SystemsModelPrototype.h
+ *
+ * Per-vehicle-type factories for systems models.
+ *
+ **/
+
+#include <csp/cspsim/Bus.h>
+#include <csp/cspsim/Export.h>
+#include <csp/csplib/data/Path.h>
+#include <csp/csplib/util/Ref.h>
+#include <csp/csplib/util/Singleton.h>
+
+#include <map>
+#include <vector>
+
+namespace csp {
+
+class DataManager;
+class SystemsModel;
+
+
+/** Creates and binds the systems models of one vehicle type (i.e., one
+ *  systems model path in the data archive).
+ *
+ *  The first model bound by the prototype records the channel lookups made
+ *  by its systems (see ChannelBindings).  Later models of the same type are
+ *  bound by replaying these lookups, which avoids searching the bus by name
+ *  for every channel that every system imports.  The prototype also keeps
+ *  a few unbound spare models loaded from the archive, which are rebuilt
+ *  one at a time between frames by SystemsModelFactory::update().  Spawning
+ *  a vehicle then only binds a spare model, rather than loading the entire
+ *  system tree from the archive.
+ */
+class CSPSIM_EXPORT SystemsModelPrototype: public Referenced {
+public:
+	SystemsModelPrototype(DataManager &manager, Path const &path, unsigned spares);
+
+	/** Get an unbound systems model, using a spare model if one is
+	 *  available.  The caller should register any channels provided by
+	 *  the vehicle and then call bind().  Returns null if the model cannot
+	 *  be loaded.
+	 */
+	Ref<SystemsModel> create();
+
+	/** Bind the systems of a model returned by create().
+	 */
+	void bind(SystemsModel *model);
+
+	/** Load one spare model if fewer than the requested number are available.
+	 *
+	 *  @returns true if a model was loaded.
+	 */
+	bool refill();
+
+	/** Set the number of spare models to keep.  Excess spare models are released. */
+	void setSpares(unsigned spares);
+
+	/** The number of spare models currently available. */
+	unsigned spares() const { return static_cast<unsigned>(m_Spares.size()); }
+
+	/** Test if channel bindings have been recorded for this vehicle type. */
+	bool hasBindings() const { return m_Recorded; }
+
+	Path const &getPath() const { return m_Path; }
+
+protected:
+	virtual ~SystemsModelPrototype();
+
+private:
+	Ref<SystemsModel> load();
+
+	Ref<DataManager> m_DataManager;
+	Path m_Path;
+	ChannelBindings m_Bindings;
+	bool m_Recorded;
+	unsigned m_Target;
+	std::vector<Ref<SystemsModel> > m_Spares;
+};
+
+
+/** SystemsModelFactory is a singleton that holds the SystemsModelPrototype
+ *  of each vehicle type that has been spawned.
+ */
+class CSPSIM_EXPORT SystemsModelFactory: public Singleton<SystemsModelFactory> {
+	friend class Singleton<SystemsModelFactory>;
+
+public:
+	/** Get the prototype for the systems model at the specified path,
+	 *  creating it if necessary.  The number of spare models for new
+	 *  prototypes is set by Simulation.SystemsModelSpares in the global
+	 *  configuration.
+	 */
+	SystemsModelPrototype *getPrototype(DataManager &manager, Path const &path);
+
+	/** Load at most one spare model.  Called once per frame, so that the
+	 *  cost of loading spare models is spread over several frames.
+	 */
+	void update();
+
+	/** Release all prototypes and spare models.  Used when the simulation
+	 *  (and the data archives) are unloaded.
+	 */
+	void reset();
+
+private:
+	SystemsModelFactory();
+	virtual ~SystemsModelFactory();
+
+	typedef std::map<ObjectID, Ref<SystemsModelPrototype> > PrototypeMap;
+	PrototypeMap m_Prototypes;
+};
+
+} // namespace csp
+
@@ -33,6 +33,10 @@
 
 #include <osg/LineSegment>
 
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
 namespace csp {
 
 CSP_XML_BEGIN(TerrainObject)
@@ -63,6 +67,53 @@ void TerrainObject::postCreate() {
 	m_Map = projection;
 }
 
+namespace {
+
+/** Interleave the bits of two 16-bit values (Morton order). */
+inline uint32_t interleave(uint32_t x, uint32_t y) {
+	x = (x | (x << 8)) & 0x00ff00ff;
+	x = (x | (x << 4)) & 0x0f0f0f0f;
+	x = (x | (x << 2)) & 0x33333333;
+	x = (x | (x << 1)) & 0x55555555;
+	y = (y | (y << 8)) & 0x00ff00ff;
+	y = (y | (y << 4)) & 0x0f0f0f0f;
+	y = (y | (y << 2)) & 0x33333333;
+	y = (y | (y << 1)) & 0x55555555;
+	return x | (y << 1);
+}
+
+} // namespace
+
+void TerrainObject::getGroundElevations(unsigned n, double const *x, double const *y, float *elevation) const {
+	if (n == 0) return;
+	double min_x = x[0], max_x = x[0], min_y = y[0], max_y = y[0];
+	for (unsigned i = 1; i < n; ++i) {
+		min_x = std::min(min_x, x[i]);
+		max_x = std::max(max_x, x[i]);
+		min_y = std::min(min_y, y[i]);
+		max_y = std::max(max_y, y[i]);
+	}
+	const double scale = 65535.0 / std::max(1.0, std::max(max_x - min_x, max_y - min_y));
+	std::vector<std::pair<uint32_t, unsigned> > order(n);
+	for (unsigned i = 0; i < n; ++i) {
+		const uint32_t qx = static_cast<uint32_t>((x[i] - min_x) * scale);
+		const uint32_t qy = static_cast<uint32_t>((y[i] - min_y) * scale);
+		order[i] = std::make_pair(interleave(qx, qy), i);
+	}
+	std::sort(order.begin(), order.end());
+	IntersectionHint hint = 0;
+	unsigned last = n;
+	for (unsigned k = 0; k < n; ++k) {
+		const unsigned i = order[k].second;
+		if (last < n && x[i] == x[last] && y[i] == y[last]) {
+			elevation[i] = elevation[last];
+		} else {
+			elevation[i] = getGroundElevation(x[i], y[i], hint);
+		}
+		last = i;
+	}
+}
+
 TerrainObject::Intersection::Intersection() {
 	_hit = false;
 	_ratio = 0.0;
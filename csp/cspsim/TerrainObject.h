@@ -118,6 +118,18 @@ public:
 
 	virtual float getGroundElevation(double x, double y, IntersectionHint &) const = 0;
 
+	/** Look up the ground elevation at many points.  The default
+	 *  implementation visits the points in a spatially coherent order
+	 *  and shares a single intersection hint, which is much faster than
+	 *  independent queries for large numbers of nearby points.
+	 *
+	 *  @param n the number of points.
+	 *  @param x the x coordinates of the points.
+	 *  @param y the y coordinates of the points.
+	 *  @param elevation returns the ground elevation at each point.
+	 */
+	virtual void getGroundElevations(unsigned n, double const *x, double const *y, float *elevation) const;
+
 	virtual int getTerrainPolygonsRendered() const = 0;
 
 	virtual osg::Node *getNode() = 0;
@@ -31,6 +31,7 @@
 #include <csp/cspsim/CSPSim.h>
 #include <csp/cspsim/DynamicObject.h>
 #include <csp/cspsim/ObjectModel.h>
+#include <csp/cspsim/ParticleEngine.h>
 #include <csp/cspsim/Projection.h>
 #include <csp/cspsim/SceneConstants.h>
 #include <csp/cspsim/ScreenInfoNode.h>
@@ -523,6 +524,11 @@ void VirtualScene::buildScene() {
 	m_FarGroup->addChild(m_GlobalFrame.get());
 	m_FarGroup->addChild(m_ParticleUpdaterGroup.get());
 
+	if (fx::ParticleEngine::isEnabled()) {
+		m_ParticleEngine = new fx::ParticleEngine;
+		m_GlobalFrame->addChild(m_ParticleEngine->getNode());
+	}
+
 	// fog properties: start and end distances are read from CSPSim.ini
 	osg::StateSet * pFogState = m_FogGroup->getOrCreateStateSet();
 	fogTerrainGroup->setStateSet(pFogState);
@@ -50,6 +50,10 @@ class FeatureTile;
 class FeatureGroup;
 class Sky;
 
+namespace fx {
+	class ParticleEngine;
+}
+
 namespace wf {
 	class WindowManager;
 }
@@ -75,6 +79,11 @@ public:
 	void removeParticleEmitter(osg::Node *emitter);
 	void addParticleSystem(osg::Node *system, osg::Node *program);
 	void removeParticleSystem(osg::Node *system, osg::Node *program);
+
+	/** The shared particle engine, or null if disabled (see fx::ParticleEngine).
+	 */
+	fx::ParticleEngine *getParticleEngine() { return m_ParticleEngine.get(); }
+
 	void addObject(Ref<DynamicObject> object);
 	void removeObject(Ref<DynamicObject> object);
 	void setNearObject(Ref<DynamicObject> object, bool isNear);
@@ -215,6 +224,7 @@ protected:
 	osg::ref_ptr<osg::Group> m_FreeObjectGroup;
 	osg::ref_ptr<osg::Group> m_ParticleEmitterGroup;
 	osg::ref_ptr<osg::Group> m_ParticleUpdaterGroup;
+	osg::ref_ptr<fx::ParticleEngine> m_ParticleEngine;
 	osg::ref_ptr<osg::PositionAttitudeTransform> m_GlobalFrame;
 	osg::ref_ptr<osg::PositionAttitudeTransform> m_FeatureGroup;
 	osg::ref_ptr<osg::PositionAttitudeTransform> m_TerrainGroup;
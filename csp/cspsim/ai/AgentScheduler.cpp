@@ -0,0 +1,128 @@
+// Combat Simulator Project
+// Copyright (C) 2002 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/**
+ * @file AgentScheduler.cpp
+ *
+ **/
+
+#include <csp/cspsim/ai/AgentScheduler.h>
+#include <csp/cspsim/Config.h>
+
+#include <csp/csplib/util/Math.h>
+#include <csp/csplib/util/Profiler.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace csp {
+namespace ai {
+
+namespace {
+
+/** The maximum stretch of the update interval with distance from the observers. */
+const double MaxDistanceFactor = 4.0;
+
+/** Smoothing of the frame time used to estimate the load. */
+const double FrameTimeFilter = 0.1;
+
+} // namespace
+
+
+AgentScheduler &AgentScheduler::getInstance() {
+	static AgentScheduler *scheduler = 0;
+	if (!scheduler) scheduler = new AgentScheduler;
+	return *scheduler;
+}
+
+AgentScheduler::AgentScheduler():
+	m_Spent(0.0),
+	m_Start(0.0),
+	m_Updates(0),
+	m_Deferred(0)
+{
+	m_Budget = g_Config.getFloat("Simulation", "AIBudget", 0.004, true);
+	m_TargetFrameTime = g_Config.getFloat("Simulation", "AITargetFrameTime", 1.0 / 30.0, true);
+	m_MaxLoadFactor = std::max(1.0, g_Config.getFloat("Simulation", "AIMaxLoadFactor", 4.0, true));
+	m_NearRange = g_Config.getFloat("Simulation", "AINearRange", 2000.0, true);
+	m_LowAltitude = g_Config.getFloat("Simulation", "AILowAltitude", 300.0, true);
+	m_MaxInterval = g_Config.getFloat("Simulation", "AIMaxInterval", 0.5, true);
+	m_Intervals[Task::LOW] = g_Config.getFloat("Simulation", "AILowPriorityInterval", 0.2, true);
+	m_Intervals[Task::NORMAL] = g_Config.getFloat("Simulation", "AINormalPriorityInterval", 0.1, true);
+	m_Intervals[Task::HIGH] = 0.0;
+	m_Intervals[Task::CRITICAL] = 0.0;
+	m_FrameTime = m_TargetFrameTime;
+	m_LoadFactor = 1.0;
+}
+
+void AgentScheduler::beginFrame(double dt) {
+	CSP_PROFILE_COUNTER("ai updates", m_Updates);
+	CSP_PROFILE_COUNTER("ai deferred", m_Deferred);
+	CSP_PROFILE_COUNTER("ai load factor", m_LoadFactor);
+	m_Observers.clear();
+	m_Spent = 0.0;
+	m_Updates = 0;
+	m_Deferred = 0;
+	if (dt > 0.0) {
+		m_FrameTime += (dt - m_FrameTime) * FrameTimeFilter;
+		m_LoadFactor = clampTo(m_FrameTime / m_TargetFrameTime, 1.0, m_MaxLoadFactor);
+	}
+}
+
+void AgentScheduler::addObserver(Vector3 const &position) {
+	m_Observers.push_back(position);
+}
+
+bool AgentScheduler::beginUpdate(Task::Priority priority, double waiting) {
+	// critical tasks, and agents that have been deferred for longer than their
+	// longest interval, are updated regardless of the budget.
+	if (priority != Task::CRITICAL && m_Spent >= m_Budget && waiting < m_MaxInterval * m_LoadFactor) {
+		++m_Deferred;
+		return false;
+	}
+	m_Start = get_realtime();
+	return true;
+}
+
+void AgentScheduler::endUpdate() {
+	m_Spent += get_realtime() - m_Start;
+	++m_Updates;
+}
+
+double AgentScheduler::getInterval(Task::Priority priority, Vector3 const &position, double altitude) const {
+	if (priority == Task::LOW && altitude < m_LowAltitude) priority = Task::NORMAL;
+	double interval = m_Intervals[priority];
+	if (interval <= 0.0) return 0.0;
+
+	// agents close to an observer are updated every frame.  beyond that the
+	// interval grows with distance.
+	if (!m_Observers.empty()) {
+		double distance2 = (m_Observers[0] - position).length2();
+		for (unsigned i = 1; i < m_Observers.size(); ++i) {
+			distance2 = std::min(distance2, (m_Observers[i] - position).length2());
+		}
+		const double distance = std::sqrt(distance2);
+		if (distance < m_NearRange) return 0.0;
+		interval *= std::min(MaxDistanceFactor, distance / m_NearRange);
+	}
+	return std::min(interval * m_LoadFactor, m_MaxInterval * m_LoadFactor);
+}
+
+} // end namespace ai
+} // end namespace csp
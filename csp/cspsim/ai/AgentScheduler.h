@@ -0,0 +1,116 @@
+#pragma once
+// Combat Simulator Project
+// Copyright (C) 2002 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/**
+ * @file AgentScheduler.h
+ *
+ **/
+
+#include <csp/cspsim/ai/Task.h>
+
+#include <csp/csplib/data/Vector3.h>
+#include <csp/csplib/util/Properties.h>
+#include <csp/csplib/util/Timing.h>
+
+#include <vector>
+
+namespace csp {
+namespace ai {
+
+/**
+ * Level of detail for AI updates.
+ *
+ * Agents ask the scheduler how long to wait before their next task
+ * update, based on the priority of the active task, the altitude above
+ * the ground, and the distance to the nearest observer (the camera, or a
+ * human player).  Agents flying routine tasks far from any observer make
+ * their decisions a few times per second instead of every frame.  The
+ * control loops that carry out those decisions still run every frame.
+ *
+ * The scheduler also limits the total time spent in agent updates to
+ * Simulation.AIBudget seconds per frame.  Once the budget is spent,
+ * agents with non-critical tasks defer their update to the next frame.
+ * When frames take longer than Simulation.AITargetFrameTime, all
+ * non-critical update intervals are stretched in proportion, up to
+ * Simulation.AIMaxLoadFactor.
+ *
+ * All methods must be called from the simulation thread.
+ */
+class AgentScheduler: public NonCopyable {
+public:
+	/** Get the scheduler instance. */
+	static AgentScheduler &getInstance();
+
+	/** Start a new frame.  Clears the observer list and resets the time
+	 *  budget.  Called once per frame, before the agents are updated.
+	 *
+	 *  @param dt the duration of the last frame (s).
+	 */
+	void beginFrame(double dt);
+
+	/** Add the position of an observer (in global coordinates) for the
+	 *  current frame.
+	 */
+	void addObserver(Vector3 const &position);
+
+	/** Returns true if an agent should run its update now.  If true, the
+	 *  agent must call endUpdate() when the update is done.
+	 *
+	 *  @param priority the priority of the agent's active task.
+	 *  @param waiting the time since the agent's last update (s).
+	 */
+	bool beginUpdate(Task::Priority priority, double waiting);
+
+	/** Charge the time since beginUpdate() to the frame budget. */
+	void endUpdate();
+
+	/** The time until the next update of an agent (s).
+	 *
+	 *  @param priority the priority of the agent's active task.
+	 *  @param position the position of the agent in global coordinates.
+	 *  @param altitude the height of the agent above the ground (m).
+	 */
+	double getInterval(Task::Priority priority, Vector3 const &position, double altitude) const;
+
+	/** The factor by which update intervals are currently stretched. */
+	double getLoadFactor() const { return m_LoadFactor; }
+
+private:
+	AgentScheduler();
+
+	double m_Budget;
+	double m_TargetFrameTime;
+	double m_MaxLoadFactor;
+	double m_NearRange;
+	double m_LowAltitude;
+	double m_MaxInterval;
+	double m_Intervals[4];
+
+	std::vector<Vector3> m_Observers;
+	double m_FrameTime;
+	double m_LoadFactor;
+	double m_Spent;
+	timing_t m_Start;
+	unsigned m_Updates;
+	unsigned m_Deferred;
+};
+
+} // end namespace ai
+} // end namespace csp
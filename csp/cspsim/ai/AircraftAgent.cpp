@@ -38,17 +38,21 @@
 //   - take off, follow waypoints, then land.
 
 #include <csp/cspsim/ai/AircraftAgent.h>
+#include <csp/cspsim/ai/AgentScheduler.h>
 #include <csp/cspsim/ai/AircraftControl.h>
 #include <csp/cspsim/ai/AircraftMission.h>
 #include <csp/cspsim/ai/Runway.h>
+#include <csp/cspsim/AggregateModel.h>
 #include <csp/cspsim/ConditionsChannels.h>
 #include <csp/cspsim/ControlInputsChannels.h>
 #include <csp/cspsim/FlightDynamicsChannels.h>
 #include <csp/cspsim/KineticsChannels.h>
 #include <csp/cspsim/LandingGearChannels.h>
+#include <csp/cspsim/NavigationChannels.h>
 
 #include <csp/csplib/data/ObjectInterface.h>
 
+#include <algorithm>
 #include <iostream>
 
 namespace csp {
@@ -57,7 +61,7 @@ namespace ai {
 CSP_XML_BEGIN(AircraftAgent)
 CSP_XML_END
 
-AircraftAgent::AircraftAgent() {
+AircraftAgent::AircraftAgent(): m_Waiting(0.0), m_Interval(0.0), m_RouteWaypoint(-1) {
 	m_AircraftControl = new AircraftControl;
 
 	Ref<Runway> runway = new Runway;
@@ -81,6 +85,7 @@ AircraftAgent::AircraftAgent() {
 	mission->waypoints().push_back(new Waypoint(-19510, -1400, 1500.0, 140.0));
 	mission->waypoints().push_back(new Waypoint(-25510, -2400, 1500.0, 140.0));
 	m_Task = mission;
+	m_Mission = mission;
 }
 
 AircraftAgent::~AircraftAgent() {
@@ -95,6 +100,7 @@ void AircraftAgent::registerChannels(Bus* bus) {
 	b_RightBrakeInput = bus->registerLocalDataChannel<double>(bus::ControlInputs::RightBrakeInput, 0.0);
 	b_ThrottleInput = bus->registerLocalDataChannel<double>(bus::ControlInputs::ThrottleInput, 0.0);
 	b_AirbrakeInput = bus->registerLocalDataChannel<double>(bus::ControlInputs::AirbrakeInput, 0.0);
+	b_Route = bus->registerLocalDataChannel<Ref<AggregateRoute> >(bus::Navigation::Route, new AggregateRoute);
 }
 
 void AircraftAgent::importChannels(Bus* bus) {
@@ -106,9 +112,40 @@ void AircraftAgent::getInfo(InfoList &info) const {
 }
 
 double AircraftAgent::onUpdate(double dt) {
-	m_Task->update(dt);
+	// the task decides what to do at the interval set by the scheduler, but
+	// the control loops that carry out its commands run every frame.
+	AgentScheduler &scheduler = AgentScheduler::getInstance();
+	updateRoute();
+	m_Waiting += dt;
+	if (m_Waiting >= m_Interval && scheduler.beginUpdate(m_Task->priority(), m_Waiting)) {
+		m_AircraftControl->beginCommands();
+		m_Task->update(m_Waiting, dt);
+		m_AircraftControl->endCommands();
+		m_Waiting = 0.0;
+		scheduler.endUpdate();
+		m_Interval = scheduler.getInterval(m_Task->priority(), m_AircraftControl->position(), m_AircraftControl->ralt());
+	} else {
+		m_AircraftControl->repeatCommands(dt);
+	}
 	return 0.0;
 }
 
+void AircraftAgent::updateRoute() {
+	AggregateRoute *route = b_Route->value().get();
+	const int n_waypoints = static_cast<int>(m_Mission->waypoints().size());
+	if (route->resume) {
+		m_Mission->resumeRoute(std::min(n_waypoints, std::max(0, m_RouteWaypoint) + static_cast<int>(route->progress)));
+		route->progress = 0;
+		route->resume = false;
+	}
+	if (m_Mission->waypoint() == m_RouteWaypoint) return;
+	m_RouteWaypoint = m_Mission->waypoint();
+	route->legs.clear();
+	for (int i = std::max(0, m_RouteWaypoint); i < n_waypoints; ++i) {
+		Waypoint const &waypoint = *(m_Mission->waypoints()[i]);
+		route->legs.push_back(AggregateRoute::Leg(waypoint.position, waypoint.speed));
+	}
+}
+
 } // end namespace ai
 } // end namespace csp
@@ -31,9 +31,13 @@
 #include <csp/csplib/util/TimeStamp.h>
 
 namespace csp {
+
+class AggregateRoute;
+
 namespace ai {
 
 class AircraftControl;
+class AircraftMission;
 class Task;
 
 class AircraftAgent: public System {
@@ -56,9 +60,25 @@ protected:
 	DataChannel<double>::RefT b_RightBrakeInput;
 	DataChannel<double>::RefT b_ThrottleInput;
 	DataChannel<double>::RefT b_AirbrakeInput;
+	DataChannel<Ref<AggregateRoute> >::RefT b_Route;
 
 	Ref<AircraftControl> m_AircraftControl;
 	Ref<Task> m_Task;
+	AircraftMission *m_Mission;  // owned by m_Task
+
+	/// Time since the last task update, including updates deferred by
+	/// the AgentScheduler.
+	double m_Waiting;
+
+	/// Time between task updates, set by the AgentScheduler.
+	double m_Interval;
+
+	/// The mission waypoint at the start of the published route.
+	int m_RouteWaypoint;
+
+	/// Publish the remaining waypoints for the aggregated model, and skip
+	/// the waypoints that were reached while aggregated.
+	void updateRoute();
 };
 
 } // end namespace ai
@@ -42,13 +42,20 @@ AircraftControl::AircraftControl():
 		m_EngageDynamicRollLimit(false),
 		m_TargetG(1.0),
 		m_Capture(false),
-		m_Done(false) {
+		m_Done(false),
+		m_Recording(false),
+		m_Depth(0) {
 	m_PitchPID.clamp(-1.0, 1.0);
 	m_RollPID.clamp(-1.0, 1.0);
 	m_ThrottlePID.clamp(0.0, 0.9);
 	m_RudderPID.clamp(-1.0, 1.0);
 }
 
+void AircraftControl::repeatCommands(double dt) {
+	assert(!m_Recording);
+	for (unsigned i = 0; i < m_Commands.size(); ++i) m_Commands[i](dt);
+}
+
 void AircraftControl::importChannels(Bus *bus) {
 	b_PitchInput = bus->getSharedChannel(bus::ControlInputs::PitchInput, true, true);
 	b_RollInput = bus->getSharedChannel(bus::ControlInputs::RollInput, true, true);
@@ -96,6 +103,7 @@ bool AircraftControl::pullupAdvisory() const {
 }
 
 void AircraftControl::flyPitchHeading(double pitch, double heading, double dt) {
+	Command command(this, [this, pitch, heading](double step) { flyPitchHeading(pitch, heading, step); });
 	double pitch_error = b_Pitch->value() - pitch;
 	b_PitchInput->value() = m_PitchPID.update(pitch_error, dt);
 	holdHeading(heading, dt, 0.0);
@@ -110,6 +118,7 @@ bool AircraftControl::flyTowardPosition(
 		double max_g,
 		bool can_invert,
 		double dt) {
+	Command command(this, [this, target, max_g, can_invert](double step) { flyTowardPosition(target, max_g, can_invert, step); });
 	static int xxx = 0; bool debug = s_doDebug && ((++xxx % 10) == 0);
 
 	if ((target - m_LastTarget).length2() > 10000.0) {
@@ -263,6 +272,7 @@ bool AircraftControl::flyTowardPosition(
 }
 
 double AircraftControl::adjustPitch(double error, double dt) {
+	Command command(this, [this, error](double step) { adjustPitch(error, step); });
 	// good in theory, but if the speed drops due to a high alpha
 	// climb, there isn't any authority to bring the nose back
 	// down.  need to work on this.
@@ -276,6 +286,7 @@ bool AircraftControl::flyToPositionSpeed(
 		double max_g,
 		bool can_invert,
 		double dt) {
+	Command command(this, [this, target_position, target_speed, max_g, can_invert](double step) { flyToPositionSpeed(target_position, target_speed, max_g, can_invert, step); });
 	Vector3 dir = velocity();
 	double speed = dir.normalize();
 
@@ -307,6 +318,7 @@ void AircraftControl::flyToPositionVelocity(
 		double max_g,
 		bool can_invert,
 		double dt) {
+	Command command(this, [this, target_position, target_velocity, max_g, can_invert](double step) { flyToPositionVelocity(target_position, target_velocity, max_g, can_invert, step); });
 	Vector3 dir = velocity();
 	Vector3 pos = position();
 	Vector3 delta = target_position - pos;
@@ -402,6 +414,7 @@ void AircraftControl::flyToPositionVelocity(
 // implemented.  It worked ok, but could not command high-g turns.
 // See flyTowardPosition for a more sophisticated approach.
 void AircraftControl::flyLevelHeading(double altitude, double heading, double dt) {
+	Command command(this, [this, altitude, heading](double step) { flyLevelHeading(altitude, heading, step); });
 	static int xxx = 0; ++xxx;
 	double error = -(alt() - altitude);
 	double vvi = clampTo(error * 0.2, -100.0, 100.0);
@@ -442,6 +455,7 @@ void AircraftControl::flyLevelHeading(double altitude, double heading, double dt
 }
 
 void AircraftControl::holdAirspeed(double airspeed, double dt) {
+	Command command(this, [this, airspeed](double step) { holdAirspeed(airspeed, step); });
 	double error = cas() - airspeed;
 	b_ThrottleInput->value() = m_ThrottlePID.update(error, dt);
 }
@@ -450,6 +464,7 @@ void AircraftControl::holdAirspeed(double airspeed, double dt) {
 // Returns true when the target waypoint is reached.  As a better
 // alternative, see flyToPositionSpeed.
 bool AircraftControl::flyToPosition(Vector3 const &target, double dt) {
+	Command command(this, [this, target](double step) { flyToPosition(target, step); });
 	Vector3 pos = b_ModelPosition->value();
 	Vector3 vel = b_LinearVelocity->value();
 	Vector3 delta = target - pos;
@@ -471,6 +486,7 @@ bool AircraftControl::flyToPosition(Vector3 const &target, double dt) {
 }
 
 void AircraftControl::steerToPoint(Vector3 const &point, double dt) {
+	Command command(this, [this, point](double step) { steerToPoint(point, step); });
 	if (!wow()) return;
 	Vector3 direction = (point - position()).normalized();
 	Vector3 motion = velocity().normalized();
@@ -479,6 +495,7 @@ void AircraftControl::steerToPoint(Vector3 const &point, double dt) {
 }
 
 void AircraftControl::holdHeading(double heading, double vv_error, double dt) {
+	Command command(this, [this, heading, vv_error](double step) { holdHeading(heading, vv_error, step); });
 	Vector3 vel = b_LinearVelocity->value();
 	double actual_heading = atan2(vel.x(), vel.y());
 	double heading_error = actual_heading - heading;
@@ -486,30 +503,36 @@ void AircraftControl::holdHeading(double heading, double vv_error, double dt) {
 }
 
 void AircraftControl::holdAlpha(double target, double dt) {
+	Command command(this, [this, target](double step) { holdAlpha(target, step); });
 	double error = 3.0 * (alpha() - target);
 	controlPitch(error, dt);
 }
 
 void AircraftControl::controlPitch(double error, double dt) {
+	Command command(this, [this, error](double step) { controlPitch(error, step); });
 	b_PitchInput->value() = m_PitchPID.update(error, dt);
 }
 
 void AircraftControl::controlThrottle(double error, double dt) {
+	Command command(this, [this, error](double step) { controlThrottle(error, step); });
 	b_ThrottleInput->value() = m_ThrottlePID.update(error, dt);
 }
 
 void AircraftControl::fastRoll(double roll, double dt) {
+	Command command(this, [this, roll](double step) { fastRoll(roll, step); });
 	double error = roll - b_Roll->value();
 	b_RollInput->value() = m_RollPID.update(5.0 * error, dt);
 }
 
 void AircraftControl::holdRoll(double roll, double dt) {
+	Command command(this, [this, roll](double step) { holdRoll(roll, step); });
 	double error = roll - b_Roll->value();
 	if (!gearFullyRetracted()) error *= 6.0;
 	b_RollInput->value() = m_RollPID.update(error, dt);
 }
 
 void AircraftControl::controlHeading(double heading_error, double vv_error, double dt) {
+	Command command(this, [this, heading_error, vv_error](double step) { controlHeading(heading_error, vv_error, step); });
 	while (heading_error > toRadians(180.0)) heading_error -= toRadians(360.0);
 	while (heading_error < -toRadians(180.0)) heading_error += toRadians(360.0);
 	double max_roll = clampTo(0.02 * (cas() - 65.0), 0.0, toRadians(60.0));
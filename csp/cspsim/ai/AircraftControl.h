@@ -23,6 +23,9 @@
 #include <csp/cspsim/Bus.h>
 #include <csp/cspsim/ai/PID.h>
 
+#include <functional>
+#include <vector>
+
 namespace csp {
 namespace ai {
 
@@ -32,18 +35,45 @@ public:
 
 	virtual void importChannels(Bus *bus);
 
+	/** Start recording the control commands of a task update.  The commands
+	 *  issued until endCommands() replace the previous ones, and are repeated
+	 *  by repeatCommands() on the frames between task updates so that the
+	 *  control loops run every frame.
+	 */
+	void beginCommands() { m_Commands.clear(); m_Recording = true; }
+	void endCommands() { m_Recording = false; }
+
+	/** Run the control loops for the last recorded commands.
+	 *
+	 *  @param dt the duration of the current frame (s).
+	 */
+	void repeatCommands(double dt);
+
 	void raiseGear() { b_GearCommand->push(true); }
 	void lowerGear() { b_GearCommand->push(false); }
 	void setLeftBrakeInput(double x) { b_LeftBrakeInput->value() = x; }
 	void setRightBrakeInput(double x) { b_RightBrakeInput->value() = x; }
 	void setThrottleInput(double x) {
+		Command command(this, [this, x](double) { setThrottleInput(x); });
 		b_ThrottleInput->value() = x;
 		m_ThrottlePID.set(x);
 	}
-	void setPitchInput(double x) { b_PitchInput->value() = x; }
-	void setRollInput(double x) { b_RollInput->value() = x; }
-	void setRudderInput(double x) { b_RudderInput->value() = x; }
-	void setAirbrakeInput(double x) { b_AirbrakeInput->value() = x; }
+	void setPitchInput(double x) {
+		Command command(this, [this, x](double) { setPitchInput(x); });
+		b_PitchInput->value() = x;
+	}
+	void setRollInput(double x) {
+		Command command(this, [this, x](double) { setRollInput(x); });
+		b_RollInput->value() = x;
+	}
+	void setRudderInput(double x) {
+		Command command(this, [this, x](double) { setRudderInput(x); });
+		b_RudderInput->value() = x;
+	}
+	void setAirbrakeInput(double x) {
+		Command command(this, [this, x](double) { setAirbrakeInput(x); });
+		b_AirbrakeInput->value() = x;
+	}
 	void setBrakes(double x) { setLeftBrakeInput(x); setRightBrakeInput(x); }
 	double throttleInput() const { return b_ThrottleInput->value(); }
 	bool wow() const { return b_WOW->value(); }
@@ -97,6 +127,20 @@ public:
 	void controlHeading(double heading_error, double vv_error, double dt);
 
 private:
+	/// Records a top-level command while the commands of a task update are
+	/// being recorded.  Commands issued by other commands are not recorded,
+	/// since they are repeated by their caller.
+	class Command {
+	public:
+		template <class F>
+		Command(AircraftControl *control, F const &repeat): m_Control(control) {
+			if (m_Control->m_Depth++ == 0 && m_Control->m_Recording) m_Control->m_Commands.push_back(repeat);
+		}
+		~Command() { --m_Control->m_Depth; }
+	private:
+		AircraftControl *m_Control;
+	};
+
 	DataChannel<double>::RefT b_PitchInput;
 	DataChannel<double>::RefT b_RollInput;
 	DataChannel<double>::RefT b_RudderInput;
@@ -140,6 +184,10 @@ private:
 	Vector3 m_LastTarget;
 	bool m_Capture;
 	bool m_Done;
+
+	std::vector<std::function<void(double)> > m_Commands;
+	bool m_Recording;
+	int m_Depth;
 };
 
 } // end namespace ai
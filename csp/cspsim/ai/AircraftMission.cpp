@@ -27,7 +27,7 @@
 namespace csp {
 namespace ai {
 
-AircraftMission::AircraftMission(): AircraftTask("Mission") {
+AircraftMission::AircraftMission(): AircraftTask("Mission"), m_Waypoint(0) {
 	addHandler(TAKEOFF, &AircraftMission::onTakeoff, "TAKEOFF");
 	addHandler(WAYPOINTS, &AircraftMission::onWaypoints, "WAYPOINTS");
 	addHandler(LAND, &AircraftMission::onLand, "LAND");
@@ -42,8 +42,21 @@ void AircraftMission::onTakeoff() {
 	next(WAYPOINTS);
 }
 
+void AircraftMission::resumeRoute(int waypoint) {
+	if (done()) return;
+	cancelOverride();
+	ai()->setBrakes(0.0);
+	ai()->raiseGear();
+	m_Waypoint = waypoint;
+	next(WAYPOINTS);
+}
+
 void AircraftMission::onWaypoints() {
-	if (initial()) m_Waypoint = 0;
+	// m_Waypoint is reset when the mission starts and after a missed
+	// landing, and is preserved across takeoff and aggregation.
+	if (initial()) {
+		setPriority(LOW);
+	}
 	if (m_Waypoint >= static_cast<int>(m_Waypoints.size())) {
 		next(LAND);
 		return;
@@ -56,6 +69,7 @@ void AircraftMission::onWaypoints() {
 
 void AircraftMission::onLand() {
 	if (done()) return;
+	setPriority(NORMAL);
 	AircraftTask *landing = new LandingTask;
 	landing->bind(ai());
 	landing->setRunway(runway());
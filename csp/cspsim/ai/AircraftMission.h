@@ -34,6 +34,11 @@ public:
 	int waypoint() const { return m_Waypoint; }
 	void setWaypoint(int waypoint) { m_Waypoint = waypoint; }
 
+	// Continue the route at the specified waypoint, abandoning any takeoff
+	// or landing in progress.  Used after the aircraft has flown part of the
+	// route while aggregated.
+	void resumeRoute(int waypoint);
+
 private:
 	enum { TAKEOFF, WAYPOINTS, LAND };
 	int m_Waypoint;
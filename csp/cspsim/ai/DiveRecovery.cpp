@@ -26,6 +26,7 @@ namespace csp {
 namespace ai {
 
 DiveRecovery::DiveRecovery(): AircraftTask("DiveRecovery") {
+	setPriority(CRITICAL);
 	addHandler(DIVE_RECOVERY, &DiveRecovery::onDiveRecovery, "DIVE_RECOVERY");
 	next(DIVE_RECOVERY);
 }
@@ -34,6 +34,7 @@ inline double slope(Vector3 const &v) {
 
 
 LandingTask::LandingTask(): AircraftTask("Landing") {
+	setPriority(CRITICAL);
 	addHandler(LINEUP, &LandingTask::onLineup, "LINEUP");
 	addHandler(APPROACH, &LandingTask::onApproach, "APPROACH");
 	addHandler(FINAL_APPROACH, &LandingTask::onFinalApproach, "FINAL_APPROACH");
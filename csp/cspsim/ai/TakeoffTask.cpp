@@ -26,6 +26,7 @@ namespace csp {
 namespace ai {
 
 TakeoffTask::TakeoffTask(): AircraftTask("Takeoff") {
+	setPriority(CRITICAL);
 	addHandler(READY, &TakeoffTask::onReady, "READY");
 	addHandler(THROTTLE_UP, &TakeoffTask::onThrottleUp, "THROTTLE_UP");
 	addHandler(RELEASE, &TakeoffTask::onRelease, "RELEASE");
@@ -28,6 +28,7 @@ namespace ai {
 Task::Task(const char *name):
 		m_Name(name),
 		m_Status(RUNNING),
+		m_Priority(NORMAL),
 		m_StateMachine(new StateMachine),
 		m_OverrideDoneHandler(new slot<void, Status>),
 		m_dt(0.0f),
@@ -43,7 +44,7 @@ Task::Task(const char *name):
 Task::~Task() {
 }
 
-void Task::update(double dt) {
+void Task::update(double dt, double step) {
 	// To aid with debugging new tasks, m_DebugFlag is set to true
 	// for one update every one second.  Task update handlers can
 	// used the debug() accessor to periodically write diagnostic
@@ -67,14 +68,14 @@ void Task::update(double dt) {
 	// Otherwise update our state machine (which typically calls
 	// back into one of the subclass methods).
 	if (!m_OverrideTask) {
-		m_dt = dt;
+		m_dt = step;
 		preupdate();
 		m_StateMachine->update();
 		postupdate();
 		m_NewState = false;
 		m_ElapsedTime += dt;
 	} else {
-		m_OverrideTask->update(dt);
+		m_OverrideTask->update(dt, step);
 		if (!m_OverrideTask->done()) {
 			return;
 		}
@@ -94,6 +95,11 @@ std::string Task::stateName() const {
 	return m_OverrideTask->stateName();
 }
 
+Task::Priority Task::priority() const {
+	if (!m_OverrideTask) return m_Priority;
+	return m_OverrideTask->priority();
+}
+
 void Task::addHandler(int state, const slot<void> &handler, std::string const &name) {
 	m_StateMachine->addHandler(state, handler, name);
 }
@@ -112,6 +118,13 @@ bool Task::advance() {
 	return true;
 }
 
+void Task::cancelOverride() {
+	if (!m_OverrideTask) return;
+	m_OverrideTask->cancel();
+	m_OverrideTask = 0;
+	m_OverrideDoneHandler->disconnect();
+}
+
 void Task::override(Task *task) {
 	assert(task != this);
 	assert(!m_OverrideTask);
@@ -35,8 +35,24 @@ public:
 		CANCEL
 	} Status;
 
+	/// How important it is to update the task frequently.  Used by
+	/// AgentScheduler to choose the update interval of the agent.
+	typedef enum {
+		LOW,       // routine navigation; can be updated a few times per second.
+		NORMAL,
+		HIGH,      // maneuvering close to other objects (e.g., combat).
+		CRITICAL   // takeoff, landing, and recovery; update every frame.
+	} Priority;
+
+	/// Update the task.  The control commands issued by the task are run
+	/// with a time step of step, which is the duration of the current frame.
+	/// Agents that update their task less often than every frame repeat
+	/// the commands on the frames in between, so dt (the time since the
+	/// last task update) only advances the task timers.
+	virtual void update(double dt, double step);
+
 	/// Update the task for the current time interval (frame).
-	virtual void update(double dt);
+	void update(double dt) { update(dt, dt); }
 
 	/// Returns true if the task is complete.  Check status() or one
 	/// of succeeded, cancelled, or failed to determine the exit
@@ -70,6 +86,10 @@ public:
 	/// Gets the name of the task and the name of the active state.
 	virtual std::string stateName() const;
 
+	/// Returns the priority of the active task (the override task,
+	/// if any).
+	Priority priority() const;
+
 protected:
 	Task(const char *name);
 	virtual ~Task();
@@ -84,6 +104,8 @@ protected:
 
 	void next(int state) { m_NextState = state; }
 
+	void setPriority(Priority priority) { m_Priority = priority; }
+
 	void fail() { if (m_Status == RUNNING) m_Status = FAILURE; }
 	void succeed() { if (m_Status == RUNNING) m_Status = SUCCESS; }
 
@@ -105,6 +127,10 @@ protected:
 
 	virtual void override(Task *task);
 
+	/// Cancel and discard the override task, if any, without calling
+	/// its done handler.
+	void cancelOverride();
+
 private:
 	bool advance();
 	void addHandler(int state, const slot<void> &handler, std::string const &name);
@@ -113,6 +139,7 @@ private:
 	const char *m_Name;
 
 	Status m_Status;
+	Priority m_Priority;
 	ScopedPointer<StateMachine> m_StateMachine;
 
 	Ref<Task> m_OverrideTask;
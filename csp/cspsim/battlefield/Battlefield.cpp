@@ -268,6 +268,7 @@ void Battlefield::setHumanUnit(UnitWrapper *wrapper, bool human) {
 	/** @TODO update the index server and/or clients (will be done by subclasses overriding this method) */
 	if (human) {
 		m_HumanUnits.push_back(wrapper);
+		if (wrapper->unit()->isAggregated()) wrapper->unit()->deaggregate();
 		wrapper->unit()->setHuman();
 		/** update the aggregation by pretending a human unit was added from the battlefield. */
 		CSPLOG(Prio_DEBUG, Cat_BATTLEFIELD) << "setting " << *(wrapper->unit()) << " to human";
@@ -25,6 +25,12 @@
 #include <csp/cspsim/battlefield/LocalBattlefield.h>
 #include <csp/cspsim/battlefield/Battlefield.h>
 #include <csp/cspsim/battlefield/SceneManager.h>
+#include <csp/cspsim/ai/AgentScheduler.h>
+#include <csp/cspsim/stores/Flyout.h>
+#include <csp/cspsim/stores/Projectile.h>
+#include <csp/cspsim/DynamicObject.h>
+#include <csp/cspsim/HitDetection.h>
+#include <csp/cspsim/Profile.h>
 
 #include <csp/csplib/data/Link.h>
 #include <csp/csplib/data/DataArchive.h>
@@ -37,6 +43,7 @@
 #include <csp/csplib/util/Timing.h>
 #include <csp/csplib/util/Verify.h>
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
@@ -201,6 +208,8 @@ LocalBattlefield::LocalBattlefield(Ref<DataManager> const &data_manager):
 	m_CameraGridPosition(0,0),
 	m_UnitUpdateMaster(new UpdateMaster()),
 	m_LocalIdPool(new ObjectIdPool()),
+	m_Flyout(Flyout::isEnabled() ? new Flyout() : 0),
+	m_HitDetection(HitDetection::isEnabled() ? new HitDetection() : 0),
 	m_ServerTimeOffset(0),
 	m_ScanElapsedTime(0),
 	m_ScanRate(0),
@@ -273,11 +282,25 @@ void LocalBattlefield::scanUnit(LocalUnitWrapper *wrapper) {
 				}
 			}
 		}
+		updateAggregation(unit);
 	} else {
 		CSPLOG(Prio_DEBUG, Cat_BATTLEFIELD) << "scan update, skipping unit outside battlefield";
 	}
 }
 
+void LocalBattlefield::updateAggregation(Unit const &unit) {
+	if (!unit->isLocal() || unit->isHuman()) return;
+	const double radius = unit->isAir() ? unit->getAirBubbleRadius() : unit->getGroundBubbleRadius();
+	const double distance = (unit->getGlobalPosition() - m_CameraPosition).length();
+	// the gap between the two thresholds prevents units near the edge of the
+	// bubble from switching models on every scan.
+	if (unit->isAggregated()) {
+		if (distance < radius) unit->deaggregate();
+	} else {
+		if (distance > 1.1 * radius) unit->aggregate();
+	}
+}
+
 void LocalBattlefield::continueUnitScan(double dt) {
 	static const double loop_time = 3.0;  // seconds
 	m_ScanElapsedTime += dt;
@@ -302,6 +325,61 @@ void LocalBattlefield::continueUnitScan(double dt) {
 	}
 }
 
+void LocalBattlefield::detectHits(double dt) {
+	CSP_PROFILE_ZONE("hit detection");
+	m_HitDetection->clear();
+	const unsigned first = m_Flyout.valid() ? m_Flyout->addQueries(*m_HitDetection) : 0;
+
+	// projectiles that have been removed from the battlefield are dropped
+	// here; the others add the path of their last update.
+	const unsigned first_projectile = m_HitDetection->numQueries();
+	std::vector<unsigned> projectiles;
+	HitDetection::Query query;
+	for (unsigned i = m_Projectiles.size(); i-- > 0; ) {
+		if (!findLocalUnitWrapper(m_Projectiles[i]->id())) {
+			m_Projectiles[i] = m_Projectiles.back();
+			m_Projectiles.pop_back();
+		}
+	}
+	for (unsigned i = 0; i < m_Projectiles.size(); ++i) {
+		if (!m_Projectiles[i]->getHitQuery(query)) continue;
+		m_HitDetection->addQuery(query);
+		projectiles.push_back(i);
+	}
+	const unsigned n_queries = m_HitDetection->numQueries();
+	if (n_queries == first) return;
+
+	// collect the units near each path, so that distant rounds don't pull in
+	// everything between them.  the margin allows for the size of the units.
+	static const double margin = 100.0;
+	std::vector<QuadTreeChild*> contacts;
+	for (unsigned i = first; i < n_queries; ++i) {
+		HitDetection::Query const &path = m_HitDetection->getQuery(i);
+		dynamicIndex()->query(makeGridRegionEnclosingCircle(globalToGrid(path.end), (path.end - path.start).length() + path.radius + margin), contacts);
+	}
+	std::sort(contacts.begin(), contacts.end());
+	contacts.erase(std::unique(contacts.begin(), contacts.end()), contacts.end());
+	for (unsigned i = 0; i < contacts.size(); ++i) {
+		LocalUnitWrapper *contact = static_cast<LocalUnitWrapper*>(contacts[i]);
+		if (!contact->unit()) continue;
+		// projectiles are not targets; they would be hit by their own paths.
+		DynamicObject *object = dynamic_cast<DynamicObject*>(contact->unit().get());
+		if (object && !dynamic_cast<Projectile*>(object)) m_HitDetection->addTarget(object);
+	}
+
+	m_HitDetection->run(dt);
+	m_HitDetection->report();
+	std::vector<HitDetection::Hit> const &hits = m_HitDetection->getHits();
+	for (unsigned i = 0; i < hits.size(); ++i) {
+		if (hits[i].query < first_projectile) continue;
+		Projectile *projectile = m_Projectiles[projectiles[hits[i].query - first_projectile]].get();
+		CSPLOG(Prio_INFO, Cat_BATTLEFIELD) << "projectile " << projectile->id() << " hit " << hits[i].target->id();
+		removeUnit(projectile->id());
+	}
+	if (m_Flyout.valid()) m_Flyout->removeHits(hits, first);
+	m_HitDetection->clear();
+}
+
 void LocalBattlefield::update(double dt) {
 	double offset = m_NetworkClient.valid() ? m_NetworkClient->getServerTimeOffset() : 0.0;
 	double filter = std::min(1.0, dt);
@@ -318,16 +396,34 @@ void LocalBattlefield::update(double dt) {
 	m_CurrentTime = getCalibratedRealTime() + m_ServerTimeOffset;
 	m_CurrentTimeStamp = getTimeStamp(m_CurrentTime);
 	if (m_NetworkClient.valid()) {
+		CSP_PROFILE_ZONE("network");
 		m_NetworkClient->processIncoming(0.01);
 	}
-	m_UnitUpdateMaster->update(dt);
+	{
+		CSP_PROFILE_ZONE("units");
+		ai::AgentScheduler &scheduler = ai::AgentScheduler::getInstance();
+		scheduler.beginFrame(dt);
+		scheduler.addObserver(m_CameraPosition);
+		m_UnitUpdateMaster->update(dt);
+	}
+	if (m_Flyout.valid()) {
+		CSP_PROFILE_ZONE("flyout");
+		std::vector<Ref<DynamicObject> > promoted;
+		m_Flyout->update(dt, m_CameraPosition, promoted);
+		for (unsigned i = 0; i < promoted.size(); ++i) {
+			addLocalUnit(promoted[i]);
+		}
+	}
+	if (m_HitDetection.valid()) detectHits(dt);
 	Battlefield::update(dt);
 	continueUnitScan(dt);
 	if (m_UnitRemoteUpdateMaster.valid()) {
+		CSP_PROFILE_ZONE("remote updates");
 		m_UpdateProxyConnection->setTimeStamp(m_CurrentTimeStamp);
 		m_UnitRemoteUpdateMaster->update(dt);
 	}
 	if (m_NetworkClient.valid()) {
+		CSP_PROFILE_ZONE("network");
 		m_NetworkClient->processOutgoing(0.01);
 	}
 }
@@ -581,7 +677,7 @@ void LocalBattlefield::assignNewId(Object const &object) {
 	_assignObjectId(object, id);
 }
 
-void LocalBattlefield::__test__addLocalHumanUnit(Unit const &unit, bool human) {
+void LocalBattlefield::addLocalUnit(Unit const &unit, bool human) {
 	assert(!unit->isStatic());
 	assert(!unit->isHuman());
 	assert(unit->id() == 0);
@@ -594,11 +690,17 @@ void LocalBattlefield::__test__addLocalHumanUnit(Unit const &unit, bool human) {
 	LocalUnitWrapper *wrapper = new LocalUnitWrapper(unit, 0);
 	addUnit(wrapper);
 
+	// units start at full fidelity; the unit scan aggregates them if they are
+	// far from the camera.
+	if (unit->isAggregated()) unit->deaggregate();
+
 	if (human) {
 		setHumanUnit(wrapper, human);
 	}
 
 	unit->registerUpdate(m_UnitUpdateMaster.get());
+	Projectile *projectile = dynamic_cast<Projectile*>(unit.get());
+	if (projectile) m_Projectiles.push_back(projectile);
 	if (isConnectionActive()) {
 		Ref<RegisterUnit> msg = new RegisterUnit();
 		msg->set_unit_id(unit->id());
@@ -734,6 +836,7 @@ void LocalBattlefield::setCamera(Vector3 const &eye_point, const Vector3& look_p
 	 * if there is no scene manager, then we ignore camera updates (which probably
 	 * shouldn't be occur anyway).
 	 */
+	m_CameraPosition = eye_point;
 	if (!m_SceneManager) return;
 
 	/**
@@ -37,6 +37,9 @@ namespace csp {
 class Client;
 class DataManager;
 class DispatchHandler;
+class Flyout;
+class HitDetection;
+class Projectile;
 class MessageQueue;
 class NetworkMessage;
 class Path;
@@ -79,8 +82,25 @@ public:
 	 */
 	void setCamera(Vector3 const &eye_point, const Vector3& look_pos, const Vector3& up_vec);
 
+	/** The camera position in global coordinates, as last set by setCamera().
+	 */
+	Vector3 const &getCameraPosition() const { return m_CameraPosition; }
+
+	/** The lightweight simulation of distant weapons, or null if disabled.
+	 */
+	Flyout *getFlyout() { return m_Flyout.get(); }
+
+	/** Add a unit created by this simulation, such as a released store or a
+	 *  flyout round promoted to a full simulation.  The unit is assigned a
+	 *  new id, updated locally, and registered with the server if connected.
+	 *
+	 *  @param unit a new, non-static unit that is not yet on the battlefield.
+	 *  @param human true if the unit is controlled by the local player.
+	 */
+	void addLocalUnit(Unit const &unit, bool human=false);
+
 	// testing interface
-	void __test__addLocalHumanUnit(Unit const &unit, bool human);
+	void __test__addLocalHumanUnit(Unit const &unit, bool human) { addLocalUnit(unit, human); }
 
 	inline bool isConnectionActive() const {
 		return m_ConnectionState == CONNECTION_ACTIVE;
@@ -151,6 +171,12 @@ private:
 
 	ScopedPointer<ObjectIdPool> m_LocalIdPool;
 
+	ScopedPointer<Flyout> m_Flyout;
+	ScopedPointer<HitDetection> m_HitDetection;
+	// local projectiles, tested by detectHits until they are removed.
+	std::vector<Ref<Projectile> > m_Projectiles;
+	Vector3 m_CameraPosition;
+
 	double m_ServerTimeOffset;
 	SimTime m_CurrentTime;
 	TimeStamp m_CurrentTimeStamp;
@@ -190,10 +216,20 @@ private:
 	// sent to peers.  Called by continueUnitScan.
 	void scanUnit(LocalUnitWrapper *wrapper);
 
+	// Switch a local agent to the low fidelity model when it is far from the
+	// camera, and back to the full model when it comes closer.  Called by
+	// scanUnit.
+	void updateAggregation(Unit const &unit);
+
 	// Continue a slow iteration through all units in the battlefield, calling
 	// scanUnit on each.  This method should be called once per time step.
 	void continueUnitScan(double dt);
 
+	// Test the paths of the flyout rounds and local projectiles against the
+	// units near each path, apply the damage of any hits, and remove the rounds
+	// and projectiles that hit.  Called by update.
+	void detectHits(double dt);
+
 	ScopedPointer<sigc::signal<void, int, const std::string&> > m_PlayerJoinSignal;
 	ScopedPointer<sigc::signal<void, int, const std::string&> > m_PlayerQuitSignal;
 };
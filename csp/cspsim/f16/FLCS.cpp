@@ -165,6 +165,10 @@ public:
 	PitchLimiterControl(): m_PitchRateDeltaFilter(0.0, 1.0, 1.0), m_GLimitFilter(4.0, 12.0, 3.0), m_RollRateFilter(0.67) { }
 	virtual void importChannels(Bus* bus);
 	virtual void link(MapID &map);
+	virtual void getInputs(std::vector<ControlNode*> &inputs) const {
+		inputs.push_back(m_FilteredAlpha.get());
+		inputs.push_back(m_FilteredGCommand.get());
+	}
 private:
 	virtual void evaluate(Timer const &timer);
 	DataChannel<double>::CRefT b_G;
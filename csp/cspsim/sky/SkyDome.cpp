@@ -35,9 +35,10 @@
 namespace csp {
 
 
-SkyDome::SkyDome(double radius): m_SkyShader(new SkyShader), m_Radius(radius), m_NextSunAzimuth(0), m_NextSunElevation(0), m_SunAzimuth(0), m_SunElevation(0), m_UpdateRow(0), m_UpdateInProgress(false), m_AverageIntensity(0) {
+SkyDome::SkyDome(double radius): m_SkyShader(new SkyShader), m_Radius(radius), m_NextSunAzimuth(0), m_NextSunElevation(0), m_SunAzimuth(0), m_SunElevation(0), m_AverageIntensity(0) {
 	buildDome();
 	m_SkyShader->setSunElevation(-0.1f); // XXX
+	m_ShadingEngine = new SkyShadingEngine(TEXSIZE, m_HorizonColors->size());
 }
 
 SkyDome::~SkyDome() {
@@ -53,23 +54,15 @@ void SkyDome::setSunPosition(double azimuth, double elevation) {
 		return;
 	}
 
-	// If we are not already updating the texture then we begin the update
-	// process using the new sun position.  Otherwise, store the sun coordinates
-	// and let the current update finish; it will automatically trigger another
-	// update using m_NextSunAzimuth and m_NextSunElevation when it completes.
-
 	m_NextSunAzimuth = azimuth;
 	m_NextSunElevation = elevation;
 
 	updateLighting(azimuth, elevation);
 
-	if (!m_UpdateInProgress && (m_NextSunElevation != m_SunAzimuth || m_NextSunElevation != m_SunElevation)) {
-		m_SunAzimuth = azimuth;
-		m_SunElevation = elevation;
-		m_SkyShader->setSunElevation(elevation);
-		m_UpdateRow = 0;
-		m_UpdateInProgress = true;
-	}
+	// Queue a new texture in the background.  If the shading engine is busy
+	// with an earlier position it will pick up these coordinates as soon as
+	// it finishes; intermediate requests are dropped.
+	m_ShadingEngine->request(azimuth, elevation);
 }
 
 void SkyDome::initSunlight(int light_num) {
@@ -84,74 +77,46 @@ void SkyDome::initSunlight(int light_num) {
 }
 
 void SkyDome::updateShading(bool force) {
-	// Only continue if there is work to be done (i.e., the sun position has
-	// changed as a result of calling setSunPosition).
-	if (!m_UpdateInProgress && !force) return;
-
-	unsigned char *shade = m_Image->data();
-
-	// Normally update one texture row per call, but if force is true generate
-	// the entire texture at once.
-	const int end = (force ? TEXSIZE : m_UpdateRow + 1);
-	for (; m_UpdateRow < end; ++m_UpdateRow) {
-		unsigned idx = (m_UpdateRow * TEXSIZE + TEXSIZE / 2) * 3;
-		double y = (m_UpdateRow - TEXSIZE/2) / (TEXSIZE/2 - 2.0);
-		for (int i = 0; i < TEXSIZE/2; ++i) {
-			double x = i / (TEXSIZE/2 - 2.0);
-			double elevation = (1.0 - sqrt(x*x + y*y)) * 0.5f * PI;
-			if (elevation >= -0.15) {
-				if (elevation < 0.0) elevation = 0.0;
-				double azimuth = atan2(x, y);
-				float intensity = 0.0f;
-				Color c = m_SkyShader->SkyColor(elevation, azimuth, intensity);
-				unsigned i0 = idx + i*3 - 1;
-				unsigned i1 = idx - i*3 - 1;
-				// TODO azimuth does not match up perfectly in the simulation; seems to be off
-				// by half a degree or so at 180 degrees azimuth.  need to double check the
-				// coordinate calculations here relative to the texture coordinates assigned
-				// in the dome creation.
-				// to debug horizon (fog) and sky texture alignment, uncomment the next two
-				// lines and comment the following to.  same in updateHorizon.
-				//shade[++i0] = shade[++i1] = static_cast<unsigned char>(255 * (int(toDegrees(azimuth)) % 2)); // XXX
-				//shade[++i0] = shade[++i1] = static_cast<unsigned char>(toDegrees(azimuth));
-				shade[++i0] = shade[++i1] = static_cast<unsigned char>(c.getA() * 255.0);
-				shade[++i0] = shade[++i1] = static_cast<unsigned char>(c.getB() * 255.0);
-				shade[++i0] = shade[++i1] = static_cast<unsigned char>(c.getC() * 255.0);
-				assert(i0 >= 2 && i0 < TEXSIZE*TEXSIZE*3);
-				assert(i1 >= 2 && i1 < TEXSIZE*TEXSIZE*3);
-				m_AverageIntensitySum += intensity;
-				++m_AverageIntensityCount;
-			}
-		}
+	if (force) {
+		applyFrame(*m_ShadingEngine->generateNow(m_NextSunAzimuth, m_NextSunElevation));
+		return;
 	}
 
-	if (m_UpdateRow == TEXSIZE) {  // texture generation complete
-		m_UpdateRow = 0;
-		m_UpdateInProgress = false;
-		m_Image->dirty();  // force reload
+	// Swap in the latest texture if the shading engine has finished one since
+	// the last call.  This never waits for the engine.
+	SkyShadingEngine::Frame const *frame = m_ShadingEngine->acquire();
+	if (frame) applyFrame(*frame);
+}
 
-		// orient the sky dome to place the sun is at the desired azimuth.  the texture
-		// map is aligned so that the sun rises from -Y to +Z at 0 azimuth, so we need
-		// to subtract 90 degrees to line up with atan(y/x).
-		if (m_DomeNode.valid()) {
-			m_DomeNode->setMatrix(osg::Matrix::rotate(m_SunAzimuth - PI_2, 0, 0, 1));
-		}
-		updateHorizon();
-
-		// update the average skydome intensity.
-		m_AverageIntensity = m_AverageIntensitySum / m_AverageIntensityCount;
-		m_AverageIntensitySum = 0.0;
-		m_AverageIntensityCount = 0;
-
-		// if the sun position has changed since we started the last update, start a
-		// new update using the most recent coordinates.
-		if (m_NextSunElevation != m_SunElevation || m_NextSunAzimuth != m_SunAzimuth) {
-			m_SunAzimuth = m_NextSunAzimuth;
-			m_SunElevation = m_NextSunElevation;
-			m_SkyShader->setSunElevation(m_SunElevation);
-			m_UpdateInProgress = true;
-		}
+void SkyDome::applyFrame(SkyShadingEngine::Frame const &frame) {
+	// The frame buffer remains valid until the next frame is acquired, so the
+	// image can reference it directly.  setImage also marks the image dirty,
+	// forcing the texture to reload.
+	// TODO azimuth does not match up perfectly in the simulation; seems to be off
+	// by half a degree or so at 180 degrees azimuth.  need to double check the
+	// coordinate calculations in SkyShadingEngine relative to the texture
+	// coordinates assigned in the dome creation.
+	m_Image->setImage(TEXSIZE, TEXSIZE, 1, GL_RGB, GL_RGB, GL_UNSIGNED_BYTE, const_cast<unsigned char*>(&frame.sky[0]), osg::Image::NO_DELETE);
+
+	m_SunAzimuth = frame.azimuth;
+	m_SunElevation = frame.elevation;
+
+	// orient the sky dome to place the sun is at the desired azimuth.  the texture
+	// map is aligned so that the sun rises from -Y to +Z at 0 azimuth, so we need
+	// to subtract 90 degrees to line up with atan(y/x).
+	if (m_DomeNode.valid()) {
+		m_DomeNode->setMatrix(osg::Matrix::rotate(m_SunAzimuth - PI_2, 0, 0, 1));
+	}
+
+	// update the horizon color texture, which can be used to shade the fog.
+	const unsigned n = m_HorizonColors->size();
+	for (unsigned i = 0; i < n; ++i) {
+		(*m_HorizonColors)[i].set(frame.horizon_colors[3*i+0], frame.horizon_colors[3*i+1], frame.horizon_colors[3*i+2], 1.0f);
 	}
+	std::copy(frame.horizon.begin(), frame.horizon.end(), m_HorizonImage->data());
+	m_HorizonImage->dirty();  // force reload
+
+	m_AverageIntensity = frame.average_intensity;
 }
 
 void SkyDome::buildDome() {
@@ -262,30 +227,6 @@ void SkyDome::buildDome() {
 	m_HorizonTexture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
 }
 
-void SkyDome::updateHorizon() {
-	unsigned n = m_HorizonColors->size();
-	unsigned char *shade = m_HorizonImage->data();
-	double da = PI / (n - 1);
-	unsigned index = 0;
-	for (unsigned j = 0; j < 4; ++j) {
-		double azimuth = 0.0;
-		for (unsigned i = 0 ; i < n; ++i) {
-			float intensity;
-			Color c = m_SkyShader->SkyColor(j * toRadians(1.0), azimuth, intensity);
-			if (j == 0) (*m_HorizonColors)[i] = osg::Vec4(c.getA(), c.getB(), c.getC(), 1.0);
-			// to debug horizon (fog) and sky texture alignment, uncomment the next two
-			// lines and comment the following to.  same in updateShading.
-			//shade[index++] = static_cast<unsigned char>(255 * (int(toDegrees(azimuth)) % 2)); // XXX
-			//shade[index++] = static_cast<unsigned char>(toDegrees(azimuth));
-			shade[index++] = static_cast<unsigned char>(c.getA() * 255.0);
-			shade[index++] = static_cast<unsigned char>(c.getB() * 255.0);
-			shade[index++] = static_cast<unsigned char>(c.getC() * 255.0);
-			azimuth += da;
-		}
-	}
-	m_HorizonImage->dirty();  // force reload
-}
-
 void SkyDome::updateLighting(double azimuth, double elevation) {
 	if (!m_Sunlight) return;
 
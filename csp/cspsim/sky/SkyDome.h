@@ -18,9 +18,11 @@
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include <osg/Array>
+#include <csp/csplib/util/Ref.h>
 #include <csp/csplib/util/Referenced.h>
 #include <csp/csplib/util/ScopedPointer.h>
 #include <csp/cspsim/Export.h>
+#include <csp/cspsim/sky/SkyShadingEngine.h>
 
 namespace osg { class Geometry; }
 namespace osg { class Image; }
@@ -45,10 +47,10 @@ class SkyShader;
  */
 class CSPSIM_EXPORT SkyDome: public Referenced {
 
-	// The size of the sky dome texture.  Also the number of frame across
-	// which updates are spread.  Assuming 50 fps a 256 pixel texture
-	// requires about 5 seconds to update, which is fast enough to provide
-	// smooth shading transitions at sunrise/sunset.
+	// The size of the sky dome texture.  The texture is generated in a
+	// background thread by SkyShadingEngine; a full update takes a few
+	// milliseconds, so the shading keeps up with the sun even at high
+	// time compression.
 	//enum { TEXSIZE = 256 };
 	enum { TEXSIZE = 512 };
 
@@ -94,8 +96,10 @@ public:
 	 * Update the sky color texture and lighting.  This method should be called
 	 * once per frame.  Texture and lighting updates are only performed if the
 	 * sun position has changed appreciably since the last update or if force
-	 * is true.  When force is false, updates are spread across TEXSIZE calls
-	 * to prevent long frames.
+	 * is true.  When force is false, the texture is generated in a background
+	 * thread and swapped in by the first call after it completes, so this
+	 * method never blocks.  When force is true the texture is generated
+	 * immediately in the calling thread.
 	 */
 	void updateShading(bool force=false);
 
@@ -119,10 +123,10 @@ private:
 	 */
 	void updateLighting(double azimuth, double elevation);
 
-	/** Update the horizon color texture, which can be used to shade the
-	 *  fog.  Called by updateShading.
+	/** Bind a completed texture frame to the dome and update the horizon
+	 *  colors, dome orientation, and average intensity to match.
 	 */
-	void updateHorizon();
+	void applyFrame(SkyShadingEngine::Frame const &frame);
 
 	osg::ref_ptr<osg::Geometry> m_Dome;
 	osg::ref_ptr<osg::Image> m_Image;
@@ -130,29 +134,26 @@ private:
 	osg::ref_ptr<osg::Vec2Array> m_TexCoords;
 	osg::ref_ptr<osg::MatrixTransform> m_DomeNode;
 
-	// the sky texture generator
+	// the sky texture generator (used for lighting in the main thread)
 	ScopedPointer<SkyShader> m_SkyShader;
 
+	// background generator for the sky and horizon textures
+	Ref<SkyShadingEngine> m_ShadingEngine;
+
 	// dome geometry
 	double m_Radius;
 	unsigned m_Segments;
 	unsigned m_Slices;
 	std::vector<float> m_Elevations;
 
-	// incremental sun position updates
+	// sun position of the most recent request, and of the displayed texture
 	double m_NextSunAzimuth;
 	double m_NextSunElevation;
 	double m_SunAzimuth;
 	double m_SunElevation;
 
-	// incremental texture updates
-	int m_UpdateRow;
-	bool m_UpdateInProgress;
-
 	// average light intensity across the dome
 	double m_AverageIntensity;
-	double m_AverageIntensitySum;
-	double m_AverageIntensityCount;
 
 	// track horizon colors separately for fog shading
 	osg::ref_ptr<osg::Vec4Array> m_HorizonColors;
@@ -300,5 +300,86 @@ Color SkyShader::SkyColor(float elevation, float azimuth, float &intensity) {
 	return rgb;
 }
 
+void SkyShader::SkyColors(int n, float const *elevation, float const *azimuth, float *rgb, float *intensity) {
+	if (m_Dirty) _computeBase();
+
+	// process the points in fixed size blocks so that the temporaries stay
+	// in L1 cache.  each pass below is a simple loop over contiguous arrays
+	// without branches or calls into other translation units.
+	enum { BLOCK = 64 };
+	float cos_theta[BLOCK];
+	float gamma[BLOCK];
+	float dot[BLOCK];
+	float Y[BLOCK];
+
+	const float zx = m_PerezFactor.x * m_Zenith.getA();
+	const float zy = m_PerezFactor.y * m_Zenith.getB();
+	const float zY = m_PerezFactor.Y * m_Zenith.getC();
+	coeff const &cx = m_Coefficients.x;
+	coeff const &cy = m_Coefficients.y;
+	coeff const &cY = m_Coefficients.Y;
+	const float dark = m_DarkAdjustment;
+	const float dark_r = m_DarkSkyColor.getA() * dark;
+	const float dark_g = m_DarkSkyColor.getB() * dark;
+	const float dark_b = m_DarkSkyColor.getC() * dark;
+
+	for (int base = 0; base < n; base += BLOCK) {
+		const int m = std::min(static_cast<int>(BLOCK), n - base);
+		float const *elev = elevation + base;
+		float const *azim = azimuth + base;
+		float *out = rgb + 3 * base;
+
+		// geometry: angle from the zenith and angle to the sun.  the sun vector
+		// has no x component (see _computeBase).
+		for (int i = 0; i < m; ++i) {
+			const float theta = static_cast<float>(0.5*PI) - elev[i];
+			const float A = azim[i] + m_AzimuthCorrection;
+			const float d = cosf(A) * sinf(theta) * m_SunVector[1] + cosf(theta) * m_SunVector[2];
+			dot[i] = std::min(1.0f, std::max(-1.0f, d));
+			cos_theta[i] = fabsf(cosf(std::min(theta, 1.5708f))) + 0.09f;
+		}
+		for (int i = 0; i < m; ++i) {
+			gamma[i] = acosf(dot[i]);
+		}
+
+		// perez function for each of the three color components (see FasterF).
+		for (int i = 0; i < m; ++i) {
+			const float ct = cos_theta[i];
+			const float g = gamma[i];
+			const float d2 = dot[i] * dot[i];
+			const float x = zx * (1.0f + cx[0]*expf(cx[1]/ct)) * (1.0f + cx[2]*expf(cx[3]*g) + cx[4]*d2);
+			const float y = zy * (1.0f + cy[0]*expf(cy[1]/ct)) * (1.0f + cy[2]*expf(cy[3]*g) + cy[4]*d2);
+			const float L = zY * (1.0f + cY[0]*expf(cY[1]/ct)) * (1.0f + cY[2]*expf(cY[3]*g) + cY[4]*d2);
+			out[3*i+0] = x;
+			out[3*i+1] = y;
+			Y[i] = std::max(0.0f, 0.3f * logf(1.0f + L));  // CUSTOM_EYE
+		}
+
+		// xyY -> XYZ -> RGB709, normalized to the target luminance.
+		for (int i = 0; i < m; ++i) {
+			const float x = out[3*i+0];
+			const float y = out[3*i+1];
+			const float X = std::max(0.0f, x / y);
+			const float Z = std::max(0.0f, (1.0f - x - y) / y);
+			float r =  3.240479f*X - 1.537150f - 0.498535f*Z;
+			float g = -0.969256f*X + 1.875992f + 0.041556f*Z;
+			float b =  0.055648f*X - 0.204043f + 1.057311f*Z;
+			const float f = std::min(1.0f, Y[i]) / (0.212671f*r + 0.71516f*g + 0.072169f*b);
+			r = std::min(1.0f, std::max(0.0f, f * r));
+			g = std::min(1.0f, std::max(0.0f, f * g));
+			b = std::min(1.0f, std::max(0.0f, f * b));
+			if (dark > 0.0f) {
+				r = std::min(1.0f, std::max(0.0f, r + dark_r));
+				g = std::min(1.0f, std::max(0.0f, g + dark_g));
+				b = std::min(1.0f, std::max(0.0f, b + dark_b));
+			}
+			out[3*i+0] = r;
+			out[3*i+1] = g;
+			out[3*i+2] = b;
+			intensity[base + i] = Y[i];
+		}
+	}
+}
+
 } // namespace csp
 
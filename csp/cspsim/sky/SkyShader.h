@@ -60,6 +60,20 @@ public:
 	 */
 	Color SkyColor(float elevation, float azimuth, float &intensity);
 
+	/**
+	 * Compute the sky color at n points using the current sun elevation.
+	 * Equivalent to calling SkyColor for each point, but the work is split
+	 * into passes over contiguous arrays that the compiler can vectorize.
+	 * Used to generate the sky dome texture one row at a time.
+	 *
+	 * @param n the number of points.
+	 * @param elevation n elevations above the horizon in radians.
+	 * @param azimuth n azimuthal angles relative to the sun in radians.
+	 * @param rgb returns 3*n interleaved RGB components in the range [0, 1].
+	 * @param intensity returns n unnormalized cie luminance values (Y).
+	 */
+	void SkyColors(int n, float const *elevation, float const *azimuth, float *rgb, float *intensity);
+
 protected:
 
 	typedef float coeff[5];
@@ -0,0 +1,185 @@
+// Combat Simulator Project
+// Copyright (C) 2006 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include <csp/cspsim/sky/SkyShadingEngine.h>
+#include <csp/cspsim/sky/SkyShader.h>
+#include <csp/csplib/util/Log.h>
+#include <csp/csplib/util/Math.h>
+
+#include <cassert>
+
+namespace csp {
+
+
+class SkyShadingEngine::Worker: public Task {
+public:
+	Worker(SkyShadingEngine *engine): m_Engine(engine) { }
+protected:
+	virtual void run() { m_Engine->serve(); }
+private:
+	SkyShadingEngine *m_Engine;
+};
+
+
+SkyShadingEngine::SkyShadingEngine(int texsize, int horizon_samples):
+	m_Exchange(1),
+	m_Front(0),
+	m_Back(2),
+	m_TexSize(texsize),
+	m_HorizonSamples(horizon_samples),
+	m_RequestAzimuth(0.0),
+	m_RequestElevation(0.0),
+	m_HasRequest(false),
+	m_Shutdown(false),
+	m_WorkerShader(new SkyShader),
+	m_LocalShader(new SkyShader)
+{
+	for (unsigned i = 0; i < 3; ++i) allocate(m_Frames[i]);
+	m_Thread.start(new Worker(this));
+}
+
+SkyShadingEngine::~SkyShadingEngine() {
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Shutdown = true;
+	}
+	m_Wakeup.notify_one();
+	m_Thread.join();
+}
+
+void SkyShadingEngine::allocate(Frame &frame) {
+	// texels below the dome are never shaded, so start with the same fill
+	// value that SkyDome uses for the initial texture.
+	frame.sky.assign(m_TexSize * m_TexSize * 3, 255);
+	frame.horizon.assign(m_HorizonSamples * 4 * 3, 0);
+	frame.horizon_colors.assign(m_HorizonSamples * 3, 0.0f);
+	frame.azimuth = 0.0;
+	frame.elevation = 0.0;
+	frame.average_intensity = 0.0;
+}
+
+void SkyShadingEngine::request(double azimuth, double elevation) {
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_RequestAzimuth = azimuth;
+		m_RequestElevation = elevation;
+		m_HasRequest = true;
+	}
+	m_Wakeup.notify_one();
+}
+
+SkyShadingEngine::Frame const *SkyShadingEngine::acquire() {
+	if ((m_Exchange.load(std::memory_order_relaxed) & FRESH) == 0) return 0;
+	const unsigned middle = m_Exchange.exchange(m_Front, std::memory_order_acq_rel);
+	m_Front = middle & ~static_cast<unsigned>(FRESH);
+	return &m_Frames[m_Front];
+}
+
+SkyShadingEngine::Frame const *SkyShadingEngine::generateNow(double azimuth, double elevation) {
+	// pick up any frame completed by the worker first so that a stale
+	// frame does not replace this one on the next call to acquire.
+	acquire();
+	shade(*m_LocalShader, m_Frames[m_Front], azimuth, elevation);
+	return &m_Frames[m_Front];
+}
+
+void SkyShadingEngine::serve() {
+	for (;;) {
+		double azimuth, elevation;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Wakeup.wait(lock, [this]() { return m_HasRequest || m_Shutdown; });
+			if (m_Shutdown) break;
+			azimuth = m_RequestAzimuth;
+			elevation = m_RequestElevation;
+			m_HasRequest = false;
+		}
+		shade(*m_WorkerShader, m_Frames[m_Back], azimuth, elevation);
+		// publish the finished frame and take over the old middle slot.
+		const unsigned middle = m_Exchange.exchange(m_Back | FRESH, std::memory_order_acq_rel);
+		m_Back = middle & ~static_cast<unsigned>(FRESH);
+	}
+	CSPLOG(Prio_DEBUG, Cat_SCENE) << "sky shading engine stopped";
+}
+
+void SkyShadingEngine::shade(SkyShader &shader, Frame &frame, double azimuth, double elevation) {
+	const int half = m_TexSize / 2;
+	shader.setSunElevation(static_cast<float>(elevation));
+
+	std::vector<float> elev(half);
+	std::vector<float> azim(half);
+	std::vector<float> rgb(half * 3);
+	std::vector<float> intensity(half);
+
+	unsigned char *texels = &frame.sky[0];
+	double intensity_sum = 0.0;
+	int intensity_count = 0;
+
+	// each row is symmetric about the sun meridian, so only the right half is
+	// shaded and the result is mirrored into the left half.
+	for (int row = 0; row < m_TexSize; ++row) {
+		const double y = (row - half) / (half - 2.0);
+		int n = 0;
+		for (int i = 0; i < half; ++i) {
+			const double x = i / (half - 2.0);
+			const double e = (1.0 - sqrt(x*x + y*y)) * 0.5f * PI;
+			if (e < -0.15) break;  // elevation decreases monotonically with i
+			elev[i] = static_cast<float>(std::max(0.0, e));
+			azim[i] = static_cast<float>(atan2(x, y));
+			++n;
+		}
+		if (n == 0) continue;
+		shader.SkyColors(n, &elev[0], &azim[0], &rgb[0], &intensity[0]);
+		const unsigned idx = (row * m_TexSize + half) * 3;
+		for (int i = 0; i < n; ++i) {
+			const unsigned i0 = idx + i*3;
+			const unsigned i1 = idx - i*3;
+			assert(i0 + 2 < static_cast<unsigned>(m_TexSize*m_TexSize*3));
+			texels[i0+0] = texels[i1+0] = static_cast<unsigned char>(rgb[3*i+0] * 255.0f);
+			texels[i0+1] = texels[i1+1] = static_cast<unsigned char>(rgb[3*i+1] * 255.0f);
+			texels[i0+2] = texels[i1+2] = static_cast<unsigned char>(rgb[3*i+2] * 255.0f);
+			intensity_sum += intensity[i];
+		}
+		intensity_count += n;
+	}
+
+	// horizon colors at 0-3 degrees elevation for fog shading; see
+	// SkyDome::getHorizonColor.
+	const int hn = m_HorizonSamples;
+	const double da = PI / (hn - 1);
+	std::vector<float> helev(hn);
+	std::vector<float> hazim(hn);
+	std::vector<float> hrgb(hn * 3);
+	std::vector<float> hintensity(hn);
+	for (int i = 0; i < hn; ++i) hazim[i] = static_cast<float>(i * da);
+	unsigned index = 0;
+	for (int j = 0; j < 4; ++j) {
+		std::fill(helev.begin(), helev.end(), static_cast<float>(j * toRadians(1.0)));
+		shader.SkyColors(hn, &helev[0], &hazim[0], &hrgb[0], &hintensity[0]);
+		if (j == 0) std::copy(hrgb.begin(), hrgb.end(), frame.horizon_colors.begin());
+		for (int i = 0; i < hn * 3; ++i) {
+			frame.horizon[index++] = static_cast<unsigned char>(hrgb[i] * 255.0f);
+		}
+	}
+
+	frame.azimuth = azimuth;
+	frame.elevation = elevation;
+	frame.average_intensity = intensity_count > 0 ? intensity_sum / intensity_count : 0.0;
+}
+
+} // namespace csp
@@ -0,0 +1,130 @@
+#pragma once
+// Combat Simulator Project
+// Copyright (C) 2006 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include <csp/csplib/thread/Thread.h>
+#include <csp/csplib/util/Referenced.h>
+#include <csp/csplib/util/ScopedPointer.h>
+#include <csp/cspsim/Export.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace csp {
+
+class SkyShader;
+
+/**
+ * Generates the sky dome and horizon textures in a background thread.
+ *
+ * The engine owns its own SkyShader, so shading never touches state used
+ * by the rendering thread.  Completed frames are passed to the caller
+ * through a lock-free triple buffer: the worker always has a private frame
+ * to write into, the most recently completed frame waits in the middle
+ * slot, and the caller holds the frame that is currently displayed.
+ * Swapping frames is a single atomic exchange on either side, so neither
+ * thread ever blocks the other.
+ *
+ * Sun position requests are coalesced; if several requests arrive while a
+ * frame is being generated only the last one is rendered next.
+ */
+class CSPSIM_EXPORT SkyShadingEngine: public Referenced {
+public:
+	/** The output of one shading pass.  All buffers are RGB, 8 bits per
+	 *  component, in the layouts expected by SkyDome.
+	 */
+	struct Frame {
+		std::vector<unsigned char> sky;
+		std::vector<unsigned char> horizon;
+		std::vector<float> horizon_colors;
+		double azimuth;
+		double elevation;
+		double average_intensity;
+	};
+
+	/** Construct the engine and start the worker thread.
+	 *
+	 *  @param texsize the width and height of the (square) sky texture.
+	 *  @param horizon_samples the number of azimuthal samples in each of the
+	 *    four rows of the horizon texture.
+	 */
+	SkyShadingEngine(int texsize, int horizon_samples);
+
+	/** Request a new frame for the specified sun position.  Returns
+	 *  immediately.  Angles are as for SkyDome::setSunPosition.
+	 */
+	void request(double azimuth, double elevation);
+
+	/** Get the most recently completed frame, if it has not been retrieved
+	 *  already.  The returned frame remains valid and unmodified until the
+	 *  next call to acquire() that returns non-null.
+	 *
+	 *  @return the new frame, or NULL if no new frame is available.
+	 */
+	Frame const *acquire();
+
+	/** Generate a frame synchronously in the calling thread and make it the
+	 *  current frame (as if returned by acquire).  Used for forced updates,
+	 *  e.g. the first frame.
+	 */
+	Frame const *generateNow(double azimuth, double elevation);
+
+private:
+	~SkyShadingEngine();
+
+	class Worker;
+	friend class Worker;
+
+	/** Shade a complete frame using the specified shader.  Thread safe
+	 *  provided each thread uses its own shader and frame.
+	 */
+	void shade(SkyShader &shader, Frame &frame, double azimuth, double elevation);
+
+	void allocate(Frame &frame);
+
+	/** Worker thread loop: wait for requests and publish completed frames.
+	 */
+	void serve();
+
+	// triple buffer state.  m_Exchange holds the index of the middle slot,
+	// plus the FRESH bit if it holds a frame not yet seen by the caller.
+	enum { FRESH = 4 };
+	Frame m_Frames[3];
+	std::atomic<unsigned> m_Exchange;
+	unsigned m_Front;
+	unsigned m_Back;
+
+	const int m_TexSize;
+	const int m_HorizonSamples;
+
+	// requests from the main thread.
+	std::mutex m_Mutex;
+	std::condition_variable m_Wakeup;
+	double m_RequestAzimuth;
+	double m_RequestElevation;
+	bool m_HasRequest;
+	bool m_Shutdown;
+
+	ScopedPointer<SkyShader> m_WorkerShader;
+	ScopedPointer<SkyShader> m_LocalShader;
+	Thread m_Thread;
+};
+
+} // namespace csp
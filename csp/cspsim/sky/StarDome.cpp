@@ -18,189 +18,159 @@
 
 #include "csp/cspsim/sky/StarDome.h"
 #include "csp/cspsim/sky/Stars.h"
+#include "csp/cspsim/Shader.h"
+#include "csp/csplib/util/Log.h"
 #include "csp/csplib/util/Math.h"
 
 #include <osg/Depth>
 #include <osg/Geode>
-#include <osg/Geometry>
 #include <osg/Image>
+#include <osg/Program>
+#include <osg/State>
 #include <osg/Texture2D>
 #include <osg/BlendFunc>
+#include <osg/Uniform>
 #include <osgDB/ReadFile>
+#include <osgUtil/CullVisitor>
 
-#include <iostream>  // debugging only
+#include <algorithm>
+#include <cmath>
 
 namespace csp {
 
 static const char *StarFlareImage = "sky/star-flare.png";
 
-struct StarDome::Star {
-	float nx, ny, nz;  // normal
-	float cr, cg, cb, ca;  // color
-	float px, py, pz;  // position
-};
-
+namespace {
+
+// Vertex attribute locations of the star shaders.  These are the locations
+// that OSG uses for the osg_* aliases when vertex attribute aliasing is
+// enabled, so the arrays are bound the same way with or without aliasing.
+enum { VertexLocation = 0, ColorLocation = 3, MagnitudeLocation = 6, TexCoordLocation = 8 };
+
+// Apply one of the star shaders, binding its inputs and output to fixed
+// locations.  Returns false if the shader could not be loaded.
+bool applyStarShader(std::string const &effect, osg::StateSet *ss) {
+	if (!Shader::instance()->applyShader(effect, ss)) return false;
+	osg::Program *program = static_cast<osg::Program*>(ss->getAttribute(osg::StateAttribute::PROGRAM));
+	program->addBindAttribLocation("osg_Vertex", VertexLocation);
+	program->addBindAttribLocation("osg_Color", ColorLocation);
+	program->addBindAttribLocation("osg_MultiTexCoord0", TexCoordLocation);
+	program->addBindAttribLocation("magnitude", MagnitudeLocation);
+	program->addBindFragDataLocation("frag_color", 0);
+	return true;
+}
 
-class StarDome::BrightStar {
+// Sets the model view projection matrix of the star shaders during culling,
+// so that the viewer does not have to provide osg_ModelViewProjectionMatrix
+// to every shader.  The scene cameras don't compute near/far, so the cull
+// projection is the one used to draw.
+class ModelViewProjectionCallback: public osg::NodeCallback {
 public:
-	BrightStar(osg::Texture2D *texture, osg::Vec3 const &position, double angle, double magnitude) {
-		// mag +3 stars just beginning to flare at sky mag +6
-		m_Attenuation = pow(10.0, -3.0 - magnitude);
-		m_LastAlpha = 0.0;
-		makeImposter(texture, position, angle);
-	}
-
-	void update(double sky_alpha_scaling) {
-		// TODO the apparent brightness on the monitor is different for the single-pixel
-		// alpha scale and the flare alpha scale --- these should be normalized to produce
-		// a more linear apparent brightness.
-		double alpha = clampTo(sky_alpha_scaling * m_Attenuation, 0.0, 1.0);
-		if (fabs(alpha - m_LastAlpha) < (2.0 / 255.0)) return;
-		osg::Vec4Array *colors = dynamic_cast<osg::Vec4Array*>(m_Imposter->getColorArray());
-		assert(colors);
-		(*colors)[0] = osg::Vec4(1, 1, 1, alpha);
-		m_Imposter->dirtyDisplayList();
+	ModelViewProjectionCallback(osg::Uniform *uniform): m_Uniform(uniform) { }
+	virtual void operator()(osg::Node *node, osg::NodeVisitor *nv) {
+		osgUtil::CullVisitor *cv = dynamic_cast<osgUtil::CullVisitor*>(nv);
+		if (cv) m_Uniform->set(osg::Matrixf(*cv->getModelViewMatrix() * *cv->getProjectionMatrix()));
+		traverse(node, nv);
 	}
-
-	void updateViewAngle(double angle) {
-		osg::Vec2Array *tcoords = dynamic_cast<osg::Vec2Array*>(m_Imposter->getTexCoordArray(0));
-		assert(tcoords);
-		double view_scaling = std::max(0.5, 40.0 / angle);
-		float a = 0.5f + static_cast<float>(view_scaling);
-		float b = 1.0f - a;
-		(*tcoords)[0].set(b, a);
-		(*tcoords)[1].set(b, b);
-		(*tcoords)[2].set(a, b);
-		(*tcoords)[3].set(a, a);
-		m_Imposter->dirtyDisplayList();
-	}
-
-	osg::Geometry* getImposter() { return m_Imposter.get(); }
-
 private:
-	void makeImposter(osg::Texture2D *texture, osg::Vec3 const &position, double angle) {
-		osg::Vec3 norm = -position;
-		float r = norm.normalize();
-		osg::Vec3 right = position ^ osg::Vec3(0, 0, 1);
-		osg::Vec3 up = right ^ position;
-		right.normalize();
-		up.normalize();
-		double size = 0.5 * angle * r;
-
-		osg::Vec3Array *coords = new osg::Vec3Array(4);
-		(*coords)[0] = position + (up - right) * size;
-		(*coords)[1] = position + (-up - right) * size;
-		(*coords)[2] = position + (right - up) * size;
-		(*coords)[3] = position + (up + right) * size;
-
-		osg::Vec2Array* tcoords = new osg::Vec2Array(4);
-		(*tcoords)[0].set(0.0f, 1.0f);
-		(*tcoords)[1].set(0.0f, 0.0f);
-		(*tcoords)[2].set(1.0f, 0.0f);
-		(*tcoords)[3].set(1.0f, 1.0f);
-
-		osg::Vec4Array* colors = new osg::Vec4Array(1);
-		(*colors)[0].set(1.0f, 1.0f, 1.0f, 0.0f);
-
-		osg::Vec3Array* norms = new osg::Vec3Array(1);
-		(*norms)[0] = norm;
-
-		osg::Geometry *geometry = new osg::Geometry;
-		geometry->setNormalArray(norms);
-		geometry->setNormalBinding(osg::Geometry::BIND_OVERALL);
-		geometry->setVertexArray(coords);
-		geometry->setTexCoordArray(0, tcoords);
-		geometry->setColorArray(colors);
-		geometry->setColorBinding(osg::Geometry::BIND_OVERALL);
-		geometry->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::QUADS, 0, 4));
-
-		osg::StateSet *ss = geometry->getOrCreateStateSet();
-		ss->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
-		ss->setTextureAttributeAndModes(0, texture, osg::StateAttribute::ON);
-		ss->setAttributeAndModes(new osg::BlendFunc(osg::BlendFunc::SRC_ALPHA, osg::BlendFunc::ONE), osg::StateAttribute::ON);
-
-		// adjust the z range slightly so that imposters such as the moon occlude
-		// stars, which are drawn at the same depth on the skydome.
-		ss->setAttributeAndModes(new osg::Depth(osg::Depth::LESS, 0.1, 1.0, false), osg::StateAttribute::ON);
-
-		m_Imposter = geometry;
-	}
-
-	osg::ref_ptr<osg::Geometry> m_Imposter;
-	double m_Attenuation;
-	double m_LastAlpha;
+	osg::ref_ptr<osg::Uniform> m_Uniform;
 };
 
+// Opacity of a star of the given magnitude against the sky; stars as
+// bright as the sky magnitude are just visible.  The shaders compute the
+// same value.
+inline float starAlpha(double sky_magnitude, double magnitude) {
+	return static_cast<float>(clampTo((10.0 / 255.0) * pow(10.0, sky_magnitude - magnitude), 0.0, 1.0));
+}
+
+} // namespace
 
-StarDome::StarDome(double radius): m_Radius(radius) {
-	m_Stars = new Star[cNumStars];
 
-	m_BrightStars = new std::vector<BrightStar>;
-	m_BrightStars->reserve(100);
+StarDome::StarDome(double radius): m_Radius(radius), m_SkyMagnitude(4.0), m_ColorSkyMagnitude(4.0), m_FixedFunction(false) {
+	m_SkyMagnitudeUniform = new osg::Uniform("sky_magnitude", static_cast<float>(m_SkyMagnitude));
+	m_FlareScale = new osg::Uniform("flare_scale", 0.5f);
+	m_ModelViewProjection = new osg::Uniform(osg::Uniform::FLOAT_MAT4, "model_view_projection");
+	m_ModelViewProjection->setDataVariance(osg::Object::DYNAMIC);
 
 	osg::ref_ptr<osg::Image> image = osgDB::readImageFile(StarFlareImage);
-	osg::ref_ptr<osg::Texture2D> bright_texture;
 	double flare_angular_size = 0.0;
 	if (image.valid()) {
-		bright_texture = new osg::Texture2D(image.get());
-		bright_texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_BORDER);
-		bright_texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_BORDER);
-		bright_texture->setBorderColor(osg::Vec4(0.0, 0.0, 0.0, 0.0));
+		osg::Texture2D *texture = new osg::Texture2D(image.get());
+		texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_BORDER);
+		texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_BORDER);
+		texture->setBorderColor(osg::Vec4(0.0, 0.0, 0.0, 0.0));
 		flare_angular_size = 1.2 * toRadians(image->s() / 64.0);
+
+		m_Flares = new osg::Geometry;
+		m_FlareMagnitudes = new osg::FloatArray;
+		osg::Vec2Array *tcoords = new osg::Vec2Array;
+		m_Flares->setVertexArray(new osg::Vec3Array);
+		m_Flares->setTexCoordArray(0, tcoords);
+		m_Flares->setColorArray(new osg::Vec4Array);
+		m_Flares->setColorBinding(osg::Geometry::BIND_PER_VERTEX);
+		m_Flares->setVertexAttribArray(TexCoordLocation, tcoords);
+		m_Flares->setVertexAttribBinding(TexCoordLocation, osg::Geometry::BIND_PER_VERTEX);
+		m_Flares->setVertexAttribArray(MagnitudeLocation, m_FlareMagnitudes.get());
+		m_Flares->setVertexAttribBinding(MagnitudeLocation, osg::Geometry::BIND_PER_VERTEX);
+		m_Flares->addPrimitiveSet(new osg::DrawElementsUShort(osg::PrimitiveSet::TRIANGLES));
+		m_Flares->setUseDisplayList(false);
+		m_Flares->setUseVertexBufferObjects(true);
+
+		osg::StateSet *ss = m_Flares->getOrCreateStateSet();
+		ss->setTextureAttributeAndModes(0, texture, osg::StateAttribute::ON);
+		ss->setAttributeAndModes(new osg::BlendFunc(osg::BlendFunc::SRC_ALPHA, osg::BlendFunc::ONE), osg::StateAttribute::ON);
+		if (!applyStarShader("star-flare", ss)) m_FixedFunction = true;
 	} else {
 		CSPLOG(Prio_ERROR, Cat_SCENE) << "Unable to load " << StarFlareImage;
 	}
 
+	osg::Vec3Array *coords = new osg::Vec3Array(cNumStars);
+	osg::Vec4Array *colors = new osg::Vec4Array(cNumStars);
+	m_Magnitudes = new osg::FloatArray(cNumStars);
 	for (unsigned i = 0; i < cNumStars; ++i) {
 		const float *source = cStarCatalog[i];
 		const double magnitude = source[3];
-		initStar(m_Stars[i], source);
-		if (magnitude < 3.0 && bright_texture.valid()) {
-			osg::Vec3 position(m_Stars[i].px, m_Stars[i].py, m_Stars[i].pz);
-			m_BrightStars->push_back(BrightStar(bright_texture.get(), position, flare_angular_size, magnitude));
+		initStar((*coords)[i], (*colors)[i], source);
+		(*m_Magnitudes)[i] = magnitude;
+		if (magnitude < 3.0 && m_Flares.valid()) {
+			addFlare((*coords)[i], flare_angular_size, magnitude);
 		}
 	}
-	m_SkyMagnitude = 4.0;
+	// the vertex array is attribute 0 (osg_Vertex) in any case, but the
+	// colors are only passed to osg_Color as a generic attribute.
+	setVertexArray(coords);
+	setColorArray(colors);
+	setColorBinding(osg::Geometry::BIND_PER_VERTEX);
+	setVertexAttribArray(ColorLocation, colors);
+	setVertexAttribBinding(ColorLocation, osg::Geometry::BIND_PER_VERTEX);
+	setVertexAttribArray(MagnitudeLocation, m_Magnitudes.get());
+	setVertexAttribBinding(MagnitudeLocation, osg::Geometry::BIND_PER_VERTEX);
+	addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::POINTS, 0, cNumStars));
+	// the arrays only change when drawing without shaders, so upload them once.
+	setUseDisplayList(false);
+	setUseVertexBufferObjects(true);
+	if (!applyStarShader("stars", getOrCreateStateSet())) m_FixedFunction = true;
+	updateColors();
 }
 
 
 StarDome::~StarDome() {
-	delete[] m_Stars;
-	delete m_BrightStars;
 }
 
-StarDome::StarDome(const StarDome &copy, const osg::CopyOp &copyop): osg::Drawable(copy, copyop), m_Radius(copy.m_Radius) {
+StarDome::StarDome(const StarDome &copy, const osg::CopyOp &copyop): osg::Geometry(copy, copyop), m_Radius(copy.m_Radius) {
 	assert(0);
 }
 
-void StarDome::drawImplementation(osg::RenderInfo&) const {
-	const double atten = (10.0 / 255.0) * pow(10.0, m_SkyMagnitude);
-	glPushAttrib(GL_ENABLE_BIT);
-	glPushMatrix();
-	glEnable(GL_BLEND);
-	glBegin(GL_POINTS);
-	for (unsigned i = 0; i < cNumStars; ++i) {
-		const Star& star = m_Stars[i];
-		glNormal3f(star.nx, star.ny, star.nz);
-		glColor4f(star.cr, star.cg, star.cb, std::min(1.0, star.ca * atten));
-		glVertex3f(star.px, star.py, star.pz);
-	}
-	glEnd();
-	glPopMatrix();
-	glPopAttrib();
-}
-
-osg::BoundingBox StarDome::computeBoundingBox() const {
-	osg::BoundingBox bbox;
-	bbox._min = osg::Vec3(-m_Radius, -m_Radius, -m_Radius);
-	bbox._max = osg::Vec3(m_Radius, m_Radius, m_Radius);
-	return bbox;
+void StarDome::setViewAngle(double angle) {
+	m_FlareScale->set(static_cast<float>(std::max(0.5, 40.0 / angle)));
 }
 
-void StarDome::setViewAngle(double angle) {
-	for (unsigned i = 0; i < m_BrightStars->size(); ++i) {
-		(*m_BrightStars)[i].updateViewAngle(angle);
-	}
+void StarDome::drawImplementation(osg::RenderInfo &info) const {
+	// if the stars shader failed to compile or link, osg draws the stars
+	// with the fixed function pipeline; updateLighting then maintains the
+	// alpha of the star colors.
+	if (!info.getState()->getLastAppliedProgramObject()) m_FixedFunction = true;
+	osg::Geometry::drawImplementation(info);
 }
 
 void StarDome::updateLighting(double sky_magnitude) {
@@ -208,76 +178,110 @@ void StarDome::updateLighting(double sky_magnitude) {
 	// visible (alpha = 10/255), no matter how dark the sky is.  in practice,
 	// the visible threshold comes out to be around 5.5 on my monitor.
 	sky_magnitude = std::min(6.0, sky_magnitude);
-	// update less frequently when the sky is brighter than any star; when
-	// the sky is magnitude 2.5, the rgb brightness of sirius is 1/255.
-	// with 0.01 steps the peak brightness change is about 6/255 per update.
-	double delta = (sky_magnitude > -2.5 && sky_magnitude < 6.0) ? 0.01 : 0.1;
-	if (fabs(sky_magnitude - m_SkyMagnitude) >= delta) {
+	if (sky_magnitude != m_SkyMagnitude) {
 		m_SkyMagnitude = sky_magnitude;
-		dirtyDisplayList();  // force drawImplementation to update the star colors
+		m_SkyMagnitudeUniform->set(static_cast<float>(m_SkyMagnitude));
+	}
+	if (m_FixedFunction && m_ColorSkyMagnitude != m_SkyMagnitude) {
+		updateColors();
+	}
+}
 
-		const double atten = (10.0 / 255.0) * pow(10.0, m_SkyMagnitude);
-		for (unsigned i = 0; i < m_BrightStars->size(); ++i) {
-			(*m_BrightStars)[i].update(atten);
+void StarDome::updateColors() {
+	m_ColorSkyMagnitude = m_SkyMagnitude;
+	osg::Vec4Array *colors = static_cast<osg::Vec4Array*>(getColorArray());
+	for (unsigned i = 0; i < colors->size(); ++i) {
+		(*colors)[i].a() = starAlpha(m_SkyMagnitude, (*m_Magnitudes)[i]);
+	}
+	colors->dirty();
+	if (m_Flares.valid()) {
+		osg::Vec4Array *flare_colors = static_cast<osg::Vec4Array*>(m_Flares->getColorArray());
+		for (unsigned i = 0; i < flare_colors->size(); ++i) {
+			(*flare_colors)[i].a() = starAlpha(m_SkyMagnitude - 3.0, (*m_FlareMagnitudes)[i]);
 		}
+		flare_colors->dirty();
 	}
 }
 
-void StarDome::initStar(Star &star, const float source[7]) {
-	// normal
-	star.nx = -source[0];
-	star.ny = -source[1];
-	star.nz = -source[2];
-
+void StarDome::initStar(osg::Vec3 &position, osg::Vec4 &color, const float source[7]) {
 	// position
-	star.px = m_Radius * source[0];
-	star.py = m_Radius * source[1];
-	star.pz = m_Radius * source[2];
+	position.set(m_Radius * source[0], m_Radius * source[1], m_Radius * source[2]);
 
 	// color
-	star.cr = source[4];
-	star.cg = source[5];
-	star.cb = source[6];
+	double cr = source[4];
+	double cg = source[5];
+	double cb = source[6];
 
 	// desaturate dim stars.  show full color below mag=0, no color above
 	// mag=5.  when fully desaturated we use the rgb709 luminance.
-	double lum = (0.213*star.cr + 0.715*star.cg + 0.072*star.cb);
+	double lum = (0.213*cr + 0.715*cg + 0.072*cb);
 	double desat = clampTo(1.0 - 0.2 * source[3], 0.0, 1.0);
 
-	star.cr += (1.0 - desat) * (lum - star.cr);
-	star.cg += (1.0 - desat) * (lum - star.cg);
-	star.cb += (1.0 - desat) * (lum - star.cb);
+	cr += (1.0 - desat) * (lum - cr);
+	cg += (1.0 - desat) * (lum - cg);
+	cb += (1.0 - desat) * (lum - cb);
 
 	// rescale colors to luminance = 1.0, clamping as needed.  note that
 	// all the color operations here are entirely ad-hoc; intended to
 	// *very* roughly approximate color perception of dim objects.
 	if (lum > 0) {
-		star.cr = std::min(1.0, star.cr / lum);
-		star.cg = std::min(1.0, star.cg / lum);
-		star.cb = std::min(1.0, star.cb / lum);
+		cr = std::min(1.0, cr / lum);
+		cg = std::min(1.0, cg / lum);
+		cb = std::min(1.0, cb / lum);
 	}
 
-	// prescale magnitudes to save work when updating point colors.  note that
-	// magnitude is used to control the alpha value when rendering the star.
-	star.ca = pow(10.0f, - source[3]);
+	// the alpha value depends on the sky magnitude (see updateColors).
+	color.set(cr, cg, cb, 1.0);
+}
+
+void StarDome::addFlare(osg::Vec3 const &position, double angle, double magnitude) {
+	osg::Vec3Array *coords = static_cast<osg::Vec3Array*>(m_Flares->getVertexArray());
+	osg::Vec2Array *tcoords = static_cast<osg::Vec2Array*>(m_Flares->getTexCoordArray(0));
+	osg::Vec4Array *colors = static_cast<osg::Vec4Array*>(m_Flares->getColorArray());
+	osg::DrawElementsUShort *indices = static_cast<osg::DrawElementsUShort*>(m_Flares->getPrimitiveSet(0));
+
+	const float r = position.length();
+	osg::Vec3 right = position ^ osg::Vec3(0, 0, 1);
+	osg::Vec3 up = right ^ position;
+	right.normalize();
+	up.normalize();
+	const double size = 0.5 * angle * r;
+
+	const unsigned short base = static_cast<unsigned short>(coords->size());
+	coords->push_back(position + (up - right) * size);
+	coords->push_back(position + (-up - right) * size);
+	coords->push_back(position + (right - up) * size);
+	coords->push_back(position + (up + right) * size);
+	tcoords->push_back(osg::Vec2(0.0f, 1.0f));
+	tcoords->push_back(osg::Vec2(0.0f, 0.0f));
+	tcoords->push_back(osg::Vec2(1.0f, 0.0f));
+	tcoords->push_back(osg::Vec2(1.0f, 1.0f));
+	colors->insert(colors->end(), 4, osg::Vec4(1.0f, 1.0f, 1.0f, 1.0f));
+	m_FlareMagnitudes->insert(m_FlareMagnitudes->end(), 4, magnitude);
+	const unsigned short quad[6] = { 0, 1, 2, 0, 2, 3 };
+	for (unsigned i = 0; i < 6; ++i) indices->push_back(base + quad[i]);
 }
 
 osg::Geode *StarDome::makeGeode() {
 	osg::Geode *stars = new osg::Geode;
 	stars->addDrawable(this);
-	stars->getOrCreateStateSet()->setMode(GL_BLEND, osg::StateAttribute::ON);
-	stars->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
-	stars->getOrCreateStateSet()->setMode(GL_CULL_FACE, osg::StateAttribute::OFF);
-	
+	osg::StateSet *ss = stars->getOrCreateStateSet();
+	ss->setMode(GL_BLEND, osg::StateAttribute::ON);
+	ss->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+	ss->setMode(GL_CULL_FACE, osg::StateAttribute::OFF);
+	ss->addUniform(m_SkyMagnitudeUniform.get());
+	ss->addUniform(m_FlareScale.get());
+	ss->addUniform(m_ModelViewProjection.get());
+	stars->setCullCallback(new ModelViewProjectionCallback(m_ModelViewProjection.get()));
+
 	// adjust the z range slightly so that imposters such as the moon occlude
 	// stars, which are drawn at the same depth on the skydome.
-	stars->getOrCreateStateSet()->setAttributeAndModes(new osg::Depth(osg::Depth::LESS, 0.1, 1.0, false), osg::StateAttribute::ON);
+	ss->setAttributeAndModes(new osg::Depth(osg::Depth::LESS, 0.1, 1.0, false), osg::StateAttribute::ON);
 
-	for (unsigned i = 0; i < m_BrightStars->size(); ++i) {
-		stars->addDrawable((*m_BrightStars)[i].getImposter());
+	if (m_Flares.valid()) {
+		stars->addDrawable(m_Flares.get());
 	}
 	return stars;
 }
 
 } // namespace csp
-
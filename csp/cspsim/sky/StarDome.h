@@ -17,21 +17,26 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
-#include <osg/Drawable>
+#include <osg/Geometry>
+#include <osg/ref_ptr>
 #include <csp/csplib/util/Ref.h>
 #include <csp/cspsim/Export.h>
-#include <vector>
 
 namespace osg { class Geode; }
+namespace osg { class Uniform; }
 
 namespace csp {
 
-// An OSG Drawable that renders a set of stars as points on the
-// surface of a sphere.  The position, color, and magnitude of
-// the stars is hard-coded in an associated header file.
-class CSPSIM_EXPORT StarDome: public osg::Drawable {
-	struct Star;
-
+// An OSG Geometry that renders a set of stars as points on the
+// surface of a sphere, and the brightest stars as flare imposters.
+// The position, color, and magnitude of the stars is hard-coded in an
+// associated header file.  The stars are uploaded once to vertex buffer
+// objects; the "stars" and "star-flare" shaders compute the brightness
+// of each star relative to the sky from a single sky magnitude uniform.
+// If the shaders are unavailable the stars are drawn by the fixed
+// function pipeline, and the alpha of the star colors is updated (and
+// the colors re-uploaded) as the sky brightness changes.
+class CSPSIM_EXPORT StarDome: public osg::Geometry {
 public:
 	META_Object(csp, StarDome);
 
@@ -40,11 +45,10 @@ public:
 
 	virtual ~StarDome();
 
-	virtual void drawImplementation(osg::RenderInfo&) const;
-	virtual osg::BoundingBox computeBoundingBox() const;
-
 	osg::Geode *makeGeode();
 
+	virtual void drawImplementation(osg::RenderInfo &info) const;
+
 	// Adjust the contrast of the stars based on the brightness of the
 	// sky.  This simulates the dynamic range and dark adaptation of the
 	// human eye.  The sky_magnitude roughly corresponds to the magnitude
@@ -53,8 +57,9 @@ public:
 	// how dark the sky becomes.  In practice the visibility threshold may
 	// vary depending on the monitor and ambient lighting conditions.
 	//
-	// This method can be called every frame without affecting performance
-	// since small lighting updates are ignored.
+	// This method only sets a shader uniform (unless the stars are drawn
+	// without shaders), and can be called every frame without affecting
+	// performance.
 	void updateLighting(double sky_magnitude);
 
 	// Adjust the star flare size to account for the view angle (in degrees).
@@ -62,18 +67,32 @@ public:
 	void setViewAngle(double angle);
 
 private:
-	// Copy star parameters to a Star instance.  The source fields are
-	// x, y, z, red, green, blue, apparent magnitude.  The position vector
-	// should be normalized to length 1.0, and the color components are in
-	// the range [0, 1].
-	void initStar(Star &star, const float source[7]);
+	// Copy star parameters to the vertex and color arrays.  The source
+	// fields are x, y, z, red, green, blue, apparent magnitude.  The
+	// position vector should be normalized to length 1.0, and the color
+	// components are in the range [0, 1].
+	void initStar(osg::Vec3 &position, osg::Vec4 &color, const float source[7]);
+
+	// Add a flare imposter for a bright star to the flare geometry.
+	void addFlare(osg::Vec3 const &position, double angle, double magnitude);
+
+	// Set the alpha of the star and flare colors for the current sky
+	// magnitude, for drawing without the shaders.
+	void updateColors();
 
 	double m_Radius;
 	double m_SkyMagnitude;
-	Star *m_Stars;
+	double m_ColorSkyMagnitude;  // the sky magnitude of the color alpha values.
+
+	// set when the stars are drawn without a shader program.
+	mutable bool m_FixedFunction;
 
-	class BrightStar;
-	std::vector<BrightStar> *m_BrightStars;
+	osg::ref_ptr<osg::FloatArray> m_Magnitudes;
+	osg::ref_ptr<osg::Geometry> m_Flares;
+	osg::ref_ptr<osg::FloatArray> m_FlareMagnitudes;
+	osg::ref_ptr<osg::Uniform> m_SkyMagnitudeUniform;
+	osg::ref_ptr<osg::Uniform> m_FlareScale;
+	osg::ref_ptr<osg::Uniform> m_ModelViewProjection;
 };
 
 } // namespace csp
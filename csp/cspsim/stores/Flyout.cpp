@@ -0,0 +1,327 @@
+// Combat Simulator Project
+// Copyright (C) 2007 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/**
+ * @file Flyout.cpp
+ *
+ **/
+
+#include <csp/cspsim/stores/Flyout.h>
+#include <csp/cspsim/stores/DragProfile.h>
+#include <csp/cspsim/stores/Projectile.h>
+#include <csp/cspsim/stores/Stores.h>
+#include <csp/cspsim/weather/Atmosphere.h>
+#include <csp/cspsim/Config.h>
+#include <csp/cspsim/CSPSim.h>
+#include <csp/cspsim/TerrainObject.h>
+
+#include <csp/csplib/util/Log.h>
+#include <csp/csplib/util/Math.h>
+#include <csp/csplib/util/Profiler.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace csp {
+
+namespace {
+
+/** The maximum integration step (s). */
+const double MaxStep = 0.02;
+
+} // namespace
+
+
+Flyout::Round::Round():
+	mass(1.0),
+	drag_factor(0.0),
+	thrust(0.0),
+	burn_time(0.0),
+	guidance(BALLISTIC),
+	max_acceleration(0.0),
+	owner(0),
+	damage_type(DamageModifier::HIGH_EXPLOSIVE),
+	damage(0.0),
+	radius(0.0) {
+}
+
+Flyout::Flyout() {
+	m_PromotionRange = g_Config.getFloat("Simulation", "FlyoutPromotionRange", 5000.0, true);
+	m_TerminalRange = g_Config.getFloat("Simulation", "FlyoutTerminalRange", 2000.0, true);
+	m_MaxTime = g_Config.getFloat("Simulation", "FlyoutMaxTime", 120.0, true);
+}
+
+Flyout::~Flyout() {
+}
+
+bool Flyout::isEnabled() {
+	return g_Config.getBool("Simulation", "Flyout", true, true);
+}
+
+bool Flyout::shouldDefer(Vector3 const &position, Vector3 const &camera) const {
+	return (position - camera).length2() > m_PromotionRange * m_PromotionRange;
+}
+
+void Flyout::add(Round const &round) {
+	assert(round.mass > 0.0);
+	m_X.push_back(round.position.x());
+	m_Y.push_back(round.position.y());
+	m_Z.push_back(round.position.z());
+	m_PX.push_back(round.position.x());
+	m_PY.push_back(round.position.y());
+	m_PZ.push_back(round.position.z());
+	m_VX.push_back(round.velocity.x());
+	m_VY.push_back(round.velocity.y());
+	m_VZ.push_back(round.velocity.z());
+	m_Age.push_back(0.0);
+	m_InverseMass.push_back(1.0 / round.mass);
+	m_DragFactor.push_back(round.drag_factor);
+	m_Thrust.push_back(round.thrust);
+	m_BurnTime.push_back(round.burn_time);
+	m_Drag.push_back(round.drag.get());
+	Extra extra;
+	extra.drag = round.drag;
+	extra.store = round.store;
+	extra.attitude = round.attitude;
+	extra.guidance = round.guidance;
+	extra.target = round.target;
+	extra.max_acceleration = round.max_acceleration;
+	extra.owner = round.owner;
+	extra.damage_type = round.damage_type;
+	extra.damage = round.damage;
+	extra.radius = round.radius;
+	m_Extra.push_back(extra);
+}
+
+void Flyout::remove(unsigned i) {
+	const unsigned last = m_X.size() - 1;
+	if (i != last) {
+		m_X[i] = m_X[last];
+		m_Y[i] = m_Y[last];
+		m_Z[i] = m_Z[last];
+		m_PX[i] = m_PX[last];
+		m_PY[i] = m_PY[last];
+		m_PZ[i] = m_PZ[last];
+		m_VX[i] = m_VX[last];
+		m_VY[i] = m_VY[last];
+		m_VZ[i] = m_VZ[last];
+		m_Age[i] = m_Age[last];
+		m_InverseMass[i] = m_InverseMass[last];
+		m_DragFactor[i] = m_DragFactor[last];
+		m_Thrust[i] = m_Thrust[last];
+		m_BurnTime[i] = m_BurnTime[last];
+		m_Drag[i] = m_Drag[last];
+		m_Extra[i] = m_Extra[last];
+	}
+	m_X.pop_back();
+	m_Y.pop_back();
+	m_Z.pop_back();
+	m_PX.pop_back();
+	m_PY.pop_back();
+	m_PZ.pop_back();
+	m_VX.pop_back();
+	m_VY.pop_back();
+	m_VZ.pop_back();
+	m_Age.pop_back();
+	m_InverseMass.pop_back();
+	m_DragFactor.pop_back();
+	m_Thrust.pop_back();
+	m_BurnTime.pop_back();
+	m_Drag.pop_back();
+	m_Extra.pop_back();
+}
+
+void Flyout::integrate(double dt, weather::Atmosphere const *atmosphere) {
+	const unsigned n = m_X.size();
+	const double g = atmosphere ? atmosphere->getGravity(0.0) : 9.806;
+
+	// the drag coefficient varies slowly, so it is evaluated once per update
+	// rather than once per step: k = 0.5 * rho * Cd * area / mass.
+	std::vector<double> k(n);
+	std::vector<weather::AirProperties> air(n);
+	if (atmosphere && n > 0) atmosphere->getAir(n, &m_Z[0], &air[0]);
+	for (unsigned i = 0; i < n; ++i) {
+		const double speed = std::sqrt(m_VX[i] * m_VX[i] + m_VY[i] * m_VY[i] + m_VZ[i] * m_VZ[i]);
+		const double density = atmosphere ? air[i].density : 1.225;
+		const double sound = atmosphere ? air[i].speed_of_sound : 340.0;
+		const double cd = m_Drag[i] ? m_Drag[i]->drag(speed / sound, 0.0) : 1.0;
+		k[i] = 0.5 * density * cd * m_DragFactor[i] * m_InverseMass[i];
+	}
+
+	// guidance, applied as a velocity rotation limited by the lateral acceleration.
+	for (unsigned i = 0; i < n; ++i) {
+		Extra const &extra = m_Extra[i];
+		if (extra.guidance != PURSUIT) continue;
+		Vector3 v(m_VX[i], m_VY[i], m_VZ[i]);
+		const double speed = v.length();
+		Vector3 los = extra.target - Vector3(m_X[i], m_Y[i], m_Z[i]);
+		if (speed <= 0.0 || los.length2() <= 0.0) continue;
+		Vector3 dv = los.normalized() * speed - v;
+		dv -= v * (dot(dv, v) / (speed * speed));
+		const double limit = extra.max_acceleration * dt;
+		if (dv.length2() > limit * limit) dv *= limit / dv.length();
+		v = (v + dv).normalized() * speed;
+		m_VX[i] = v.x();
+		m_VY[i] = v.y();
+		m_VZ[i] = v.z();
+	}
+
+	const int steps = std::max(1, static_cast<int>(std::ceil(dt / MaxStep)));
+	const double h = dt / steps;
+	double *x = &m_X.front(), *y = &m_Y.front(), *z = &m_Z.front();
+	double *vx = &m_VX.front(), *vy = &m_VY.front(), *vz = &m_VZ.front();
+	double *age = &m_Age.front();
+	double const *thrust = &m_Thrust.front(), *burn = &m_BurnTime.front(), *inverse_mass = &m_InverseMass.front();
+	for (int step = 0; step < steps; ++step) {
+		for (unsigned i = 0; i < n; ++i) {
+			const double speed = std::sqrt(vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i]);
+			// thrust along the velocity vector while the motor is burning.
+			const double motor = (age[i] < burn[i] && speed > 0.0) ? thrust[i] * inverse_mass[i] / speed : 0.0;
+			const double a = motor - k[i] * speed;
+			vx[i] += a * vx[i] * h;
+			vy[i] += a * vy[i] * h;
+			vz[i] += (a * vz[i] - g) * h;
+			x[i] += vx[i] * h;
+			y[i] += vy[i] * h;
+			z[i] += vz[i] * h;
+			age[i] += h;
+		}
+	}
+}
+
+Ref<DynamicObject> Flyout::promote(unsigned i) {
+	Ref<Store> store = m_Extra[i].store;
+	assert(store.valid());
+	Ref<Projectile> object = store->data()->createObject();
+	if (!object.valid()) return 0;
+
+	const Vector3 velocity(m_VX[i], m_VY[i], m_VZ[i]);
+	Quat attitude = m_Extra[i].attitude;
+	if (velocity.length2() > 0.0) {
+		// keep the round pointing along its flight path.
+		Quat turn;
+		turn.makeRotate(attitude.rotate(Vector3::YAXIS), velocity.normalized());
+		attitude = turn * attitude;
+	}
+
+	object->prepareRelease(Ref<DynamicObject>(), store);
+	object->setOwner(m_Extra[i].owner);
+	object->setAttitude(attitude);
+	object->setGlobalPosition(Vector3(m_X[i], m_Y[i], m_Z[i]));
+	object->setVelocity(velocity);
+	object->setAngularVelocity(Vector3::ZERO);
+	return object;
+}
+
+void Flyout::update(double dt, Vector3 const &camera, std::vector<Ref<DynamicObject> > &promoted) {
+	m_ImpactPaths.clear();
+	// the paths tested by addQueries start where the rounds are now, so a
+	// paused frame leaves an empty path rather than the previous one.
+	m_PX = m_X;
+	m_PY = m_Y;
+	m_PZ = m_Z;
+	if (m_X.empty() || dt <= 0.0) return;
+	CSP_PROFILE_ZONE("Flyout::update");
+
+	CSPSim *sim = CSPSim::theSim;
+	integrate(dt, sim ? sim->getAtmosphere() : 0);
+
+	const unsigned n = m_X.size();
+	TerrainObject const *terrain = sim ? sim->getTerrain() : 0;
+	m_Elevation.resize(n);
+	if (terrain) {
+		terrain->getGroundElevations(n, &m_X.front(), &m_Y.front(), &m_Elevation.front());
+	} else {
+		std::fill(m_Elevation.begin(), m_Elevation.end(), 0.0f);
+	}
+
+	const double promotion_range2 = m_PromotionRange * m_PromotionRange;
+	const double terminal_range2 = m_TerminalRange * m_TerminalRange;
+
+	// iterate backwards, since remove() moves the last round into slot i.
+	for (unsigned i = n; i-- > 0; ) {
+		const Vector3 position(m_X[i], m_Y[i], m_Z[i]);
+		if (m_Z[i] <= m_Elevation[i]) {
+			Extra const &extra = m_Extra[i];
+			if (extra.damage > 0.0) {
+				// cut the path at the ground, interpolating linearly over the update.
+				const Vector3 start(m_PX[i], m_PY[i], m_PZ[i]);
+				const double drop = m_PZ[i] - m_Z[i];
+				const double t = (drop > 0.0) ? clampTo((m_PZ[i] - m_Elevation[i]) / drop, 0.0, 1.0) : 1.0;
+				HitDetection::Query path;
+				path.start = start;
+				path.end = start + (position - start) * t;
+				path.radius = extra.radius;
+				path.owner = extra.owner;
+				path.type = extra.damage_type;
+				path.damage = extra.damage;
+				m_ImpactPaths.push_back(path);
+			}
+			remove(i);
+			continue;
+		}
+		if (m_Extra[i].store.valid()) {
+			const bool visible = (position - camera).length2() < promotion_range2;
+			const bool terminal = m_Extra[i].guidance != BALLISTIC && (position - m_Extra[i].target).length2() < terminal_range2;
+			if (visible || terminal) {
+				Ref<DynamicObject> object = promote(i);
+				if (object.valid()) promoted.push_back(object);
+				remove(i);
+				continue;
+			}
+		}
+		if (m_Age[i] > m_MaxTime) {
+			remove(i);
+		}
+	}
+	CSP_PROFILE_COUNTER("flyout rounds", m_X.size());
+}
+
+unsigned Flyout::addQueries(HitDetection &detection) const {
+	const unsigned first = detection.numQueries();
+	HitDetection::Query query;
+	for (unsigned i = 0; i < m_X.size(); ++i) {
+		Extra const &extra = m_Extra[i];
+		query.start = Vector3(m_PX[i], m_PY[i], m_PZ[i]);
+		query.end = Vector3(m_X[i], m_Y[i], m_Z[i]);
+		query.radius = extra.radius;
+		query.owner = extra.owner;
+		query.type = extra.damage_type;
+		query.damage = extra.damage;
+		detection.addQuery(query);
+	}
+	for (unsigned i = 0; i < m_ImpactPaths.size(); ++i) {
+		detection.addQuery(m_ImpactPaths[i]);
+	}
+	return first;
+}
+
+void Flyout::removeHits(std::vector<HitDetection::Hit> const &hits, unsigned first) {
+	// remove from the highest index down, since remove() moves the last round into slot i.
+	const unsigned rounds = m_X.size();
+	for (unsigned i = hits.size(); i-- > 0; ) {
+		if (hits[i].query < first) break;
+		const unsigned round = hits[i].query - first;
+		if (round < rounds) remove(round);
+	}
+}
+
+} // namespace csp
+
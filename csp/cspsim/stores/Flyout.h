@@ -0,0 +1,183 @@
+#pragma once
+// Combat Simulator Project
+// Copyright (C) 2007 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/**
+ * @file Flyout.h
+ *
+ **/
+
+#include <csp/cspsim/DamageModifier.h>
+#include <csp/cspsim/HitDetection.h>
+#include <csp/cspsim/battlefield/SimObject.h>
+
+#include <csp/csplib/data/Quat.h>
+#include <csp/csplib/data/Vector3.h>
+#include <csp/csplib/util/Properties.h>
+#include <csp/csplib/util/Ref.h>
+
+#include <vector>
+
+namespace csp {
+
+class DragProfile;
+class DynamicObject;
+class Store;
+class TerrainObject;
+namespace weather { class Atmosphere; }
+
+
+/** A lightweight simulation of weapons in flight: gun rounds, unguided
+ *  rockets, and released stores or missiles that are too far from the
+ *  camera to be seen.  Instead of a full DynamicObject (with its own
+ *  systems model, bus, physics model, and scene model), each round is a
+ *  point mass stored in a set of compact arrays, and all rounds are
+ *  integrated together each frame.  Drag is computed from a DragProfile
+ *  (or a unit drag coefficient if none is given), and terrain impacts are
+ *  detected with a single batched elevation query per frame.
+ *
+ *  The path of each round during the last update can be tested against
+ *  the objects in the battlefield using HitDetection (see addQueries).
+ *  Rounds that hit the ground are removed, but the final part of their
+ *  path (down to the point of impact) is still tested, so that the
+ *  proximity fuze can damage units near the impact.
+ *
+ *  Rounds created from a Store are promoted to a full Projectile when they
+ *  come within Simulation.FlyoutPromotionRange of the camera, or (for
+ *  guided rounds) within Simulation.FlyoutTerminalRange of their target,
+ *  where detailed simulation is needed.  Other rounds are simulated until
+ *  they hit the ground or exceed Simulation.FlyoutMaxTime.
+ */
+class Flyout: public NonCopyable {
+public:
+	/** Simple guidance laws for rounds that are not promoted. */
+	typedef enum {
+		BALLISTIC,  // no guidance.
+		PURSUIT     // turn toward the target point, limited by max_acceleration.
+	} Guidance;
+
+	/** Launch parameters of a round. */
+	struct Round {
+		Round();
+		Vector3 position;         // global coordinates (m).
+		Vector3 velocity;         // (m/s)
+		Quat attitude;            // initial attitude, used if the round is promoted.
+		double mass;              // (kg)
+		double drag_factor;       // reference area scaling the drag coefficient (m^2).
+		Ref<const DragProfile> drag;
+		double thrust;            // motor thrust (N), applied along the velocity.
+		double burn_time;         // motor burn time (s).
+		Guidance guidance;
+		Vector3 target;           // target point for PURSUIT guidance.
+		double max_acceleration;  // maximum lateral acceleration for PURSUIT guidance (m/s^2).
+		Ref<Store> store;         // optional; rounds with a store can be promoted.
+		SimObject::ObjectId owner;  // the launching object, which the round can't hit.
+		DamageModifier::DamageType damage_type;
+		double damage;            // nominal damage of a hit (see DynamicObject::onHit).
+		double radius;            // proximity fuze radius (m).
+	};
+
+	Flyout();
+	~Flyout();
+
+	/** Returns true if weapon flyout is enabled (Simulation.Flyout).
+	 */
+	static bool isEnabled();
+
+	/** Returns true if a store released at the specified position should
+	 *  be simulated by the flyout rather than as a full Projectile.
+	 */
+	bool shouldDefer(Vector3 const &position, Vector3 const &camera) const;
+
+	/** Add a round.
+	 */
+	void add(Round const &round);
+
+	/** Advance all rounds.  Rounds that need detailed simulation are removed
+	 *  and returned as new Projectiles (not yet added to the battlefield).
+	 *
+	 *  @param dt the time step (s).
+	 *  @param camera the camera position in global coordinates.
+	 *  @param promoted returns the promoted rounds.
+	 */
+	void update(double dt, Vector3 const &camera, std::vector<Ref<DynamicObject> > &promoted);
+
+	/** Add a hit detection query for the path of each round during the
+	 *  last update.  The queries are added in round order, followed by the
+	 *  final paths of armed rounds that hit the ground.
+	 *
+	 *  @return the index of the first query.
+	 */
+	unsigned addQueries(HitDetection &detection) const;
+
+	/** Remove the rounds that hit an object.  Hits by queries that were not
+	 *  added by addQueries for a round in flight are ignored.
+	 *
+	 *  @param hits the hits, ordered by query index.
+	 *  @param first the index of the first query, as returned by addQueries.
+	 */
+	void removeHits(std::vector<HitDetection::Hit> const &hits, unsigned first);
+
+	/** The number of rounds in flight. */
+	unsigned size() const { return m_X.size(); }
+
+private:
+	void integrate(double dt, weather::Atmosphere const *atmosphere);
+	void remove(unsigned i);
+	Ref<DynamicObject> promote(unsigned i);
+
+	double m_PromotionRange;
+	double m_TerminalRange;
+	double m_MaxTime;
+
+	// round state; one entry per round in each array.
+	std::vector<double> m_X, m_Y, m_Z;
+	std::vector<double> m_PX, m_PY, m_PZ;  // positions before the last update.
+	std::vector<double> m_VX, m_VY, m_VZ;
+	std::vector<double> m_Age;
+	std::vector<double> m_InverseMass;
+	std::vector<double> m_DragFactor;
+	std::vector<double> m_Thrust;
+	std::vector<double> m_BurnTime;
+	std::vector<DragProfile const*> m_Drag;
+
+	// rarely used data.
+	struct Extra {
+		Ref<const DragProfile> drag;
+		Ref<Store> store;
+		Quat attitude;
+		Guidance guidance;
+		Vector3 target;
+		double max_acceleration;
+		SimObject::ObjectId owner;
+		DamageModifier::DamageType damage_type;
+		double damage;
+		double radius;
+	};
+	std::vector<Extra> m_Extra;
+
+	// paths of armed rounds that hit the ground during the last update.
+	std::vector<HitDetection::Query> m_ImpactPaths;
+
+	// scratch space for the batched elevation query.
+	std::vector<float> m_Elevation;
+};
+
+} // namespace csp
+
@@ -34,31 +34,54 @@ CSP_XML_BEGIN(Projectile)
 CSP_XML_END
 
 // TODO SimObject probably needs a specialized type for Projectiles.
-Projectile::Projectile(): DynamicObject(TYPE_AIR_UNIT), m_DetachedModel(false) {
+Projectile::Projectile(): DynamicObject(TYPE_AIR_UNIT), m_Owner(0), m_DetachedModel(false), m_Moved(false) {
 }
 
 Projectile::~Projectile() {
 }
 
-void Projectile::prepareRelease(Ref<DynamicObject> const &/*parent*/, Ref<Store> const &store) {
+void Projectile::prepareRelease(Ref<DynamicObject> const &parent, Ref<Store> const &store) {
 	assert(store.valid() && !m_Store);
 	m_Store = store;
+	if (parent.valid()) m_Owner = parent->id();
 	setReferenceMass(store->mass());
 	setReferenceInertia(store->mass() * store->unitInertia());
 	setReferenceCgOffset(store->cgOffset());
 }
 
+double Projectile::onUpdate(double dt) {
+	const double interval = DynamicObject::onUpdate(dt);
+	// m_PrevPosition is only meaningful once the projectile has been updated.
+	m_Moved = !hasAggregateModel();
+	return interval;
+}
+
+bool Projectile::getHitQuery(HitDetection::Query &query) const {
+	if (!m_Store.valid() || !m_Moved || hasAggregateModel()) return false;
+	StoreData const *data = m_Store->data();
+	if (data->damage() <= 0.0) return false;
+	query.start = m_PrevPosition;
+	query.end = b_Position->value();
+	query.radius = data->fuzeRadius();
+	query.owner = m_Owner;
+	query.type = DamageModifier::HIGH_EXPLOSIVE;
+	query.damage = data->damage();
+	return true;
+}
+
 void Projectile::onEnterScene() {
 	DynamicObject::onEnterScene();
 	if (m_Store.valid() && !m_DetachedModel) {
 		// remove store 3d model from parent, as it will be replaced by this
 		// object's 3d model.
+		// the model may already have been removed if the store was simulated
+		// by the Flyout before being promoted to a Projectile.
 		osg::Group *group = m_Store->getParentGroup();
-		if (group) {
+		if (group && group->getNumParents() > 0) {
 			assert(group->getNumParents() == 1);
 			group->getParent(0)->asGroup()->removeChild(group);
-			m_DetachedModel = true;
 		}
+		m_DetachedModel = true;
 	}
 }
 
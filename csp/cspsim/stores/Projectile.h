@@ -24,6 +24,7 @@
  **/
 
 #include <csp/cspsim/DynamicObject.h>
+#include <csp/cspsim/HitDetection.h>
 
 namespace csp {
 
@@ -49,15 +50,30 @@ public:
 	 */
 	virtual void prepareRelease(Ref<DynamicObject> const &parent, Ref<Store> const &store);
 
+	/** Set the object that launched this projectile, which it can't hit.  Set by
+	 *  prepareRelease() if a parent is given.
+	 */
+	void setOwner(ObjectId owner) { m_Owner = owner; }
+
+	/** Get a hit detection query for the path of the projectile during its last
+	 *  update.  Returns false if the store has no warhead, or if the projectile
+	 *  has not been updated at full fidelity since it was released.
+	 */
+	bool getHitQuery(HitDetection::Query &query) const;
+
 protected:
 	virtual ~Projectile();
 
+	virtual double onUpdate(double dt);
+
 	virtual void onEnterScene();
 	virtual void createSceneModel();
 
 private:
 	Ref<Store> m_Store;
+	ObjectId m_Owner;
 	bool m_DetachedModel;
+	bool m_Moved;
 };
 
 } // namespace csp
@@ -51,6 +51,8 @@ CSP_XML_BEGIN(StoreData)
 	CSP_DEF("unit_inertia", m_UnitInertia, true)
 	CSP_DEF("cg_offset", m_CgOffset, true)
 	CSP_DEF("drag_factor", m_DragFactor, true)
+	CSP_DEF("damage", m_Damage, false)
+	CSP_DEF("fuze_radius", m_FuzeRadius, false)
 	CSP_DEF("model", m_Model, false)
 	CSP_DEF("object", m_Object, false)
 CSP_XML_END
@@ -83,7 +85,7 @@ void Store::addModel(osg::Group *group) const {
 	if (group) group->addChild(data()->makeModel());
 }
 
-StoreData::StoreData(Type type): m_Type(type) {
+StoreData::StoreData(Type type): m_Type(type), m_Damage(0.0), m_FuzeRadius(0.0) {
 }
 
 StoreData::~StoreData() {
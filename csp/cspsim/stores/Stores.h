@@ -353,6 +353,15 @@ public:
 	 */
 	Vector3 const &cgOffset() const { return m_CgOffset; }
 
+	/** Get the nominal damage of a hit by this store (see DynamicObject::onHit),
+	 *  or zero if the store has no warhead.
+	 */
+	double damage() const { return m_Damage; }
+
+	/** Get the proximity fuze radius (m), or zero for an impact fuze.
+	 */
+	double fuzeRadius() const { return m_FuzeRadius; }
+
 	/** Attempt to convert this StoreData instance to a specialized subclass.
 	 *  Returns NULL on failure.
 	 */
@@ -398,6 +407,8 @@ private:
 	Matrix3 m_UnitInertia;
 	Vector3 m_CgOffset;
 	double m_DragFactor;
+	double m_Damage;
+	double m_FuzeRadius;
 	Link<ObjectModel> m_Model;
 	Path m_Object;
 };
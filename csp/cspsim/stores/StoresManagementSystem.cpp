@@ -42,6 +42,7 @@
 
 
 #include <csp/cspsim/stores/StoresManagementSystem.h>
+#include <csp/cspsim/stores/Flyout.h>
 #include <csp/cspsim/stores/Projectile.h>
 #include <csp/cspsim/stores/Stores.h>
 #include <csp/cspsim/stores/StoresDatabase.h>
@@ -178,23 +179,49 @@ void StoresManagementSystem::releaseMarkedStores(DynamicObject *parent) {
 
 		CSPLOG(Prio_INFO, Cat_OBJECT) << "Creating dynamic object for released store";
 
+		store_attitude = parent->getAttitude() * store_attitude;
+		ejection_velocity = store_attitude.rotate(ejection_velocity);
+		ejection_angular_velocity = store_attitude.rotate(ejection_angular_velocity);
+		const Vector3 position = parent->getGlobalPosition() + parent->getAttitude().rotate(store_position);
+		const Vector3 velocity = parent->getVelocity() + (parent->getAngularVelocity() ^ parent->getAttitude().rotate(store_position)) + ejection_velocity;
+
+		LocalBattlefield *battlefield = CSPSim::theSim->getBattlefield();
+		Flyout *flyout = battlefield ? battlefield->getFlyout() : 0;
+		if (flyout && flyout->shouldDefer(position, battlefield->getCameraPosition())) {
+			// out of sight; simulate the store as a point mass until it comes
+			// into view (see Flyout).
+			CSPLOG(Prio_INFO, Cat_OBJECT) << "Released store added to flyout";
+			osg::Group *group = store->getParentGroup();
+			if (group && group->getNumParents() > 0) {
+				group->getParent(0)->asGroup()->removeChild(group);
+			}
+			Flyout::Round round;
+			round.position = position;
+			round.velocity = velocity;
+			round.attitude = store_attitude;
+			round.mass = store->data()->mass();
+			round.drag_factor = store->data()->dragFactor();
+			round.store = store;
+			round.owner = parent->id();
+			round.damage = store->data()->damage();
+			round.radius = store->data()->fuzeRadius();
+			flyout->add(round);
+			continue;
+		}
+
 		// open questions / problems:
 		//  - for racks, need to include child models and dynamics
 		//    (for now assume that we have a single store, as opposed to a rack of stores)
 		Ref<Projectile> object = store->data()->createObject();
 		if (object.valid()) {
-			store_attitude = parent->getAttitude() * store_attitude;
-			ejection_velocity = store_attitude.rotate(ejection_velocity);
-			ejection_angular_velocity = store_attitude.rotate(ejection_angular_velocity);
-
 			object->prepareRelease(parent, store);
 
 			object->setAttitude(store_attitude);
-			object->setGlobalPosition(parent->getGlobalPosition() + parent->getAttitude().rotate(store_position));
-			object->setVelocity(parent->getVelocity() + (parent->getAngularVelocity() ^ parent->getAttitude().rotate(store_position)) + ejection_velocity);
+			object->setGlobalPosition(position);
+			object->setVelocity(velocity);
 			object->setAngularVelocity(parent->getAngularVelocity() + ejection_angular_velocity);
 
-			CSPSim::theSim->getBattlefield()->__test__addLocalHumanUnit(object, false);  // XXX TOTAL HACK FOR NOW!!!
+			battlefield->addLocalUnit(object);
 		}
 	}
 
@@ -50,13 +50,15 @@ double AircraftFlightSensors::onUpdate(double dt) {
 	double speed = b_Velocity->value().length();
 	weather::Atmosphere const *atmosphere = CSPSim::theSim->getAtmosphere();
 	if (atmosphere) {
-		b_Density->value() = atmosphere->getDensity(pos.z());
-		b_Temperature->value() = atmosphere->getTemperature(pos.z());
-		b_Pressure->value() = atmosphere->getPressure(pos.z());
+		weather::AirProperties air;
+		atmosphere->getAir(pos.z(), air);
+		b_Density->value() = air.density;
+		b_Temperature->value() = air.temperature;
+		b_Pressure->value() = air.pressure;
 		Vector3 wind = atmosphere->getWind(pos);
 		wind += atmosphere->getTurbulence(pos, m_Distance);
 		b_WindVelocity->value() = wind;
-		double mach = atmosphere->getMach(speed, pos.z());
+		double mach = speed / air.speed_of_sound;
 		b_Mach->value() = mach;
 		b_CAS->value() = atmosphere->getCAS(mach, pos.z());
 		m_Distance += (wind - b_Velocity->value()).length() * dt;
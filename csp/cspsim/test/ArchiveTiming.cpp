@@ -0,0 +1,167 @@
+// Combat Simulator Project
+// Copyright (C) 2007 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+// Measures deserialization and serialization throughput: for large arrays of
+// floats (as in interpolated tables) and vectors read one element at a time
+// and in bulk, and for every object in a compiled archive (e.g., the objects
+// of one vehicle), reading them and writing them back.
+//
+// usage: archive_timing path/to/sim.dar [path prefix] [repeats]
+
+#include <csp/cspsim/RegisterObjectInterfaces.h>
+#include <csp/csplib/data/Archive.h>
+#include <csp/csplib/data/DataArchive.h>
+#include <csp/csplib/data/InterfaceProxy.h>
+#include <csp/csplib/data/InterfaceRegistry.h>
+#include <csp/csplib/data/Object.h>
+#include <csp/csplib/data/Vector3.h>
+#include <csp/csplib/util/ScopedPointer.h>
+#include <csp/csplib/util/Timing.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace csp;
+
+namespace {
+
+void report(const char *label, double seconds, double bytes, double reference) {
+	char line[256];
+	snprintf(line, sizeof(line), "%-28s %9.3f ms, %8.1f MB/s (%.1fx)", label, seconds * 1000.0, bytes * 1e-6 / seconds, reference / seconds);
+	std::cout << line << "\n";
+}
+
+// Compare reading and writing an array one element at a time with the bulk paths.
+template <typename T>
+void compareArrays(const char *name, std::vector<T> const &values, int repeats) {
+	ArchiveStringWriter writer;
+	writer << values;
+	std::string const &data = writer.str();
+	const double bytes = static_cast<double>(data.size()) * repeats;
+	std::vector<T> result;
+	Timer timer;
+
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		ArchiveReader reader(data.data(), data.size());
+		result.resize(reader.readLength());
+		for (unsigned i = 0; i < result.size(); ++i) reader >> result[i];
+	}
+	const double single_read = timer.stop();
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		ArchiveReader reader(data.data(), data.size());
+		reader >> result;
+	}
+	const double bulk_read = timer.stop();
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		ArchiveStringWriter out;
+		out.writeLength(values.size());
+		for (unsigned i = 0; i < values.size(); ++i) out << values[i];
+	}
+	const double single_write = timer.stop();
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		ArchiveStringWriter out;
+		out << values;
+	}
+	const double bulk_write = timer.stop();
+
+	std::cout << name << " (" << values.size() << " elements)\n";
+	report("  read by element", single_read, bytes, single_read);
+	report("  read in bulk", bulk_read, bytes, single_read);
+	report("  write by element", single_write, bytes, single_write);
+	report("  write in bulk", bulk_write, bytes, single_write);
+}
+
+} // namespace
+
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0] << " sim.dar [path prefix] [repeats]\n";
+		return 1;
+	}
+	const std::string prefix = (argc > 2) ? argv[2] : "";
+	const int repeats = (argc > 3) ? atoi(argv[3]) : 20;
+
+	std::vector<float> table(64 * 64 * 64);
+	for (unsigned i = 0; i < table.size(); ++i) table[i] = 0.001f * i;
+	compareArrays("table", table, repeats);
+	std::vector<Vector3> vertices(100000);
+	for (unsigned i = 0; i < vertices.size(); ++i) vertices[i] = Vector3(i, 0.5 * i, -1.0 * i);
+	compareArrays("vertices", vertices, repeats);
+
+	registerAllObjectInterfaces();
+	ScopedPointer<DataArchive> archive(new DataArchive(argv[1], true, false));
+	InterfaceRegistry &registry = InterfaceRegistry::getInterfaceRegistry();
+
+	// the serialized data of the selected objects.
+	struct Entry {
+		InterfaceProxy *proxy;
+		std::string data;
+	};
+	std::vector<Entry> entries;
+	double bytes = 0.0;
+	std::vector<std::string> paths = archive->getAllPathStrings();
+	for (unsigned i = 0; i < paths.size(); ++i) {
+		if (paths[i].compare(0, prefix.size(), prefix) != 0) continue;
+		Entry entry;
+		ObjectID classhash;
+		if (!archive->getObjectData(ObjectID(paths[i]), classhash, entry.data)) continue;
+		entry.proxy = registry.getInterface(classhash);
+		if (!entry.proxy) continue;
+		bytes += entry.data.size();
+		entries.push_back(entry);
+	}
+	if (entries.empty()) {
+		std::cerr << "no objects matching '" << prefix << "' in " << argv[1] << "\n";
+		return 1;
+	}
+
+	std::vector<Ref<Object> > objects(entries.size());
+	Timer timer;
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		for (unsigned i = 0; i < entries.size(); ++i) {
+			objects[i] = entries[i].proxy->createObject();
+			ArchiveReader reader(entries[i].data.data(), entries[i].data.size(), archive.get(), false);
+			objects[i]->serialize(reader);
+		}
+	}
+	const double read_time = timer.stop();
+
+	timer.start();
+	for (int r = 0; r < repeats; ++r) {
+		for (unsigned i = 0; i < objects.size(); ++i) {
+			ArchiveStringWriter writer;
+			objects[i]->serialize(writer);
+		}
+	}
+	const double write_time = timer.stop();
+
+	std::cout << "archive:       " << argv[1] << "\n";
+	std::cout << "objects:       " << entries.size() << " (" << static_cast<int>(bytes) << " bytes)\n";
+	report("  read", read_time, bytes * repeats, read_time);
+	report("  write", write_time, bytes * repeats, write_time);
+	return 0;
+}
@@ -0,0 +1,187 @@
+// Combat Simulator Project
+// Copyright (C) 2007 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+// Compares the cost of evaluating the F16 flight control system recursively
+// and as a compiled ControlTape, and checks that both produce the same
+// control surface deflections.
+//
+// usage: fcs_timing path/to/sim.dar [steps]
+
+#include <csp/cspsim/ConditionsChannels.h>
+#include <csp/cspsim/ControlInputsChannels.h>
+#include <csp/cspsim/ControlSurfacesChannels.h>
+#include <csp/cspsim/FlightControlSystem.h>
+#include <csp/cspsim/FlightDynamicsChannels.h>
+#include <csp/cspsim/KineticsChannels.h>
+#include <csp/cspsim/LandingGearChannels.h>
+#include <csp/cspsim/RegisterObjectInterfaces.h>
+#include <csp/cspsim/SystemsModel.h>
+#include <csp/cspsim/f16/F16Channels.h>
+#include <csp/csplib/data/DataArchive.h>
+#include <csp/csplib/data/DataManager.h>
+#include <csp/csplib/util/Timing.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <vector>
+
+using namespace csp;
+
+namespace {
+
+// Supplies the channels read by the F16 flight control system.
+class FcsInputs: public System {
+public:
+	virtual void registerChannels(Bus *bus) {
+		addScalar(bus, bus::FlightDynamics::G, 1.0);
+		addScalar(bus, bus::FlightDynamics::Alpha, 0.05);
+		addScalar(bus, bus::FlightDynamics::QBar, 15000.0);
+		addScalar(bus, bus::FlightDynamics::Airspeed, 150.0);
+		addScalar(bus, bus::FlightDynamics::LateralG, 0.0);
+		addScalar(bus, bus::ControlInputs::LeftBrakeInput, 0.0);
+		addScalar(bus, bus::ControlInputs::RightBrakeInput, 0.0);
+		addScalar(bus, bus::ControlInputs::PitchInput, 0.0);
+		addScalar(bus, bus::ControlInputs::AirbrakeInput, 0.0);
+		addScalar(bus, bus::ControlInputs::RudderInput, 0.0);
+		addScalar(bus, bus::ControlInputs::RollInput, 0.0);
+		addScalar(bus, bus::ControlInputs::ThrottleInput, 0.8);
+		addScalar(bus, bus::F16::AirbrakeLimit, 60.0);
+		addScalar(bus, bus::Conditions::Pressure, 101325.0);
+		b_AccelerationBody = bus->registerLocalDataChannel(bus::Kinetics::AccelerationBody, Vector3::ZERO);
+		b_AngularVelocityBody = bus->registerLocalDataChannel(bus::Kinetics::AngularVelocityBody, Vector3::ZERO);
+		bus->registerSharedDataChannel(bus::F16::ManualPitchOverrideActive, false);
+		bus->registerLocalDataChannel(bus::LandingGear::selectWOW("FrontGear"), false);
+		bus->registerLocalDataChannel(bus::LandingGear::selectWOW("LeftGear"), false);
+		bus->registerLocalDataChannel(bus::LandingGear::selectWOW("RightGear"), false);
+		bus->registerLocalDataChannel(bus::F16::WheelSpin, false);
+		bus->registerLocalDataChannel(bus::F16::AltFlaps, false);
+		bus->registerLocalDataChannel(bus::F16::GearHandleUp, true);
+		bus->registerLocalDataChannel(bus::F16::TakeoffLandingGains, false);
+		bus->registerLocalDataChannel(bus::F16::CatIII, false);
+		bus->registerLocalDataChannel(bus::F16::ManualPitchOverride, false);
+	}
+
+	virtual void importChannels(Bus *) { }
+
+	// Drive the stick and flight state with smooth, deterministic signals.
+	void drive(double t) {
+		setScalar(bus::ControlInputs::PitchInput, 0.6 * sin(0.7 * t));
+		setScalar(bus::ControlInputs::RollInput, 0.4 * sin(1.3 * t));
+		setScalar(bus::ControlInputs::RudderInput, 0.2 * sin(0.3 * t));
+		setScalar(bus::FlightDynamics::Alpha, 0.1 + 0.08 * sin(0.5 * t));
+		setScalar(bus::FlightDynamics::G, 1.0 + 2.0 * sin(0.7 * t));
+		setScalar(bus::FlightDynamics::QBar, 15000.0 + 5000.0 * sin(0.05 * t));
+		b_AngularVelocityBody->value() = Vector3(0.3 * sin(1.3 * t), 0.2 * sin(0.7 * t), 0.05 * sin(0.3 * t));
+		b_AccelerationBody->value() = Vector3(0.0, 0.0, -9.8 * (1.0 + 2.0 * sin(0.7 * t)));
+	}
+
+private:
+	void addScalar(Bus *bus, std::string const &name, double value) {
+		m_Scalars[name] = bus->registerLocalDataChannel(name, value);
+	}
+	void setScalar(std::string const &name, double value) {
+		m_Scalars[name]->value() = value;
+	}
+
+	std::map<std::string, DataChannel<double>::RefT> m_Scalars;
+	DataChannel<Vector3>::RefT b_AccelerationBody;
+	DataChannel<Vector3>::RefT b_AngularVelocityBody;
+};
+
+
+class FcsHarness {
+public:
+	FcsHarness(DataManager &manager, bool compiled) {
+		setFlightControlSystemCompilation(compiled);
+		m_FCS = manager.getObject("vehicles.aircraft.f16.fcs");
+		m_Inputs = new FcsInputs;
+		m_Model = new SystemsModel;
+		m_Model->addChild(m_Inputs.get());
+		m_Model->addChild(m_FCS.get());
+		m_Model->bindSystems();
+		Bus *bus = m_Model->getBus();
+		m_Outputs.push_back(bus->getChannel(bus::ControlSurfaces::ElevatorDeflection));
+		m_Outputs.push_back(bus->getChannel(bus::ControlSurfaces::AileronDeflection));
+		m_Outputs.push_back(bus->getChannel(bus::ControlSurfaces::RudderDeflection));
+		m_Outputs.push_back(bus->getChannel(bus::ControlSurfaces::LeadingEdgeFlapDeflection));
+		m_Outputs.push_back(bus->getChannel(bus::ControlSurfaces::TrailingEdgeFlapDeflection));
+	}
+
+	void step(double t, double dt) {
+		m_Inputs->drive(t);
+		m_FCS->onUpdate(dt);
+	}
+
+	unsigned outputs() const { return static_cast<unsigned>(m_Outputs.size()); }
+	double output(unsigned i) const { return m_Outputs[i]->value(); }
+
+private:
+	Ref<System> m_FCS;
+	Ref<FcsInputs> m_Inputs;
+	Ref<SystemsModel> m_Model;
+	std::vector<DataChannel<double>::CRefT> m_Outputs;
+};
+
+} // namespace
+
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0] << " sim.dar [steps]\n";
+		return 1;
+	}
+	const int steps = (argc > 2) ? atoi(argv[2]) : 200000;
+	const double dt = 1.0 / 60.0;
+
+	registerAllObjectInterfaces();
+	DataManager manager;
+	manager.addArchive(new DataArchive(argv[1], true));
+
+	FcsHarness recursive(manager, false);
+	FcsHarness compiled(manager, true);
+	setFlightControlSystemCompilation(true);
+
+	// parity check over a few minutes of simulated time.
+	double max_error = 0.0;
+	for (int i = 0; i < 10000; ++i) {
+		recursive.step(i * dt, dt);
+		compiled.step(i * dt, dt);
+		for (unsigned j = 0; j < recursive.outputs(); ++j) {
+			max_error = std::max(max_error, std::abs(recursive.output(j) - compiled.output(j)));
+		}
+	}
+
+	Timer timer;
+	timer.start();
+	for (int i = 0; i < steps; ++i) recursive.step(i * dt, dt);
+	const double recursive_time = timer.stop();
+
+	timer.start();
+	for (int i = 0; i < steps; ++i) compiled.step(i * dt, dt);
+	const double compiled_time = timer.stop();
+
+	std::cout << "steps:         " << steps << "\n";
+	std::cout << "recursive:     " << (recursive_time * 1e+9 / steps) << " ns/step\n";
+	std::cout << "compiled:      " << (compiled_time * 1e+9 / steps) << " ns/step\n";
+	std::cout << "speedup:       " << (recursive_time / compiled_time) << "\n";
+	std::cout << "max deviation: " << max_error << "\n";
+	return 0;
+}
@@ -0,0 +1,159 @@
+// Combat Simulator Project
+// Copyright (C) 2007 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+// Measures the cost of creating and binding the systems models of N
+// identical vehicles: loading each model from the archive and binding it
+// by name (as DynamicObject did before SystemsModelPrototype), binding
+// with the channel lookups replayed from the first model, and taking
+// spare models that were loaded ahead of time.
+//
+// usage: spawn_timing path/to/sim.dar [vehicles] [systems model path]
+
+#include <csp/cspsim/KineticsChannels.h>
+#include <csp/cspsim/ObjectModel.h>
+#include <csp/cspsim/RegisterObjectInterfaces.h>
+#include <csp/cspsim/SystemsModel.h>
+#include <csp/cspsim/SystemsModelPrototype.h>
+#include <csp/cspsim/stores/StoresDynamics.h>
+#include <csp/csplib/data/DataArchive.h>
+#include <csp/csplib/data/DataManager.h>
+#include <csp/csplib/data/Matrix3.h>
+#include <csp/csplib/data/Quat.h>
+#include <csp/csplib/data/Vector3.h>
+#include <csp/csplib/util/Timing.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace csp;
+
+namespace {
+
+// Registers the channels that DynamicObject provides to its systems model.
+void registerVehicleChannels(Bus *bus, Ref<ObjectModel> const &model) {
+	bus->registerLocalDataChannel(bus::Kinetics::Position, Vector3::ZERO);
+	bus->registerLocalDataChannel(bus::Kinetics::ModelPosition, Vector3::ZERO);
+	bus->registerLocalDataChannel(bus::Kinetics::Velocity, Vector3::ZERO);
+	bus->registerLocalDataChannel(bus::Kinetics::AccelerationBody, Vector3::ZERO);
+	bus->registerLocalDataChannel(bus::Kinetics::AngularVelocity, Vector3::ZERO);
+	bus->registerLocalDataChannel(bus::Kinetics::AngularVelocityBody, Vector3::ZERO);
+	bus->registerLocalDataChannel(bus::Kinetics::Attitude, Quat::IDENTITY);
+	bus->registerLocalDataChannel(bus::Kinetics::Mass, 1.0);
+	bus->registerLocalDataChannel(bus::Kinetics::Inertia, Matrix3::IDENTITY);
+	bus->registerLocalDataChannel(bus::Kinetics::InertiaInverse, Matrix3::IDENTITY);
+	bus->registerLocalDataChannel(bus::Kinetics::CenterOfMassOffset, Vector3::ZERO);
+	bus->registerLocalDataChannel(bus::Kinetics::GroundN, Vector3::ZAXIS);
+	bus->registerLocalDataChannel(bus::Kinetics::GroundZ, 0.0);
+	bus->registerLocalDataChannel(bus::Kinetics::NearGround, false);
+	bus->registerLocalDataChannel(bus::Kinetics::StoresDynamics, StoresDynamics());
+	bus->registerLocalDataChannel< Ref<ObjectModel> >("Internal.ObjectModel", model);
+}
+
+typedef std::vector<Ref<SystemsModel> > Vehicles;
+
+void report(const char *label, double seconds, int count) {
+	char line[256];
+	snprintf(line, sizeof(line), "%-28s %10.3f ms total, %8.3f ms/vehicle", label, seconds * 1000.0, seconds * 1000.0 / count);
+	std::cout << line << "\n";
+}
+
+} // namespace
+
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0] << " sim.dar [vehicles] [systems model path]\n";
+		return 1;
+	}
+	const int count = (argc > 2) ? atoi(argv[2]) : 16;
+	const Path path((argc > 3) ? argv[3] : "vehicles.aircraft.f16.agent");
+
+	registerAllObjectInterfaces();
+	Ref<DataManager> manager = new DataManager;
+	manager->addArchive(new DataArchive(argv[1], true));
+	Ref<ObjectModel> object_model = new ObjectModel;
+	Timer timer;
+
+	// warm up the archive (static objects and file cache).
+	{
+		Ref<SystemsModel> model;
+		model = manager->getObject(path);
+		if (!model) {
+			std::cerr << "unable to load systems model " << path.getPath() << "\n";
+			return 1;
+		}
+	}
+
+	Vehicles vehicles;
+	timer.start();
+	for (int i = 0; i < count; ++i) {
+		Ref<SystemsModel> model;
+		model = manager->getObject(path);
+		registerVehicleChannels(model->getBus(), object_model);
+		model->bindSystems();
+		vehicles.push_back(model);
+	}
+	const double archive_time = timer.stop();
+	vehicles.clear();
+
+	Ref<SystemsModelPrototype> prototype = new SystemsModelPrototype(*manager, path, 0);
+	{
+		Ref<SystemsModel> model = prototype->create();
+		registerVehicleChannels(model->getBus(), object_model);
+		prototype->bind(model.get());
+	}
+
+	timer.start();
+	for (int i = 0; i < count; ++i) {
+		Ref<SystemsModel> model = prototype->create();
+		registerVehicleChannels(model->getBus(), object_model);
+		prototype->bind(model.get());
+		vehicles.push_back(model);
+	}
+	const double replay_time = timer.stop();
+	vehicles.clear();
+
+	// spare models are loaded between frames, one per frame.
+	prototype->setSpares(count);
+	int frames = 0;
+	timer.start();
+	while (prototype->refill()) ++frames;
+	const double refill_time = timer.stop();
+
+	timer.start();
+	for (int i = 0; i < count; ++i) {
+		Ref<SystemsModel> model = prototype->create();
+		registerVehicleChannels(model->getBus(), object_model);
+		prototype->bind(model.get());
+		vehicles.push_back(model);
+	}
+	const double spare_time = timer.stop();
+	vehicles.clear();
+
+	std::cout << "vehicles:      " << count << "\n";
+	std::cout << "bindings:      " << (prototype->hasBindings() ? "replayed" : "diverged") << "\n";
+	report("load and bind by name:", archive_time, count);
+	report("load and replay bindings:", replay_time, count);
+	report("spare and replay bindings:", spare_time, count);
+	report("load spares (per frame):", refill_time, frames > 0 ? frames : 1);
+	std::cout << "speedup:       " << (archive_time / spare_time) << "\n";
+	return 0;
+}
+
@@ -0,0 +1,73 @@
+// Combat Simulator Project
+// Copyright (C) 2007 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include <csp/cspsim/weather/Atmosphere.h>
+#include <csp/csplib/util/Testing.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace csp;
+using namespace csp::weather;
+
+namespace {
+
+// 1976 Standard Atmosphere density relative to sea level, below 32 km.
+double standardDensity(double h) {
+	if (h < 11000.0) return pow(1.0 - h * 0.0000225586, 4.255876);
+	if (h < 20000.0) return 0.297076 * exp((10999.0 - h) * 0.000157694);
+	return pow(0.978261 + std::min(h, 32000.0) * 0.00000497488, -35.16319);
+}
+
+} // namespace
+
+CSP_TESTFIXTURE(Atmosphere) {
+public:
+	virtual void setupFixture() {
+		m_Atmosphere = new Atmosphere;
+	}
+
+	CSP_TESTCASE(Profile) {
+		const double heights[] = { -250.0, 0.0, 1234.5, 5000.0, 10950.3, 15555.5, 25000.0, 31999.0, 40000.0 };
+		const double ground = m_Atmosphere->getDensity(0.0);
+		for (unsigned i = 0; i < sizeof(heights) / sizeof(heights[0]); ++i) {
+			const double h = heights[i];
+			CSP_VERIFY_LT(std::abs(m_Atmosphere->getDensity(h) / (ground * standardDensity(h)) - 1.0), 1e-5);
+		}
+		// the ideal gas law and the speed of sound at ground level.
+		const double T0 = m_Atmosphere->getTemperature(0.0);
+		CSP_VERIFY_LT(std::abs(m_Atmosphere->getPressure(0.0) / (286.9 * T0) / ground - 1.0), 1e-6);
+		CSP_VERIFY_LT(std::abs(m_Atmosphere->getSpeedOfSound(0.0) - 20.0324 * sqrt(T0)), 1e-3);
+	}
+
+	CSP_TESTCASE(Batch) {
+		const double heights[] = { 0.0, 300.0, 8000.0, 11000.0, 11010.0, 19999.0, 32000.0 };
+		const unsigned n = sizeof(heights) / sizeof(heights[0]);
+		AirProperties air[n];
+		m_Atmosphere->getAir(n, heights, air);
+		for (unsigned i = 0; i < n; ++i) {
+			CSP_VERIFY_EQ(air[i].density, m_Atmosphere->getDensity(heights[i]));
+			CSP_VERIFY_EQ(air[i].pressure, m_Atmosphere->getPressure(heights[i]));
+			CSP_VERIFY_EQ(air[i].temperature, m_Atmosphere->getTemperature(heights[i]));
+			CSP_VERIFY_EQ(air[i].speed_of_sound, m_Atmosphere->getSpeedOfSound(heights[i]));
+		}
+	}
+
+private:
+	Ref<Atmosphere> m_Atmosphere;
+};
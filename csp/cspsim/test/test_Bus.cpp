@@ -0,0 +1,167 @@
+// Combat Simulator Project
+// Copyright (C) 2007 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include <csp/cspsim/Bus.h>
+#include <csp/csplib/data/Matrix3.h>
+#include <csp/csplib/data/Vector3.h>
+#include <csp/csplib/util/Testing.h>
+
+#include <string>
+
+using namespace csp;
+
+CSP_TESTFIXTURE(Bus) {
+public:
+	// registers the same channels on a bus, in the same order.
+	void registerChannels(Bus *bus) {
+		m_Mass = DataChannel<double>::newLocal("Mass", 1.0);
+		m_Gear = DataChannel<bool>::newShared("GearDown", true);
+		m_Position = DataChannel<Vector3>::newLocal("Position", Vector3(1, 2, 3));
+		m_Inertia = DataChannel<Matrix3>::newLocal("Inertia", Matrix3::IDENTITY);
+		m_Label = DataChannel<std::string>::newLocal("Label", "viper");
+		m_Count = DataChannel<int>::newLocalPush("Count", 7);
+		bus->registerChannel(m_Mass.get());
+		bus->registerChannel(m_Gear.get());
+		bus->registerChannel(m_Position.get());
+		bus->registerChannel(m_Inertia.get());
+		bus->registerChannel(m_Label.get());
+		bus->registerChannel(m_Count.get());
+	}
+
+	CSP_TESTCASE(Layout) {
+		Ref<Bus> bus = new Bus("test");
+		registerChannels(bus.get());
+		m_Mass->value() = 2.0;
+		bus->layoutChannels();
+		CSP_VERIFY(bus->hasArena());
+		// bitwise copyable values move into the arena (in order, aligned), others stay in the channel.
+		CSP_VERIFY_EQ(bus->getArenaSize(), sizeof(double) + sizeof(double) + sizeof(Vector3) + sizeof(Matrix3) + sizeof(int));
+		CSP_VERIFY_EQ(m_Mass->value(), 2.0);
+		CSP_VERIFY(m_Gear->value());
+		CSP_VERIFY_EQ(m_Position->value().y(), 2.0);
+		CSP_VERIFY_EQ(m_Inertia->value()(1, 1), 1.0);
+		CSP_VERIFY_EQ(m_Label->value(), "viper");
+		CSP_VERIFY_EQ(m_Count->value(), 7);
+		// channels retrieved from the bus share the relocated values.
+		DataChannel<double>::RefT mass = bus->getSharedChannel("Mass", true, true);
+		mass->value() = 3.0;
+		CSP_VERIFY_EQ(m_Mass->value(), 3.0);
+		// values return to the channels when the bus is destroyed.
+		bus = 0;
+		CSP_VERIFY_EQ(m_Mass->value(), 3.0);
+		CSP_VERIFY_EQ(m_Position->value().z(), 3.0);
+	}
+
+	CSP_TESTCASE(SaveRestore) {
+		Ref<Bus> bus = new Bus("test");
+		registerChannels(bus.get());
+		ChannelState state;
+		CSP_VERIFY(!bus->saveState(state));
+		bus->layoutChannels();
+		CSP_VERIFY(bus->saveState(state));
+		CSP_VERIFY_EQ(state.size(), bus->getArenaSize());
+		m_Mass->value() = 5.0;
+		m_Gear->value() = false;
+		m_Position->value() = Vector3(4, 5, 6);
+		m_Label->value() = "falcon";
+		CSP_VERIFY(bus->restoreState(state));
+		CSP_VERIFY_EQ(m_Mass->value(), 1.0);
+		CSP_VERIFY(m_Gear->value());
+		CSP_VERIFY_EQ(m_Position->value().x(), 1.0);
+		// not in the arena, so not part of the state.
+		CSP_VERIFY_EQ(m_Label->value(), "falcon");
+
+		// restore into a second bus with the same layout.
+		m_Mass->value() = 9.0;
+		CSP_VERIFY(bus->saveState(state));
+		Ref<Bus> copy = new Bus("copy");
+		registerChannels(copy.get());
+		copy->layoutChannels();
+		CSP_VERIFY(copy->restoreState(state));
+		CSP_VERIFY_EQ(m_Mass->value(), 9.0);
+
+		// a different layout is rejected.
+		Ref<Bus> other = new Bus("other");
+		other->registerChannel(DataChannel<double>::newLocal("Mass", 1.0));
+		other->layoutChannels();
+		CSP_VERIFY(!other->restoreState(state));
+	}
+
+	CSP_TESTCASE(Bindings) {
+		ChannelBindings bindings;
+		Ref<Bus> bus = new Bus("test");
+		registerChannels(bus.get());
+		bus->recordBindings(bindings);
+		CSP_VERIFY(bus->getChannel("Position").valid());
+		CSP_VERIFY(!bus->getChannel("Missing", false));
+		CSP_VERIFY(bus->getSharedChannel("GearDown").valid());
+		CSP_VERIFY(bus->finishBindings());
+		CSP_VERIFY_EQ(bindings.size(), 3u);
+
+		// the same lookups on another bus return that bus's channels.
+		Ref<Bus> copy = new Bus("copy");
+		registerChannels(copy.get());
+		copy->replayBindings(bindings);
+		DataChannel<Vector3>::CRefT position = copy->getChannel("Position");
+		CSP_VERIFY(position.get() == m_Position.get());
+		CSP_VERIFY(!copy->getChannel("Missing", false));
+		CSP_VERIFY(copy->getSharedChannel("GearDown").get() == m_Gear.get());
+		CSP_VERIFY(copy->finishBindings());
+
+		// a different lookup falls back to the name.
+		Ref<Bus> other = new Bus("other");
+		registerChannels(other.get());
+		other->replayBindings(bindings);
+		CSP_VERIFY(other->getChannel("Position").get() == m_Position.get());
+		CSP_VERIFY(other->getChannel("Mass").get() == m_Mass.get());
+		CSP_VERIFY(other->getChannel("Label").get() == m_Label.get());
+		CSP_VERIFY(!other->finishBindings());
+
+		// an incomplete replay is also reported.
+		other->replayBindings(bindings);
+		CSP_VERIFY(other->getChannel("Position").valid());
+		CSP_VERIFY(!other->finishBindings());
+
+		// a bus with different channels binds by name.
+		Ref<Bus> extra = new Bus("extra");
+		registerChannels(extra.get());
+		extra->registerChannel(DataChannel<double>::newLocal("Extra", 1.0));
+		extra->replayBindings(bindings);
+		CSP_VERIFY(extra->getChannel("Position").get() == m_Position.get());
+		CSP_VERIFY(!extra->getChannel("Missing", false));
+		CSP_VERIFY(extra->getSharedChannel("GearDown").get() == m_Gear.get());
+		CSP_VERIFY(!extra->finishBindings());
+
+		// a recorded missing channel that is present on the bus is found.
+		Ref<Bus> present = new Bus("present");
+		registerChannels(present.get());
+		present->replayBindings(bindings);
+		CSP_VERIFY(present->getChannel("Position").valid());
+		present->registerChannel(DataChannel<double>::newLocal("Missing", 1.0));
+		CSP_VERIFY(present->getChannel("Missing", false).valid());
+		CSP_VERIFY(!present->finishBindings());
+	}
+
+private:
+	DataChannel<double>::RefT m_Mass;
+	DataChannel<bool>::RefT m_Gear;
+	DataChannel<Vector3>::RefT m_Position;
+	DataChannel<Matrix3>::RefT m_Inertia;
+	DataChannel<std::string>::RefT m_Label;
+	DataChannel<int>::RefT m_Count;
+};
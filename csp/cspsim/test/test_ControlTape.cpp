@@ -0,0 +1,154 @@
+// Combat Simulator Project
+// Copyright (C) 2006 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include <csp/cspsim/FlightControlSystem.h>
+#include <csp/cspsim/SystemsModel.h>
+#include <csp/csplib/data/InterfaceProxy.h>
+#include <csp/csplib/data/InterfaceRegistry.h>
+#include <csp/csplib/data/Key.h>
+#include <csp/csplib/data/TypeAdapter.h>
+#include <csp/csplib/util/Testing.h>
+
+#include <vector>
+
+using namespace csp;
+
+namespace {
+
+// Supplies the switch selectors read by the test network.
+class Selectors: public System {
+public:
+	void select(bool a) {
+		b_Select->value() = a ? 0.0 : 1.0;
+		b_Flag->value() = a;
+	}
+protected:
+	virtual void registerChannels(Bus *bus) {
+		b_Select = bus->registerLocalDataChannel<double>("Test.Select", 0.0);
+		b_Flag = bus->registerLocalDataChannel<bool>("Test.Flag", true);
+	}
+	virtual void importChannels(Bus*) {}
+private:
+	DataChannel<double>::RefT b_Select;
+	DataChannel<bool>::RefT b_Flag;
+};
+
+// A flight control network with an integrator on input A of a switch and
+// of a boolean switch, evaluated either recursively or as a ControlTape.
+class Network {
+public:
+	Network(bool compiled) {
+		setFlightControlSystemCompilation(compiled);
+		InterfaceProxy *fcs = getInterface("FlightControlSystem");
+		m_FCS = fcs->createObject();
+		addNode("Constant", "rate").set("value", TypeAdapter(1.0));
+		addNode("Constant", "hold").set("value", TypeAdapter(-1.0));
+		addNode("InputScalarChannel", "select").set("channel", TypeAdapter("Test.Select"));
+		addNode("Integrator", "integral").set("input", TypeAdapter(Key("rate")));
+		addNode("Integrator", "integral2").set("input", TypeAdapter(Key("rate")));
+		Node sw = addNode("Switch", "switch");
+		sw.set("input_a", TypeAdapter(Key("integral")));
+		sw.set("input_b", TypeAdapter(Key("hold")));
+		sw.set("input_c", TypeAdapter(Key("select")));
+		sw.set("compare", TypeAdapter(0.5));
+		Node bsw = addNode("BooleanSwitch", "bswitch");
+		bsw.set("input_a", TypeAdapter(Key("integral2")));
+		bsw.set("input_b", TypeAdapter(Key("hold")));
+		bsw.set("channel", TypeAdapter("Test.Flag"));
+		Node out = addNode("OutputChannel", "out");
+		out.set("input", TypeAdapter(Key("switch")));
+		out.set("channel", TypeAdapter("Test.Output"));
+		Node out2 = addNode("OutputChannel", "out2");
+		out2.set("input", TypeAdapter(Key("bswitch")));
+		out2.set("channel", TypeAdapter("Test.Output2"));
+		for (unsigned i = 0; i < m_Nodes.size(); ++i) {
+			m_Nodes[i]->_postCreate();
+			fcs->push_back(m_FCS.get(), "nodes", TypeAdapter(LinkBase(m_Nodes[i].get())));
+		}
+		m_FCS->_postCreate();
+		setFlightControlSystemCompilation(true);
+
+		m_Selectors = new Selectors;
+		m_Model = new SystemsModel;
+		m_Model->addChild(m_Selectors.get());
+		m_Model->addChild(m_FCS.get());
+		m_Model->bindSystems();
+		m_Output = m_Model->getBus()->getChannel("Test.Output");
+		m_Output2 = m_Model->getBus()->getChannel("Test.Output2");
+	}
+
+	void step(bool select_a, double dt) {
+		m_Selectors->select(select_a);
+		m_FCS->onUpdate(dt);
+	}
+
+	double output() const { return m_Output->value(); }
+	double output2() const { return m_Output2->value(); }
+
+private:
+	struct Node {
+		InterfaceProxy *proxy;
+		Object *object;
+		void set(const char *name, TypeAdapter const &value) { proxy->set(object, name, value); }
+	};
+
+	static InterfaceProxy *getInterface(const char *type) {
+		return InterfaceRegistry::getInterfaceRegistry().getInterface(type);
+	}
+
+	Node addNode(const char *type, const char *id) {
+		Node node = { getInterface(type), 0 };
+		m_Nodes.push_back(node.proxy->createObject());
+		node.object = m_Nodes.back().get();
+		node.set("id", TypeAdapter(Key(id)));
+		return node;
+	}
+
+	std::vector<Ref<Object> > m_Nodes;
+	Ref<System> m_FCS;
+	Ref<Selectors> m_Selectors;
+	Ref<SystemsModel> m_Model;
+	DataChannel<double>::CRefT m_Output;
+	DataChannel<double>::CRefT m_Output2;
+};
+
+} // namespace
+
+CSP_TESTFIXTURE(ControlTape) {
+public:
+	virtual void setup() {
+		registerFlightControlSystemObjects();
+	}
+
+	CSP_TESTCASE(SwitchMatchesRecursiveEvaluation) {
+		Network recursive(false);
+		Network compiled(true);
+		const double dt = 0.1;
+		// select input A, then B, then A again.  the integrators only feed
+		// input A, so they hold their value while B is selected.
+		for (int i = 0; i < 30; ++i) {
+			const bool select_a = (i < 10 || i >= 20);
+			recursive.step(select_a, dt);
+			compiled.step(select_a, dt);
+			CSP_VERIFY_EQ(compiled.output(), recursive.output());
+			CSP_VERIFY_EQ(compiled.output2(), recursive.output2());
+		}
+		CSP_EXPECT_DEQ(compiled.output(), 20 * dt);
+		CSP_EXPECT_DEQ(compiled.output2(), 20 * dt);
+	}
+};
@@ -0,0 +1,138 @@
+// Combat Simulator Project
+// Copyright (C) 2007 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include <csp/cspsim/HitDetection.h>
+#include <csp/cspsim/DynamicObject.h>
+#include <csp/cspsim/stores/DragProfile.h>
+#include <csp/cspsim/stores/Flyout.h>
+#include <csp/cspsim/stores/Stores.h>
+#include <csp/csplib/util/Testing.h>
+
+#include <cmath>
+#include <vector>
+
+using namespace csp;
+
+namespace {
+
+const SimObject::ObjectId Launcher = 3;
+const double Altitude = 5000.0;
+const Vector3 Camera(0.0, 0.0, 1e6);  // far enough that rounds are never promoted.
+
+// Run hit detection for the paths of the last flyout update against an
+// aircraft (with a 20 m box) flying north at 200 m/s from the origin.
+void detectHits(Flyout &flyout, double dt) {
+	HitDetection detection;
+	const unsigned first = flyout.addQueries(detection);
+	detection.addTarget(Ref<DynamicObject>(), Launcher, Vector3(0.0, 200.0 * dt, Altitude), Vector3(0.0, 200.0, 0.0), Quat::IDENTITY, Vector3(-10.0, -10.0, -10.0), Vector3(10.0, 10.0, 10.0));
+	detection.run(dt);
+	detection.report();
+	flyout.removeHits(detection.getHits(), first);
+}
+
+// A round released below the aircraft, still inside its bounding box.
+Flyout::Round release(double damage, SimObject::ObjectId owner) {
+	Flyout::Round round;
+	round.position = Vector3(0.0, 0.0, Altitude - 2.0);
+	round.velocity = Vector3(0.0, 200.0, -3.0);
+	round.mass = 250.0;
+	round.drag_factor = 0.05;
+	round.damage = damage;
+	round.owner = owner;
+	return round;
+}
+
+} // namespace
+
+CSP_TESTFIXTURE(Flyout) {
+
+	CSP_TESTCASE(ReleasedStoreSurvivesFirstUpdate) {
+		Flyout flyout;
+		std::vector<Ref<DynamicObject> > promoted;
+		// a released store has an owner and no damage of its own.
+		flyout.add(release(0.0, Launcher));
+		flyout.update(0.02, Camera, promoted);
+		detectHits(flyout, 0.02);
+		CSP_VERIFY_EQ(flyout.size(), 1u);
+		// an armed round fired by the aircraft doesn't hit it either.
+		flyout.add(release(1.0, Launcher));
+		flyout.update(0.02, Camera, promoted);
+		detectHits(flyout, 0.02);
+		CSP_VERIFY_EQ(flyout.size(), 2u);
+		CSP_VERIFY(promoted.empty());
+	}
+
+	CSP_TESTCASE(RoundHitsOtherObject) {
+		Flyout flyout;
+		std::vector<Ref<DynamicObject> > promoted;
+		flyout.add(release(1.0, Launcher + 1));
+		flyout.update(0.02, Camera, promoted);
+		detectHits(flyout, 0.02);
+		CSP_VERIFY_EQ(flyout.size(), 0u);
+	}
+
+	CSP_TESTCASE(GroundImpact) {
+		Flyout flyout;
+		std::vector<Ref<DynamicObject> > promoted;
+		// a round diving into the ground (at zero elevation) next to a tank.
+		Flyout::Round round;
+		round.position = Vector3(30.0, 0.0, 10.0);
+		round.velocity = Vector3(0.0, 0.0, -300.0);
+		round.mass = 10.0;
+		round.damage = 0.5;
+		round.radius = 35.0;
+		round.owner = Launcher;
+		flyout.add(round);
+		flyout.update(0.1, Camera, promoted);
+		CSP_VERIFY_EQ(flyout.size(), 0u);
+		// the path down to the impact is still tested, and the fuze radius
+		// reaches the tank.
+		HitDetection detection;
+		const unsigned first = flyout.addQueries(detection);
+		CSP_VERIFY_EQ(detection.numQueries(), 1u);
+		HitDetection::Query const &query = detection.getQuery(first);
+		CSP_VERIFY_LT(std::abs(query.end.z()), 1e-6);
+		detection.addTarget(Ref<DynamicObject>(), Launcher + 1, Vector3(0.0, 0.0, 1.5), Vector3::ZERO, Quat::IDENTITY, Vector3(-2.0, -4.0, -1.5), Vector3(2.0, 4.0, 1.5));
+		detection.run(0.1);
+		CSP_VERIFY_EQ(detection.getHits().size(), 1u);
+		flyout.removeHits(detection.getHits(), first);
+		CSP_VERIFY_EQ(flyout.size(), 0u);
+		// unarmed stores leave no path behind.
+		round.damage = 0.0;
+		flyout.add(round);
+		flyout.update(0.1, Camera, promoted);
+		HitDetection unarmed;
+		flyout.addQueries(unarmed);
+		CSP_VERIFY_EQ(unarmed.numQueries(), 0u);
+	}
+
+	CSP_TESTCASE(PausedFrame) {
+		Flyout flyout;
+		std::vector<Ref<DynamicObject> > promoted;
+		flyout.add(release(1.0, Launcher + 1));
+		flyout.update(0.02, Camera, promoted);
+		flyout.update(0.0, Camera, promoted);
+		// the path of a paused frame is empty, not the previous frame's path.
+		HitDetection detection;
+		flyout.addQueries(detection);
+		CSP_VERIFY_EQ(detection.numQueries(), 1u);
+		HitDetection::Query const &query = detection.getQuery(0);
+		CSP_VERIFY_EQ(query.start, query.end);
+	}
+};
+
@@ -0,0 +1,78 @@
+// Combat Simulator Project
+// Copyright (C) 2007 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include <csp/cspsim/Projection.h>
+#include <csp/csplib/util/Testing.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace csp;
+
+// The batch conversions must agree with the single point conversions.  An odd
+// number of points is used so that both the vector and scalar paths are tested.
+CSP_TESTFIXTURE(Projection) {
+public:
+	virtual void setupFixture() {
+		// a 1000 km theater centered at 35N 128E.
+		m_Projection = new SecantGnomonicProjection(toRadians(35.0), toRadians(128.0), 1000000.0, 1000000.0);
+		m_X.clear();
+		m_Y.clear();
+		for (int i = 0; i < 33; ++i) {
+			for (int j = 0; j < 33; ++j) {
+				m_X.push_back(-500000.0 + i * 31250.0);
+				m_Y.push_back(-500000.0 + j * 31250.0);
+			}
+		}
+		m_X.push_back(1234.5);
+		m_Y.push_back(-6789.0);
+	}
+
+	CSP_TESTCASE(Unproject) {
+		const unsigned n = m_X.size();
+		std::vector<double> lat(n), lon(n);
+		m_Projection->unproject(n, &m_X[0], &m_Y[0], &lat[0], &lon[0]);
+		double error = 0.0;
+		for (unsigned i = 0; i < n; ++i) {
+			LLA lla = m_Projection->convert(Vector3(m_X[i], m_Y[i], 0.0));
+			error = std::max(error, std::max(std::abs(lla.latitude() - lat[i]), std::abs(lla.longitude() - lon[i])));
+		}
+		CSP_VERIFY_LT(error, 1e-12);
+	}
+
+	CSP_TESTCASE(Project) {
+		const unsigned n = m_X.size();
+		std::vector<double> lat(n), lon(n), x(n), y(n);
+		m_Projection->unproject(n, &m_X[0], &m_Y[0], &lat[0], &lon[0]);
+		m_Projection->project(n, &lat[0], &lon[0], &x[0], &y[0]);
+		double error = 0.0;
+		double round_trip = 0.0;
+		for (unsigned i = 0; i < n; ++i) {
+			Vector3 pos = m_Projection->convert(LLA(lat[i], lon[i]));
+			error = std::max(error, std::max(std::abs(pos.x() - x[i]), std::abs(pos.y() - y[i])));
+			round_trip = std::max(round_trip, std::max(std::abs(m_X[i] - x[i]), std::abs(m_Y[i] - y[i])));
+		}
+		CSP_VERIFY_LT(error, 1e-6);
+		CSP_VERIFY_LT(round_trip, 1e-3);
+	}
+
+private:
+	Ref<Projection> m_Projection;
+	std::vector<double> m_X, m_Y;
+};
@@ -0,0 +1,83 @@
+// Combat Simulator Project
+// Copyright (C) 2007 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include <csp/cspsim/SystemsModel.h>
+#include <csp/csplib/util/SynchronousUpdate.h>
+#include <csp/csplib/util/Testing.h>
+
+using namespace csp;
+
+namespace {
+
+// A system that counts its update callbacks.
+class CountingSystem: public System {
+public:
+	CountingSystem(): m_Calls(0) {}
+	int calls() const { return m_Calls; }
+protected:
+	virtual void registerChannels(Bus*) {}
+	virtual void importChannels(Bus*) {}
+	virtual double onUpdate(double) { ++m_Calls; return 0.0; }
+private:
+	int m_Calls;
+};
+
+// Stands in for the DynamicObject that owns the systems model.
+class Owner: public UpdateTarget {
+protected:
+	virtual double onUpdate(double) { return 0.0; }
+};
+
+} // namespace
+
+CSP_TESTFIXTURE(SystemsModel) {
+public:
+	virtual void setup() {
+		m_Systems = new SystemsModel;
+		m_Engine = new CountingSystem;
+		m_Autopilot = new CountingSystem;
+		m_Systems->addChild(m_Engine.get());
+		m_Engine->addChild(m_Autopilot.get());
+		m_Systems->bindSystems();
+	}
+
+	CSP_TESTCASE(Aggregate) {
+		UpdateMaster master;
+		Owner owner;
+		owner.registerUpdate(&master);
+		m_Systems->registerUpdate(&master);
+		for (int i = 0; i < 5; ++i) master.update(0.1);
+		CSP_VERIFY_EQ(m_Engine->calls(), 5);
+		CSP_VERIFY_EQ(m_Autopilot->calls(), 5);
+		// aggregation disconnects every system in the tree.
+		m_Systems->registerUpdate(0);
+		for (int i = 0; i < 5; ++i) master.update(0.1);
+		CSP_VERIFY_EQ(m_Engine->calls(), 5);
+		CSP_VERIFY_EQ(m_Autopilot->calls(), 5);
+		// and deaggregation restores the owner's registration.
+		m_Systems->copyRegistration(&owner);
+		for (int i = 0; i < 5; ++i) master.update(0.1);
+		CSP_VERIFY_EQ(m_Engine->calls(), 10);
+		CSP_VERIFY_EQ(m_Autopilot->calls(), 10);
+	}
+
+private:
+	Ref<SystemsModel> m_Systems;
+	Ref<CountingSystem> m_Engine;
+	Ref<CountingSystem> m_Autopilot;
+};
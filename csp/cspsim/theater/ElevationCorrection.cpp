@@ -53,5 +53,26 @@ osg::Vec3 ElevationCorrection::operator()(osg::Vec3 const &offset) const {
 	return offset + osg::Z_AXIS * elevation;
 }
 
+void ElevationCorrection::correct(std::vector<osg::Vec3> &offsets) const {
+	const unsigned n = offsets.size();
+	if (n == 0) return;
+	if (m_Terrain == 0) {
+		CSPLOG(Prio_ERROR, Cat_SCENE) << "No elevation data available for " << n << " features!";
+		return;
+	}
+	std::vector<double> x(n), y(n);
+	std::vector<float> elevation(n);
+	for (unsigned i = 0; i < n; ++i) {
+		const osg::Vec3 absolute = LayoutTransform::operator()(offsets[i]);
+		x[i] = absolute.x();
+		y[i] = absolute.y();
+	}
+	m_Terrain->getGroundElevations(n, &x[0], &y[0], &elevation[0]);
+	for (unsigned i = 0; i < n; ++i) {
+		offsets[i] += osg::Z_AXIS * elevation[i];
+	}
+	CSPLOG(Prio_DEBUG, Cat_SCENE) << "Corrected elevation of " << n << " features";
+}
+
 } // namespace csp
 
@@ -27,6 +27,8 @@
 #include <csp/cspsim/theater/LayoutTransform.h>
 #include <osg/Vec3>
 
+#include <vector>
+
 namespace csp {
 
 class TerrainObject;
@@ -43,6 +45,12 @@ class CSPSIM_EXPORT ElevationCorrection: public LayoutTransform {
 public:
 	ElevationCorrection(TerrainObject *terrain, float x=0.0, float y=0.0, float angle=0.0);
 	osg::Vec3 operator()(osg::Vec3 const &offset) const;
+
+	/** Correct the elevation of many offsets at once.  Equivalent to
+	 *  applying operator() to each offset, but the terrain queries are
+	 *  batched.
+	 */
+	void correct(std::vector<osg::Vec3> &offsets) const;
 };
 
 } // namespace csp
@@ -26,6 +26,7 @@
 #include <csp/cspsim/theater/FeatureGroup.h>
 #include <csp/cspsim/theater/FeatureObjectModel.h>
 #include <csp/cspsim/theater/FeatureSceneGroup.h>
+#include <csp/cspsim/theater/FeatureTileBuilder.h>
 #include <csp/cspsim/theater/LayoutTransform.h>
 #include <csp/cspsim/theater/ElevationCorrection.h>
 #include <csp/cspsim/TerrainObject.h>
@@ -37,6 +38,9 @@
 #include <osg/Vec3>
 #include <osg/Quat>
 
+#include <iomanip>
+#include <sstream>
+
 namespace csp {
 
 CSP_XML_BEGIN(FeatureGroup)
@@ -69,7 +73,20 @@ void FeatureGroup::onLeaveScene() {
 FeatureSceneGroup* FeatureGroup::makeSceneGroup(Vector3 const &origin, TerrainObject *terrain) {
 	assert(!m_SceneGroup);
 	m_SceneGroup = new FeatureSceneGroup();
-	m_Model->addSceneModel(m_SceneGroup.get(), LayoutTransform(), ElevationCorrection(terrain, m_X, m_Y, m_Orientation));
+	ElevationCorrection correction(terrain, m_X, m_Y, m_Orientation);
+	if (FeatureTileBuilder::isEnabled()) {
+		// the merged features are cached by terrain and layout.
+		std::ostringstream key;
+		if (terrain) key << terrain->getName() << ":" << terrain->getVersion();
+		key << ":" << m_Model->getPath() << std::fixed << std::setprecision(3) << ":" << m_X << ":" << m_Y << ":" << m_Orientation;
+		FeatureTileBuilder builder(key.str());
+		m_SceneGroup->setTileBuilder(&builder);
+		m_Model->addSceneModel(m_SceneGroup.get(), LayoutTransform(), correction);
+		m_SceneGroup->setTileBuilder(0);
+		builder.build(m_SceneGroup.get(), correction);
+	} else {
+		m_Model->addSceneModel(m_SceneGroup.get(), LayoutTransform(), correction);
+	}
 	m_SceneGroup->setPosition(osg::Vec3(m_X-origin.x(), m_Y-origin.y(), -origin.z()));
 	m_SceneGroup->setAttitude(osg::Quat(m_Orientation, osg::Z_AXIS));
 	return m_SceneGroup.get();
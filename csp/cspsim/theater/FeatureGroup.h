@@ -105,7 +105,8 @@ public:
 	 * The scene graph will be positioned relative to the supplied origin (which
 	 * is usually the origin of the Battlefield cell that contains the
 	 * FeatureGroup.  Elevation corrections are computed for each individual
-	 * feature using the supplied terrain model.
+	 * feature using the supplied terrain model.  Static features are merged
+	 * into shared geometry batches when possible (see FeatureTileBuilder).
 	 */
 	virtual FeatureSceneGroup* makeSceneGroup(Vector3 const &origin, TerrainObject *terrain);
 
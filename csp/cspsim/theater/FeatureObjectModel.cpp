@@ -27,6 +27,7 @@
 #include <csp/cspsim/theater/FeatureObjectModel.h>
 #include <csp/cspsim/theater/FeatureSceneGroup.h>
 #include <csp/cspsim/theater/FeatureSceneModel.h>
+#include <csp/cspsim/theater/FeatureTileBuilder.h>
 #include <csp/cspsim/theater/LayoutTransform.h>
 #include <csp/cspsim/theater/ElevationCorrection.h>
 
@@ -45,13 +46,16 @@ CSP_XML_END
 
 void FeatureObjectModel::addSceneModel(FeatureSceneGroup *group, LayoutTransform const &transform, ElevationCorrection const &correction) {
 	assert(group != 0);
+	// static features are merged into shared batches when possible.
+	FeatureTileBuilder *builder = group->getTileBuilder();
+	if (builder && builder->add(m_ObjectModel, transform, m_ObjectModel->getElevationCorrection())) return;
 	FeatureSceneModel *model;
 	if (m_ObjectModel->getElevationCorrection()) {
 		model = new FeatureSceneModel(transform, correction);
 	} else {
 		model = new FeatureSceneModel(transform);
 	}
-	model->addChild(m_ObjectModel->getModel().get());
+	model->addChild(m_ObjectModel->getLodModel().get());
 	if (m_ObjectModel->getGroundShadow().valid()) {
 		model->addChild(m_ObjectModel->getGroundShadow().get());
 	}
@@ -38,6 +38,7 @@
 #include <osgDB/ReadFile>
 #include <osg/CullFace>
 #include <osg/Material>
+#include <osg/Uniform>
 
 namespace csp {
 
@@ -90,6 +91,46 @@ osg::Geometry *FeatureQuad::makeGeometry() const {
 	return geom;
 }
 
+osg::Geometry *FeatureQuad::makeCrossGeometry() const {
+	const float x0 = m_Width * (m_OffsetX - 0.5f);
+	const float x1 = m_Width * (m_OffsetX + 0.5f);
+	const float z0 = m_Height * (m_OffsetY - 0.5f);
+	const float z1 = m_Height * (m_OffsetY + 0.5f);
+
+	osg::Vec3Array& v = *(new osg::Vec3Array(8));
+	osg::Vec3Array& n = *(new osg::Vec3Array(8));
+	osg::Vec2Array& t = *(new osg::Vec2Array(8));
+	osg::Vec4Array& l = *(new osg::Vec4Array(1));
+
+	l[0].set(1.0, 1.0, 1.0, 1.0);
+
+	// one quad in the xz plane and one in the yz plane.  the quads are
+	// single sided; the instanced state set disables back face culling.
+	v[0].set(x0, 0.0, z0); v[1].set(x1, 0.0, z0); v[2].set(x1, 0.0, z1); v[3].set(x0, 0.0, z1);
+	v[4].set(0.0, x0, z0); v[5].set(0.0, x1, z0); v[6].set(0.0, x1, z1); v[7].set(0.0, x0, z1);
+
+	for (int i = 0; i < 4; ++i) {
+		n[i].set(0.0, -1.0, 0.0);
+		n[i + 4].set(1.0, 0.0, 0.0);
+	}
+	for (int k = 0; k < 8; k += 4) {
+		t[k + 0].set(0.0, 0.0);
+		t[k + 1].set(1.0, 0.0);
+		t[k + 2].set(1.0, 1.0);
+		t[k + 3].set(0.0, 1.0);
+	}
+
+	osg::Geometry *geom = new osg::Geometry;
+	geom->setVertexArray(&v);
+	geom->setTexCoordArray(0, &t);
+	geom->setColorArray(&l);
+	geom->setColorBinding(osg::Geometry::BIND_OVERALL);
+	geom->setNormalArray(&n);
+	geom->setNormalBinding(osg::Geometry::BIND_PER_VERTEX);
+	geom->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::QUADS, 0, 8));
+	return geom;
+}
+
 osg::StateSet* FeatureQuad::makeStateSet() const {
 	osg::Texture2D* tex = new osg::Texture2D;
 	std::string image_path = getDataPath("ImagePath");
@@ -114,6 +155,14 @@ osg::StateSet* FeatureQuad::makeStateSet() const {
 	return state;
 }
 
+osg::StateSet* FeatureQuad::makeInstancedStateSet() const {
+	osg::StateSet *state = new osg::StateSet(*getStateSet(), osg::CopyOp::SHALLOW_COPY);
+	state->setMode(GL_CULL_FACE, osg::StateAttribute::OFF);
+	state->addUniform(new osg::Uniform("lighting", m_Lighting));
+	Shader::instance()->applyShader("vegetation", state);
+	return state;
+}
+
 FeatureQuad::FeatureQuad() {
 	m_OffsetX = 0.0;
 	m_OffsetY = 0.5;
@@ -139,5 +188,19 @@ osg::StateSet * FeatureQuad::getStateSet() const {
 	return m_StateSet.get();
 }
 
+osg::Geometry * FeatureQuad::getCrossGeometry() const {
+	if (!m_CrossGeometry) {
+		m_CrossGeometry = makeCrossGeometry();
+	}
+	return m_CrossGeometry.get();
+}
+
+osg::StateSet * FeatureQuad::getInstancedStateSet() const {
+	if (!m_InstancedStateSet) {
+		m_InstancedStateSet = makeInstancedStateSet();
+	}
+	return m_InstancedStateSet.get();
+}
+
 } // namespace csp
 
@@ -49,10 +49,14 @@ class FeatureQuad: public Object {
 	float m_OffsetX, m_OffsetY;
 	bool m_Lighting;
 	mutable osg::ref_ptr<osg::Geometry> m_Geometry;
+	mutable osg::ref_ptr<osg::Geometry> m_CrossGeometry;
 	mutable osg::ref_ptr<osg::StateSet> m_StateSet;
+	mutable osg::ref_ptr<osg::StateSet> m_InstancedStateSet;
 
 	osg::Geometry *makeGeometry() const;
+	osg::Geometry *makeCrossGeometry() const;
 	osg::StateSet* makeStateSet() const;
+	osg::StateSet* makeInstancedStateSet() const;
 
 public:
 	CSP_DECLARE_STATIC_OBJECT(FeatureQuad)
@@ -69,6 +73,16 @@ public:
 	osg::Geometry * getGeometry() const;
 	osg::StateSet * getStateSet() const;
 
+	/** Two copies of the quad crossed at right angles about the vertical
+	 *  axis, for use with the instanced state set.
+	 */
+	osg::Geometry * getCrossGeometry() const;
+
+	/** The state set used to draw instanced copies of the quad (see
+	 *  InstancedVegetation).
+	 */
+	osg::StateSet * getInstancedStateSet() const;
+
 };
 
 } // namespace csp
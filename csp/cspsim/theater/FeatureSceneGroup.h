@@ -27,6 +27,8 @@
 
 namespace csp {
 
+class FeatureTileBuilder;
+
 /**
  * Scene graph class to encapsulate and position and orientation
  * of one 3D model contained in a FeatureGroup.  The origin and
@@ -34,6 +36,17 @@ namespace csp {
  */
 class FeatureSceneGroup: public osg::PositionAttitudeTransform {
 public:
+	FeatureSceneGroup(): m_TileBuilder(0) { }
+
+	/** While the scene group is being constructed, static features can be
+	 *  passed to a tile builder to be merged instead of being added as
+	 *  separate models.  Returns null if merging is not enabled.
+	 */
+	FeatureTileBuilder *getTileBuilder() const { return m_TileBuilder; }
+	void setTileBuilder(FeatureTileBuilder *builder) { m_TileBuilder = builder; }
+
+private:
+	FeatureTileBuilder *m_TileBuilder;
 };
 
 } // namespace csp
@@ -0,0 +1,494 @@
+// Combat Simulator Project
+// Copyright (C) 2002 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/**
+ * @file FeatureTileBuilder.cpp
+ *
+ **/
+
+
+#include <csp/cspsim/theater/FeatureTileBuilder.h>
+#include <csp/cspsim/theater/ElevationCorrection.h>
+#include <csp/cspsim/theater/FeatureSceneGroup.h>
+#include <csp/cspsim/Config.h>
+#include <csp/cspsim/ObjectModel.h>
+
+#include <csp/csplib/data/Archive.h>
+#include <csp/csplib/util/FileUtility.h>
+#include <csp/csplib/util/HashUtility.h>
+#include <csp/csplib/util/Log.h>
+#include <csp/csplib/util/Timing.h>
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <osg/PositionAttitudeTransform>
+#include <osg/TriangleIndexFunctor>
+#include <osgDB/FileUtils>
+#include <osgDB/ReadFile>
+#include <osgDB/WriteFile>
+
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <typeinfo>
+
+namespace csp {
+
+namespace {
+
+/** Change to invalidate cached tiles when the merged scene graph changes. */
+const int CacheVersion = 1;
+
+/** Batches are split to allow 16-bit indices. */
+const unsigned MaxBatchVertices = 65536;
+
+/** Hash of the contents of a model file, or of its name if it can't be
+ *  read.  Files are only read once per run.
+ */
+uint64_t hashModelFile(std::string const &path) {
+	static std::map<std::string, uint64_t> hashes;
+	if (path.empty()) return 0;
+	std::map<std::string, uint64_t>::const_iterator iter = hashes.find(path);
+	if (iter != hashes.end()) return iter->second;
+	std::string data = path;
+	std::ifstream file(osgDB::findDataFile(path).c_str(), std::ios::binary);
+	if (file) {
+		std::ostringstream contents;
+		contents << file.rdbuf();
+		data = contents.str();
+	}
+	const uint64_t hash = hash_string(data).u64();
+	hashes[path] = hash;
+	return hash;
+}
+
+bool isTriangleMode(GLenum mode) {
+	switch (mode) {
+		case osg::PrimitiveSet::TRIANGLES:
+		case osg::PrimitiveSet::TRIANGLE_STRIP:
+		case osg::PrimitiveSet::TRIANGLE_FAN:
+		case osg::PrimitiveSet::QUADS:
+		case osg::PrimitiveSet::QUAD_STRIP:
+		case osg::PrimitiveSet::POLYGON:
+			return true;
+		default:
+			return false;
+	}
+}
+
+bool isSimpleBinding(osg::Geometry::AttributeBinding binding) {
+	return binding == osg::Geometry::BIND_OFF || binding == osg::Geometry::BIND_OVERALL || binding == osg::Geometry::BIND_PER_VERTEX;
+}
+
+/** Returns true if the geometry can be appended to a batch. */
+bool isMergeable(osg::Geometry const &geometry) {
+	if (!geometry.areFastPathsUsed()) return false;
+	if (geometry.getUpdateCallback() || geometry.getCullCallback() || geometry.getDrawCallback()) return false;
+	if (!dynamic_cast<osg::Vec3Array const*>(geometry.getVertexArray())) return false;
+	if (geometry.getNormalArray()) {
+		if (!dynamic_cast<osg::Vec3Array const*>(geometry.getNormalArray()) || !isSimpleBinding(geometry.getNormalBinding())) return false;
+	}
+	if (geometry.getColorArray()) {
+		if (!dynamic_cast<osg::Vec4Array const*>(geometry.getColorArray()) || !isSimpleBinding(geometry.getColorBinding())) return false;
+	}
+	if (geometry.getSecondaryColorArray() || geometry.getFogCoordArray() || geometry.getNumVertexAttribArrays() > 0) return false;
+	for (unsigned unit = 0; unit < geometry.getNumTexCoordArrays(); ++unit) {
+		osg::Array const *coords = geometry.getTexCoordArray(unit);
+		if (coords && (unit > 0 || !dynamic_cast<osg::Vec2Array const*>(coords))) return false;
+	}
+	for (unsigned i = 0; i < geometry.getNumPrimitiveSets(); ++i) {
+		if (!isTriangleMode(geometry.getPrimitiveSet(i)->getMode())) return false;
+	}
+	return true;
+}
+
+/** Visitor that checks if a model scene graph can be merged. */
+class MergeableVisitor: public osg::NodeVisitor {
+	bool m_Mergeable;
+
+	bool isPlain(osg::Node const &node) const {
+		return node.getNodeMask() == 0xffffffff && !node.getUpdateCallback() && !node.getCullCallback();
+	}
+
+public:
+	MergeableVisitor(): osg::NodeVisitor(TRAVERSE_ALL_CHILDREN), m_Mergeable(true) { }
+
+	bool isMergeable() const { return m_Mergeable; }
+
+	virtual void apply(osg::Node &) {
+		m_Mergeable = false;
+	}
+
+	virtual void apply(osg::Group &node) {
+		// rejects switches, lods, effects, etc.
+		if (typeid(node) != typeid(osg::Group) || !isPlain(node)) {
+			m_Mergeable = false;
+		} else {
+			traverse(node);
+		}
+	}
+
+	virtual void apply(osg::Transform &node) {
+		const bool simple = typeid(node) == typeid(osg::MatrixTransform) || typeid(node) == typeid(osg::PositionAttitudeTransform);
+		if (!simple || !isPlain(node) || node.getReferenceFrame() != osg::Transform::RELATIVE_RF) {
+			m_Mergeable = false;
+		} else {
+			traverse(node);
+		}
+	}
+
+	virtual void apply(osg::Geode &geode) {
+		if (typeid(geode) != typeid(osg::Geode) || !isPlain(geode)) {
+			m_Mergeable = false;
+			return;
+		}
+		for (unsigned i = 0; i < geode.getNumDrawables(); ++i) {
+			osg::Geometry const *geometry = geode.getDrawable(i)->asGeometry();
+			if (!geometry || !csp::isMergeable(*geometry)) {
+				m_Mergeable = false;
+				return;
+			}
+		}
+	}
+};
+
+/** Collects the triangle indices of a geometry, offset by the base index of the batch. */
+struct IndexCollector {
+	std::vector<unsigned> *indices;
+	unsigned base;
+	void operator()(unsigned a, unsigned b, unsigned c) {
+		if (a == b || b == c || a == c) return;
+		indices->push_back(base + a);
+		indices->push_back(base + b);
+		indices->push_back(base + c);
+	}
+};
+
+} // namespace
+
+
+/** Merged geometry for one combination of render state and vertex attributes. */
+class FeatureTileBuilder::Batch {
+public:
+	enum { NORMALS = 1, COLORS = 2, TEXTURE = 4 };
+
+	explicit Batch(unsigned attributes):
+		m_Vertices(new osg::Vec3Array),
+		m_Normals((attributes & NORMALS) ? new osg::Vec3Array : 0),
+		m_Colors((attributes & COLORS) ? new osg::Vec4Array : 0),
+		m_Coords((attributes & TEXTURE) ? new osg::Vec2Array : 0) {
+	}
+
+	static unsigned getAttributes(osg::Geometry const &geometry) {
+		unsigned attributes = 0;
+		if (geometry.getNormalArray() && geometry.getNormalBinding() != osg::Geometry::BIND_OFF) attributes |= NORMALS;
+		if (geometry.getColorArray() && geometry.getColorBinding() != osg::Geometry::BIND_OFF) attributes |= COLORS;
+		if (geometry.getTexCoordArray(0)) attributes |= TEXTURE;
+		return attributes;
+	}
+
+	unsigned size() const { return m_Vertices->size(); }
+
+	/** Append a geometry transformed by the specified matrix. */
+	void add(osg::Geometry const &geometry, osg::Matrix const &matrix) {
+		osg::Vec3Array const &vertices = *static_cast<osg::Vec3Array const*>(geometry.getVertexArray());
+		const unsigned base = m_Vertices->size();
+		const unsigned n = vertices.size();
+		for (unsigned i = 0; i < n; ++i) {
+			m_Vertices->push_back(vertices[i] * matrix);
+		}
+		if (m_Normals.valid()) {
+			osg::Vec3Array const &normals = *static_cast<osg::Vec3Array const*>(geometry.getNormalArray());
+			const bool overall = geometry.getNormalBinding() == osg::Geometry::BIND_OVERALL;
+			const osg::Matrix inverse = osg::Matrix::inverse(matrix);
+			for (unsigned i = 0; i < n; ++i) {
+				osg::Vec3 normal = osg::Matrix::transform3x3(inverse, normals[overall ? 0 : i]);
+				normal.normalize();
+				m_Normals->push_back(normal);
+			}
+		}
+		if (m_Colors.valid()) {
+			osg::Vec4Array const &colors = *static_cast<osg::Vec4Array const*>(geometry.getColorArray());
+			const bool overall = geometry.getColorBinding() == osg::Geometry::BIND_OVERALL;
+			for (unsigned i = 0; i < n; ++i) {
+				m_Colors->push_back(colors[overall ? 0 : i]);
+			}
+		}
+		if (m_Coords.valid()) {
+			osg::Vec2Array const &coords = *static_cast<osg::Vec2Array const*>(geometry.getTexCoordArray(0));
+			m_Coords->insert(m_Coords->end(), coords.begin(), coords.begin() + n);
+		}
+		osg::TriangleIndexFunctor<IndexCollector> collector;
+		collector.indices = &m_Indices;
+		collector.base = base;
+		geometry.accept(collector);
+	}
+
+	/** Create the merged geometry. */
+	osg::Geometry *finish() const {
+		osg::Geometry *geometry = new osg::Geometry;
+		geometry->setVertexArray(m_Vertices.get());
+		if (m_Normals.valid()) {
+			geometry->setNormalArray(m_Normals.get());
+			geometry->setNormalBinding(osg::Geometry::BIND_PER_VERTEX);
+		}
+		if (m_Colors.valid()) {
+			geometry->setColorArray(m_Colors.get());
+			geometry->setColorBinding(osg::Geometry::BIND_PER_VERTEX);
+		}
+		if (m_Coords.valid()) {
+			geometry->setTexCoordArray(0, m_Coords.get());
+		}
+		if (size() <= MaxBatchVertices) {
+			osg::DrawElementsUShort *elements = new osg::DrawElementsUShort(osg::PrimitiveSet::TRIANGLES);
+			elements->reserve(m_Indices.size());
+			for (unsigned i = 0; i < m_Indices.size(); ++i) elements->push_back(static_cast<unsigned short>(m_Indices[i]));
+			geometry->addPrimitiveSet(elements);
+		} else {
+			osg::DrawElementsUInt *elements = new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES);
+			elements->reserve(m_Indices.size());
+			for (unsigned i = 0; i < m_Indices.size(); ++i) elements->push_back(m_Indices[i]);
+			geometry->addPrimitiveSet(elements);
+		}
+		geometry->setUseDisplayList(false);
+		geometry->setUseVertexBufferObjects(true);
+		return geometry;
+	}
+
+private:
+	osg::ref_ptr<osg::Vec3Array> m_Vertices;
+	osg::ref_ptr<osg::Vec3Array> m_Normals;
+	osg::ref_ptr<osg::Vec4Array> m_Colors;
+	osg::ref_ptr<osg::Vec2Array> m_Coords;
+	std::vector<unsigned> m_Indices;
+};
+
+
+/** Visitor that appends the geometry of one feature to the batches.  Batches
+ *  are keyed by the state sets along the path from the model root to each
+ *  drawable, and by the vertex attributes present.
+ */
+class FeatureTileBuilder::Collector: public osg::NodeVisitor {
+public:
+	typedef std::vector<osg::StateSet*> StatePath;
+	typedef std::map<std::pair<StatePath, unsigned>, std::vector<Batch*> > BatchMap;
+
+	Collector(BatchMap &batches): osg::NodeVisitor(TRAVERSE_ALL_CHILDREN), m_Batches(batches) { }
+
+	void collect(osg::Node *node, osg::Matrix const &matrix) {
+		m_Matrix = matrix;
+		m_Path.clear();
+		node->accept(*this);
+	}
+
+	virtual void apply(osg::Group &node) {
+		push(node.getStateSet());
+		traverse(node);
+		pop(node.getStateSet());
+	}
+
+	virtual void apply(osg::Transform &node) {
+		const osg::Matrix saved = m_Matrix;
+		node.computeLocalToWorldMatrix(m_Matrix, this);
+		push(node.getStateSet());
+		traverse(node);
+		pop(node.getStateSet());
+		m_Matrix = saved;
+	}
+
+	virtual void apply(osg::Geode &geode) {
+		push(geode.getStateSet());
+		for (unsigned i = 0; i < geode.getNumDrawables(); ++i) {
+			osg::Geometry *geometry = geode.getDrawable(i)->asGeometry();
+			assert(geometry);
+			push(geometry->getStateSet());
+			add(*geometry);
+			pop(geometry->getStateSet());
+		}
+		pop(geode.getStateSet());
+	}
+
+private:
+	void push(osg::StateSet *ss) { if (ss) m_Path.push_back(ss); }
+	void pop(osg::StateSet *ss) { if (ss) m_Path.pop_back(); }
+
+	void add(osg::Geometry const &geometry) {
+		const unsigned n = geometry.getVertexArray()->getNumElements();
+		if (n == 0) return;
+		const unsigned attributes = Batch::getAttributes(geometry);
+		std::vector<Batch*> &batches = m_Batches[std::make_pair(m_Path, attributes)];
+		if (batches.empty() || batches.back()->size() + n > MaxBatchVertices) {
+			batches.push_back(new Batch(attributes));
+		}
+		batches.back()->add(geometry, m_Matrix);
+	}
+
+	BatchMap &m_Batches;
+	StatePath m_Path;
+	osg::Matrix m_Matrix;
+};
+
+
+FeatureTileBuilder::FeatureTileBuilder(std::string const &key): m_Key(key) {
+}
+
+FeatureTileBuilder::~FeatureTileBuilder() {
+}
+
+bool FeatureTileBuilder::isEnabled() {
+	return g_Config.getBool("Graphics", "MergeFeatures", true, true);
+}
+
+bool FeatureTileBuilder::isMergeable(osg::Node *node) {
+	MergeableVisitor visitor;
+	node->accept(visitor);
+	return visitor.isMergeable();
+}
+
+bool FeatureTileBuilder::add(Ref<ObjectModel> const &model, LayoutTransform const &transform, bool correct) {
+	std::map<ObjectModel const*, bool>::iterator iter = m_Mergeable.find(model.get());
+	if (iter == m_Mergeable.end()) {
+		bool mergeable = model->numAnimations() == 0 && model->numStations() == 0 && model->numLodLevels() == 0 && !model->hasImpostor();
+		mergeable = mergeable && isMergeable(model->getModel().get());
+		mergeable = mergeable && (!model->getGroundShadow().valid() || isMergeable(model->getGroundShadow().get()));
+		if (!mergeable) {
+			CSPLOG(Prio_DEBUG, Cat_SCENE) << "Feature model " << model->getModelPath() << " can not be merged";
+		}
+		iter = m_Mergeable.insert(std::make_pair(model.get(), mergeable)).first;
+		if (mergeable) {
+			// the archived parameters and the model files, so that the cached
+			// tile is rebuilt if either changes.
+			ArchiveStringWriter writer;
+			model->serialize(writer);
+			std::ostringstream hash;
+			hash << std::hex << hash_string(writer.str()).u64() << "." << hashModelFile(model->getModelPath()) << "." << hashModelFile(model->getGroundShadowPath());
+			m_ModelHashes[model.get()] = hash.str();
+		}
+	}
+	if (!iter->second) return false;
+	Placement placement;
+	placement.model = model;
+	placement.position = transform();
+	placement.angle = transform.getAngle();
+	placement.correct = correct;
+	m_Placements.push_back(placement);
+	return true;
+}
+
+std::string FeatureTileBuilder::getCacheFile() const {
+	std::ostringstream key;
+	key << m_Key << ":" << CacheVersion << std::fixed << std::setprecision(3);
+	for (unsigned i = 0; i < m_Placements.size(); ++i) {
+		Placement const &placement = m_Placements[i];
+		key << ":" << placement.model->getModelPath() << "#" << m_ModelHashes.find(placement.model.get())->second << "@" << placement.position.x() << "," << placement.position.y() << "," << placement.angle << "," << placement.correct;
+	}
+	std::ostringstream name;
+	name << "feature-" << std::hex << std::setw(16) << std::setfill('0') << hash_string(key.str()).u64() << ".ive";
+	return ospath::join(ospath::join(getCachePath(), "features"), name.str());
+}
+
+osg::Node *FeatureTileBuilder::merge(ElevationCorrection const &correction) {
+	// look up the elevations of all the features at once.
+	std::vector<osg::Vec3> offsets;
+	std::vector<unsigned> corrected;
+	for (unsigned i = 0; i < m_Placements.size(); ++i) {
+		if (m_Placements[i].correct) {
+			offsets.push_back(m_Placements[i].position);
+			corrected.push_back(i);
+		}
+	}
+	correction.correct(offsets);
+	for (unsigned i = 0; i < corrected.size(); ++i) {
+		m_Placements[corrected[i]].position = offsets[i];
+	}
+
+	Collector::BatchMap batches;
+	Collector collector(batches);
+	for (unsigned i = 0; i < m_Placements.size(); ++i) {
+		Placement const &placement = m_Placements[i];
+		const osg::Matrix matrix = osg::Matrix::rotate(placement.angle, osg::Z_AXIS) * osg::Matrix::translate(placement.position);
+		collector.collect(placement.model->getModel().get(), matrix);
+		if (placement.model->getGroundShadow().valid()) {
+			collector.collect(placement.model->getGroundShadow().get(), matrix);
+		}
+	}
+
+	// recreate the state set hierarchy above each batch, sharing common prefixes.
+	osg::Group *root = new osg::Group;
+	root->setName("merged features");
+	std::map<std::pair<osg::Group*, osg::StateSet*>, osg::Group*> groups;
+	unsigned count = 0;
+	for (Collector::BatchMap::const_iterator iter = batches.begin(); iter != batches.end(); ++iter) {
+		osg::Group *parent = root;
+		Collector::StatePath const &path = iter->first.first;
+		for (unsigned i = 0; i < path.size(); ++i) {
+			osg::Group *&child = groups[std::make_pair(parent, path[i])];
+			if (!child) {
+				child = new osg::Group;
+				child->setStateSet(path[i]);
+				parent->addChild(child);
+			}
+			parent = child;
+		}
+		osg::Geode *geode = new osg::Geode;
+		for (unsigned i = 0; i < iter->second.size(); ++i) {
+			geode->addDrawable(iter->second[i]->finish());
+			delete iter->second[i];
+			++count;
+		}
+		parent->addChild(geode);
+	}
+
+	CSPLOG(Prio_INFO, Cat_SCENE) << "Merged " << m_Placements.size() << " features into " << count << " batches";
+	return root;
+}
+
+void FeatureTileBuilder::build(FeatureSceneGroup *group, ElevationCorrection const &correction) {
+	if (m_Placements.empty()) return;
+
+	Timer timer;
+	timer.start();
+
+	const bool use_cache = g_Config.getBool("Graphics", "FeatureCache", true, true);
+	const std::string path = use_cache ? getCacheFile() : std::string();
+	osg::ref_ptr<osg::Node> tile;
+	if (use_cache && ospath::exists(path)) {
+		tile = osgDB::readNodeFile(path);
+		if (!tile) {
+			CSPLOG(Prio_WARNING, Cat_SCENE) << "Unable to read cached feature tile " << path;
+		}
+	}
+	const bool cached = tile.valid();
+	if (!cached) {
+		tile = merge(correction);
+		if (use_cache) {
+			if (!osgDB::makeDirectoryForFile(path) || !osgDB::writeNodeFile(*tile, path)) {
+				CSPLOG(Prio_WARNING, Cat_SCENE) << "Unable to write cached feature tile " << path;
+			}
+		}
+	}
+	group->addChild(tile.get());
+	timer.stop();
+
+	CSPLOG(Prio_DEBUG, Cat_SCENE) << (cached ? "Loaded " : "Built ") << "feature tile with " << m_Placements.size() << " features in " << (timer.elapsed() * 1e3) << " ms";
+}
+
+} // namespace csp
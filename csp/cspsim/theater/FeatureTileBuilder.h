@@ -0,0 +1,114 @@
+#pragma once
+// Combat Simulator Project
+// Copyright (C) 2002 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/**
+ * @file FeatureTileBuilder.h
+ *
+ **/
+
+#include <csp/cspsim/theater/LayoutTransform.h>
+#include <csp/csplib/util/Properties.h>
+#include <csp/csplib/util/Ref.h>
+
+#include <osg/Vec3>
+#include <osg/ref_ptr>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace osg { class Node; }
+
+namespace csp {
+
+class ElevationCorrection;
+class FeatureSceneGroup;
+class ObjectModel;
+
+
+/**
+ * class FeatureTileBuilder
+ *
+ * Merges the static features of a FeatureGroup into a small number of
+ * geometry batches, one per distinct combination of render state, instead
+ * of one transform and set of drawables per feature.  The elevations of
+ * all merged features are looked up in a single batch, and the merged
+ * scene graph is cached on disk (keyed by terrain, feature group layout,
+ * placement, and the contents of the models) so that it only needs to be
+ * built once.
+ *
+ * Only models without animations, cockpits, or lower detail levels, and
+ * whose scene graphs consist of plain groups, transforms, and triangle
+ * geometry, can be merged.  Other features are added to the scene as
+ * usual.
+ */
+class FeatureTileBuilder: public NonCopyable {
+public:
+	/** Construct a builder.
+	 *
+	 *  @param key identifies the terrain and feature group layout; used
+	 *    to construct the name of the cache file.
+	 */
+	explicit FeatureTileBuilder(std::string const &key);
+	~FeatureTileBuilder();
+
+	/** Queue a feature for merging.  Returns false if the model can't be
+	 *  merged, in which case the caller should add it to the scene itself.
+	 *
+	 *  @param model the feature model.
+	 *  @param transform the position and orientation relative to the group.
+	 *  @param correct if true, the feature is placed on the terrain.
+	 */
+	bool add(Ref<ObjectModel> const &model, LayoutTransform const &transform, bool correct);
+
+	/** The number of queued features. */
+	unsigned size() const { return m_Placements.size(); }
+
+	/** Merge the queued features (or load the merged features from the
+	 *  cache) and add them to the scene group.
+	 */
+	void build(FeatureSceneGroup *group, ElevationCorrection const &correction);
+
+	/** Returns true if feature merging is enabled (Graphics.MergeFeatures).
+	 */
+	static bool isEnabled();
+
+private:
+	struct Placement {
+		Ref<ObjectModel> model;
+		osg::Vec3 position;
+		float angle;
+		bool correct;
+	};
+
+	class Batch;
+	class Collector;
+
+	static bool isMergeable(osg::Node *node);
+	std::string getCacheFile() const;
+	osg::Node *merge(ElevationCorrection const &correction);
+
+	std::string m_Key;
+	std::vector<Placement> m_Placements;
+	std::map<ObjectModel const*, bool> m_Mergeable;
+	std::map<ObjectModel const*, std::string> m_ModelHashes;
+};
+
+} // namespace csp
@@ -0,0 +1,174 @@
+// Combat Simulator Project
+// Copyright (C) 2002 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+
+/**
+ * @file InstancedVegetation.cpp
+ *
+ **/
+
+
+#include <csp/cspsim/theater/InstancedVegetation.h>
+#include <csp/cspsim/theater/FeatureQuad.h>
+#include <csp/cspsim/Config.h>
+
+#include <csp/csplib/util/Math.h>
+#include <csp/csplib/util/Random.h>
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Image>
+#include <osg/LOD>
+#include <osg/Texture2D>
+#include <osg/Uniform>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <map>
+#include <utility>
+
+namespace csp {
+
+namespace {
+
+/** Instances per row of the instance texture (see vegetation.vertex). */
+const unsigned Columns = 512;
+
+/** The size of the cells used to group instances for culling, in meters. */
+const float CellSize = 512.0f;
+
+osg::Texture2D *makeInstanceTexture(std::vector<InstancedVegetation::Instance const*> const &instances) {
+	const unsigned n = instances.size();
+	const unsigned width = 2 * std::min(n, Columns);
+	const unsigned height = (n + Columns - 1) / Columns;
+	osg::Image *image = new osg::Image;
+	image->allocateImage(width, height, 1, GL_RGBA, GL_FLOAT);
+	image->setInternalTextureFormat(GL_RGBA32F_ARB);
+	float *texel = reinterpret_cast<float*>(image->data());
+	for (unsigned i = 0; i < n; ++i) {
+		InstancedVegetation::Instance const &instance = *instances[i];
+		*texel++ = instance.position.x();
+		*texel++ = instance.position.y();
+		*texel++ = instance.position.z();
+		*texel++ = instance.scale;
+		*texel++ = std::cos(instance.rotation);
+		*texel++ = std::sin(instance.rotation);
+		*texel++ = instance.variant;
+		*texel++ = instance.rank;
+	}
+	osg::Texture2D *texture = new osg::Texture2D(image);
+	texture->setInternalFormat(GL_RGBA32F_ARB);
+	texture->setSourceFormat(GL_RGBA);
+	texture->setSourceType(GL_FLOAT);
+	texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
+	texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::NEAREST);
+	texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+	texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+	texture->setResizeNonPowerOfTwoHint(false);
+	texture->setUnRefImageDataAfterApply(true);
+	return texture;
+}
+
+/** Copy the prototype geometry, drawing each primitive set once per instance. */
+osg::Geometry *makeInstancedGeometry(osg::Geometry const *proto, unsigned count) {
+	osg::Geometry *geometry = new osg::Geometry(*proto, osg::CopyOp::SHALLOW_COPY);
+	geometry->removePrimitiveSet(0, geometry->getNumPrimitiveSets());
+	for (unsigned i = 0; i < proto->getNumPrimitiveSets(); ++i) {
+		osg::DrawArrays const *arrays = dynamic_cast<osg::DrawArrays const*>(proto->getPrimitiveSet(i));
+		assert(arrays);
+		geometry->addPrimitiveSet(new osg::DrawArrays(arrays->getMode(), arrays->getFirst(), arrays->getCount(), count));
+	}
+	geometry->setUseDisplayList(false);
+	geometry->setUseVertexBufferObjects(true);
+	return geometry;
+}
+
+} // namespace
+
+
+bool InstancedVegetation::isEnabled() {
+	return g_Config.getBool("Graphics", "InstancedVegetation", true, true);
+}
+
+void InstancedVegetation::makeInstances(std::vector<osg::Vec3> const &positions, int seed, float scale_variation, std::vector<Instance> &instances) {
+	random::Taus2 rand;
+	rand.setSeed(seed);
+	instances.resize(positions.size());
+	for (unsigned i = 0; i < positions.size(); ++i) {
+		Instance &instance = instances[i];
+		instance.position = positions[i];
+		instance.scale = static_cast<float>(rand.uniform(1.0 - scale_variation, 1.0 + scale_variation));
+		instance.rotation = static_cast<float>(rand.uniform(0.0, 2.0 * PI));
+		instance.variant = static_cast<float>(rand.unit());
+		instance.rank = static_cast<float>(rand.unit());
+	}
+}
+
+osg::Node *InstancedVegetation::build(FeatureQuad const *quad, Style style, std::vector<Instance> const &instances) {
+	const float fade_start = g_Config.getFloat("Graphics", "VegetationFadeStart", 1500.0f, true);
+	const float fade_end = std::max(fade_start + 1.0f, g_Config.getFloat("Graphics", "VegetationFadeEnd", 3000.0f, true));
+
+	osg::Geometry const *proto = (style == BILLBOARD) ? quad->getGeometry() : quad->getCrossGeometry();
+
+	// the largest distance from the instance origin to a vertex, at unit scale.
+	const float extent = std::sqrt(quad->getWidth() * quad->getWidth() + quad->getHeight() * quad->getHeight());
+
+	osg::ref_ptr<osg::Uniform> sampler = new osg::Uniform("instances", 1);
+	osg::ref_ptr<osg::Uniform> range = new osg::Uniform("vegetation_range", osg::Vec2(fade_start, fade_end));
+	osg::ref_ptr<osg::Uniform> billboard = new osg::Uniform("billboard", style == BILLBOARD);
+
+	typedef std::map<std::pair<int, int>, std::vector<Instance const*> > CellMap;
+	CellMap cells;
+	for (std::vector<Instance>::const_iterator iter = instances.begin(); iter != instances.end(); ++iter) {
+		const int x = static_cast<int>(std::floor(iter->position.x() / CellSize));
+		const int y = static_cast<int>(std::floor(iter->position.y() / CellSize));
+		cells[std::make_pair(x, y)].push_back(&*iter);
+	}
+
+	osg::Group *group = new osg::Group;
+	group->setStateSet(quad->getInstancedStateSet());
+	for (CellMap::const_iterator cell = cells.begin(); cell != cells.end(); ++cell) {
+		std::vector<Instance const*> const &members = cell->second;
+		osg::BoundingBox bound;
+		for (unsigned i = 0; i < members.size(); ++i) {
+			const float radius = extent * members[i]->scale;
+			bound.expandBy(osg::BoundingSphere(members[i]->position, radius));
+		}
+		osg::Geometry *geometry = makeInstancedGeometry(proto, members.size());
+		geometry->setInitialBound(bound);
+
+		osg::Geode *geode = new osg::Geode;
+		geode->addDrawable(geometry);
+		osg::StateSet *state = geode->getOrCreateStateSet();
+		state->setTextureAttribute(1, makeInstanceTexture(members));
+		state->addUniform(sampler.get());
+		state->addUniform(range.get());
+		state->addUniform(billboard.get());
+
+		// nothing in the cell is visible beyond the fade range.
+		osg::LOD *lod = new osg::LOD;
+		lod->addChild(geode, 0.0f, fade_end + bound.radius());
+		group->addChild(lod);
+	}
+	return group;
+}
+
+} // namespace csp
+
@@ -0,0 +1,87 @@
+#pragma once
+// Combat Simulator Project
+// Copyright (C) 2002 The Combat Simulator Project
+// http://csp.sourceforge.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+/**
+ * @file InstancedVegetation.h
+ *
+ **/
+
+#include <osg/Vec3>
+
+#include <vector>
+
+namespace osg { class Node; }
+
+namespace csp {
+
+class FeatureQuad;
+
+
+/**
+ * class InstancedVegetation
+ *
+ * Builds the scene graph for large numbers of copies of a FeatureQuad
+ * (trees, bushes) using hardware instancing.  A single crossed-quad or
+ * camera facing quad mesh is drawn once per instance, with the placement
+ * of each instance (position, scale, rotation, variant, and rank) read
+ * from a floating point texture in the vertex shader.  Instances are
+ * grouped into spatial cells, each of which is drawn with one call and
+ * culled as a unit.
+ *
+ * Vegetation density decreases with distance from the viewer: the
+ * "vegetation" shader removes instances in order of increasing rank
+ * between Graphics.VegetationFadeStart and Graphics.VegetationFadeEnd,
+ * fading each one out as it is removed.  Cells beyond the fade end are
+ * not drawn at all.
+ */
+class InstancedVegetation {
+public:
+	/** The placement of one instance.  Rotation is about the vertical axis,
+	 *  in radians, and is ignored for billboards.  Variant and rank are in
+	 *  the range [0, 1).
+	 */
+	struct Instance {
+		osg::Vec3 position;
+		float scale;
+		float rotation;
+		float variant;
+		float rank;
+	};
+
+	enum Style { CROSS, BILLBOARD };
+
+	/** Returns true if instanced vegetation is enabled
+	 *  (Graphics.InstancedVegetation).
+	 */
+	static bool isEnabled();
+
+	/** Generate instances at the specified positions, with scale, rotation,
+	 *  variant, and rank drawn from a random sequence initialized with seed.
+	 *  The scale is uniformly distributed in [1-scale_variation, 1+scale_variation].
+	 */
+	static void makeInstances(std::vector<osg::Vec3> const &positions, int seed, float scale_variation, std::vector<Instance> &instances);
+
+	/** Build a scene graph that draws the instances of a quad.
+	 */
+	static osg::Node *build(FeatureQuad const *quad, Style style, std::vector<Instance> const &instances);
+};
+
+} // namespace csp
+
@@ -30,6 +30,7 @@
 #include <csp/cspsim/theater/FeatureQuad.h>
 #include <csp/cspsim/theater/LayoutTransform.h>
 #include <csp/cspsim/theater/ElevationCorrection.h>
+#include <csp/cspsim/theater/InstancedVegetation.h>
 
 #include <csp/csplib/data/ObjectInterface.h>
 #include <csp/csplib/util/Random.h>
@@ -46,6 +47,7 @@ CSP_XML_BEGIN(RandomBillboardModel)
 	CSP_DEF("models", m_Models, true)
 	CSP_DEF("density", m_Density, true)
 	CSP_DEF("minimum_spacing", m_MinimumSpacing, true)
+	CSP_DEF("scale_variation", m_ScaleVariation, false)
 	CSP_DEF("seed", m_Seed, false)
 	CSP_DEF("isocontour", m_IsoContour, false)
 CSP_XML_END
@@ -59,6 +61,7 @@ void RandomBillboardModel::makeFeatures(std::vector<Feature> &, int) const {
 }
 
 RandomBillboardModel::RandomBillboardModel():
+	m_ScaleVariation(0.2f),
 	m_Seed(0),
 	m_IsoContour(new RectangularCurve()) {
 }
@@ -87,7 +90,27 @@ void RandomBillboardModel::postCreate() {
 	}
 }
 
+void RandomBillboardModel::addInstancedSceneModel(FeatureSceneGroup *group, LayoutTransform const &transform, ElevationCorrection const &correction) {
+	// instance positions are relative to the root scene group.
+	FeatureSceneModel *scene_model = new FeatureSceneModel(LayoutTransform());
+	std::vector<InstancedVegetation::Instance> instances;
+	for (unsigned i = 0; i < m_Models.size(); i++) {
+		std::vector<osg::Vec3> pos(m_Offsets[i].size());
+		for (unsigned j = 0; j < pos.size(); j++) {
+			pos[j] = transform(m_Offsets[i][j]);
+		}
+		correction.correct(pos);
+		InstancedVegetation::makeInstances(pos, m_Seed + i, m_ScaleVariation, instances);
+		scene_model->addChild(InstancedVegetation::build(m_Models[i].get(), InstancedVegetation::BILLBOARD, instances));
+	}
+	group->addChild(scene_model);
+}
+
 void RandomBillboardModel::addSceneModel(FeatureSceneGroup *group, LayoutTransform const &transform, ElevationCorrection const &correction) {
+	if (InstancedVegetation::isEnabled()) {
+		addInstancedSceneModel(group, transform, correction);
+		return;
+	}
 	int i, n = m_Models.size();
 	std::vector<Vector3>::iterator ofs, end;
 	
@@ -46,9 +46,13 @@ class RandomBillboardModel: public FeatureGroupModel {
 	Link<FeatureQuad>::vector m_Models;
 	std::vector<float> m_Density;
 	float m_MinimumSpacing;
+	float m_ScaleVariation;
 	int m_Seed;
 	std::vector<std::vector<Vector3> > m_Offsets;
 	Link<IsoContour> m_IsoContour;
+
+	/** Add the billboards using hardware instancing (see InstancedVegetation). */
+	void addInstancedSceneModel(FeatureSceneGroup *group, LayoutTransform const &transform, ElevationCorrection const &correction);
 	
 public:
 	CSP_DECLARE_STATIC_OBJECT(RandomBillboardModel)
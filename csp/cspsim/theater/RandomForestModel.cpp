@@ -28,6 +28,7 @@
 #include <csp/cspsim/theater/FeatureSceneGroup.h>
 #include <csp/cspsim/theater/LayoutTransform.h>
 #include <csp/cspsim/theater/ElevationCorrection.h>
+#include <csp/cspsim/theater/InstancedVegetation.h>
 #include <csp/cspsim/theater/IsoContour.h>
 
 #include <csp/csplib/data/ObjectInterface.h>
@@ -44,6 +45,7 @@ CSP_XML_BEGIN(RandomForestModel)
 	CSP_DEF("models", m_Models, true)
 	CSP_DEF("density", m_Density, true)
 	CSP_DEF("minimum_spacing", m_MinimumSpacing, true)
+	CSP_DEF("scale_variation", m_ScaleVariation, false)
 	CSP_DEF("seed", m_Seed, false)
 	CSP_DEF("isocontour", m_IsoContour, false)
 CSP_XML_END
@@ -136,6 +138,7 @@ void RandomForestModel::makeFeatures(std::vector<Feature> &, int) const {
 }
 
 RandomForestModel::RandomForestModel():
+	m_ScaleVariation(0.2f),
 	m_Seed(0),
 	m_IsoContour(new RectangularCurve()) {
 }
@@ -164,7 +167,27 @@ void RandomForestModel::postCreate() {
 	}
 }
 
+void RandomForestModel::addInstancedSceneModel(FeatureSceneGroup *group, LayoutTransform const &transform, ElevationCorrection const &correction) {
+	// instance positions are relative to the root scene group.
+	FeatureSceneModel *scene_model = new FeatureSceneModel(LayoutTransform());
+	std::vector<InstancedVegetation::Instance> instances;
+	for (unsigned i = 0; i < m_Models.size(); i++) {
+		std::vector<osg::Vec3> pos(m_Offsets[i].size());
+		for (unsigned j = 0; j < pos.size(); j++) {
+			pos[j] = transform(m_Offsets[i][j]);
+		}
+		correction.correct(pos);
+		InstancedVegetation::makeInstances(pos, m_Seed + i, m_ScaleVariation, instances);
+		scene_model->addChild(InstancedVegetation::build(m_Models[i].get(), InstancedVegetation::CROSS, instances));
+	}
+	group->addChild(scene_model);
+}
+
 void RandomForestModel::addSceneModel(FeatureSceneGroup *group, LayoutTransform const &transform, ElevationCorrection const &correction) {
+	if (InstancedVegetation::isEnabled()) {
+		addInstancedSceneModel(group, transform, correction);
+		return;
+	}
 	int i, n = m_Models.size();
 	std::vector<Vector3>::iterator ofs, end;
 	FeatureSceneModel *scene_model = new FeatureSceneModel(transform);
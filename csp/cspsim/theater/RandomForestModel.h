@@ -58,6 +58,7 @@ class RandomForestModel: public FeatureGroupModel {
 	Link<FeatureQuad>::vector m_Models;
 	std::vector<float> m_Density;
 	float m_MinimumSpacing;
+	float m_ScaleVariation;
 	int m_Seed;
 	Link<IsoContour> m_IsoContour;
 
@@ -65,6 +66,9 @@ class RandomForestModel: public FeatureGroupModel {
 	
 	osg::Geometry *construct(Ref<FeatureQuad> quad, std::vector<osg::Vec3> const &position) const;
 
+	/** Add the trees using hardware instancing (see InstancedVegetation). */
+	void addInstancedSceneModel(FeatureSceneGroup *group, LayoutTransform const &transform, ElevationCorrection const &correction);
+
 public:
 	CSP_DECLARE_OBJECT(RandomForestModel)
 
@@ -31,6 +31,12 @@ namespace csp {
 
 namespace weather {
 
+// Altitude range and spacing of the standard atmosphere table.  The table
+// has nodes at the 11 and 20 km layer boundaries.
+static const double ProfileMinimum = -1000.0;
+static const double ProfileMaximum = 32000.0;
+static const double ProfileSpacing = 20.0;
+
 static void DumpNoise(std::vector<float> const &noise, std::string const &filename) {
 	FILE *fp = fopen(filename.c_str(), "wt");
 	if(fp) {
@@ -58,6 +64,7 @@ Atmosphere::Atmosphere() {
 	m_TurbulenceBlendUp = true;
 	m_GustModulation = 1.0;
 	m_GustIndex = 0;
+	tabulateProfile();
 	reset();
 	tabulateCAS();
 }
@@ -152,15 +159,32 @@ void Atmosphere::generateWinds() {
 	}
 }
 
+/**
+ * Blend the wind and turbulence altitude profiles.  Called whenever the
+ * average wind, wind scale, or turbulence blend changes, so that getWind()
+ * and getTurbulence() only need to interpolate a single table.
+ */
+void Atmosphere::blendProfiles() {
+	m_WindProfile.resize(m_WindAltX.size());
+	for (unsigned i = 0; i < m_WindProfile.size(); ++i) {
+		m_WindProfile[i] = (m_AverageWind + Vector3(m_WindAltX[i], m_WindAltY[i], 0.0)) * m_WindScale;
+	}
+	assert(m_TurbulenceBlend >= 0.0 && m_TurbulenceBlend <= 1.0);
+	const float blend = static_cast<float>(m_TurbulenceBlend);
+	m_TurbulenceProfile.resize(m_TurbulenceAltA.size());
+	for (unsigned i = 0; i < m_TurbulenceProfile.size(); ++i) {
+		const float a = std::max(m_TurbulenceAltA[i], 0.0f);
+		const float b = std::max(m_TurbulenceAltB[i], 0.0f);
+		m_TurbulenceProfile[i] = a * (1.0f - blend) + b * blend;
+	}
+}
+
 Vector3 Atmosphere::getWind(Vector3 const &p) const {
-	Vector3 wind = m_AverageWind;
 	const double h = std::min(98.0, std::max(0.0, p.z() * 0.0033));
 	const int idx = static_cast<int>(h);
 	const double f = h - idx;
-	wind.x() += m_WindAltX[idx]*(1.0-f) + m_WindAltX[idx+1]*f;
-	wind.y() += m_WindAltY[idx]*(1.0-f) + m_WindAltY[idx+1]*f;
-	wind *= m_WindScale * m_GustModulation;
-	if (wind.length() > 100.0) {  // XXX remove me
+	const Vector3 wind = (m_WindProfile[idx]*(1.0-f) + m_WindProfile[idx+1]*f) * m_GustModulation;
+	if (wind.length2() > 100.0 * 100.0) {  // XXX remove me
 		CSPLOG(Prio_WARNING, Cat_PHYSICS) << "strong wind! " << m_WindScale << " " << m_GustModulation << " " << wind;
 	}
 	return wind;
@@ -169,14 +193,11 @@ Vector3 Atmosphere::getWind(Vector3 const &p) const {
 Vector3 Atmosphere::getTurbulence(Vector3 const &p, double dist) const {
 	assert(dist >= 0.0 && dist < 2e+9);
 	int idx = clampTo(static_cast<int>(p.z() * (1000.0 / 15000.0)), 0, 999);
-	double a = std::max(m_TurbulenceAltA[idx], 0.0f);
-	float b = std::max(m_TurbulenceAltB[idx], 0.0f);
-	assert(m_TurbulenceBlend >= 0.0 && m_TurbulenceBlend <= 1.0);
-	a = a * (1.0 - m_TurbulenceBlend) + b * m_TurbulenceBlend;
+	const double a = m_TurbulenceProfile[idx];
 	if (a <= 0.0) return Vector3::ZERO;
 	idx = std::max(0, static_cast<int>(dist * 0.1)) % 1000;
 	const Vector3 turbulence(a * m_TurbulenceX[idx], a * m_TurbulenceY[idx], a * m_TurbulenceZ[idx]);
-	if (turbulence.length() > 100.0) {  // XXX remove me
+	if (turbulence.length2() > 100.0 * 100.0) {  // XXX remove me
 		CSPLOG(Prio_WARNING, Cat_PHYSICS) << "strong turbulence! " << a << " " << turbulence << " " << m_TurbulenceX[idx] << " " << idx << " " << dist << " " << m_TurbulenceBlend;
 	}
 	return turbulence;
@@ -191,46 +212,77 @@ void Atmosphere::setPrevailingWind(Vector3 const &wind) {
 	m_PrevailingWind = wind;
 }
 
-float Atmosphere::getTemperature(double h) const {
-	double scale;
-	if (h < 11000.0) {
-		scale = 1.0 - h * 0.0000225586;
-	} else
-	if (h < 20000.0) {
-		scale = 0.751865f;
-	} else {
-		if (h > 32000.0) h = 32000.0;
-  		scale = 0.682357 + h * .00000347058;
+/**
+ * Tabulate the 1976 Standard Atmosphere, relative to ground level, from
+ * ProfileMinimum to ProfileMaximum.  Linear interpolation of the table is
+ * accurate to about one part in 10^6 (to 10^4 within 20 m of the layer
+ * boundaries at 11 km and 20 km, where the model is not continuous).
+ */
+void Atmosphere::tabulateProfile() {
+	const int n = static_cast<int>((ProfileMaximum - ProfileMinimum) / ProfileSpacing) + 1;
+	m_Profile.resize(n);
+	for (int i = 0; i < n; ++i) {
+		const double h = ProfileMinimum + i * ProfileSpacing;
+		ProfileSample &sample = m_Profile[i];
+		if (h < 11000.0) {
+			sample.temperature = 1.0 - h * 0.0000225586;
+			sample.pressure = pow(1.0 - h * 0.0000225586, 5.255876);
+			sample.density = pow(1.0 - h * 0.0000225586, 4.255876);
+		} else
+		if (h < 20000.0) {
+			sample.temperature = 0.751865f;
+			sample.pressure = 0.223361 * exp((10999.0-h)*0.000157694);
+			sample.density = 0.297076 * exp( (10999.0 - h) * 0.000157694);
+		} else {
+			sample.temperature = 0.682357 + h * .00000347058;
+			sample.pressure = pow(0.988626 + h * 0.00000502758, -34.16319);
+			sample.density = pow(0.978261 + h * 0.00000497488, -35.16319);
+		}
+		sample.sound = sqrt(sample.temperature);
 	}
-	return static_cast<float>(m_GroundTemperature*scale);
+}
+
+void Atmosphere::sampleProfile(double h, ProfileSample &sample) const {
+	const double x = clampTo((h - ProfileMinimum) * (1.0 / ProfileSpacing), 0.0, static_cast<double>(m_Profile.size() - 1));
+	const int idx = std::min(static_cast<int>(x), static_cast<int>(m_Profile.size()) - 2);
+	const double f = x - idx;
+	ProfileSample const &a = m_Profile[idx];
+	ProfileSample const &b = m_Profile[idx + 1];
+	sample.temperature = a.temperature + (b.temperature - a.temperature) * f;
+	sample.pressure = a.pressure + (b.pressure - a.pressure) * f;
+	sample.density = a.density + (b.density - a.density) * f;
+	sample.sound = a.sound + (b.sound - a.sound) * f;
+}
+
+float Atmosphere::getTemperature(double h) const {
+	ProfileSample sample;
+	sampleProfile(h, sample);
+	return static_cast<float>(m_GroundTemperature * sample.temperature);
 }
 
 double Atmosphere::getPressure(double h) const {
-	double scale;
-	if (h < 11000.0) {
-		scale = pow(1.0 - h * 0.0000225586, 5.255876);
-	} else
-	if (h < 20000.0) {
-		scale = 0.223361 * exp((10999.0-h)*0.000157694);
-	} else {
-		if (h > 32000.0) h = 32000.0;
-		scale = pow(0.988626 + h * 0.00000502758, -34.16319);
-	}
-	return m_GroundPressure * scale;
+	ProfileSample sample;
+	sampleProfile(h, sample);
+	return m_GroundPressure * sample.pressure;
 }
 
 double Atmosphere::getDensity(double h) const {
-	double scale;
-	if (h < 11000.0) {
-		scale = pow(1.0 - h * 0.0000225586, 4.255876);
-	} else
-	if (h < 20000.0) {
-		scale = 0.297076 * exp( (10999.0 - h) * 0.000157694);
-	} else {
-		if (h > 32000.0) h = 32000.0;
-		scale = pow(0.978261 + h * 0.00000497488, -35.16319);
-	}
-	return m_GroundDensity * scale;
+	ProfileSample sample;
+	sampleProfile(h, sample);
+	return m_GroundDensity * sample.density;
+}
+
+void Atmosphere::getAir(double h, AirProperties &air) const {
+	ProfileSample sample;
+	sampleProfile(h, sample);
+	air.density = m_GroundDensity * sample.density;
+	air.pressure = m_GroundPressure * sample.pressure;
+	air.temperature = static_cast<float>(m_GroundTemperature * sample.temperature);
+	air.speed_of_sound = static_cast<float>(m_GroundSpeedOfSound * sample.sound);
+}
+
+void Atmosphere::getAir(unsigned n, double const *h, AirProperties *air) const {
+	for (unsigned i = 0; i < n; ++i) getAir(h[i], air[i]);
 }
 
 bool Atmosphere::fastUpdate(double &dt) {
@@ -260,6 +312,7 @@ void Atmosphere::update(double dt) {
 	m_GroundPressure *= 1.0 - f;
 	m_GroundPressure += f * m_TargetPressure;
 	m_GroundDensity = m_GroundPressure / (286.9 * m_GroundTemperature);
+	m_GroundSpeedOfSound = 20.0324 * sqrt(m_GroundTemperature);
 	f = dt * 0.001; // 1000 second timescale for wind direction change
 	m_AverageWind *= 1.0 - f;
 	m_AverageWind += f * m_TargetWind;
@@ -299,6 +352,8 @@ void Atmosphere::update(double dt) {
 		}
 	}
 
+	blendProfiles();
+
 	/*
 	std::cout << "==========================" << std:: endl;
 	std::cout << "PRES: " << m_GroundPressure << std:: endl;
@@ -343,16 +398,19 @@ void Atmosphere::reset() {
 	m_GroundTemperature = m_TargetTemperature;
 	m_GroundPressure = m_TargetPressure;
 	m_GroundDensity = m_GroundPressure / (286.9 * m_GroundTemperature);
+	m_GroundSpeedOfSound = 20.0324 * sqrt(m_GroundTemperature);
 	m_AverageWind = m_TargetWind;
 	slowUpdate();
 	slowUpdate();
 	slowUpdate();
+	blendProfiles();
 }
 
 
 float Atmosphere::getSpeedOfSound(double altitude) const {
-	float T = getTemperature(altitude);
-	return 20.0324f * sqrtf(T); // m/s
+	ProfileSample sample;
+	sampleProfile(altitude, sample);
+	return static_cast<float>(m_GroundSpeedOfSound * sample.sound); // m/s
 }
 
 float Atmosphere::getPreciseCAS(double mach, double altitude) const {
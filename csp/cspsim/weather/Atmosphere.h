@@ -34,6 +34,15 @@ namespace csp {
 
 namespace weather {
 
+/** Properties of the air at a given altitude.  See Atmosphere::getAir().
+ */
+struct AirProperties {
+	double density;        ///< kg/m^3
+	double pressure;       ///< Pa
+	float temperature;     ///< K
+	float speed_of_sound;  ///< m/s
+};
+
 /**
  * class Atmosphere
  *
@@ -54,6 +63,12 @@ namespace weather {
  * Turbulence is handled separately and must be added to the wind value
  * described above.  Turbulence combines altitude dependent noise functions
  * that morph over time with a 1D noise function indexed by distance travelled.
+ *
+ * The standard atmosphere is tabulated by altitude relative to the ground
+ * level values, and the wind and turbulence altitude profiles are blended
+ * into tables by update().  The queries are therefore just table lookups,
+ * and can be made from any thread provided that they do not overlap calls
+ * to update() or reset().
  */
 class Atmosphere : public Object {
 
@@ -79,6 +94,15 @@ public:
 	 */
 	double getDensity(double alt) const;
 
+	/** Get the density, pressure, temperature, and speed of sound at the
+	 *  specified altitude (m) with a single table lookup.
+	 */
+	void getAir(double alt, AirProperties &air) const;
+
+	/** Get the air properties at each of n altitudes (m).
+	 */
+	void getAir(unsigned n, double const *alt, AirProperties *air) const;
+
 	/** Get the current wind velocity at the specified position (in global
 	 *  coordinates).
 	 */
@@ -139,6 +163,21 @@ protected:
 
 	void generateWinds();
 	void tabulateCAS();
+	void tabulateProfile();
+	void blendProfiles();
+
+	/** The 1976 Standard Atmosphere relative to ground level, at one altitude.
+	 */
+	struct ProfileSample {
+		double temperature;
+		double pressure;
+		double density;
+		double sound;
+	};
+
+	/** Interpolate m_Profile at the specified altitude.
+	 */
+	void sampleProfile(double alt, ProfileSample &sample) const;
 
 	double m_Latitude;
 	double m_Longitude;
@@ -147,6 +186,7 @@ protected:
 	double m_TargetPressure;
 	double m_GroundPressure;
 	double m_GroundDensity;
+	double m_GroundSpeedOfSound;
 	double m_TimeScale;
 	double m_WindIndex;
 	double m_WindScale;
@@ -168,6 +208,9 @@ protected:
 	std::vector<float> m_TurbulenceZ;
 	std::vector<float> m_TurbulenceAltA;
 	std::vector<float> m_TurbulenceAltB;
+	std::vector<ProfileSample> m_Profile;
+	std::vector<Vector3> m_WindProfile;
+	std::vector<float> m_TurbulenceProfile;
 	Table2 m_CAS;
 	double m_TurbulenceBlend;
 	bool m_TurbulenceBlendUp;
@@ -85,6 +85,17 @@ int s_child_count = 0;
 #include <osg/ref_ptr>
 #include <osg/Image>
 
+#include <mutex>
+
+#include <csp/csplib/util/SimdMath.h>
+
+#ifndef GL_ARRAY_BUFFER_ARB
+#define GL_ARRAY_BUFFER_ARB			0x8892
+#define GL_ELEMENT_ARRAY_BUFFER_ARB	0x8893
+#define GL_STATIC_DRAW_ARB			0x88E4
+#define GL_STREAM_DRAW_ARB			0x88E0
+#endif
+
 #ifndef GL_STATIC_ATI
 #define GL_STATIC_ATI				0x8760
 #define GL_DYNAMIC_ATI				0x8761
@@ -165,7 +176,7 @@ ChunkLodTree::ChunkLodTree(const char *chunksrc,
 
 	printf("Max Vertices: %ld\n", maxvertices);
 	maxvertices = maxvertices | 0xf; // pad to 8.
-	vertexBuffer = new float [maxvertices * 4];	// allocate a vertex buffer
+	vertexBuffer = new float [maxvertices * 4];	// allocate a vertex buffer (x, y, z, pad)
 	allocated += sizeof(float)*maxvertices*4;
 	vertexBufferSize = maxvertices * 4;
 
@@ -242,7 +253,7 @@ ChunkLodTree::ChunkLodTree(const char *chunksrc,
 }
 
 void ChunkLodTree::setScaleAndOffset(osg::State &s, const osg::Vec3 &scale, const osg::Vec3 &offset) {
-	if (_useVertexProgram) {
+	if (_useVertexProgram && _vertexProgram.valid()) {
 		_vertexScale->set(scale);
 		_vertexOffset->set(offset);
 		// todo: this should be done automatically when the tree is split into separate
@@ -295,6 +306,8 @@ void ChunkLodTree::useVertexProgram(bool /*use*/) {
 }
 
 void ChunkLodTree::update(const osg::Vec3& viewpoint, osg::State& s) {
+	flushReleasedBuffers();
+
 	if (chunks[0].data == NULL) {
 		loader->requestLoad(&chunks[0], 1.0f);
 	}
@@ -342,6 +355,10 @@ int ChunkLodTree::render(osg::State& s, MultiTextureDetails &details) {
 #ifdef USE_CG
 		cgGLEnableProfile(cgGetProgramProfile(_cgProgram->getHandle(s)));
 #endif
+		// chunks bind their own buffer objects behind the back of osg::State,
+		// so make sure the state doesn't assume any buffers are bound.
+		s.unbindVertexBufferObject();
+		s.unbindElementBufferObject();
 	}
 
 	if (chunks[0].data == NULL) {
@@ -355,6 +372,12 @@ int ChunkLodTree::render(osg::State& s, MultiTextureDetails &details) {
 #ifdef USE_CG
 		cgGLDisableProfile(cgGetProgramProfile(_cgProgram->getHandle(s)));
 #endif
+		const Extensions* ext = getExtensions(0, true);
+		if (ext->isVertexBufferObjectSupported()) {
+			ext->glBindBuffer(GL_ARRAY_BUFFER_ARB, 0);
+			ext->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+		}
+		s.dirtyVertexPointer();
 	}
 
 #ifdef DUMP_STATS
@@ -733,33 +756,39 @@ void ChunkLod::requestUnloadTextures(ChunkLodTree* tree) {
 	}
 }
 
-void draw_box(osg::Vec3 const &min, osg::Vec3 const &max) {
-	glBegin(GL_LINES);
-	glVertex3f(min.x(), min.y(), min.z());
-	glVertex3f(min.x(), max.y(), min.z());
-	glVertex3f(min.x(), min.y(), max.z());
-	glVertex3f(min.x(), max.y(), max.z());
-	glVertex3f(max.x(), min.y(), min.z());
-	glVertex3f(max.x(), max.y(), min.z());
-	glVertex3f(max.x(), min.y(), max.z());
-	glVertex3f(max.x(), max.y(), max.z());
-	glEnd();
-
-	glBegin(GL_LINE_STRIP);
-	glVertex3f(min.x(), min.y(), min.z());
-	glVertex3f(min.x(), min.y(), max.z());
-	glVertex3f(max.x(), min.y(), max.z());
-	glVertex3f(max.x(), min.y(), min.z());
-	glVertex3f(min.x(), min.y(), min.z());
-	glEnd();
-
-	glBegin(GL_LINE_STRIP);
-	glVertex3f(min.x(), max.y(), min.z());
-	glVertex3f(min.x(), max.y(), max.z());
-	glVertex3f(max.x(), max.y(), max.z());
-	glVertex3f(max.x(), max.y(), min.z());
-	glVertex3f(min.x(), max.y(), min.z());
-	glEnd();
+// draws the edges of a box as lines, for debugging.  the corners are
+// streamed through a small vertex buffer object, and the edge indices are
+// kept in an element buffer.
+void draw_box(osg::State &s, osg::Vec3 const &min, osg::Vec3 const &max) {
+	const ChunkLodTree::Extensions* ext = ChunkLodTree::getExtensions(0, true);
+	if (!ext->isVertexBufferObjectSupported()) return;
+	static GLuint buffers[2] = { 0, 0 };
+	if (buffers[0] == 0) {
+		// corner i takes x, y, z from max if bit 0, 1, 2 of i is set.
+		static const GLubyte edges[24] = {
+			0, 1, 2, 3, 4, 5, 6, 7,
+			0, 2, 1, 3, 4, 6, 5, 7,
+			0, 4, 1, 5, 2, 6, 3, 7
+		};
+		ext->glGenBuffers(2, buffers);
+		ext->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, buffers[1]);
+		ext->glBufferData(GL_ELEMENT_ARRAY_BUFFER_ARB, sizeof(edges), edges, GL_STATIC_DRAW_ARB);
+	}
+	GLfloat corners[8][3];
+	for (int i = 0; i < 8; ++i) {
+		corners[i][0] = (i & 1) ? max.x() : min.x();
+		corners[i][1] = (i & 2) ? max.y() : min.y();
+		corners[i][2] = (i & 4) ? max.z() : min.z();
+	}
+	ext->glBindBuffer(GL_ARRAY_BUFFER_ARB, buffers[0]);
+	ext->glBufferData(GL_ARRAY_BUFFER_ARB, sizeof(corners), corners, GL_STREAM_DRAW_ARB);
+	ext->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, buffers[1]);
+	s.dirtyVertexPointer();
+	s.setVertexPointer(3, GL_FLOAT, 0, 0);
+	glDrawElements(GL_LINES, 24, GL_UNSIGNED_BYTE, 0);
+	ext->glBindBuffer(GL_ARRAY_BUFFER_ARB, 0);
+	ext->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+	s.dirtyVertexPointer();
 }
 
 void ChunkLod::cull(const ChunkLodTree& c, osg::State& s) {
@@ -816,7 +845,7 @@ int ChunkLod::render(ChunkLodTree& c, osg::State& s, MultiTextureDetails &detail
 		details.setMode(s, false);
 		float f = (lod & 255) / 255.0f;     //xxx
 		glColor3f(f, 1 - f, texture_bound ? 1.0 : 0.0);
-		draw_box(lores_center - lores_extent, lores_center + lores_extent); 
+		draw_box(s, lores_center - lores_extent, lores_center + lores_extent); 
 		// XXX XXX should push/pop texture states!
 		details.setMode(s, true);
 		s.applyTextureMode(0, GL_TEXTURE_2D, true);
@@ -1102,16 +1131,40 @@ void ChunkLod::findElevation(ChunkLodElevationTest &test, float vscale) const {
 ///// ChunkLodData methods
 ////////////////////////
 
+/** Morph the vertices of a chunk on the CPU.  The output has four floats
+ *  per vertex (x, y, z, and one unused float for alignment).  Uses SIMD
+ *  vectors when available, converting and morphing two vertices per
+ *  iteration.
+ */
+static void morphVertices(const ChunkLodVertex *v, int count, float *out, const osg::Vec3 &scale, const osg::Vec3 &offset, float one_minus_f) {
+	int i = 0;
+#ifdef CSP_SIMD_SSE2
+	const csp::simd::Vec4f vscale(scale.x(), scale.y(), scale.z(), 0.0f);
+	const csp::simd::Vec4f dscale(0.0f, one_minus_f * scale.y(), 0.0f, 0.0f);
+	const csp::simd::Vec4f voffset(offset.x(), 0.0f, offset.z(), 0.0f);
+	for (; i + 2 <= count; i += 2) {
+		// two vertices of four shorts each (x, y, z, y_delta), sign extended to floats.
+		csp::simd::Vec4i raw_a, raw_b;
+		csp::simd::loadInt16(reinterpret_cast<const int16_t*>(v + i), raw_a, raw_b);
+		const csp::simd::Vec4f a = csp::simd::toFloat(raw_a);
+		const csp::simd::Vec4f b = csp::simd::toFloat(raw_b);
+		(a * vscale + csp::simd::broadcast<3>(a) * dscale + voffset).store(out + 4 * i);
+		(b * vscale + csp::simd::broadcast<3>(b) * dscale + voffset).store(out + 4 * i + 4);
+	}
+#endif
+	for (; i < count; ++i) {
+		out[4 * i + 0] = offset.x() + v[i].v[0] * scale.x();
+		out[4 * i + 1] = (v[i].v[1] + v[i].y_delta * one_minus_f) * scale.y();
+		out[4 * i + 2] = offset.z() + v[i].v[2] * scale.z();
+		out[4 * i + 3] = 0.0f;
+	}
+}
+
 int ChunkLodData::render(ChunkLodTree& c, const ChunkLod& chunk, osg::State& s, MultiTextureDetails &/*details*/, const osg::Vec3& box_center, const osg::Vec3& box_extent) {
 	int triangle_count = 0;
-	float *buffer = c.getVertexBuffer();
-	unsigned long buffer_size = c.getVertexBufferSize();
-
-	assert(((unsigned long) (3*vertexInfo.vertexCount)) <= buffer_size);
 
 	float f = (chunk.lod & 0x0FF) / 255.0f;
 
-	// first morph the vertices
 	const float sx = box_extent.x() / (1 << 14);
 	const float sz = box_extent.z() / (1 << 14);
 
@@ -1121,26 +1174,18 @@ int ChunkLodData::render(ChunkLodTree& c, const ChunkLod& chunk, osg::State& s,
 	const float one_minus_f = (1.0f - f);
 
 	if (!c.useVertexProgram()) {
-		// perform the morphing in-place
-		float *verts = buffer;
-		const float verticalScale = c.getVerticalScale();
-		const ChunkLodVertex *v = vertexInfo.vertices;
-		for (int i = vertexInfo.vertexCount; --i >= 0;) {
-			*verts++ = offsetx + v->v[0] * sx;
-			*verts++ = (v->v[1] + v->y_delta * one_minus_f) * verticalScale;
-			*verts++ = offsetz + v->v[2] * sz;
-			v++;
-		}
+		// morph the vertices into the shared buffer
+		float *buffer = c.getVertexBuffer();
+		assert(((unsigned long) (4*vertexInfo.vertexCount)) <= c.getVertexBufferSize());
+		morphVertices(vertexInfo.vertices, vertexInfo.vertexCount, buffer, osg::Vec3(sx, c.getVerticalScale(), sz), osg::Vec3(offsetx, 0.0f, offsetz), one_minus_f);
 		// then do the drawing using the vertex and index buffers
 		glColor3f(1.0f, 1.0f, 1.0f);
-		s.setVertexPointer(3, GL_FLOAT, 0, buffer);
+		s.setVertexPointer(3, GL_FLOAT, 4 * sizeof(float), buffer);
 		glDrawElements(GL_TRIANGLE_STRIP, vertexInfo.indexCount, GL_UNSIGNED_SHORT, vertexInfo.indices);
 	} else {
-		if (c.useVertexProgram()) {
-			c.setScaleAndOffset(s, osg::Vec3(sx, c.getVerticalScale(), sz), osg::Vec3(offsetx, one_minus_f, offsetz));
-			s.setVertexPointer(4, GL_FLOAT, 0, vertexInfo.floatVertices);
-			glDrawElements(GL_TRIANGLE_STRIP, vertexInfo.indexCount, GL_UNSIGNED_SHORT, vertexInfo.indices);
-		}
+		// the vertex program does the morphing, so the vertices are drawn
+		// unmodified (from buffer objects if available).
+		c.setScaleAndOffset(s, osg::Vec3(sx, c.getVerticalScale(), sz), osg::Vec3(offsetx, one_minus_f, offsetz));
 #ifdef USE_CG
 		c.getCgScaleValueParameter()->set(sx, c.getVerticalScale(), sz);
 		c.getCgOffsetValueParameter()->set(offsetx, 1.0f - f, offsetz);
@@ -1181,42 +1226,7 @@ int ChunkLodData::render(ChunkLodTree& c, const ChunkLod& chunk, osg::State& s,
 #endif
 #endif
 
-#if defined(USE_CG) || defined(USE_NV)
-		// If we're using a vertex program, we might be using a server-side vertex object
-		if (vertexInfo._vertexArray != 0) {
-			// yep, we have a vertex object
-			const ChunkLodTree::Extensions* ext = ChunkLodTree::getExtensions(0, true);
-			::exit(0);
-			ext->glArrayObjectATI(GL_VERTEX_ARRAY, 4, GL_FLOAT, 0, vertexInfo._vertexArray, 0);
-			glEnableClientState(GL_VERTEX_ARRAY);
-			glDrawArrays(GL_TRIANGLE_STRIP, 0, vertexInfo.indexCount);
-		} else {
-			// nope, no vertex array; fill up the buffer with non-morphed values and copy.
-			// this ought to be a memcpy()
-			// FIXME make vertexInfo store this data as a *float
-			// ^^^^^ actually, the height test works best with shorts, but this is probably
-			//       more important....
-
-/*
-			float *verts = buffer;
-			const ChunkLodVertex *v = vertexInfo.vertices;
-
-			for (int i = vertexInfo.vertexCount; --i >= 0;) {
-				*verts++ = v->v[0];
-				*verts++ = v->v[1]; 
-				*verts++ = v->v[2];
-				*verts++ = v->y_delta;
-				v++;
-			}
-
-			s.setVertexPointer (4, GL_FLOAT, 0, buffer);
-*/
-			s.setVertexPointer(4, GL_FLOAT, 0, vertexInfo.floatVertices);
-			glDrawElements(GL_TRIANGLE_STRIP, vertexInfo.indexCount, GL_UNSIGNED_SHORT, vertexInfo.indices);
-		}
-
-		//s.dirtyAllAttributes ();		// needed to make sure we can apply the same context again (To update params)
-#endif
+		vertexInfo.drawUnmorphed(s);
 	}
 	
 	triangle_count += vertexInfo.triangleCount;
@@ -1239,21 +1249,14 @@ ChunkLodVertexInfo::~ChunkLodVertexInfo() {
 		delete [] indices;
 		indices = NULL;
 	}
-	if (floatVertices) {
-		allocated -= vertexCount * 4 * sizeof(float);
-		delete[] floatVertices;
-		floatVertices = NULL;
-	}
 #ifdef DUMP_ALLOC
     	std::cerr << "FREEING " << allocated << "\n";
 #endif
-#ifdef USE_VAR
-	if (_vertexArray) {
-		const ChunkLodTree::Extensions* ext = ChunkLodTree::getExtensions(0, true);
-		ext->glFreeObjectBufferATI(_vertexArray);
-		_vertexArray = 0;
+	if (_vertexBuffer) {
+		ChunkLodTree::releaseBuffers(_vertexBuffer, _indexBuffer);
+		_vertexBuffer = 0;
+		_indexBuffer = 0;
 	}
-#endif // USE_VAR
 }
 
 /*
@@ -1271,14 +1274,6 @@ void ChunkLodVertexInfo::read(MmapFile* mf) {
 		vertices[i].y_delta = mf->readUI16();
 	}
 
-	floatVertices = new float[vertexCount * 4];
-	for (int j = 0; j < vertexCount; j++) {
-		floatVertices[4*j+0] = vertices[j].v[0];
-		floatVertices[4*j+1] = vertices[j].v[1];
-		floatVertices[4*j+2] = vertices[j].v[2];
-		floatVertices[4*j+3] = vertices[j].y_delta;
-	}
-
 	indexCount = mf->readUI32();
 	if (indexCount > 0) {
 		indices = new unsigned short[indexCount];
@@ -1297,31 +1292,41 @@ void ChunkLodVertexInfo::read(MmapFile* mf) {
 	triangleCount = mf->readUI32();
 }
 
-/*
- * convert the data in this chunk to an object array
-  */
-void ChunkLodVertexInfo::convertToObjectArray() {
-	// Explode the vertices into a server-side vertex buffer
+void ChunkLodVertexInfo::createBufferObjects() {
 	const ChunkLodTree::Extensions* ext = ChunkLodTree::getExtensions(0, true);
-	if (!ext->isVertexArrayObjectSupported()) {
-		return;		// no vertex array buffer support, return
+	if (!ext->isVertexBufferObjectSupported() || _vertexBuffer != 0 || indexCount == 0) {
+		return;
 	}
+	GLuint buffers[2] = { 0, 0 };
+	ext->glGenBuffers(2, buffers);
+	_vertexBuffer = buffers[0];
+	_indexBuffer = buffers[1];
+	ext->glBindBuffer(GL_ARRAY_BUFFER_ARB, _vertexBuffer);
+	ext->glBufferData(GL_ARRAY_BUFFER_ARB, vertexCount * sizeof(ChunkLodVertex), vertices, GL_STATIC_DRAW_ARB);
+	ext->glBindBuffer(GL_ARRAY_BUFFER_ARB, 0);
+	ext->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, _indexBuffer);
+	ext->glBufferData(GL_ELEMENT_ARRAY_BUFFER_ARB, indexCount * sizeof(unsigned short), indices, GL_STATIC_DRAW_ARB);
+	ext->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+}
 
-	float *fbuf = new float[indexCount * 4];
-	for (int i = 0; i < indexCount; i++) {
-		fbuf[i*4 + 0] = vertices[indices[i]].v[0];
-		fbuf[i*4 + 1] = vertices[indices[i]].v[1];
-		fbuf[i*4 + 2] = vertices[indices[i]].v[2];
-		fbuf[i*4 + 3] = vertices[indices[i]].y_delta;
+void ChunkLodVertexInfo::drawUnmorphed(osg::State& s) const {
+	// the vertex pointer must be respecified after binding a different buffer,
+	// even if the offset (zero) is unchanged.
+	s.dirtyVertexPointer();
+	const ChunkLodTree::Extensions* ext = ChunkLodTree::getExtensions(0, true);
+	if (_vertexBuffer != 0) {
+		ext->glBindBuffer(GL_ARRAY_BUFFER_ARB, _vertexBuffer);
+		ext->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, _indexBuffer);
+		s.setVertexPointer(4, GL_SHORT, 0, 0);
+		glDrawElements(GL_TRIANGLE_STRIP, indexCount, GL_UNSIGNED_SHORT, 0);
+	} else {
+		if (ext->isVertexBufferObjectSupported()) {
+			ext->glBindBuffer(GL_ARRAY_BUFFER_ARB, 0);
+			ext->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+		}
+		s.setVertexPointer(4, GL_SHORT, 0, vertices);
+		glDrawElements(GL_TRIANGLE_STRIP, indexCount, GL_UNSIGNED_SHORT, indices);
 	}
-#ifdef USE_VAR
-	_vertexArray = ext->glNewObjectBufferATI(sizeof(float) * indexCount * 4, fbuf, GL_STATIC_ATI);
-#endif // USE_VAR
-	delete [] fbuf;
-	delete [] indices;
-	delete [] vertices;
-	indices = NULL;
-	vertices = NULL;
 }
 
 ////
@@ -1340,6 +1345,39 @@ void ChunkLodTree::setExtensions(unsigned int contextID, ChunkLodTree::Extension
 	s_extensions[contextID] = extensions;
 }
 
+namespace {
+
+struct ReleasedBuffers {
+	std::mutex mutex;
+	std::vector<GLuint> buffers;
+};
+
+// never deleted, since trees may be destroyed during static destruction.
+ReleasedBuffers &releasedBuffers() {
+	static ReleasedBuffers *released = new ReleasedBuffers;
+	return *released;
+}
+
+} // namespace
+
+void ChunkLodTree::releaseBuffers(GLuint vertexBuffer, GLuint indexBuffer) {
+	ReleasedBuffers &released = releasedBuffers();
+	std::lock_guard<std::mutex> lock(released.mutex);
+	released.buffers.push_back(vertexBuffer);
+	released.buffers.push_back(indexBuffer);
+}
+
+void ChunkLodTree::flushReleasedBuffers() {
+	std::vector<GLuint> buffers;
+	{
+		ReleasedBuffers &released = releasedBuffers();
+		std::lock_guard<std::mutex> lock(released.mutex);
+		if (released.buffers.empty()) return;
+		buffers.swap(released.buffers);
+	}
+	getExtensions(0, true)->glDeleteBuffers(static_cast<GLsizei>(buffers.size()), &buffers[0]);
+}
+
 ChunkLodTree::Extensions::Extensions(unsigned int contextID) {
 	setupGLExtensions(contextID);
 }
@@ -1347,11 +1385,16 @@ ChunkLodTree::Extensions::Extensions(unsigned int contextID) {
 ChunkLodTree::Extensions::Extensions(const ChunkLodTree::Extensions& rhs) :
 	osg::Referenced(),
 	_vertexArrayObjectSupported(rhs._vertexArrayObjectSupported),
+	_vertexBufferObjectSupported(rhs._vertexBufferObjectSupported),
 	_glNewObjectBufferATI(rhs._glNewObjectBufferATI),
 	_glUpdateObjectBufferATI(rhs._glUpdateObjectBufferATI),
 	_glFreeObjectBufferATI(rhs._glFreeObjectBufferATI),
 	_glArrayObjectATI(rhs._glArrayObjectATI),
-	_glVariantObjectArrayATI(rhs._glVariantObjectArrayATI)
+	_glVariantObjectArrayATI(rhs._glVariantObjectArrayATI),
+	_glGenBuffersARB(rhs._glGenBuffersARB),
+	_glBindBufferARB(rhs._glBindBufferARB),
+	_glBufferDataARB(rhs._glBufferDataARB),
+	_glDeleteBuffersARB(rhs._glDeleteBuffersARB)
 {
 }
 
@@ -1365,6 +1408,7 @@ void ChunkLodTree::Extensions::setupGLExtensions(unsigned int contextID) {
 #	define IS_GL_EXTENSION_SUPPORTED(f)  osg::isGLExtensionSupported(f)
 #endif
 	_vertexArrayObjectSupported = IS_GL_EXTENSION_SUPPORTED("GL_ATI_vertex_array_object");
+	_vertexBufferObjectSupported = IS_GL_EXTENSION_SUPPORTED("GL_ARB_vertex_buffer_object");
 
 	std::cout << "NV VAR = " <<  IS_GL_EXTENSION_SUPPORTED("GL_NV_vertex_array_range") << "\n";;
 	std::cout << "NV VAR2 = " <<  IS_GL_EXTENSION_SUPPORTED("GL_NV_vertex_array_range2") << "\n";;
@@ -1376,7 +1420,48 @@ void ChunkLodTree::Extensions::setupGLExtensions(unsigned int contextID) {
 	GET_FUNC(glFreeObjectBufferATI);
 	GET_FUNC(glArrayObjectATI);
 	GET_FUNC(glVariantObjectArrayATI);
+	GET_FUNC(glGenBuffersARB);
+	GET_FUNC(glBindBufferARB);
+	GET_FUNC(glBufferDataARB);
+	GET_FUNC(glDeleteBuffersARB);
 #undef GET_FUNC
+	_vertexBufferObjectSupported = _vertexBufferObjectSupported && _glGenBuffersARB && _glBindBufferARB && _glBufferDataARB && _glDeleteBuffersARB;
+}
+
+void ChunkLodTree::Extensions::glGenBuffers(GLsizei n, GLuint *buffers) const {
+	if (_glGenBuffersARB) {
+		typedef void (APIENTRY * glGenBuffersARBPtr) (GLsizei n, GLuint *buffers);
+		((glGenBuffersARBPtr) _glGenBuffersARB) (n, buffers);
+	} else {
+		osg::notify(osg::WARN) << "Error: glGenBuffersARB is not supported by OpenGL" << std::endl;
+	}
+}
+
+void ChunkLodTree::Extensions::glBindBuffer(GLenum target, GLuint buffer) const {
+	if (_glBindBufferARB) {
+		typedef void (APIENTRY * glBindBufferARBPtr) (GLenum target, GLuint buffer);
+		((glBindBufferARBPtr) _glBindBufferARB) (target, buffer);
+	} else {
+		osg::notify(osg::WARN) << "Error: glBindBufferARB is not supported by OpenGL" << std::endl;
+	}
+}
+
+void ChunkLodTree::Extensions::glBufferData(GLenum target, std::ptrdiff_t size, const void *data, GLenum usage) const {
+	if (_glBufferDataARB) {
+		typedef void (APIENTRY * glBufferDataARBPtr) (GLenum target, std::ptrdiff_t size, const void *data, GLenum usage);
+		((glBufferDataARBPtr) _glBufferDataARB) (target, size, data, usage);
+	} else {
+		osg::notify(osg::WARN) << "Error: glBufferDataARB is not supported by OpenGL" << std::endl;
+	}
+}
+
+void ChunkLodTree::Extensions::glDeleteBuffers(GLsizei n, const GLuint *buffers) const {
+	if (_glDeleteBuffersARB) {
+		typedef void (APIENTRY * glDeleteBuffersARBPtr) (GLsizei n, const GLuint *buffers);
+		((glDeleteBuffersARBPtr) _glDeleteBuffersARB) (n, buffers);
+	} else {
+		osg::notify(osg::WARN) << "Error: glDeleteBuffersARB is not supported by OpenGL" << std::endl;
+	}
 }
 
 #ifdef USE_VAR
@@ -27,6 +27,7 @@
 
 #include <csp/modules/chunklod/ChunkLodLoader>
 #include <csp/modules/chunklod/ChunkLod>
+#include <csp/csplib/util/Profiler.h>
 
 
 namespace osgChunkLod {
@@ -118,6 +119,7 @@ void ChunkLodLoader::useThread(bool use_thread) {
 }
 
 void ChunkLodLoader::syncLoader() {
+	CSP_PROFILE_ZONE("terrain sync");
 	if (_usingThread) {
 #if defined(USE_WIN32_THREADS)
 		EnterCriticalSection(&_hCritSection);
@@ -157,9 +159,9 @@ void ChunkLodLoader::syncLoader() {
 			if (r._chunk->parent != NULL && r._chunk->parent->data == NULL) {
 				delete r._chunk_data;
 			} else {
-				// ATI
+				// upload the vertices once; the vertex program morphs them in place.
 				if (_tree->useVertexProgram()) {
-					r._chunk_data->vertexInfo.convertToObjectArray();
+					r._chunk_data->vertexInfo.createBufferObjects();
 				}
 				r._chunk->data = r._chunk_data;
 			}
@@ -326,8 +328,11 @@ bool ChunkLodLoader::_serviceData() {
 	}
 
 	ChunkLodData* loaded_data = NULL;
-	_chunkfile->seek(chunk_to_load->dataFilePosition);
-	loaded_data = new ChunkLodData(_chunkfile);
+	{
+		CSP_PROFILE_ZONE("terrain load");
+		_chunkfile->seek(chunk_to_load->dataFilePosition);
+		loaded_data = new ChunkLodData(_chunkfile);
+	}
 
 	if (_usingThread) {
 #if defined(USE_WIN32_THREADS)
@@ -407,7 +412,10 @@ bool ChunkLodLoader::_serviceTexture() {
 	}
 
 	osg::Image* texImage;
-	texImage = _tqt->loadImage(chunk_to_load->level, chunk_to_load->x, chunk_to_load->z);
+	{
+		CSP_PROFILE_ZONE("terrain texture load");
+		texImage = _tqt->loadImage(chunk_to_load->level, chunk_to_load->x, chunk_to_load->z);
+	}
 
 	if (_usingThread) {
 #if defined(USE_WIN32_THREADS)
@@ -442,6 +450,7 @@ bool ChunkLodLoader::_serviceTexture() {
 
 ChunkLodLoader::ThreadFuncReturn ChunkLodLoader::_loaderThreadFunc(void *param) {
 	ChunkLodLoader *loader = (ChunkLodLoader *) param;
+	csp::Profiler::setThreadName("terrain loader");
 	while (!loader->_stopThread) {
 		//std::cout << "IN LOADER THREAD\n";
 		bool loaded = false;
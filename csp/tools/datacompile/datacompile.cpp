@@ -0,0 +1,85 @@
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+// Compiles the xml data into an archive (see csplib/data/DataCompiler.h).
+// This is a faster, incremental replacement for tools/data-compiler, and
+// takes the same options.
+//
+// usage: datacompile [-j N] [--full] [-m module]... -s source-dir -d archive
+//
+// Objects are built by N threads (default one per processor).  Unless
+// --full is given, objects whose sources are unchanged since the last
+// compile are copied from the existing archive.
+
+#include <csp/csplib/data/DataCompiler.h>
+#include <csp/csplib/util/Modules.h>
+#include <csp/cspsim/RegisterObjectInterfaces.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+	std::string source;
+	std::string archive;
+	std::vector<std::string> modules;
+	unsigned threads = 0;
+	bool full = false;
+	bool usage = false;
+	for (int arg = 1; arg < argc && !usage; ++arg) {
+		const bool has_value = arg + 1 < argc;
+		if (strcmp(argv[arg], "-s") == 0 && has_value) {
+			source = argv[++arg];
+		} else if (strcmp(argv[arg], "-d") == 0 && has_value) {
+			archive = argv[++arg];
+		} else if (strcmp(argv[arg], "-m") == 0 && has_value) {
+			modules.push_back(argv[++arg]);
+		} else if (strcmp(argv[arg], "-j") == 0 && has_value) {
+			threads = atoi(argv[++arg]);
+		} else if (strcmp(argv[arg], "--full") == 0) {
+			full = true;
+		} else {
+			usage = true;
+		}
+	}
+	if (usage || source.empty() || archive.empty()) {
+		std::cerr << "usage: " << argv[0] << " [-j N] [--full] [-m module]... -s source-dir -d archive\n";
+		return 1;
+	}
+
+	// make all objects available for introspection and serialization.
+	csp::registerAllObjectInterfaces();
+	for (unsigned i = 0; i < modules.size(); ++i) {
+		if (!csp::ModuleLoader::load(modules[i])) {
+			std::cerr << "unable to load module " << modules[i] << "\n";
+			return 1;
+		}
+	}
+
+	csp::DataCompiler compiler;
+	compiler.setThreads(threads);
+	compiler.setIncremental(!full);
+	if (!compiler.compile(source, archive)) {
+		std::cerr << "compile failed with " << compiler.numErrors() << " error(s)\n";
+		return 2;
+	}
+	std::cout << archive << ": built " << compiler.numBuilt() << ", reused " << compiler.numReused() << " objects\n";
+	return 0;
+}
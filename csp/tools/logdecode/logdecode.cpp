@@ -0,0 +1,68 @@
+/* Combat Simulator Project
+ * Copyright (C) 2007 The Combat Simulator Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+// Converts a binary log file written by the asynchronous logging backend
+// (see csplib/util/AsyncLog.h) to text.  Binary logging is enabled by
+// setting CSPLOG_ASYNC to the output path, or by LogStream::logToBinaryFile.
+//
+// usage: logdecode [--flags=N] logfile [output]
+//
+// The optional flags select the metadata written with each entry, as for
+// CSPLOG_FLAGS.  The default matches the standard text log.
+
+#include <csp/csplib/util/AsyncLog.h>
+#include <csp/csplib/util/LogStream.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char **argv) {
+	int flags = csp::LogStream::cPriority | csp::LogStream::cTimestamp | csp::LogStream::cLinestamp | csp::LogStream::cThread | csp::LogStream::cCategory;
+	int arg = 1;
+	if (arg < argc && strncmp(argv[arg], "--flags=", 8) == 0) {
+		flags = atoi(argv[arg] + 8);
+		++arg;
+	}
+	if (arg >= argc || argc - arg > 2) {
+		std::cerr << "usage: " << argv[0] << " [--flags=N] logfile [output]\n";
+		return 1;
+	}
+
+	std::ifstream input(argv[arg], std::ios::binary);
+	if (!input) {
+		std::cerr << "unable to open " << argv[arg] << "\n";
+		return 1;
+	}
+
+	std::ofstream file;
+	if (arg + 1 < argc) {
+		file.open(argv[arg + 1]);
+		if (!file) {
+			std::cerr << "unable to open " << argv[arg + 1] << "\n";
+			return 1;
+		}
+	}
+
+	if (!csp::AsyncLog::decode(input, file.is_open() ? file : std::cout, flags)) {
+		std::cerr << argv[arg] << ": not a binary log file, or truncated\n";
+		return 1;
+	}
+	return 0;
+}
@@ -23,6 +23,10 @@
 Converts data recorder output from the simulation to tab delimited text.
 The result can be imported into a spreadsheet or used as input to other
 tools to generate performance graphs.
+
+Both the original row oriented format and the columnar version 2 format
+are supported.  For version 2 recordings the --start and --end options
+use the block index to decode only part of the recording.
 """
 
 import math
@@ -45,12 +49,120 @@ def readbyte(f):
 def readdata(f):
 	return struct.unpack("If", f.read(8))
 
+def readvarint(f):
+	value = 0
+	shift = 0
+	while 1:
+		byte = readbyte(f)
+		value |= (byte & 0x7f) << shift
+		if byte < 0x80: return value
+		shift += 7
+
+
+V2_MAGIC = "CSPREC02"
+V2_INDEX_MAGIC = "CSPRECIX"
+
+class BlockReader:
+	"""Reads the fields of a version 2 block payload."""
+
+	def __init__(self, data):
+		self.data = bytearray(data)
+		self.pos = 0
+
+	def varint(self):
+		value = 0
+		shift = 0
+		while 1:
+			byte = self.data[self.pos]
+			self.pos += 1
+			value |= (byte & 0x7f) << shift
+			if byte < 0x80: return value
+			shift += 7
+
+	def byte(self):
+		self.pos += 1
+		return self.data[self.pos - 1]
+
+	def bytes(self):
+		n = self.varint()
+		self.pos += n
+		return self.data[self.pos - n:self.pos]
+
+	def varints(self, count):
+		reader = BlockReader(self.bytes())
+		return [reader.varint() for i in range(count)]
+
+	def floats(self, count):
+		return decodeValues(self.bytes(), count)
+
+
+class BitReader:
+	"""Reads bit fields packed most significant bit first."""
+
+	def __init__(self, data):
+		self.data = data
+		self.pos = 0
+
+	def read(self, n):
+		value = 0
+		for i in range(n):
+			pos = self.pos + i
+			value = (value << 1) | ((self.data[pos >> 3] >> (7 - (pos & 7))) & 1)
+		self.pos += n
+		return value
+
+
+def decodeValues(data, count):
+	"""Decodes xor compressed floats; see DataRecorder.cpp for the format."""
+	bits = BitReader(data)
+	values = []
+	last = 0
+	lead = trail = 0
+	for i in range(count):
+		if i > 0 and bits.read(1) == 0:
+			values.append(values[-1])
+			continue
+		if i > 0 and bits.read(1) == 0:
+			x = bits.read(32 - lead - trail) << trail
+		else:
+			if i == 0: bits.read(2)
+			lead = bits.read(5)
+			length = bits.read(5) + 1
+			trail = 32 - lead - length
+			x = bits.read(length) << trail
+		last = last ^ x
+		values.append(struct.unpack("<f", struct.pack("<I", last))[0])
+	return values
+
 
 class RecorderConverter:
 	def __init__(self):
 		self.header = ""
 
-	def convert(self, f):
+	def convert(self, f, start=None, end=None):
+		magic = f.read(8)
+		if magic == V2_MAGIC:
+			self.convertV2(f, start, end)
+		else:
+			self.convertV1(f)
+		n = len(self.channels)
+		self.min_time = 1e+10
+		self.max_time = -1e+10
+		self.min_data = [1e+10] * n
+		self.max_data = [-1e+10] * n
+		for timestamp, set in self.output:
+			if timestamp < 0: continue
+			self.min_time = min(self.min_time, timestamp)
+			self.max_time = max(self.max_time, timestamp)
+			for i in range(n):
+				self.min_data[i] = min(self.min_data[i], set[i])
+				self.max_data[i] = max(self.max_data[i], set[i])
+		for i in range(n):
+			if self.min_data[i] > self.max_data[i]:
+				self.min_data[i] = 0.0
+				self.max_data[i] = 0.0
+
+	def convertV1(self, f):
 		f.seek(-4, 2)
 		f.seek(readint(f), 0)
 		n = readint(f)
@@ -61,15 +173,7 @@ class RecorderConverter:
 			name = name[0:name.find("\0")]
 			channels.append(name)
 		n = len(channels)
-		self.set = set = range(n)
-		self.min_time = 1e+10
-		self.max_time = -1e+10
-		self.min_data = range(n)
-		self.max_data = range(n)
-		for i in range(n):
-			set[i] = 0.0
-			self.min_data[i] = 1e+10
-			self.max_data[i] = -1e+10
+		set = [0.0] * n
 		self.time = -1.0
 		f.seek(0, 0)
 		while 1:
@@ -80,16 +184,56 @@ class RecorderConverter:
 			if type == 250:
 				output.append((self.time, set[:]))
 				self.time = value
-				self.min_time = min(self.min_time, self.time)
-				self.max_time = max(self.max_time, self.time)
 			if type < n:
 				set[type] = value
-				self.min_data[type] = min(self.min_data[type], value)
-				self.max_data[type] = max(self.max_data[type], value)
-		for i in range(n):
-			if self.min_data[i] > self.max_data[i]:
-				self.min_data[i] = 0.0
-				self.max_data[i] = 0.0
+
+	def readIndex(self, f):
+		f.seek(-16, 2)
+		offset = struct.unpack("<Q", f.read(8))[0]
+		if f.read(8) != V2_INDEX_MAGIC:
+			raise IOError("recording was not closed properly (missing index)")
+		f.seek(offset, 0)
+		channels = []
+		for i in range(struct.unpack("<I", f.read(4))[0]):
+			channels.append(f.read(readvarint(f)))
+		count = struct.unpack("<I", f.read(4))[0]
+		blocks = [struct.unpack("<QffI", f.read(20)) for i in range(count)]
+		return channels, blocks
+
+	def convertV2(self, f, start, end):
+		self.channels, blocks = self.readIndex(f)
+		self.output = output = []
+		n = len(self.channels)
+		set = [0.0] * n
+		for offset, block_start, block_end, samples in blocks:
+			# blocks are self-contained, so any block outside the requested
+			# time range can be skipped.
+			if start is not None and block_end < start: continue
+			if end is not None and block_start > end: break
+			f.seek(offset, 0)
+			samples, size = struct.unpack("<II", f.read(8))
+			block = BlockReader(f.read(size))
+			times = block.floats(samples)
+			for i in range(block.varint()):
+				block.varint()
+				block.byte()
+			changes = [[] for i in range(samples)]
+			for i in range(block.varint()):
+				channel = block.varint()
+				count = block.varint()
+				gaps = block.varints(count)
+				values = block.floats(count)
+				sample = 0
+				for gap, value in zip(gaps, values):
+					sample += gap
+					if channel < n: changes[sample].append((channel, value))
+					sample += 1
+			for timestamp, change in zip(times, changes):
+				for channel, value in change:
+					set[channel] = value
+				if start is not None and timestamp < start: continue
+				if end is not None and timestamp > end: break
+				output.append((timestamp, set[:]))
 
 
 	def dumpTab(self):
@@ -215,7 +359,10 @@ def main(args):
 
 	converter = RecorderConverter()
 	converter.setHeader(header)
-	converter.convert(file)
+	start = end = None
+	if options.start is not None: start = float(options.start)
+	if options.end is not None: end = float(options.end)
+	converter.convert(file, start, end)
 
 	if options.jgraph:
 		converter.dumpJGraph()
@@ -226,5 +373,7 @@ def main(args):
 if __name__ == '__main__':
 	csp.base.app.addOption('--jgraph', action='store_true', default=0, help='Generate jgraph commands')
 	csp.base.app.addOption('--header', metavar='HEADER', default=None, help='File to prepend to the output')
+	csp.base.app.addOption('--start', metavar='TIME', default=None, help='Skip data recorded before TIME (version 2 recordings)')
+	csp.base.app.addOption('--end', metavar='TIME', default=None, help='Skip data recorded after TIME (version 2 recordings)')
 	csp.base.app.addOption('--set', metavar='KEY:VAL', action='append', default=[], help='Add header substitution for $KEY')
 	csp.base.app.start()